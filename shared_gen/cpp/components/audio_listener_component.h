@@ -8,6 +8,7 @@ class AudioListenerComponent final : public Halley::Component {
 public:
 	static constexpr int componentIndex{ 6 };
 	static const constexpr char* componentName{ "AudioListener" };
+	static constexpr bool prefabTemplateCopy{ true };
 
 	float referenceDistance{ 500 };
 
@@ -8,6 +8,7 @@ class CameraComponent final : public Halley::Component {
 public:
 	static constexpr int componentIndex{ 4 };
 	static const constexpr char* componentName{ "Camera" };
+	static constexpr bool prefabTemplateCopy{ true };
 
 	float zoom{ 1 };
 	std::optional<Halley::Colour4f> clearColour{};
@@ -8,6 +8,7 @@ class Transform2DComponentBase : public Halley::Component {
 public:
 	static constexpr int componentIndex{ 0 };
 	static const constexpr char* componentName{ "Transform2D" };
+	static constexpr bool prefabTemplateCopy{ true };
 
 	Transform2DComponentBase() {
 	}
@@ -6,7 +6,8 @@
 namespace Halley
 {
 	class ResourceLoader;
-	class VorbisData;
+	class ResourceDataStream;
+	class AudioClipStreamer;
 
 	class IAudioClip
 	{
@@ -14,10 +15,14 @@ namespace Halley
 		virtual ~IAudioClip() = default;
 
 		virtual size_t copyChannelData(size_t channelN, size_t pos, size_t len, gsl::span<AudioConfig::SampleFormat> dst) const = 0;
+		virtual void skipChannelData(size_t channelN, size_t pos, size_t len) const {} // Only clips that consume data as it's copied need to do anything here
 		virtual uint8_t getNumberOfChannels() const = 0;
 		virtual size_t getLength() const = 0; // in samples
 		virtual size_t getLoopPoint() const { return 0; } // in samples
 		virtual bool isLoaded() const { return true; }
+
+		// Clips that are decoded while they play return a new streamer for each voice, which must be used instead of copyChannelData
+		virtual std::shared_ptr<AudioClipStreamer> makeStreamer(bool looping) const { return {}; }
 	};
 
 	class AudioClip final : public AsyncResource, public IAudioClip
@@ -36,6 +41,8 @@ namespace Halley
 		size_t getLength() const override; // in samples
 		size_t getLoopPoint() const override; // in samples
 		bool isLoaded() const override;
+		std::shared_ptr<AudioClipStreamer> makeStreamer(bool looping) const override;
+		size_t getMemoryUsage() const override;
 
 		static std::shared_ptr<AudioClip> loadResource(ResourceLoader& loader);
 		constexpr static AssetType getAssetType() { return AssetType::AudioClip; }
@@ -44,15 +51,11 @@ namespace Halley
 	private:
 		size_t sampleLength = 0;
 		size_t loopPoint = 0;
-		mutable size_t streamPos = 0;
 		uint8_t numChannels = 0;
 		bool streaming = false;
 
-		// TODO: sort this mess?
-		mutable std::vector<std::vector<AudioConfig::SampleFormat>> temp0;
-		mutable std::vector<std::vector<AudioConfig::SampleFormat>> temp1;
-		mutable std::vector<std::vector<AudioConfig::SampleFormat>> samples;
-		mutable std::unique_ptr<VorbisData> vorbisData;
+		std::vector<std::vector<AudioConfig::SampleFormat>> samples;
+		std::shared_ptr<ResourceDataStream> streamData;
 	};
 
 	class StreamingAudioClip final : public IAudioClip
@@ -63,6 +66,7 @@ namespace Halley
 		void addInterleavedSamples(gsl::span<const AudioConfig::SampleFormat> src);
 
 		size_t copyChannelData(size_t channelN, size_t pos, size_t len, gsl::span<AudioConfig::SampleFormat> dst) const override;
+		void skipChannelData(size_t channelN, size_t pos, size_t len) const override;
 		uint8_t getNumberOfChannels() const override;
 		size_t getLength() const override;
 		size_t getSamplesLeft() const;
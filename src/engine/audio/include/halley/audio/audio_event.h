@@ -85,6 +85,7 @@ namespace Halley
 		Range<float> volume;
 		float delay = 0.0f;
 		float minimumSpace = 0.0f;
+		int priority = 0;
 		bool loop = false;
 		std::optional<AudioDynamicsConfig> dynamics;
 	};
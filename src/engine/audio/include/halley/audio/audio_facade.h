@@ -47,6 +47,7 @@ namespace Halley {
 
 	    void setOutputChannels(std::vector<AudioChannelData> audioChannelData) override;
 	    void setListener(AudioListenerData listener) override;
+		void setMaxRealVoices(size_t maxVoices) override;
 
 		void setGlobalVariable(const String& variable, float value) override;
 
@@ -56,6 +57,7 @@ namespace Halley {
 		void onResume() override;
 
 		int64_t getLastTimeElapsed() const override;
+		size_t getStreamUnderruns() const override;
 		std::optional<AudioSpec> getAudioSpec() const override;
     	
     private:
@@ -13,7 +13,13 @@ namespace Halley
 		virtual ~AudioSource() {}
 
 		virtual uint8_t getNumberOfChannels() const = 0;
+		// Checked before the voice starts, and again before it reads after skipping, so a source can catch up first
 		virtual bool isReady() const { return true; }
 		virtual bool getAudioData(size_t numSamples, AudioSourceData& dst) = 0;
+
+		// Advances playback as if getAudioData had been called, without producing any samples.
+		// Used while the voice playing this source is virtualised, so it can resume from the right place.
+		// The default renders the samples and discards them, override it if the source can do better.
+		virtual bool skipAudioData(size_t numSamples);
 	};
 }
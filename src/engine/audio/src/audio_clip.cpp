@@ -1,4 +1,5 @@
 #include "audio_clip.h"
+#include "audio_clip_streamer.h"
 #include "halley/resources/resource_data.h"
 #include "vorbis_dec.h"
 #include "halley/resources/metadata.h"
@@ -24,13 +25,10 @@ AudioClip& AudioClip::operator=(AudioClip&& other) noexcept
 	sampleLength = other.sampleLength;
 	numChannels = other.numChannels;
 	loopPoint = other.loopPoint;
-	streamPos = other.streamPos;
 	streaming = other.streaming;
 
-	temp0 = std::move(other.temp0);
-	temp1 = std::move(other.temp1);
 	samples = std::move(other.samples);
-	vorbisData = std::move(other.vorbisData);
+	streamData = std::move(other.streamData);
 
 	doneLoading();
 
@@ -60,58 +58,28 @@ void AudioClip::loadFromStatic(std::shared_ptr<ResourceDataStatic> data, Metadat
 
 void AudioClip::loadFromStream(std::shared_ptr<ResourceDataStream> data, Metadata metadata)
 {
-	vorbisData = std::make_unique<VorbisData>(data);
-	uint8_t nChannels = vorbisData->getNumChannels();
-	if (vorbisData->getSampleRate() != AudioConfig::sampleRate) {
+	// Only read the header here, each voice playing this gets its own decoder (see makeStreamer)
+	VorbisData vorbis(data);
+	if (vorbis.getSampleRate() != AudioConfig::sampleRate) {
 		throw Exception("Sound clip should be " + toString(AudioConfig::sampleRate) + " Hz.", HalleyExceptions::AudioEngine);
 	}
-	
-	samples.resize(nChannels);
-	numChannels = nChannels;
-	sampleLength = vorbisData->getNumSamples();
+	numChannels = vorbis.getNumChannels();
+	sampleLength = vorbis.getNumSamples();
 	loopPoint = metadata.getInt("loopPoint", 0);
-	streamPos = 0;
 	streaming = true;
+	vorbis.close();
+
+	streamData = std::move(data);
 	doneLoading();
 }
 
 size_t AudioClip::copyChannelData(size_t channelN, size_t pos, size_t len, gsl::span<AudioConfig::SampleFormat> dst) const
 {
 	Expects(pos + len <= sampleLength);
+	Expects(!streaming); // Streaming clips are read through their AudioClipStreamer
 
-	if (streaming) {
-		auto& temp = pos == 0 ? temp0 : temp1; // pos == 0 has a different buffer because if it loops around, it will be used together with another buffer
-		if (temp.size() != numChannels) {
-			temp.resize(numChannels);
-		}
-
-		if (channelN == 0) { // TODO: this assumes the channels will be read in order. This will break threading.
-			if (pos != streamPos) {
-				vorbisData->seek(pos);
-				streamPos = pos;
-			}
-
-			size_t toRead = len;
-			for (size_t i = 0; i < numChannels; ++i) {
-				if (temp[i].size() < toRead) {
-					temp[i].resize(toRead);
-				}
-			}
-			vorbisData->read(temp);
-			streamPos += len;
-		}
-
-		auto& buf = samples.at(channelN);
-		if (buf.size() < len) {
-			buf.resize(len);
-		}
-
-		memcpy(dst.data(), temp[channelN].data(), len * sizeof(AudioConfig::SampleFormat));
-		return len;
-	} else {
-		memcpy(dst.data(), samples.at(channelN).data() + pos, len * sizeof(AudioConfig::SampleFormat));
-		return len;
-	}
+	memcpy(dst.data(), samples.at(channelN).data() + pos, len * sizeof(AudioConfig::SampleFormat));
+	return len;
 }
 
 size_t AudioClip::getLength() const
@@ -136,6 +104,24 @@ bool AudioClip::isLoaded() const
 	return AsyncResource::isLoaded();
 }
 
+std::shared_ptr<AudioClipStreamer> AudioClip::makeStreamer(bool looping) const
+{
+	Expects(isLoaded());
+	if (!streaming) {
+		return {};
+	}
+	return std::make_shared<AudioClipStreamer>(streamData, numChannels, sampleLength, loopPoint, looping);
+}
+
+size_t AudioClip::getMemoryUsage() const
+{
+	// Streaming clips only hold on to their stream, each voice decodes into its own AudioClipStreamer
+	if (streaming || !isLoaded()) {
+		return 0;
+	}
+	return sampleLength * numChannels * sizeof(AudioConfig::SampleFormat);
+}
+
 std::shared_ptr<AudioClip> AudioClip::loadResource(ResourceLoader& loader)
 {
 	auto meta = loader.getMeta();
@@ -204,6 +190,14 @@ size_t StreamingAudioClip::copyChannelData(size_t channelN, size_t pos, size_t l
 	return len;
 }
 
+void StreamingAudioClip::skipChannelData(size_t channelN, size_t pos, size_t len) const
+{
+	std::unique_lock<std::mutex> lock(mutex);
+
+	auto& buffer = buffers[channelN];
+	buffer.erase(buffer.begin(), buffer.begin() + std::min(len, buffer.size()));
+}
+
 uint8_t StreamingAudioClip::getNumberOfChannels() const
 {
 	return numChannels;
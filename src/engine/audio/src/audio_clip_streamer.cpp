@@ -0,0 +1,220 @@
+#include "audio_clip_streamer.h"
+#include "vorbis_dec.h"
+#include "halley/resources/resource_data.h"
+#include "halley/concurrency/concurrent.h"
+#include "halley/support/logger.h"
+
+using namespace Halley;
+
+namespace {
+	constexpr size_t ringSize = AudioConfig::sampleRate / 2;
+	constexpr size_t chunkSize = 4096;
+}
+
+std::atomic<size_t> AudioClipStreamer::totalUnderruns(0);
+
+AudioClipStreamer::AudioClipStreamer(std::shared_ptr<ResourceDataStream> data, uint8_t numChannels, size_t length, size_t loopPoint, bool looping)
+	: data(std::move(data))
+	, numChannels(numChannels)
+	, length(length)
+	, loopPoint(loopPoint)
+	, looping(looping && loopPoint < length)
+{
+	ring.resize(numChannels);
+	for (auto& channel: ring) {
+		channel.resize(ringSize);
+	}
+	decodeBuffer.resize(numChannels);
+	decodeEnded = length == 0;
+}
+
+AudioClipStreamer::~AudioClipStreamer() = default;
+
+bool AudioClipStreamer::isReady()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	const bool ready = started && (decodeEnded || ringCount >= chunkSize);
+	started = true;
+	skipping = false;
+	resuming = true;
+	scheduleDecoding(lock);
+	return ready;
+}
+
+bool AudioClipStreamer::read(size_t pos, size_t len, gsl::span<const gsl::span<AudioConfig::SampleFormat>> dst)
+{
+	Expects(size_t(dst.size()) >= numChannels);
+
+	std::unique_lock<std::mutex> lock(mutex);
+	skipping = false;
+	resuming = false;
+	const size_t nRead = consume(pos, len, dst);
+	if (nRead < len) {
+		for (size_t i = 0; i < numChannels; ++i) {
+			memset(dst[i].data() + nRead, 0, (len - nRead) * sizeof(AudioConfig::SampleFormat));
+		}
+		// Coming up short while catching up after starting or skipping is expected, it's not the decoder falling behind
+		if (caughtUp) {
+			++underruns;
+			++totalUnderruns;
+		}
+	}
+	caughtUp = caughtUp || nRead == len;
+	scheduleDecoding(lock);
+	return nRead == len;
+}
+
+void AudioClipStreamer::skip(size_t pos, size_t len)
+{
+	// Nobody is listening, so just keep track of the position, unless the voice is waiting for isReady to resume
+	std::unique_lock<std::mutex> lock(mutex);
+	skipping = !resuming;
+	resuming = false;
+	caughtUp = false;
+	consume(pos, len, {});
+	scheduleDecoding(lock);
+}
+
+size_t AudioClipStreamer::getUnderruns() const
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	return underruns;
+}
+
+size_t AudioClipStreamer::getTotalUnderruns()
+{
+	return totalUnderruns.load();
+}
+
+size_t AudioClipStreamer::consume(size_t pos, size_t len, gsl::span<const gsl::span<AudioConfig::SampleFormat>> dst)
+{
+	if (pos != ringPos) {
+		// Playback jumped somewhere we haven't decoded
+		reposition(pos);
+	}
+
+	const size_t n = std::min(len, ringCount);
+	if (!dst.empty()) {
+		const size_t firstPart = std::min(n, ringSize - ringStart);
+		for (size_t i = 0; i < numChannels; ++i) {
+			memcpy(dst[i].data(), ring[i].data() + ringStart, firstPart * sizeof(AudioConfig::SampleFormat));
+			memcpy(dst[i].data() + firstPart, ring[i].data(), (n - firstPart) * sizeof(AudioConfig::SampleFormat));
+		}
+	}
+	ringStart = (ringStart + n) % ringSize;
+	ringCount -= n;
+	ringPos = advance(ringPos, n);
+
+	if (n < len) {
+		// Whatever was missing is lost, but make sure we stay in sync with playback
+		reposition(advance(pos, len));
+	}
+
+	return n;
+}
+
+void AudioClipStreamer::reposition(size_t pos)
+{
+	ringStart = 0;
+	ringCount = 0;
+	ringPos = pos;
+	decodePos = pos;
+	decodeEnded = pos >= length;
+	++generation;
+}
+
+size_t AudioClipStreamer::advance(size_t pos, size_t n) const
+{
+	// Same as AudioSourceClip, which never reads across the end of the clip
+	pos += n;
+	if (pos >= length && looping) {
+		pos = loopPoint + (pos - length);
+	}
+	return pos;
+}
+
+bool AudioClipStreamer::needsDecoding() const
+{
+	return !skipping && !decodeEnded && ringSize - ringCount >= chunkSize;
+}
+
+void AudioClipStreamer::scheduleDecoding(std::unique_lock<std::mutex>& lock)
+{
+	if (!decoding && started && needsDecoding()) {
+		decoding = true;
+		lock.unlock();
+		Concurrent::execute(Executors::getDiskIO(), [self = shared_from_this()] ()
+		{
+			self->decode();
+		});
+	}
+}
+
+void AudioClipStreamer::decode()
+{
+	try {
+		decodeChunks();
+	} catch (const std::exception& e) {
+		Logger::logException(e);
+		std::unique_lock<std::mutex> lock(mutex);
+		decodeEnded = true;
+		decoding = false;
+	}
+}
+
+void AudioClipStreamer::decodeChunks()
+{
+	if (!vorbis) {
+		vorbis = std::make_unique<VorbisData>(data);
+		vorbisPos = 0;
+	}
+
+	while (true) {
+		size_t pos;
+		size_t toDecode;
+		uint32_t decodeGeneration;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			if (!needsDecoding()) {
+				decoding = false;
+				return;
+			}
+			pos = decodePos;
+			toDecode = std::min(chunkSize, length - pos);
+			decodeGeneration = generation;
+		}
+
+		// Decode without holding the lock, so the audio thread is never kept waiting on this
+		if (pos != vorbisPos) {
+			vorbis->seek(pos);
+			vorbisPos = pos;
+		}
+		for (auto& channel: decodeBuffer) {
+			channel.resize(toDecode);
+		}
+		const size_t nDecoded = vorbis->read(decodeBuffer);
+		vorbisPos += nDecoded;
+
+		std::unique_lock<std::mutex> lock(mutex);
+		if (decodeGeneration != generation) {
+			// Playback jumped while we were decoding, so this is no good
+			continue;
+		}
+
+		const size_t writeStart = (ringStart + ringCount) % ringSize;
+		const size_t firstPart = std::min(nDecoded, ringSize - writeStart);
+		for (size_t i = 0; i < numChannels; ++i) {
+			memcpy(ring[i].data() + writeStart, decodeBuffer[i].data(), firstPart * sizeof(AudioConfig::SampleFormat));
+			memcpy(ring[i].data(), decodeBuffer[i].data() + firstPart, (nDecoded - firstPart) * sizeof(AudioConfig::SampleFormat));
+		}
+		ringCount += nDecoded;
+
+		if (nDecoded < toDecode) {
+			// The stream is shorter than advertised, treat it as the end of the clip
+			decodePos = advance(pos, length - pos);
+		} else {
+			decodePos = advance(pos, nDecoded);
+		}
+		decodeEnded = decodePos >= length;
+	}
+}
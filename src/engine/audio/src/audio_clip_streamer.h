@@ -0,0 +1,76 @@
+#pragma once
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <gsl/gsl>
+#include "halley/core/api/audio_api.h"
+
+namespace Halley
+{
+	class ResourceDataStream;
+	class VorbisData;
+
+	// Decodes a streamed clip ahead of playback for a single voice, on the disk IO executor.
+	// The audio thread only ever copies out of the ring buffer; if the samples it wants haven't been decoded yet,
+	// it gets silence instead and an underrun is counted, so a slow disk or decoder never holds up the mix.
+	class AudioClipStreamer final : public std::enable_shared_from_this<AudioClipStreamer>
+	{
+	public:
+		AudioClipStreamer(std::shared_ptr<ResourceDataStream> data, uint8_t numChannels, size_t length, size_t loopPoint, bool looping);
+		~AudioClipStreamer();
+
+		// Starts (or, after skipping, resumes) decoding, and returns true once enough has been buffered to play.
+		// Call this before playing the first sample, and before reading again after a skip.
+		bool isReady();
+
+		// pos and len are the same as would be passed to IAudioClip::copyChannelData, but for all channels at once.
+		// Returns false if the samples weren't decoded in time, in which case dst is filled with silence.
+		// That only counts as an underrun once playback has caught up after starting or skipping.
+		bool read(size_t pos, size_t len, gsl::span<const gsl::span<AudioConfig::SampleFormat>> dst);
+
+		// Advances playback without decoding anything further, unless isReady was called since the last skip
+		void skip(size_t pos, size_t len);
+
+		size_t getUnderruns() const;
+		static size_t getTotalUnderruns();
+
+	private:
+		const std::shared_ptr<ResourceDataStream> data;
+		const uint8_t numChannels;
+		const size_t length;
+		const size_t loopPoint;
+		const bool looping;
+
+		// Only touched by the decoding job, of which there's at most one at a time
+		std::unique_ptr<VorbisData> vorbis;
+		std::vector<std::vector<AudioConfig::SampleFormat>> decodeBuffer;
+		size_t vorbisPos = 0;
+
+		// Everything below is guarded by mutex
+		mutable std::mutex mutex;
+		std::vector<std::vector<AudioConfig::SampleFormat>> ring;
+		size_t ringStart = 0;
+		size_t ringCount = 0;
+		size_t ringPos = 0; // Position in the clip of the sample at ringStart
+		size_t decodePos = 0; // Position in the clip of the next sample to be decoded
+		uint32_t generation = 0; // Bumped whenever playback jumps, so an in-flight decode knows to discard its results
+		bool decoding = false;
+		bool decodeEnded = false;
+		bool started = false;
+		bool skipping = false; // Stops decoding while the voice isn't being heard
+		bool resuming = false; // Set by isReady, so skipping keeps decoding while the voice waits to be heard again
+		bool caughtUp = false; // Whether a read has been served in full since starting or skipping
+		size_t underruns = 0;
+
+		static std::atomic<size_t> totalUnderruns;
+
+		size_t consume(size_t pos, size_t len, gsl::span<const gsl::span<AudioConfig::SampleFormat>> dst);
+		void reposition(size_t pos);
+		size_t advance(size_t pos, size_t n) const;
+		bool needsDecoding() const;
+		void scheduleDecoding(std::unique_lock<std::mutex>& lock);
+		void decode();
+		void decodeChunks();
+	};
+}
@@ -268,6 +268,11 @@ void AudioEngine::setGroupGain(const String& name, float gain)
 	groupGains[getGroupId(name)] = gain;
 }
 
+void AudioEngine::setMaxRealVoices(size_t maxVoices)
+{
+	maxRealVoices = maxVoices;
+}
+
 void AudioEngine::mixEmitters(size_t numSamples, size_t nChannels, gsl::span<AudioBuffer*> buffers)
 {
 	// Clear buffers
@@ -275,21 +280,59 @@ void AudioEngine::mixEmitters(size_t numSamples, size_t nChannels, gsl::span<Aud
 		clearBuffer(buffers[i]->packs);
 	}
 
-	// Mix every emitter
+	// Update every emitter
 	for (auto& e: emitters) {
 		// Start playing if necessary
 		if (!e->isPlaying() && !e->isDone() && e->isReady()) {
 			e->start();
 		}
 
-		// Mix it in!
 		if (e->isPlaying()) {
 			e->update(channels, listener, masterGain * getGroupGain(e->getGroup()));
+		}
+	}
+
+	virtualiseVoices();
+
+	// Mix it in!
+	for (auto& e: emitters) {
+		if (e->isPlaying()) {
 			e->mixTo(numSamples, buffers, *mixer, *pool);
 		}
 	}
 }
 
+void AudioEngine::virtualiseVoices()
+{
+	// Inaudible voices don't decode anything anyway, so they don't count towards the limit
+	audibleVoices.clear();
+	for (auto& e: emitters) {
+		if (e->isPlaying()) {
+			if (e->getAudibility() >= 0.0001f) {
+				audibleVoices.push_back(e.get());
+			} else {
+				e->setVirtual(false);
+			}
+		}
+	}
+
+	if (audibleVoices.size() > maxRealVoices) {
+		// Voices that are already real get a bit of an edge, so that two voices of similar volume don't keep swapping (and fading) every buffer
+		const auto getScore = [] (const AudioVoice* v) { return v->getAudibility() * (v->isVirtual() ? 1.0f : 1.25f); };
+		std::nth_element(audibleVoices.begin(), audibleVoices.begin() + maxRealVoices, audibleVoices.end(), [&] (const AudioVoice* a, const AudioVoice* b)
+		{
+			if (a->getPriority() != b->getPriority()) {
+				return a->getPriority() > b->getPriority();
+			}
+			return getScore(a) > getScore(b);
+		});
+	}
+
+	for (size_t i = 0; i < audibleVoices.size(); ++i) {
+		audibleVoices[i]->setVirtual(i >= maxRealVoices);
+	}
+}
+
 void AudioEngine::removeFinishedEmitters()
 {
 	for (auto& e: emitters) {
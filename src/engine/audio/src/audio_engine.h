@@ -45,6 +45,7 @@ namespace Halley {
 
 		void setMasterGain(float gain);
 		void setGroupGain(const String& name, float gain);
+		void setMaxRealVoices(size_t maxVoices);
 		int getGroupId(const String& group);
 
     	void setVariable(const String& name, float value);
@@ -66,6 +67,8 @@ namespace Halley {
 		std::atomic<bool> needsBuffer;
 
 		std::vector<std::unique_ptr<AudioVoice>> emitters;
+		std::vector<AudioVoice*> audibleVoices;
+		size_t maxRealVoices = AudioConfig::maxVoices;
 		std::vector<AudioChannelData> channels;
 		
 		std::map<uint32_t, std::vector<AudioVoice*>> idToSource;
@@ -83,6 +86,7 @@ namespace Halley {
     	std::vector<uint32_t> finishedSounds;
 
 		void mixEmitters(size_t numSamples, size_t channels, gsl::span<AudioBuffer*> buffers);
+		void virtualiseVoices();
 	    void removeFinishedEmitters();
 		void clearBuffer(gsl::span<AudioSamplePack> dst);
 		void queueAudioFloat(gsl::span<const float> data);
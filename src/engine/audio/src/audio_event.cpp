@@ -115,6 +115,7 @@ AudioEventActionPlay::AudioEventActionPlay(AudioEvent& event, const ConfigNode&
 
 	minimumSpace = node["minimumSpace"].asFloat(0.0f);
 	delay = node["delay"].asFloat(0.0f);
+	priority = node["priority"].asInt(0);
 	loop = node["loop"].asBool(false);
 
 	if (node.hasKey("dynamics")) {
@@ -150,6 +151,7 @@ bool AudioEventActionPlay::run(AudioEngine& engine, uint32_t id, const AudioPosi
 	}
 
 	auto voice = std::make_unique<AudioVoice>(source, position, curVolume, engine.getGroupId(group));
+	voice->setPriority(priority);
 	if (dynamics) {
 		voice->addBehaviour(std::make_unique<AudioVoiceDynamicsBehaviour>(dynamics.value(), engine));
 	}
@@ -171,6 +173,7 @@ void AudioEventActionPlay::serialize(Serializer& s) const
 	s << volume;
 	s << delay;
 	s << minimumSpace;
+	s << priority;
 	s << loop;
 	s << dynamics;
 }
@@ -183,6 +186,7 @@ void AudioEventActionPlay::deserialize(Deserializer& s)
 	s >> volume;
 	s >> delay;
 	s >> minimumSpace;
+	s >> priority;
 	s >> loop;
 	s >> dynamics;
 }
@@ -1,5 +1,6 @@
 #include "audio_facade.h"
 #include "audio_engine.h"
+#include "audio_clip_streamer.h"
 #include "audio_handle_impl.h"
 #include "behaviours/audio_voice_behaviour.h"
 #include "halley/support/console.h"
@@ -153,6 +154,11 @@ int64_t AudioFacade::getLastTimeElapsed() const
 	return engine->getLastTimeElapsed();
 }
 
+size_t AudioFacade::getStreamUnderruns() const
+{
+	return AudioClipStreamer::getTotalUnderruns();
+}
+
 std::optional<AudioSpec> AudioFacade::getAudioSpec() const
 {
 	return running ? audioSpec : std::optional<AudioSpec>();
@@ -242,6 +248,13 @@ void AudioFacade::setGroupVolume(const String& groupName, float volume)
 	});
 }
 
+void AudioFacade::setMaxRealVoices(size_t maxVoices)
+{
+	enqueue([=] () {
+		engine->setMaxRealVoices(maxVoices);
+	});
+}
+
 void AudioFacade::setOutputChannels(std::vector<AudioChannelData> audioChannelData)
 {
 	enqueue([=, audioChannelData = std::move(audioChannelData)] () mutable
@@ -22,3 +22,8 @@ bool AudioFilterBiquad::getAudioData(size_t numSamples, AudioSourceData& dst)
 	// TODO
 	return src->getAudioData(numSamples, dst);
 }
+
+bool AudioFilterBiquad::skipAudioData(size_t numSamples)
+{
+	return src->skipAudioData(numSamples);
+}
@@ -69,3 +69,22 @@ bool AudioFilterResample::getAudioData(size_t numSamples, AudioSourceData& dstBu
 
 	return playing;
 }
+
+bool AudioFilterResample::skipAudioData(size_t numSamples)
+{
+	// Leftovers have already been resampled, so they're consumed first
+	const size_t nChannels = source->getNumberOfChannels();
+	const size_t nLeftOver = std::min(leftoverSamples[0].n, numSamples);
+	for (size_t channel = 0; channel < nChannels; ++channel) {
+		auto& leftOver = leftoverSamples[channel];
+		for (size_t i = nLeftOver; i < leftOver.n; ++i) {
+			leftOver.samples[i - nLeftOver] = leftOver.samples[i];
+		}
+		leftOver.n -= nLeftOver;
+	}
+
+	// Keep track of the fractional part, otherwise long stretches of skipping would drift
+	const size_t numSamplesSrc = (numSamples - nLeftOver) * size_t(fromHz) + skipRemainder;
+	skipRemainder = numSamplesSrc % size_t(toHz);
+	return source->skipAudioData(numSamplesSrc / size_t(toHz));
+}
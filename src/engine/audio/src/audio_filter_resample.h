@@ -13,6 +13,7 @@ namespace Halley
 		uint8_t getNumberOfChannels() const override;
 		bool isReady() const override;
 		bool getAudioData(size_t numSamples, AudioSourceData& dst) override;
+		bool skipAudioData(size_t numSamples) override;
 
 	private:
 		AudioBufferPool& pool;
@@ -20,6 +21,7 @@ namespace Halley
 		std::vector<std::unique_ptr<AudioResampler>> resamplers;
 		int fromHz;
 		int toHz;
+		size_t skipRemainder = 0; // Fraction of a source sample (in 1/toHz units) owed by previous skips
 
 		struct LeftOverData
 		{
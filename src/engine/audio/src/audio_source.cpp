@@ -0,0 +1,19 @@
+#include "audio_source.h"
+#include <vector>
+
+using namespace Halley;
+
+bool AudioSource::skipAudioData(size_t numSamples)
+{
+	// Sources that can't seek just render as usual and throw it away
+	static thread_local std::vector<AudioConfig::SampleFormat> scratch;
+
+	const size_t nChannels = getNumberOfChannels();
+	scratch.resize(numSamples * nChannels);
+
+	AudioSourceData dst;
+	for (size_t i = 0; i < nChannels; ++i) {
+		dst[i] = gsl::span<AudioConfig::SampleFormat>(scratch.data() + i * numSamples, numSamples);
+	}
+	return getAudioData(numSamples, dst);
+}
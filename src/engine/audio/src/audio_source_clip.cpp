@@ -1,6 +1,7 @@
 #include "audio_source_clip.h"
 #include <utility>
 #include "audio_clip.h"
+#include "audio_clip_streamer.h"
 
 using namespace Halley;
 
@@ -20,15 +21,19 @@ uint8_t AudioSourceClip::getNumberOfChannels() const
 
 bool AudioSourceClip::isReady() const
 {
-	return clip->isLoaded();
+	if (!clip->isLoaded()) {
+		return false;
+	}
+	if (!initialised) {
+		streamer = clip->makeStreamer(looping);
+		initialised = true;
+	}
+	return !streamer || streamer->isReady();
 }
 
 bool AudioSourceClip::getAudioData(size_t samplesRequested, AudioSourceData& dstChannels)
 {
-	Expects(isReady());
-	if (!initialised) {
-		initialised = true;
-	}
+	Expects(initialised);
 	const auto playbackLength = int64_t(clip->getLength());
 
 	bool isPlaying = true;
@@ -71,10 +76,18 @@ bool AudioSourceClip::getAudioData(size_t samplesRequested, AudioSourceData& dst
 
 		if (samplesToRead > 0) {
 			// We have some samples that we can read, so go ahead with reading them
-			for (size_t srcChannel = 0; srcChannel < nChannels; ++srcChannel) {
-				auto dst = gsl::span<AudioConfig::SampleFormat>(dstChannels[srcChannel].data() + samplesWritten, samplesToRead);
-				size_t nCopied = clip->copyChannelData(srcChannel, size_t(playbackPos), samplesToRead, dst);
-				Expects(nCopied <= samplesRequested * sizeof(AudioConfig::SampleFormat));
+			if (streamer) {
+				std::array<gsl::span<AudioConfig::SampleFormat>, AudioConfig::maxChannels> dsts;
+				for (size_t srcChannel = 0; srcChannel < nChannels; ++srcChannel) {
+					dsts[srcChannel] = gsl::span<AudioConfig::SampleFormat>(dstChannels[srcChannel].data() + samplesWritten, samplesToRead);
+				}
+				streamer->read(size_t(playbackPos), samplesToRead, gsl::span<const gsl::span<AudioConfig::SampleFormat>>(dsts.data(), nChannels));
+			} else {
+				for (size_t srcChannel = 0; srcChannel < nChannels; ++srcChannel) {
+					auto dst = gsl::span<AudioConfig::SampleFormat>(dstChannels[srcChannel].data() + samplesWritten, samplesToRead);
+					size_t nCopied = clip->copyChannelData(srcChannel, size_t(playbackPos), samplesToRead, dst);
+					Expects(nCopied <= samplesRequested * sizeof(AudioConfig::SampleFormat));
+				}
 			}
 
 			playbackPos += int64_t(samplesToRead);
@@ -93,3 +106,47 @@ bool AudioSourceClip::getAudioData(size_t samplesRequested, AudioSourceData& dst
 
 	return isPlaying;
 }
+
+bool AudioSourceClip::skipAudioData(size_t samplesRequested)
+{
+	Expects(initialised);
+	const auto playbackLength = int64_t(clip->getLength());
+	const uint8_t nChannels = getNumberOfChannels();
+	int64_t samplesLeft = int64_t(samplesRequested);
+
+	// Delay
+	if (playbackPos < 0) {
+		const int64_t delaySamples = std::min(-playbackPos, samplesLeft);
+		playbackPos += delaySamples;
+		samplesLeft -= delaySamples;
+	}
+
+	// Same looping rules as getAudioData
+	while (samplesLeft > 0) {
+		if (playbackPos >= playbackLength) {
+			if (looping) {
+				playbackPos = int64_t(clip->getLoopPoint());
+				if (playbackPos >= playbackLength) {
+					looping = false;
+					playbackPos = playbackLength;
+					return false;
+				}
+			} else {
+				return false;
+			}
+		}
+
+		const int64_t samplesToSkip = std::min(samplesLeft, playbackLength - playbackPos);
+		if (streamer) {
+			streamer->skip(size_t(playbackPos), size_t(samplesToSkip));
+		} else {
+			for (size_t srcChannel = 0; srcChannel < nChannels; ++srcChannel) {
+				clip->skipChannelData(srcChannel, size_t(playbackPos), size_t(samplesToSkip));
+			}
+		}
+		playbackPos += samplesToSkip;
+		samplesLeft -= samplesToSkip;
+	}
+
+	return true;
+}
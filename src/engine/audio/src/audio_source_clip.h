@@ -3,6 +3,8 @@
 
 namespace Halley
 {
+	class AudioClipStreamer;
+
 	class AudioSourceClip final : public AudioSource
 	{
 	public:
@@ -10,14 +12,16 @@ namespace Halley
 
 		uint8_t getNumberOfChannels() const override;
 		bool getAudioData(size_t numSamples, AudioSourceData& dst) override;
+		bool skipAudioData(size_t numSamples) override;
 		bool isReady() const override;
 
 	private:
 		const std::shared_ptr<const IAudioClip> clip;
+		mutable std::shared_ptr<AudioClipStreamer> streamer; // Created as soon as the clip is loaded, so it can start buffering before we start playing
 		
 		int64_t playbackPos = 0;
 
-		bool initialised = false;
+		mutable bool initialised = false;
 		bool looping;
 	};
 }
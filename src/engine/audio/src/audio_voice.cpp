@@ -12,6 +12,8 @@ AudioVoice::AudioVoice(std::shared_ptr<AudioSource> source, AudioPosition source
 	, playing(false)
 	, done(false)
 	, isFirstUpdate(true)
+	, virtualised(false)
+	, skipped(false)
 	, baseGain(gain)
 	, userGain(1.0f)
 	, source(std::move(source))
@@ -78,6 +80,39 @@ uint8_t AudioVoice::getGroup() const
 	return group;
 }
 
+void AudioVoice::setPriority(int p)
+{
+	priority = p;
+}
+
+int AudioVoice::getPriority() const
+{
+	return priority;
+}
+
+void AudioVoice::setVirtual(bool isVirtual)
+{
+	virtualised = isVirtual;
+	if (virtualised) {
+		// Fades out from prevChannelMix on this mix, and since prevChannelMix will be zero on the next one, fades back in when it becomes real again
+		channelMix.fill(0.0f);
+		if (isFirstUpdate) {
+			// Never been heard, so there's nothing to fade out from
+			prevChannelMix.fill(0.0f);
+		}
+	}
+}
+
+bool AudioVoice::isVirtual() const
+{
+	return virtualised;
+}
+
+float AudioVoice::getAudibility() const
+{
+	return audibility;
+}
+
 void AudioVoice::setBaseGain(float gain)
 {
 	baseGain = gain;
@@ -135,8 +170,14 @@ void AudioVoice::update(gsl::span<const AudioChannelData> channels, const AudioL
 	sourcePos.setMix(nChannels, channels, channelMix, baseGain * userGain * dynamicGain * groupGain, listener);
 	
 	if (isFirstUpdate) {
+		// Start at full volume, unless setVirtual says otherwise before the first mix
 		prevChannelMix = channelMix;
-		isFirstUpdate = false;
+	}
+
+	audibility = 0.0f;
+	const size_t nMixes = std::min(size_t(nChannels) * size_t(channels.size()), channelMix.size());
+	for (size_t i = 0; i < nMixes; ++i) {
+		audibility += channelMix[i];
 	}
 }
 
@@ -147,6 +188,7 @@ void AudioVoice::mixTo(size_t numSamples, gsl::span<AudioBuffer*> dst, AudioMixe
 
 	const size_t numPacks = numSamples / 16;
 	Expects(dst[0]->packs.size() >= numPacks);
+	isFirstUpdate = false;
 	const size_t nSrcChannels = getNumberOfChannels();
 	const auto nDstChannels = size_t(dst.size());
 
@@ -158,6 +200,24 @@ void AudioVoice::mixTo(size_t numSamples, gsl::span<AudioBuffer*> dst, AudioMixe
 		totalMix += prevChannelMix[i] + channelMix[i];
 	}
 
+	// After skipping, the source might need a moment to catch up (e.g. a streamed clip that stopped decoding).
+	// Keep skipping until it has, and fade in from silence then, rather than fading in over an underrun.
+	const bool waitingForSource = skipped && totalMix >= 0.0001f && !source->isReady();
+	if (waitingForSource) {
+		channelMix.fill(0.0f);
+	}
+
+	// If there's nothing to listen to, just move the playback position along instead of decoding
+	skipped = totalMix < 0.0001f || waitingForSource;
+	if (skipped) {
+		const bool isPlaying = source->skipAudioData(numSamples);
+		advancePlayback(numSamples);
+		if (!isPlaying) {
+			stop();
+		}
+		return;
+	}
+
 	// Read data from source
 	std::array<gsl::span<AudioSamplePack>, AudioConfig::maxChannels> audioData;
 	std::array<gsl::span<AudioConfig::SampleFormat>, AudioConfig::maxChannels> audioSampleData;
@@ -169,21 +229,18 @@ void AudioVoice::mixTo(size_t numSamples, gsl::span<AudioBuffer*> dst, AudioMixe
 	}
 	bool isPlaying = source->getAudioData(numSamples, audioSampleData);
 
-	// If we're audible, render
-	if (totalMix >= 0.0001f) {
-		// Render each emitter channel
-		for (size_t srcChannel = 0; srcChannel < nSrcChannels; ++srcChannel) {
-			// Read to buffer
-			for (size_t dstChannel = 0; dstChannel < nDstChannels; ++dstChannel) {
-				// Compute mix
-				const size_t mixIndex = (srcChannel * nChannels) + dstChannel;
-				const float gain0 = prevChannelMix[mixIndex];
-				const float gain1 = channelMix[mixIndex];
-
-				// Render to destination
-				if (gain0 + gain1 > 0.0001f) {
-					mixer.mixAudio(audioData[srcChannel], dst[dstChannel]->packs, gain0, gain1);
-				}
+	// Render each emitter channel
+	for (size_t srcChannel = 0; srcChannel < nSrcChannels; ++srcChannel) {
+		// Read to buffer
+		for (size_t dstChannel = 0; dstChannel < nDstChannels; ++dstChannel) {
+			// Compute mix
+			const size_t mixIndex = (srcChannel * nChannels) + dstChannel;
+			const float gain0 = prevChannelMix[mixIndex];
+			const float gain1 = channelMix[mixIndex];
+
+			// Render to destination
+			if (gain0 + gain1 > 0.0001f) {
+				mixer.mixAudio(audioData[srcChannel], dst[dstChannel]->packs, gain0, gain1);
 			}
 		}
 	}
@@ -43,6 +43,18 @@ namespace Halley {
 		
 		uint8_t getGroup() const;
 
+		void setPriority(int priority);
+		int getPriority() const;
+
+		// Virtual voices fade out and then only advance their playback position, without decoding anything.
+		// Set by the engine after update() on the voices that didn't make the cut for real voices.
+		// Once they're real again, they keep skipping until the source is ready, and then fade in.
+		void setVirtual(bool isVirtual);
+		bool isVirtual() const;
+
+		// Sum of all channel gains, as of the last update
+		float getAudibility() const;
+
 	private:
 		uint32_t id = std::numeric_limits<uint32_t>::max();
 		uint8_t group = 0;
@@ -50,6 +62,10 @@ namespace Halley {
 		bool playing : 1;
 		bool done : 1;
 		bool isFirstUpdate : 1;
+		bool virtualised : 1;
+		bool skipped : 1;
+		int priority = 0;
+		float audibility = 0.0f;
     	float baseGain = 1.0f;
 		float dynamicGain = 1.0f;
 		float userGain = 1.0f;
@@ -59,8 +75,8 @@ namespace Halley {
 		std::unique_ptr<AudioVoiceBehaviour> behaviour;
     	AudioPosition sourcePos;
 
-		std::array<float, 16> channelMix;
-		std::array<float, 16> prevChannelMix;
+		std::array<float, 16> channelMix = {};
+		std::array<float, 16> prevChannelMix = {};
 
 		void advancePlayback(size_t samples);
     };
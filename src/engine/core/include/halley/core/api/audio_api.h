@@ -181,11 +181,15 @@ namespace Halley
 		virtual void setGroupVolume(const String& groupName, float gain = 1.0f) = 0;
 		virtual void setOutputChannels(std::vector<AudioChannelData> audioChannelData) = 0;
 
+		// Voices beyond this limit (ranked by priority, then by how loud they are) are virtualised: they keep track of their position, but aren't decoded or mixed
+		virtual void setMaxRealVoices(size_t maxVoices = AudioConfig::maxVoices) = 0;
+
 		virtual void setGlobalVariable(const String& variable, float value) = 0;
 
 		virtual void setListener(AudioListenerData listener) = 0;
 
 		virtual int64_t getLastTimeElapsed() const = 0;
+		virtual size_t getStreamUnderruns() const = 0; // Times a streamed clip wasn't decoded in time and played silence instead, since startup
 		virtual std::optional<AudioSpec> getAudioSpec() const = 0;
 	};
 }
@@ -11,6 +11,7 @@ namespace Halley
 	class VideoAPI;
 	class InputAPI;
 	class HalleyAPIInternal;
+	class MappedFile;
 
 	using SystemOnSuspendCallback = std::function<void(void)>;
 	using SystemOnResumeCallback = std::function<void(void)>;
@@ -32,6 +33,7 @@ namespace Halley
 		virtual Path getUnpackedAssetsPath(const Path& gamePath) const = 0;
 
 		virtual std::unique_ptr<ResourceDataReader> getDataReader(String path, int64_t start = 0, int64_t end = -1) = 0;
+		virtual std::shared_ptr<const MappedFile> getMappedFile(String path) { return {}; } // Optional, callers fall back to getDataReader
 		
 		virtual std::unique_ptr<GLContext> createGLContext() = 0;
 
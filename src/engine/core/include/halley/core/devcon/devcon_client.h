@@ -21,6 +21,7 @@ namespace Halley
 		void update();
 
 		void onReceiveReloadAssets(const DevCon::ReloadAssetsMsg& msg);
+		void onReceiveListResidency(const DevCon::ListResidencyMsg& msg);
 
 	private:
 		const HalleyAPI& api;
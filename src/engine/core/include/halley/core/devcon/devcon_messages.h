@@ -17,7 +17,8 @@ namespace Halley
 		enum class MessageType
 		{
 			Log,
-			ReloadAssets
+			ReloadAssets,
+			ListResidency
 		};
 
 
@@ -60,5 +61,16 @@ namespace Halley
 		private:
 			std::vector<String> ids;
 		};
+
+		class ListResidencyMsg final : public DevConMessage
+		{
+		public:
+			ListResidencyMsg() = default;
+			ListResidencyMsg(gsl::span<const gsl::byte> data);
+
+			void serialize(Serializer& s) const override;
+
+			MessageType getMessageType() const override;
+		};
 	}
 }
@@ -15,6 +15,7 @@ namespace Halley
 		constexpr static int devConPort = 12500;
 		class LogMsg;
 		class ReloadAssetsMsg;
+		class ListResidencyMsg;
 	}
 
 	class DevConServerConnection
@@ -25,6 +26,7 @@ namespace Halley
 		void update();
 		
 		void reloadAssets(const std::vector<String>& assetIds);
+		void listResidency();
 
 	private:
 		std::shared_ptr<IConnection> connection;
@@ -41,6 +43,7 @@ namespace Halley
 		void update();
 
 		void reloadAssets(const std::vector<String>& assetIds);
+		void listResidency();
 
 	private:
 		std::unique_ptr<NetworkService> service;
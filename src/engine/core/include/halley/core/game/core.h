@@ -102,6 +102,7 @@ namespace Halley
 		std::unique_ptr<Stage> currentStage;
 		std::unique_ptr<Stage> nextStage;
 		bool pendingStageTransition = false;
+		std::optional<Future<void>> stagePrefetch;
 
 		bool initialized = false;
 		bool running = true;
@@ -190,6 +190,7 @@ namespace Halley
 		size_t getVertexSize() const;
 		size_t getVertexStride() const;
 		size_t getVertexPosOffset() const;
+		bool isInstanced() const;
 		const Vector<MaterialAttribute>& getAttributes() const { return attributes; }
 		const Vector<MaterialUniformBlock>& getUniformBlocks() const { return uniformBlocks; }
 		const Vector<MaterialTexture>& getTextures() const { return textures; }
@@ -216,6 +217,7 @@ namespace Halley
 		int vertexPosOffset = 0;
 		int defaultMask = 1;
 		bool columnMajor = false;
+		bool instanced = false; // Sprites get one vertex each, with vertPos read from a separate per-corner stream
 
 		std::shared_ptr<const Texture> fallbackTexture;
 
@@ -60,6 +60,10 @@ namespace Halley
 		// vertPosOffset is the offset, in bytes, from the start of each vertex's data, to a Vector2f which will be filled with the vertex's position in 0-1 space.
 		void drawSprites(const std::shared_ptr<Material>& material, size_t numSprites, const void* vertexData);
 
+		// Same as above, but each sprite's data starts srcStride bytes after the previous one, e.g. when reading straight out of an array of Sprite
+		// If the material is instanced and the backend supports it, each sprite is sent as a single instance instead of four vertices.
+		void drawSprites(const std::shared_ptr<Material>& material, size_t numSprites, const void* vertexData, size_t srcStride);
+
 		// Draw one sliced sprite. Slices -> x = left, y = top, z = right, w = bottom, in [0..1] space relative to the texture
 		void drawSlicedSprite(const std::shared_ptr<Material>& material, Vector2f scale, Vector4f slices, const void* vertexData);
 
@@ -81,12 +85,19 @@ namespace Halley
 		size_t getNumVertices() const { return nVertices; }
 		size_t getNumTriangles() const { return nTriangles; }
 
+		size_t getNumBytesUploaded() const { return nBytesUploaded; }
+
 		size_t getPrevDrawCalls() const { return prevDrawCalls; }
 		size_t getPrevVertices() const { return prevVertices; }
 		size_t getPrevTriangles() const { return prevTriangles; }
+		size_t getPrevBytesUploaded() const { return prevBytesUploaded; }
 
 		void setLogging(bool logging);
 
+		// Writes four vertices for each sprite into dst, setting the 16 bytes at vertPosOffset to each corner's position in 0-1 space
+		static void expandSpriteVertices(char* dst, const char* src, size_t numSprites, size_t srcStride, size_t vertexSize, size_t vertexStride, size_t vertPosOffset);
+		static void generateQuadIndices(IndexType firstVertex, size_t numQuads, IndexType* target);
+
 	protected:
 		virtual void startDrawCall() {}
 		virtual void endDrawCall() {}
@@ -95,13 +106,20 @@ namespace Halley
 		virtual void setVertices(const MaterialDefinition& material, size_t numVertices, void* vertexData, size_t numIndices, IndexType* indices, bool standardQuadsOnly) = 0;
 		virtual void drawTriangles(size_t numIndices) = 0;
 
+		// Instancing: the instance data has one vertex per quad, and the backend must read the material's vertPos attribute from the
+		// four corners of the quad instead, i.e. (0, 0, 0, 0), (1, 0, 1, 0), (1, 1, 1, 1), (0, 1, 0, 1), indexed as standard quads
+		virtual bool supportsInstancing() const { return false; }
+		virtual void setInstances(const MaterialDefinition& material, size_t numInstances, void* instanceData);
+		virtual void drawInstancedQuads(size_t numInstances);
+
 		virtual void setViewPort(Rect4i rect) = 0;
 		virtual void setClip(Rect4i clip, bool enable) = 0;
 
 		virtual void onUpdateProjection(Material& material) = 0;
-		void generateQuadIndices(IndexType firstVertex, size_t numQuads, IndexType* target);
 		RenderTarget& getActiveRenderTarget();
 
+		void bind(Camera& camera, RenderTarget& defaultRenderTarget);
+
 		std::unique_ptr<Material> halleyGlobalMaterial;
 
 	private:
@@ -116,6 +134,7 @@ namespace Halley
 		size_t bytesPending = 0;
 		size_t indicesPending = 0;
 		bool allIndicesAreQuads = true;
+		bool instancesPending = false;
 		Vector<char> vertexBuffer;
 		Vector<IndexType> indexBuffer;
 		std::shared_ptr<Material> materialPending;
@@ -125,9 +144,11 @@ namespace Halley
 		size_t nDrawCalls = 0;
 		size_t nVertices = 0;
 		size_t nTriangles = 0;
+		size_t nBytesUploaded = 0;
 		size_t prevDrawCalls = 0;
 		size_t prevVertices = 0;
 		size_t prevTriangles = 0;
+		size_t prevBytesUploaded = 0;
 		bool logging = true;
 
 		Vector<IndexType> stdQuadIndexCache;
@@ -144,10 +165,12 @@ namespace Halley
 		void startDrawCall(const std::shared_ptr<Material>& material);
 		void flushPending();
 		void executeDrawPrimitives(Material& material, size_t numVertices, void* vertexData, gsl::span<const IndexType> indices, PrimitiveType primitiveType = PrimitiveType::Triangle);
+		void executeDrawInstances(Material& material, size_t numInstances, void* instanceData);
 
 		void makeSpaceForPendingVertices(size_t numBytes);
 		void makeSpaceForPendingIndices(size_t numIndices);
 		PainterVertexData addDrawData(const std::shared_ptr<Material>& material, size_t numVertices, size_t numIndices, bool standardQuadsOnly);
+		char* addInstanceData(const std::shared_ptr<Material>& material, size_t numInstances);
 
 		IndexType* getStandardQuadIndices(size_t numQuads);
 		void generateQuadIndicesOffset(IndexType firstVertex, IndexType lineStride, IndexType* target);
@@ -10,15 +10,6 @@ namespace Halley {
 	class Animation;
 	
 	class Particles {
-		struct Particle {
-			Vector2f pos;
-			Vector2f vel;
-			Angle1f angle;
-			float time = 0;
-			float ttl = 1;
-			bool alive = true;
-		};
-		
 	public:
 		Particles();
 		Particles(const ConfigNode& node, Resources& resources);
@@ -32,6 +23,10 @@ namespace Halley {
 
 		void setPosition(Vector2f pos);
 
+		// Large emitters can spread their update across the CPU executor
+		void setParallelUpdate(bool enabled);
+		bool isParallelUpdate() const;
+
 		void update(Time t);
 
 		void setSprites(std::vector<Sprite> sprites);
@@ -39,9 +34,12 @@ namespace Halley {
 
 		bool isAnimated() const;
 		bool isAlive() const;
-		
+		size_t getNumParticlesAlive() const;
+
+		// Sprites are generated on demand from the simulation state, which is why these aren't const. The returned span is only valid
+		// until the next update or getSprites call. The overload taking an area only generates sprites for particles that might overlap it.
 		[[nodiscard]] gsl::span<Sprite> getSprites();
-		[[nodiscard]] gsl::span<const Sprite> getSprites() const;
+		[[nodiscard]] gsl::span<const Sprite> getSprites(Rect4f area);
 
 	private:
 		Random* rng;
@@ -49,16 +47,32 @@ namespace Halley {
 
 		bool enabled = true;
 		bool firstUpdate = true;
+		bool parallelUpdate = false;
 		float spawnRateMultiplier = 1.0f;
 
-		std::vector<Sprite> sprites;
-		std::vector<Particle> particles;
+		// Simulation state, stored as one array per field. The arrays are padded to a multiple of 4, so they can be updated 4 at a time.
+		std::vector<float> posX;
+		std::vector<float> posY;
+		std::vector<float> velX;
+		std::vector<float> velY;
+		std::vector<float> angles;
+		std::vector<float> times;
+		std::vector<float> ttls;
+		std::vector<float> alphas;
+		std::vector<float> turns;
+		std::vector<uint32_t> baseSpriteIdx;
+		std::vector<Sprite> animationSprites;
 		std::vector<AnimationPlayerLite> animationPlayers;
 		
 		size_t nParticlesAlive = 0;
-		size_t nParticlesVisible = 0;
 		float pendingSpawn = 0;
 
+		std::vector<Sprite> sprites;
+		std::vector<uint32_t> spriteSources;
+		size_t nSprites = 0;
+		bool spritesDirty = true;
+		std::optional<Rect4f> spritesArea;
+
 		float spawnRate = 100;
 		Vector2f spawnArea;
 		float ttl = 1;
@@ -85,6 +99,10 @@ namespace Halley {
 		void spawn(size_t n);
 		void initializeParticle(size_t index);
 		void updateParticles(float t);
+		void updateParticleRange(size_t start, size_t end, float t);
+		void removeDeadParticles();
+		void moveParticle(size_t from, size_t to);
+		void generateSprites(std::optional<Rect4f> area);
 
 		Vector2f getSpawnPosition() const;
 	};
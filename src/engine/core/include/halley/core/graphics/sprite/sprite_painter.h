@@ -30,6 +30,9 @@ namespace Halley
 
 		bool operator<(const SpritePainterEntry& o) const;
 		SpritePainterEntryType getType() const;
+		int getLayer() const;
+		float getTieBreaker() const;
+		size_t getInsertOrder() const;
 		gsl::span<const Sprite> getSprites() const;
 		gsl::span<const TextRenderer> getTexts() const;
 		uint32_t getIndex() const;
@@ -52,6 +55,9 @@ namespace Halley
 	class SpritePainter
 	{
 	public:
+		// Entries are bucketed by layer, and then by bands of tieBreaker this tall (usually the vertical position on screen)
+		constexpr static float bandSize = 32.0f;
+
 		void start();
 		[[deprecated]] void start(size_t nSprites);
 		
@@ -62,15 +68,58 @@ namespace Halley
 		void add(const TextRenderer& sprite, int mask, int layer, float tieBreaker, std::optional<Rect4f> clip = {});
 		void addCopy(const TextRenderer& text, int mask, int layer, float tieBreaker, std::optional<Rect4f> clip = {});
 		
+		// Static entries are kept across start() until clearStatic(), and are only sorted again when they change.
+		// When they compare equal to a regular entry, static entries are drawn first.
+		void addStatic(const Sprite& sprite, int mask, int layer, float tieBreaker, std::optional<Rect4f> clip = {});
+		void addStatic(gsl::span<const Sprite> sprites, int mask, int layer, float tieBreaker, std::optional<Rect4f> clip = {});
+		void addStatic(const TextRenderer& text, int mask, int layer, float tieBreaker, std::optional<Rect4f> clip = {});
+		void clearStatic();
+
 		void draw(int mask, Painter& painter);
 
 	private:
-		Vector<SpritePainterEntry> sprites;
-		Vector<Sprite> cachedSprites;
-		Vector<TextRenderer> cachedText;
-		bool dirty = false;
+		struct Bucket {
+			int layer;
+			int band;
+			uint32_t begin;
+			uint32_t end;
+			int mask = 0;
+			Rect4f bounds; // Of the sprites only, text is never culled
+			bool cullable = true; // False if the bucket has text, so it can't be skipped based on bounds
+		};
+
+		// The entries added through one of the add functions, along with their storage and sorted buckets
+		struct EntrySet {
+			Vector<SpritePainterEntry> entries;
+			Vector<Sprite> cachedSprites;
+			Vector<TextRenderer> cachedText;
+
+			Vector<uint32_t> order;
+			Vector<Bucket> buckets;
+			Vector<std::optional<Rect4f>> bounds;
+			bool dirty = false;
+
+			void clear();
+			void sort();
+			gsl::span<const Sprite> getSprites(const SpritePainterEntry& entry) const;
+			gsl::span<const TextRenderer> getTexts(const SpritePainterEntry& entry) const;
+
+		private:
+			Vector<std::pair<uint64_t, uint32_t>> keys;
+			Vector<std::pair<uint64_t, uint32_t>> keysTmp;
+
+			void computeBounds();
+		};
+
+		EntrySet dynamicEntries;
+		EntrySet staticEntries;
+
+		void draw(const EntrySet& set, const Bucket& bucket, int mask, Painter& painter, Rect4f view) const;
+		void draw(const EntrySet& set, uint32_t entryIdx, bool cull, Painter& painter, Rect4f view) const;
+		void drawMerged(const Bucket& dynamicBucket, const Bucket& staticBucket, int mask, Painter& painter, Rect4f view) const;
+		void draw(gsl::span<const Sprite> sprite, bool cull, Painter& painter, Rect4f view, const std::optional<Rect4f>& clip) const;
+		void draw(gsl::span<const TextRenderer> text, Painter& painter, const std::optional<Rect4f>& clip) const;
 
-		void draw(gsl::span<const Sprite> sprite, Painter& painter, Rect4f view, const std::optional<Rect4f>& clip) const;
-		void draw(gsl::span<const TextRenderer> text, Painter& painter, Rect4f view, const std::optional<Rect4f>& clip) const;
+		static bool isBucketVisible(const Bucket& bucket, int mask, Rect4f view);
 	};
 }
@@ -96,10 +96,20 @@ namespace Halley
 
 		std::vector<ColourOverride> colourOverrides;
 
+		struct GlyphRun;
+
+		// Glyphs laid out at the origin, shared by every renderer with the same layout inputs. Moving the text only translates these into spritesCache.
+		mutable std::shared_ptr<const GlyphRun> glyphRun;
 		mutable Vector<Sprite> spritesCache;
 		mutable bool materialDirty = true;
 		mutable bool glyphsDirty = true;
 		mutable bool positionDirty = true;
+		mutable bool spritesDirty = true;
+
+		const GlyphRun& getGlyphRun() const;
+		void layoutGlyphs(GlyphRun& run) const;
+		void copyGlyphs(const GlyphRun& run, gsl::span<Sprite> dst) const;
+		void updateSpritesCache() const;
 
 		std::shared_ptr<Material> getMaterial(const Font& font) const;
 		void updateMaterial(Material& material, const Font& font) const;
@@ -25,9 +25,12 @@ namespace Halley
 		Vector2i getSize() const { return size; }
 		const TextureDescriptor& getDescriptor() const { return descriptor; }
 
+		size_t getMemoryUsage() const override;
+
 	protected:
 		Vector2i size;
 		TextureDescriptor descriptor;
+		bool retainsPixelData = false;
 
 		virtual void doLoad(TextureDescriptor& descriptor);
 	};
@@ -92,6 +92,7 @@ namespace Halley
 		PixelDataFormat pixelFormat = PixelDataFormat::Image;
 		TextureAddressMode addressMode = TextureAddressMode::Clamp;
 		TextureDescriptorImageData pixelData;
+		int mipLevels = 1; // Levels present in pixelData, one after the other. If useMipMap is set with a single level, the rest are generated at runtime.
 
 		bool useMipMap = false;
 		bool useFiltering = false;
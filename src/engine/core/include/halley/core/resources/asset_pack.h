@@ -2,8 +2,11 @@
 #include "halley/utils/utils.h"
 #include "halley/text/halleystring.h"
 #include <memory>
+#include <optional>
 #include <gsl/span>
 #include "halley/resources/resource_data.h"
+#include "halley/data_structures/hash_map.h"
+#include "halley/data_structures/vector.h"
 
 namespace Halley {
 	enum class AssetType;
@@ -12,6 +15,8 @@ namespace Halley {
 	class AssetDatabase;
 	class ResourceData;
 	class ResourceDataReader;
+	class MappedFile;
+	class Metadata;
 
 	struct AssetPackHeader {
 		std::array<char, 8> identifier;
@@ -19,7 +24,16 @@ namespace Halley {
 		uint64_t assetDbStartPos;
 		uint64_t dataStartPos;
 
-		void init(size_t assetDbSize);
+		void init(size_t assetDbSize, int version = 1);
+		int getVersion() const;
+	};
+
+	// A single asset as stored in a v2 pack
+	struct AssetPackEntryData {
+		Bytes data;
+		size_t size = 0;
+		bool compressed = false;
+		bool encrypted = false;
 	};
 
     class AssetPack {
@@ -28,6 +42,7 @@ namespace Halley {
 		AssetPack(const AssetPack& other) = delete;
 		AssetPack(AssetPack&& other) noexcept;
 		AssetPack(std::unique_ptr<ResourceDataReader> reader, const String& encryptionKey = "", bool preLoad = false);
+		AssetPack(std::shared_ptr<const MappedFile> mapping, const String& encryptionKey = "", bool preLoad = false);
 		~AssetPack();
 
 		AssetPack& operator=(const AssetPack& other) = delete;
@@ -42,6 +57,12 @@ namespace Halley {
 
 		std::unique_ptr<ResourceData> getData(const String& asset, AssetType type, bool stream);
 
+		// v2 packs store every asset on its own, optionally compressed and encrypted, so it can be decoded independently
+		// encodeAsset is thread-safe, so assets can be encoded in parallel before being added
+		static AssetPackEntryData encodeAsset(gsl::span<const gsl::byte> src, bool compress, const String& encryptionKey, const std::array<char, 16>& iv);
+		void addAsset(const String& name, AssetType type, const AssetPackEntryData& entry, const Metadata& meta);
+		int getVersion() const;
+
 		void readToMemory();
 		void encrypt(const String& key);
 		void decrypt(const String& key);
@@ -49,15 +70,37 @@ namespace Halley {
     	void readData(size_t pos, gsl::span<gsl::byte> dst);
 
 		std::unique_ptr<ResourceDataReader> extractReader();
+		bool isMapped() const;
 
     private:
+		struct IndexEntry {
+			size_t pos = 0;
+			size_t size = 0;
+			size_t storedSize = 0;
+			bool compressed = false;
+			bool encrypted = false;
+		};
+
 		std::unique_ptr<AssetDatabase> assetDb;
 		std::unique_ptr<ResourceDataReader> reader;
+		std::shared_ptr<const MappedFile> mapping;
+		Vector<HashMap<String, IndexEntry>> index;
 		std::atomic<bool> hasReader;
 		std::mutex readerMutex;
 		size_t dataOffset = 0;
 		Bytes data;
 		std::array<char, 16> iv;
+		String encryptionKey;
+		int version = 1;
+
+		void readHeader(const AssetPackHeader& header);
+		void loadAssetDatabase(gsl::span<const gsl::byte> assetDbBytes);
+		void buildIndex();
+		IndexEntry getIndexEntry(const String& asset, AssetType type) const;
+		static std::optional<IndexEntry> parseIndexEntry(const String& path);
+		Bytes decodeAsset(const IndexEntry& entry);
+		bool hasPackEncryption() const;
+		const char* getMappedData(size_t pos, size_t size) const;
     };
 
 
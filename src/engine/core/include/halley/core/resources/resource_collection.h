@@ -3,9 +3,12 @@
 #include <utility>
 #include <memory>
 #include <functional>
+#include <mutex>
 #include <halley/text/halleystring.h>
+#include <halley/concurrency/future.h>
 #include <halley/resources/resource_data.h>
 #include <halley/data_structures/hash_map.h>
+#include <halley/data_structures/vector.h>
 
 namespace Halley
 {
@@ -14,6 +17,23 @@ namespace Halley
 	class Resources;
 	class ResourceLoader;
 
+	struct ResourceMemoryStats
+	{
+		size_t count = 0;
+		size_t memoryUsage = 0;
+		size_t unreferencedCount = 0;
+		size_t unreferencedMemoryUsage = 0;
+		size_t budget = 0;
+		size_t evictions = 0;
+	};
+
+	struct ResourceResidency
+	{
+		String assetId;
+		size_t memoryUsage = 0;
+		long useCount = 0;
+	};
+
 	class ResourceCollectionBase
 	{
 		class Wrapper
@@ -22,15 +42,33 @@ namespace Halley
 			Wrapper(Wrapper&& other) noexcept
 				: res(std::move(other.res))
 				, depth(other.depth)
+				, loadedFromAssets(other.loadedFromAssets)
+				, dataSize(other.dataSize)
+				, lastAccess(other.lastAccess)
 			{}
 
-			Wrapper(std::shared_ptr<Resource> resource, int loadDepth)
+			Wrapper(std::shared_ptr<Resource> resource, int loadDepth, bool loadedFromAssets, size_t dataSize = 0, uint64_t lastAccess = 0)
 				: res(std::move(resource))
 				, depth(loadDepth)
+				, loadedFromAssets(loadedFromAssets)
+				, dataSize(dataSize)
+				, lastAccess(lastAccess)
 			{}
 
+			size_t getMemoryUsage() const;
+
 			std::shared_ptr<Resource> res;
 			int depth;
+			bool loadedFromAssets; // Only these can be loaded back, so only these can be evicted
+			size_t dataSize;
+			uint64_t lastAccess;
+		};
+
+		struct PendingLoad
+		{
+			Promise<std::shared_ptr<Resource>> promise;
+			std::exception_ptr error;
+			std::atomic<bool> started = false;
 		};
 
 	public:
@@ -53,23 +91,51 @@ namespace Halley
 		void reload(const String& assetId);
 		void purge(const String& assetId);
 
+		// Concurrent requests for the same asset, sync or async, share a single load. If another thread is already loading it,
+		// this blocks until that's done. Loads only ever wait on their own dependencies, so that can't deadlock, but it can stall
+		// the main thread for as long as the load takes. Prefetch what the main thread is going to need to avoid that.
 		std::shared_ptr<Resource> getUntyped(const String& name, ResourceLoadPriority priority = ResourceLoadPriority::Normal);
 
+		// Loads on the executor returned by getLoadQueue. Concurrent requests for the same asset, sync or async, share a single load.
+		// If loading fails, the error is logged and the future resolves to null.
+		Future<std::shared_ptr<Resource>> getUntypedAsync(const String& name, ResourceLoadPriority priority = ResourceLoadPriority::Normal);
+		bool isLoaded(const String& assetId) const;
+
+		// Textures, shaders and materials create video objects as they load, so they're loaded on the video aux executor,
+		// which has a video context. Everything else is loaded on the CPU aux executor.
+		bool needsVideoContext() const;
+		ExecutionQueue& getLoadQueue() const;
+
 		std::vector<String> enumerate() const;
 
+		// When over budget, the least recently used resources that nothing else holds on to are unloaded. 0 means no budget
+		void setMemoryBudget(size_t bytes);
+		size_t getMemoryBudget() const;
+		ResourceMemoryStats getMemoryStats() const;
+		Vector<ResourceResidency> getResidency() const; // Largest first
+
 	protected:
 		virtual std::shared_ptr<Resource> loadResource(ResourceLoader& loader) = 0;
 
 		std::shared_ptr<Resource> doGet(const String& name, ResourceLoadPriority priority, bool allowFallback);
-		std::pair<std::shared_ptr<Resource>, bool> loadAsset(const String& assetId, ResourceLoadPriority priority, bool allowFallback);
+		std::pair<std::shared_ptr<Resource>, bool> loadAsset(const String& assetId, ResourceLoadPriority priority, bool allowFallback, size_t* dataSize = nullptr);
 
 	private:
 		Resources& parent;
+		mutable std::mutex mutex;
 		HashMap<String, Wrapper> resources;
+		HashMap<String, std::shared_ptr<PendingLoad>> pendingLoads;
 		String fallback;
 		AssetType type;
 		ResourceLoaderFunc resourceLoader;
 		ResourceEnumeratorFunc resourceEnumerator;
+
+		size_t memoryBudget = 0;
+		size_t evictions = 0;
+		uint64_t accessCounter = 0;
+
+		Vector<std::shared_ptr<Resource>> enforceBudget();
+		std::shared_ptr<Resource> runLoad(const String& assetId, ResourceLoadPriority priority, bool allowFallback, PendingLoad& load);
 	};
 
 	template <typename T>
@@ -113,12 +113,24 @@ namespace Halley {
 		void reloadAssets(const std::vector<String>& ids); // ids are in "type:name" format
 		void reloadAssets(const std::map<AssetType, std::vector<String>>& byType);
 
+		// Loads the assets in parallel, along with the dependencies listed in their "dependencies" metadata, which the importer
+		// generates for prefabs and scenes. Failures are logged and skipped. ids are in "type:name" format
+		Future<void> prefetch(Vector<String> ids);
+
 		const Options& getOptions() const { return options; }
 
+		// See ResourceCollectionBase::setMemoryBudget
+		void setMemoryBudget(AssetType type, size_t bytes);
+		String getResidencyReport(size_t maxEntriesPerType = 10) const;
+
 	private:
+		struct PrefetchState;
+
 		const std::unique_ptr<ResourceLocator> locator;
 		Vector<std::unique_ptr<ResourceCollectionBase>> resources;
 		const HalleyAPI* const api;
 		Options options;
+
+		void doPrefetch(PrefetchState& state, gsl::span<const String> ids);
 	};
 }
@@ -25,6 +25,9 @@ namespace Halley
 
 		virtual void init() {}
 
+		// Assets in "type:name" format, loaded in parallel before the stage is switched to
+		virtual Vector<String> getPrefetchSet() const { return {}; }
+
 		const HalleyAPI& getAPI() const { return *api; }
 
 	protected:
@@ -50,6 +53,7 @@ namespace Halley
 		friend class Core;
 
 		void setGame(Game& game);
+		void setAPI(const HalleyAPI* api, Resources& resources);
 		void doInit(const HalleyAPI* api, Resources& resources);
 		void doDeInit();
 
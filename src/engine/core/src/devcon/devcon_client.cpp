@@ -5,6 +5,7 @@
 #include "halley/core/api/halley_api.h"
 #include "halley/net/connection/message_queue.h"
 #include "devcon/devcon_messages.h"
+#include "resources/resources.h"
 
 using namespace Halley;
 
@@ -41,6 +42,10 @@ void DevConClient::update()
 			onReceiveReloadAssets(dynamic_cast<DevCon::ReloadAssetsMsg&>(msg));
 			break;
 
+		case DevCon::MessageType::ListResidency:
+			onReceiveListResidency(dynamic_cast<DevCon::ListResidencyMsg&>(msg));
+			break;
+
 		default:
 			break;
 		}
@@ -52,6 +57,16 @@ void DevConClient::onReceiveReloadAssets(const DevCon::ReloadAssetsMsg& msg)
 	resources.reloadAssets(msg.getIds());
 }
 
+void DevConClient::onReceiveListResidency(const DevCon::ListResidencyMsg& msg)
+{
+	// Logs are forwarded to the server
+	for (const auto& line: resources.getResidencyReport().split('\n')) {
+		if (!line.isEmpty()) {
+			Logger::logInfo(line);
+		}
+	}
+}
+
 void DevConClient::connect()
 {
 	queue = std::make_shared<MessageQueueTCP>(service->connect(address, port));
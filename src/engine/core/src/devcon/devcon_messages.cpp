@@ -12,6 +12,7 @@ void DevCon::setupMessageQueue(MessageQueue& queue)
 
 	queue.addFactory<LogMsg>();
 	queue.addFactory<ReloadAssetsMsg>();
+	queue.addFactory<ListResidencyMsg>();
 }
 
 LogMsg::LogMsg(gsl::span<const gsl::byte> data)
@@ -72,3 +73,17 @@ MessageType ReloadAssetsMsg::getMessageType() const
 {
 	return MessageType::ReloadAssets;
 }
+
+
+ListResidencyMsg::ListResidencyMsg(gsl::span<const gsl::byte> data)
+{
+}
+
+void ListResidencyMsg::serialize(Serializer& s) const
+{
+}
+
+MessageType ListResidencyMsg::getMessageType() const
+{
+	return MessageType::ListResidency;
+}
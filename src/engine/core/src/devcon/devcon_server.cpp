@@ -40,6 +40,12 @@ void DevConServerConnection::reloadAssets(const std::vector<String>& ids)
 	queue->sendAll();
 }
 
+void DevConServerConnection::listResidency()
+{
+	queue->enqueue(std::make_unique<DevCon::ListResidencyMsg>(), 0);
+	queue->sendAll();
+}
+
 void DevConServerConnection::onReceiveLogMsg(const DevCon::LogMsg& msg)
 {
 	Logger::log(msg.getLevel(), "[REMOTE] " + msg.getMessage());
@@ -72,3 +78,10 @@ void DevConServer::reloadAssets(const std::vector<String>& ids)
 		c->reloadAssets(ids);
 	}
 }
+
+void DevConServer::listResidency()
+{
+	for (auto& c: connections) {
+		c->listResidency();
+	}
+}
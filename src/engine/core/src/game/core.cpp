@@ -485,6 +485,18 @@ void Core::setStage(std::unique_ptr<Stage> next)
 {
 	nextStage = std::move(next);
 	pendingStageTransition = true;
+
+	// Keep the current stage running while the next one's assets load
+	stagePrefetch.reset();
+	if (nextStage && resources) {
+		// The stage isn't initialised until the transition, but it may need the API to know what it's going to load
+		nextStage->setGame(*game);
+		nextStage->setAPI(api.get(), *resources);
+		auto prefetchSet = nextStage->getPrefetchSet();
+		if (!prefetchSet.empty()) {
+			stagePrefetch = resources->prefetch(std::move(prefetchSet));
+		}
+	}
 }
 
 void Core::quit(int code)
@@ -570,6 +582,15 @@ bool Core::transitionStage()
 		nextStage.reset();
 	}
 
+	// Don't switch until the next stage's assets are loaded
+	if (stagePrefetch) {
+		if (running && !stagePrefetch->isReady()) {
+			return false;
+		}
+		stagePrefetch->wait();
+		stagePrefetch.reset();
+	}
+
 	// Check if there's a stage waiting to be switched to
 	if (pendingStageTransition) {
 		// Get rid of current stage
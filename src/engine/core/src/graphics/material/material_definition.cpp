@@ -162,11 +162,15 @@ void MaterialDefinition::load(const ConfigNode& root)
 	// Load name
 	name = root["name"].asString("Unknown");
 	defaultMask = root["defaultMask"].asInt(1);
+	instanced = root["instanced"].asBool(instanced);
 
 	// Load attributes & uniforms
 	if (root.hasKey("attributes")) {
 		loadAttributes(root["attributes"]);
 	}
+	if (instanced && !std::any_of(attributes.begin(), attributes.end(), [&] (const MaterialAttribute& a) { return a.offset == vertexPosOffset && a.type == ShaderParameterType::Float4; })) {
+		throw Exception("Instanced material \"" + name + "\" needs a vec4 attribute with \"special: vertPos\"", HalleyExceptions::Resources);
+	}
 	if (root.hasKey("uniforms")) {
 		loadUniforms(root["uniforms"]);
 	}
@@ -244,6 +248,7 @@ void MaterialDefinition::serialize(Serializer& s) const
 	s << vertexSize;
 	s << vertexPosOffset;
 	s << defaultMask;
+	s << instanced;
 }
 
 void MaterialDefinition::deserialize(Deserializer& s)
@@ -256,6 +261,12 @@ void MaterialDefinition::deserialize(Deserializer& s)
 	s >> vertexSize;
 	s >> vertexPosOffset;
 	s >> defaultMask;
+	s >> instanced;
+}
+
+bool MaterialDefinition::isInstanced() const
+{
+	return instanced;
 }
 
 bool MaterialDefinition::isColumnMajor() const
@@ -12,9 +12,38 @@
 
 #include "halley/maths/polygon.h"
 #include "resources/resources.h"
+#include "halley/core/graphics/sprite/sprite.h"
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define HAS_SSE
+#include <emmintrin.h>
+#endif
 
 using namespace Halley;
 
+#ifdef HAS_SSE
+// Each sprite is loaded into registers once, and then its four vertices are written out in order
+template <size_t nChunks>
+static void expandSpriteVerticesSSE(char* dst, const char* src, size_t numSprites, size_t srcStride, size_t vertexStride, size_t posChunk, const __m128 corners[4])
+{
+	for (size_t i = 0; i < numSprites; ++i) {
+		const float* s = reinterpret_cast<const float*>(src + i * srcStride);
+		__m128 v[nChunks];
+		for (size_t c = 0; c < nChunks; ++c) {
+			v[c] = _mm_loadu_ps(s + c * 4);
+		}
+
+		char* d = dst + i * 4 * vertexStride;
+		for (size_t j = 0; j < 4; ++j) {
+			float* vertex = reinterpret_cast<float*>(d + j * vertexStride);
+			for (size_t c = 0; c < nChunks; ++c) {
+				_mm_storeu_ps(vertex + c * 4, c == posChunk ? corners[j] : v[c]);
+			}
+		}
+	}
+}
+#endif
+
 struct LineVertex {
 	Vector4f colour;
 	Vector2f position;
@@ -41,7 +70,8 @@ void Painter::startRender()
 	prevDrawCalls = nDrawCalls;
 	prevTriangles = nTriangles;
 	prevVertices = nVertices;
-	nDrawCalls = nTriangles = nVertices = 0;
+	prevBytesUploaded = nBytesUploaded;
+	nDrawCalls = nTriangles = nVertices = nBytesUploaded = 0;
 
 	resetPending();
 	doStartRender();
@@ -81,7 +111,7 @@ Painter::PainterVertexData Painter::addDrawData(const std::shared_ptr<Material>&
 	if (numVertices > maxVertices) {
 		throw Exception("Too many vertices in draw call: " + toString(numVertices) + ", maximum is " + toString(maxVertices), HalleyExceptions::Graphics);
 	}
-	if (verticesPending + numVertices > maxVertices) {
+	if (verticesPending + numVertices > maxVertices || instancesPending) {
 		flushPending();
 	}
 
@@ -111,6 +141,32 @@ Painter::PainterVertexData Painter::addDrawData(const std::shared_ptr<Material>&
 	return result;
 }
 
+char* Painter::addInstanceData(const std::shared_ptr<Material>& material, size_t numInstances)
+{
+	updateClip();
+
+	// Instances can't share a draw call with indexed vertices
+	constexpr auto maxInstances = size_t(std::numeric_limits<IndexType>::max());
+	if (verticesPending + numInstances > maxInstances || (verticesPending > 0 && !instancesPending)) {
+		flushPending();
+	}
+
+	Expects(material != nullptr);
+	Expects(numInstances > 0);
+
+	startDrawCall(material);
+
+	const size_t dataSize = numInstances * material->getDefinition().getVertexStride();
+	makeSpaceForPendingVertices(dataSize);
+
+	char* result = vertexBuffer.data() + bytesPending;
+	verticesPending += numInstances;
+	bytesPending += dataSize;
+	instancesPending = true;
+
+	return result;
+}
+
 void Painter::draw(const std::shared_ptr<Material>& material, size_t numVertices, const void* vertexData, gsl::span<const IndexType> indices, PrimitiveType primitiveType)
 {
 	Expects(primitiveType == PrimitiveType::Triangle);
@@ -137,35 +193,70 @@ void Painter::drawQuads(const std::shared_ptr<Material>& material, size_t numVer
 }
 
 void Painter::drawSprites(const std::shared_ptr<Material>& material, size_t numSprites, const void* vertexData)
+{
+	drawSprites(material, numSprites, vertexData, material->getDefinition().getVertexStride());
+}
+
+void Painter::drawSprites(const std::shared_ptr<Material>& material, size_t numSprites, const void* vertexData, size_t srcStride)
 {
 	Expects(vertexData != nullptr);
 
+	const auto& definition = material->getDefinition();
+	if (definition.isInstanced() && supportsInstancing()) {
+		// One vertex per sprite, the backend supplies the corners
+		const size_t vertexSize = definition.getVertexSize();
+		const size_t vertexStride = definition.getVertexStride();
+		Expects(srcStride >= vertexSize);
+
+		char* dst = addInstanceData(material, numSprites);
+		if (srcStride == vertexStride) {
+			memcpy(dst, vertexData, numSprites * vertexStride);
+		} else {
+			const char* src = static_cast<const char*>(vertexData);
+			for (size_t i = 0; i < numSprites; ++i) {
+				memcpy(dst + i * vertexStride, src + i * srcStride, vertexSize);
+			}
+		}
+		return;
+	}
+
 	const size_t verticesPerSprite = 4;
 	const size_t numVertices = verticesPerSprite * numSprites;
 	const size_t vertPosOffset = material->getDefinition().getVertexPosOffset();
 
 	const auto result = addDrawData(material, numVertices, numSprites * 6, true);
+	Expects(srcStride >= result.vertexSize);
 
-	const char* const src = reinterpret_cast<const char*>(vertexData);
+	expandSpriteVertices(result.dstVertex, static_cast<const char*>(vertexData), numSprites, srcStride, result.vertexSize, result.vertexStride, vertPosOffset);
+	generateQuadIndices(result.firstIndex, numSprites, result.dstIndex);
+}
 
-	for (size_t i = 0; i < numSprites; i++) {
-		for (size_t j = 0; j < verticesPerSprite; j++) {
-			const size_t srcOffset = i * result.vertexStride;
-			const size_t dstOffset = (i * verticesPerSprite + j) * result.vertexStride;
-			memmove(result.dstVertex + dstOffset, src + srcOffset, result.vertexSize);
-
-			// j -> vertPos
-			// 0 -> 0, 0
-			// 1 -> 1, 0
-			// 2 -> 1, 1
-			// 3 -> 0, 1
-			const float x = ((j & 1) ^ ((j & 2) >> 1)) * 1.0f;
-			const float y = ((j & 2) >> 1) * 1.0f;
-			getVertPos(result.dstVertex + dstOffset, vertPosOffset) = Vector4f(x, y, x, y);
+void Painter::expandSpriteVertices(char* dst, const char* src, size_t numSprites, size_t srcStride, size_t vertexSize, size_t vertexStride, size_t vertPosOffset)
+{
+	// A-----B
+	// |     |
+	// D-----C
+	alignas(16) constexpr float corners[4][4] = { { 0, 0, 0, 0 }, { 1, 0, 1, 0 }, { 1, 1, 1, 1 }, { 0, 1, 0, 1 } };
+
+#ifdef HAS_SSE
+	// The vertex is copied in 16 byte chunks, so the destination layout must be in whole chunks, and the source needs room for the last one
+	const size_t nChunks = (vertexSize + 15) / 16;
+	if (vertexStride % 16 == 0 && vertPosOffset % 16 == 0 && nChunks * 16 <= srcStride && nChunks * 16 <= vertexStride) {
+		const __m128 cornerData[4] = { _mm_load_ps(corners[0]), _mm_load_ps(corners[1]), _mm_load_ps(corners[2]), _mm_load_ps(corners[3]) };
+		if (nChunks == sizeof(SpriteVertexAttrib) / 16) {
+			expandSpriteVerticesSSE<sizeof(SpriteVertexAttrib) / 16>(dst, src, numSprites, srcStride, vertexStride, vertPosOffset / 16, cornerData);
+			return;
 		}
 	}
+#endif
 
-	generateQuadIndices(result.firstIndex, numSprites, result.dstIndex);
+	for (size_t i = 0; i < numSprites; i++) {
+		for (size_t j = 0; j < 4; j++) {
+			char* d = dst + (i * 4 + j) * vertexStride;
+			memcpy(d, src + i * srcStride, vertexSize);
+			memcpy(d + vertPosOffset, corners[j], sizeof(corners[j]));
+		}
+	}
 }
 
 void Painter::drawSlicedSprite(const std::shared_ptr<Material>& material, Vector2f scale, Vector4f slices, const void* vertexData)
@@ -395,11 +486,16 @@ void Painter::makeSpaceForPendingIndices(size_t numIndices)
 }
 
 void Painter::bind(RenderContext& context)
+{
+	bind(context.getCamera(), context.getDefaultRenderTarget());
+}
+
+void Painter::bind(Camera& cam, RenderTarget& defaultRenderTarget)
 {
 	// Setup camera
-	camera = &context.getCamera();
+	camera = &cam;
 	camera->rendering = true;
-	camera->defaultRenderTarget = &context.getDefaultRenderTarget();
+	camera->defaultRenderTarget = &defaultRenderTarget;
 
 	// Set render target
 	activeRenderTarget = &camera->getActiveRenderTarget();
@@ -488,7 +584,9 @@ void Painter::startDrawCall(const std::shared_ptr<Material>& material)
 
 void Painter::flushPending()
 {
-	if (verticesPending > 0) {
+	if (verticesPending > 0 && instancesPending) {
+		executeDrawInstances(*materialPending, verticesPending, vertexBuffer.data());
+	} else if (verticesPending > 0) {
 		executeDrawPrimitives(*materialPending, verticesPending, vertexBuffer.data(), gsl::span<const IndexType>(indexBuffer.data(), indicesPending));
 	}
 
@@ -501,6 +599,7 @@ void Painter::resetPending()
 	verticesPending = 0;
 	indicesPending = 0;
 	allIndicesAreQuads = true;
+	instancesPending = false;
 	if (materialPending) {
 		Material::resetBindCache();
 		materialPending.reset();
@@ -538,10 +637,58 @@ void Painter::executeDrawPrimitives(Material& material, size_t numVertices, void
 			}
 		}
 	}
+	if (logging) {
+		nBytesUploaded += numVertices * material.getDefinition().getVertexStride() + indices.size() * sizeof(IndexType);
+	}
 
 	endDrawCall();
 }
 
+void Painter::executeDrawInstances(Material& material, size_t numInstances, void* instanceData)
+{
+	startDrawCall();
+
+	// Load instances
+	setInstances(material.getDefinition(), numInstances, instanceData);
+
+	// Load material uniforms
+	material.uploadData(*this);
+	setMaterialData(material);
+
+	// Go through each pass
+	for (int i = 0; i < material.getDefinition().getNumPasses(); i++) {
+		if (material.isPassEnabled(i)) {
+			// Bind pass
+			material.bind(i, *this);
+
+			// Draw
+			drawInstancedQuads(numInstances);
+
+			// Log stats
+			if (logging) {
+				nDrawCalls++;
+				nTriangles += numInstances * 2;
+				nVertices += numInstances * 4;
+			}
+		}
+	}
+	if (logging) {
+		nBytesUploaded += numInstances * material.getDefinition().getVertexStride();
+	}
+
+	endDrawCall();
+}
+
+void Painter::setInstances(const MaterialDefinition& material, size_t numInstances, void* instanceData)
+{
+	throw Exception("Instanced drawing is not supported by this painter", HalleyExceptions::Graphics);
+}
+
+void Painter::drawInstancedQuads(size_t numInstances)
+{
+	throw Exception("Instanced drawing is not supported by this painter", HalleyExceptions::Graphics);
+}
+
 IndexType* Painter::getStandardQuadIndices(size_t numQuads)
 {
 	size_t sz = numQuads * 6;
@@ -571,8 +718,29 @@ IndexType* Painter::getStandardQuadIndices(size_t numQuads)
 
 void Painter::generateQuadIndices(IndexType pos, size_t numQuads, IndexType* target)
 {
-	size_t numIndices = numQuads * 6;
-	for (size_t i = 0; i < numIndices; i += 6) {
+	size_t quad = 0;
+
+#ifdef HAS_SSE
+	static_assert(sizeof(IndexType) == 2);
+
+	// Four quads at a time, which is 24 indices, or three registers
+	const __m128i pattern0 = _mm_setr_epi16(0, 1, 2, 2, 3, 0, 4, 5);
+	const __m128i pattern1 = _mm_setr_epi16(6, 6, 7, 4, 8, 9, 10, 10);
+	const __m128i pattern2 = _mm_setr_epi16(11, 8, 12, 13, 14, 14, 15, 12);
+	const __m128i step = _mm_set1_epi16(16);
+	__m128i base = _mm_set1_epi16(static_cast<short>(pos));
+
+	for (; quad + 4 <= numQuads; quad += 4) {
+		auto* dst = reinterpret_cast<__m128i*>(target + quad * 6);
+		_mm_storeu_si128(dst, _mm_add_epi16(base, pattern0));
+		_mm_storeu_si128(dst + 1, _mm_add_epi16(base, pattern1));
+		_mm_storeu_si128(dst + 2, _mm_add_epi16(base, pattern2));
+		base = _mm_add_epi16(base, step);
+	}
+	pos = static_cast<IndexType>(pos + quad * 4);
+#endif
+
+	for (size_t i = quad * 6; i < numQuads * 6; i += 6) {
 		// A-----B
 		// |     |
 		// D-----C
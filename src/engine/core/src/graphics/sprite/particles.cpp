@@ -2,9 +2,20 @@
 
 #include "halley/maths/random.h"
 #include "halley/support/logger.h"
+#include "halley/concurrency/concurrent.h"
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define HAS_SSE
+#include <xmmintrin.h>
+#endif
 
 using namespace Halley;
 
+namespace {
+	constexpr size_t parallelBlockSize = 1024;
+	constexpr size_t minParallelParticles = 4 * parallelBlockSize;
+}
+
 Particles::Particles()
 	: rng(&Random::getGlobal())
 {
@@ -28,6 +39,7 @@ Particles::Particles(const ConfigNode& node, Resources& resources)
 	directionScatter = node["directionScatter"].asFloat(0.0f);
 	rotateTowardsMovement = node["rotateTowardsMovement"].asBool(false);
 	destroyWhenDone = node["destroyWhenDone"].asBool(false);
+	parallelUpdate = node["parallelUpdate"].asBool(false);
 
 	if (node.hasKey("maxParticles")) {
 		maxParticles = node["maxParticles"].asInt();
@@ -69,6 +81,16 @@ void Particles::setPosition(Vector2f pos)
 	position = pos;
 }
 
+void Particles::setParallelUpdate(bool enabled)
+{
+	parallelUpdate = enabled;
+}
+
+bool Particles::isParallelUpdate() const
+{
+	return parallelUpdate;
+}
+
 void Particles::start()
 {
 	if (burst) {
@@ -94,33 +116,25 @@ void Particles::update(Time t)
 	updateParticles(static_cast<float>(t));
 
 	// Remove dead particles
-	for (size_t i = 0; i < nParticlesAlive; ) {
-		if (!particles[i].alive) {
-			if (i != nParticlesAlive - 1) {
-				// Swap with last particle that's alive
-				std::swap(particles[i], particles[nParticlesAlive - 1]);
-				std::swap(sprites[i], sprites[nParticlesAlive - 1]);
-				if (isAnimated()) {
-					std::swap(animationPlayers[i], animationPlayers[nParticlesAlive - 1]);
-				}
-			}
-			--nParticlesAlive;
-			// Don't increment i here, since i is now a new particle that's still alive
-		} else {
-			++i;
-		}
-	}
+	removeDeadParticles();
 
-	// Update visibility
-	nParticlesVisible = nParticlesAlive;
-	if (nParticlesVisible > 0 && !sprites[0].hasMaterial()) {
-		nParticlesVisible = 0;
-	}
+	spritesDirty = true;
 }
 
 void Particles::setSprites(std::vector<Sprite> sprites)
 {
 	baseSprites = std::move(sprites);
+
+	// Every slot has to be copied again, but keep them so generateSprites doesn't have to grow the vectors
+	spriteSources.assign(this->sprites.size(), std::numeric_limits<uint32_t>::max());
+
+	// Particles that are already alive might be using a base sprite that no longer exists
+	if (!baseSprites.empty()) {
+		for (size_t i = 0; i < nParticlesAlive; ++i) {
+			baseSpriteIdx[i] %= uint32_t(baseSprites.size());
+		}
+	}
+	spritesDirty = true;
 }
 
 void Particles::setAnimation(std::shared_ptr<const Animation> animation)
@@ -138,14 +152,21 @@ bool Particles::isAlive() const
 	return nParticlesAlive > 0 || !destroyWhenDone;
 }
 
+size_t Particles::getNumParticlesAlive() const
+{
+	return nParticlesAlive;
+}
+
 gsl::span<Sprite> Particles::getSprites()
 {
-	return gsl::span<Sprite>(sprites).subspan(0, nParticlesVisible);
+	generateSprites({});
+	return gsl::span<Sprite>(sprites).subspan(0, nSprites);
 }
 
-gsl::span<const Sprite> Particles::getSprites() const
+gsl::span<const Sprite> Particles::getSprites(Rect4f area)
 {
-	return gsl::span<const Sprite>(sprites).subspan(0, nParticlesVisible);
+	generateSprites(area);
+	return gsl::span<const Sprite>(sprites).subspan(0, nSprites);
 }
 
 void Particles::spawn(size_t n)
@@ -157,10 +178,13 @@ void Particles::spawn(size_t n)
 	const size_t start = nParticlesAlive;
 	nParticlesAlive += n;
 	const size_t size = std::max(size_t(8), nextPowerOf2(nParticlesAlive));
-	if (particles.size() < size) {
-		particles.resize(size);
-		sprites.resize(size);
+	if (posX.size() < size) {
+		for (auto* field: { &posX, &posY, &velX, &velY, &angles, &times, &ttls, &alphas, &turns }) {
+			field->resize(size);
+		}
+		baseSpriteIdx.resize(size);
 		if (isAnimated()) {
+			animationSprites.resize(size);
 			animationPlayers.resize(size, AnimationPlayerLite(baseAnimation));
 		}
 	}
@@ -173,64 +197,248 @@ void Particles::spawn(size_t n)
 void Particles::initializeParticle(size_t index)
 {
 	const auto startDirection = Angle1f::fromDegrees(rng->getFloat(angle - angleScatter, angle + angleScatter));
+	const auto pos = getSpawnPosition();
+	const auto vel = Vector2f(rng->getFloat(speed - speedScatter, speed + speedScatter), startDirection);
 	
-	auto& particle = particles[index];
-	particle.alive = true;
-	particle.time = 0;
-	particle.ttl = rng->getFloat(ttl - ttlScatter, ttl + ttlScatter);
-	particle.pos = getSpawnPosition();
-	particle.angle = rotateTowardsMovement ? startDirection : Angle1f();
-	particle.vel = Vector2f(rng->getFloat(speed - speedScatter, speed + speedScatter), startDirection);
-
-	auto& sprite = sprites[index];
+	times[index] = 0;
+	ttls[index] = rng->getFloat(ttl - ttlScatter, ttl + ttlScatter);
+	posX[index] = pos.x;
+	posY[index] = pos.y;
+	velX[index] = vel.x;
+	velY[index] = vel.y;
+	angles[index] = rotateTowardsMovement ? startDirection.getRadians() : 0.0f;
+	alphas[index] = 1.0f;
+
 	if (isAnimated()) {
-		auto& anim = animationPlayers[index];
-		anim.update(0, sprite);
+		animationPlayers[index].update(0, animationSprites[index]);
 	} else if (!baseSprites.empty()) {
-		sprite = rng->getRandomElement(baseSprites);
+		baseSpriteIdx[index] = static_cast<uint32_t>(rng->getSizeT(0, baseSprites.size() - 1));
 	}
 }
 
 void Particles::updateParticles(float time)
 {
-	const bool hasAnim = isAnimated();
-	
-	for (size_t i = 0; i < nParticlesAlive; ++i) {
-		if (hasAnim) {
-			animationPlayers[i].update(time, sprites[i]);
+	if (isAnimated()) {
+		for (size_t i = 0; i < nParticlesAlive; ++i) {
+			animationPlayers[i].update(time, animationSprites[i]);
 		}
-		
-		auto& particle = particles[i];
+	}
 
-		particle.time += time;
-		if (particle.time >= particle.ttl) {
-			particle.alive = false;
-		} else {
-			particle.vel += acceleration * time;
-			
-			if (speedDamp > 0.0001f) {
-				particle.vel = damp(particle.vel, Vector2f(), speedDamp, time);
+	// The RNG isn't thread safe, so the direction changes are rolled up front
+	if (directionScatter > 0.00001f) {
+		const float maxTurn = directionScatter * time * float(pi()) / 180.0f;
+		for (size_t i = 0; i < nParticlesAlive; ++i) {
+			turns[i] = rng->getFloat(-maxTurn, maxTurn);
+		}
+	}
+
+	if (parallelUpdate && nParticlesAlive >= minParallelParticles) {
+		const size_t nBlocks = (nParticlesAlive + parallelBlockSize - 1) / parallelBlockSize;
+		Concurrent::parallelFor(0, nBlocks, [&] (size_t block)
+		{
+			updateParticleRange(block * parallelBlockSize, std::min(nParticlesAlive, (block + 1) * parallelBlockSize), time);
+		});
+	} else {
+		updateParticleRange(0, nParticlesAlive, time);
+	}
+}
+
+void Particles::updateParticleRange(size_t start, size_t end, float time)
+{
+	const bool hasScatter = directionScatter > 0.00001f;
+	const float dampFactor = speedDamp > 0.0001f ? std::exp(-speedDamp * time) : 1.0f;
+
+	// alpha = clamp(min(time * fadeInScale + fadeInBias, (ttl - time) * fadeOutScale + fadeOutBias), 0, 1), with disabled fades never being the minimum
+	const bool hasFade = fadeInTime > 0.000001f || fadeOutTime > 0.00001f;
+	const float fadeInScale = fadeInTime > 0.000001f ? 1.0f / fadeInTime : 0.0f;
+	const float fadeInBias = fadeInTime > 0.000001f ? 0.0f : std::numeric_limits<float>::max();
+	const float fadeOutScale = fadeOutTime > 0.00001f ? 1.0f / fadeOutTime : 0.0f;
+	const float fadeOutBias = fadeOutTime > 0.00001f ? 0.0f : std::numeric_limits<float>::max();
+
+	// Arrays are padded to a multiple of 4, so the last group may include a few dead slots, which are harmless to update
+	for (size_t i = start; i < end; i += 4) {
+		alignas(16) float turnSin[4] = { 0, 0, 0, 0 };
+		alignas(16) float turnCos[4] = { 1, 1, 1, 1 };
+		if (hasScatter) {
+			for (size_t j = 0; j < 4; ++j) {
+				turnSin[j] = std::sin(turns[i + j]);
+				turnCos[j] = std::cos(turns[i + j]);
 			}
+		}
 
-			if (directionScatter > 0.00001f) {
-				particle.vel = particle.vel.rotate(Angle1f::fromDegrees(rng->getFloat(-directionScatter * time, directionScatter * time)));
+#ifdef HAS_SSE
+		const __m128 dt = _mm_set1_ps(time);
+		const __m128 t = _mm_add_ps(_mm_loadu_ps(&times[i]), dt);
+		_mm_storeu_ps(&times[i], t);
+
+		const __m128 oldVx = _mm_loadu_ps(&velX[i]);
+		const __m128 oldVy = _mm_loadu_ps(&velY[i]);
+		const __m128 damping = _mm_set1_ps(dampFactor);
+		const __m128 dampedVx = _mm_mul_ps(_mm_add_ps(oldVx, _mm_set1_ps(acceleration.x * time)), damping);
+		const __m128 dampedVy = _mm_mul_ps(_mm_add_ps(oldVy, _mm_set1_ps(acceleration.y * time)), damping);
+		const __m128 s = _mm_load_ps(turnSin);
+		const __m128 c = _mm_load_ps(turnCos);
+		const __m128 vx = _mm_sub_ps(_mm_mul_ps(dampedVx, c), _mm_mul_ps(dampedVy, s));
+		const __m128 vy = _mm_add_ps(_mm_mul_ps(dampedVx, s), _mm_mul_ps(dampedVy, c));
+		_mm_storeu_ps(&velX[i], vx);
+		_mm_storeu_ps(&velY[i], vy);
+		_mm_storeu_ps(&posX[i], _mm_add_ps(_mm_loadu_ps(&posX[i]), _mm_mul_ps(vx, dt)));
+		_mm_storeu_ps(&posY[i], _mm_add_ps(_mm_loadu_ps(&posY[i]), _mm_mul_ps(vy, dt)));
+
+		if (rotateTowardsMovement) {
+			// The angle is only computed when the sprites are generated, unless the particle is coming to a halt, in which case it keeps the last one
+			const __m128 threshold = _mm_set1_ps(0.001f);
+			const __m128 wasMoving = _mm_cmpgt_ps(_mm_add_ps(_mm_mul_ps(oldVx, oldVx), _mm_mul_ps(oldVy, oldVy)), threshold);
+			const __m128 isMoving = _mm_cmpgt_ps(_mm_add_ps(_mm_mul_ps(vx, vx), _mm_mul_ps(vy, vy)), threshold);
+			if (_mm_movemask_ps(_mm_andnot_ps(isMoving, wasMoving)) != 0) {
+				alignas(16) float ox[4];
+				alignas(16) float oy[4];
+				_mm_store_ps(ox, oldVx);
+				_mm_store_ps(oy, oldVy);
+				for (size_t j = 0; j < 4; ++j) {
+					if (ox[j] * ox[j] + oy[j] * oy[j] > 0.001f && velX[i + j] * velX[i + j] + velY[i + j] * velY[i + j] <= 0.001f) {
+						angles[i + j] = std::atan2(oy[j], ox[j]);
+					}
+				}
 			}
-			
-			particle.pos += particle.vel * time;
+		}
 
-			if (rotateTowardsMovement && particle.vel.squaredLength() > 0.001f) {
-				particle.angle = particle.vel.angle();
+		if (hasFade) {
+			const __m128 fadeIn = _mm_add_ps(_mm_mul_ps(t, _mm_set1_ps(fadeInScale)), _mm_set1_ps(fadeInBias));
+			const __m128 fadeOut = _mm_add_ps(_mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(&ttls[i]), t), _mm_set1_ps(fadeOutScale)), _mm_set1_ps(fadeOutBias));
+			const __m128 alpha = _mm_max_ps(_mm_min_ps(_mm_min_ps(fadeIn, fadeOut), _mm_set1_ps(1.0f)), _mm_setzero_ps());
+			_mm_storeu_ps(&alphas[i], alpha);
+		}
+#else
+		for (size_t j = i; j < i + 4; ++j) {
+			times[j] += time;
+			const float oldVx = velX[j];
+			const float oldVy = velY[j];
+			const float dampedVx = (oldVx + acceleration.x * time) * dampFactor;
+			const float dampedVy = (oldVy + acceleration.y * time) * dampFactor;
+			velX[j] = dampedVx * turnCos[j - i] - dampedVy * turnSin[j - i];
+			velY[j] = dampedVx * turnSin[j - i] + dampedVy * turnCos[j - i];
+			posX[j] += velX[j] * time;
+			posY[j] += velY[j] * time;
+
+			if (rotateTowardsMovement && oldVx * oldVx + oldVy * oldVy > 0.001f && velX[j] * velX[j] + velY[j] * velY[j] <= 0.001f) {
+				angles[j] = std::atan2(oldVy, oldVx);
 			}
 
-			if (fadeInTime > 0.000001f || fadeOutTime > 0.00001f) {
-				const float alpha = clamp(std::min(particle.time / fadeInTime, (particle.ttl - particle.time) / fadeOutTime), 0.0f, 1.0f);
-				sprites[i].getColour().a = alpha;
+			if (hasFade) {
+				const float fadeIn = times[j] * fadeInScale + fadeInBias;
+				const float fadeOut = (ttls[j] - times[j]) * fadeOutScale + fadeOutBias;
+				alphas[j] = clamp(std::min(fadeIn, fadeOut), 0.0f, 1.0f);
 			}
+		}
+#endif
+	}
+}
+
+void Particles::removeDeadParticles()
+{
+	for (size_t i = 0; i < nParticlesAlive; ) {
+#ifdef HAS_SSE
+		// Skip over groups of 4 where everyone is still alive
+		if (i + 4 <= nParticlesAlive && _mm_movemask_ps(_mm_cmpge_ps(_mm_loadu_ps(&times[i]), _mm_loadu_ps(&ttls[i]))) == 0) {
+			i += 4;
+			continue;
+		}
+#endif
+		if (times[i] >= ttls[i]) {
+			// Replace with last particle that's alive
+			if (i != nParticlesAlive - 1) {
+				moveParticle(nParticlesAlive - 1, i);
+			}
+			--nParticlesAlive;
+			// Don't increment i here, since i is now a new particle that's still alive
+		} else {
+			++i;
+		}
+	}
+}
+
+void Particles::moveParticle(size_t from, size_t to)
+{
+	posX[to] = posX[from];
+	posY[to] = posY[from];
+	velX[to] = velX[from];
+	velY[to] = velY[from];
+	angles[to] = angles[from];
+	times[to] = times[from];
+	ttls[to] = ttls[from];
+	alphas[to] = alphas[from];
+	baseSpriteIdx[to] = baseSpriteIdx[from];
+	if (isAnimated()) {
+		std::swap(animationSprites[to], animationSprites[from]);
+		std::swap(animationPlayers[to], animationPlayers[from]);
+	}
+}
+
+void Particles::generateSprites(std::optional<Rect4f> area)
+{
+	if (!spritesDirty && spritesArea == area) {
+		return;
+	}
+	spritesDirty = false;
+	spritesArea = area;
+	nSprites = 0;
+
+	const bool animated = isAnimated();
+	if (!animated && baseSprites.empty()) {
+		return;
+	}
+
+	const bool hasFade = fadeInTime > 0.000001f || fadeOutTime > 0.00001f;
+
+	// The sprite can't reach further from its pivot than its width plus height, whatever the pivot and rotation.
+	// A negative reach means the sprite can't be drawn at all.
+	auto getReach = [] (const Sprite& sprite)
+	{
+		const auto size = sprite.getScaledSize().abs();
+		return sprite.hasMaterial() ? size.x + size.y : -1.0f;
+	};
+	Vector<float> baseReach;
+	if (!animated) {
+		for (auto& sprite: baseSprites) {
+			baseReach.push_back(getReach(sprite));
+		}
+	}
+	const float infinity = std::numeric_limits<float>::infinity();
+	const Rect4f bounds = area.value_or(Rect4f(Vector2f(-infinity, -infinity), Vector2f(infinity, infinity)));
+
+	for (size_t i = 0; i < nParticlesAlive; ++i) {
+		const float reach = animated ? getReach(animationSprites[i]) : baseReach[baseSpriteIdx[i]];
+		const Vector2f pos(posX[i], posY[i]);
+		const bool outside = (pos.x + reach < bounds.getLeft()) | (pos.x - reach > bounds.getRight()) | (pos.y + reach < bounds.getTop()) | (pos.y - reach > bounds.getBottom());
+		if (outside || reach < 0) {
+			continue;
+		}
+
+		// Only grow as far as the visible particles need
+		if (nSprites == sprites.size()) {
+			sprites.resize(std::max(size_t(8), sprites.size() * 2));
+			spriteSources.resize(sprites.size(), std::numeric_limits<uint32_t>::max());
+		}
+
+		// Only copy the whole sprite when the slot was last used by a different base sprite
+		auto& dst = sprites[nSprites];
+		const uint32_t source = animated ? std::numeric_limits<uint32_t>::max() : baseSpriteIdx[i];
+		if (animated || spriteSources[nSprites] != source) {
+			dst = animated ? animationSprites[i] : baseSprites[source];
+			spriteSources[nSprites] = source;
+		}
+
+		float rotation = angles[i];
+		if (rotateTowardsMovement && velX[i] * velX[i] + velY[i] * velY[i] > 0.001f) {
+			rotation = std::atan2(velY[i], velX[i]);
+		}
 
-			sprites[i]
-				.setPosition(particle.pos)
-				.setRotation(particle.angle);
+		dst.setPosition(pos).setRotation(Angle1f::fromRadians(rotation));
+		if (hasFade) {
+			dst.getColour().a = alphas[i];
 		}
+		++nSprites;
 	}
 }
 
@@ -96,25 +96,12 @@ void Sprite::draw(const Sprite* sprites, size_t n, Painter& painter) // static
 	auto& material = sprites[0].material;
 	Expects(material->getDefinition().getVertexStride() == sizeof(SpriteVertexAttrib));
 
-	size_t spriteSize = sizeof(SpriteVertexAttrib);
-	char buffer[4096];
-	char* vertexData;
-	std::vector<char> vertices;
-	const size_t vertexDataSize = n * spriteSize;
-	if (vertexDataSize <= 4096) {
-		vertexData = buffer;
-	} else {
-		vertices.resize(vertexDataSize);
-		vertexData = vertices.data();
-	}
-
-	for (size_t i = 0; i < n; i++) {
-		auto& sprite = sprites[i];
-		Expects(sprite.material == material);
-		memcpy(&vertexData[i * spriteSize], &sprite.vertexAttrib, spriteSize);
+	for (size_t i = 1; i < n; i++) {
+		Expects(sprites[i].material == material || *sprites[i].material == *material);
 	}
 
-	painter.drawSprites(material, n, vertexData);
+	// Read the vertex data straight out of the sprites, rather than gathering it first
+	painter.drawSprites(material, n, &sprites[0].vertexAttrib, sizeof(Sprite));
 }
 
 void Sprite::drawMixedMaterials(const Sprite* sprites, size_t n, Painter& painter)
@@ -123,11 +110,12 @@ void Sprite::drawMixedMaterials(const Sprite* sprites, size_t n, Painter& painte
 		return;
 	}
 
+	// Different instances of identical materials would be batched by the painter anyway, so keep them in the same run
 	size_t start = 0;
 	auto* lastMaterial = sprites[0].material.get();
 	for (size_t i = 0; i < n; ++i) {
 		auto* material = sprites[i].material.get();
-		if (material != lastMaterial) {
+		if (material != lastMaterial && (!material || !lastMaterial || !(*material == *lastMaterial))) {
 			draw(sprites + start, i - start, painter);
 			start = i;
 			lastMaterial = material;
@@ -3,9 +3,33 @@
 #include "graphics/painter.h"
 #include <gsl/gsl>
 #include "graphics/text/text_renderer.h"
+#include <array>
 
 using namespace Halley;
 
+namespace {
+	uint64_t makeBucketKey(int layer, int band)
+	{
+		// Flip the sign bits so that the unsigned key sorts the same way as the signed values
+		return (uint64_t(uint32_t(layer) ^ 0x80000000u) << 32) | uint64_t(uint32_t(band) ^ 0x80000000u);
+	}
+
+	int getBand(float tieBreaker)
+	{
+		const float band = std::floor(tieBreaker / SpritePainter::bandSize);
+		if (!(band > -1e9f)) {
+			// Also catches NaN
+			return -1000000000;
+		}
+		return int(std::min(band, 1e9f));
+	}
+
+	bool isInside(Rect4f rect, Rect4f view)
+	{
+		return rect.getLeft() >= view.getLeft() && rect.getRight() <= view.getRight() && rect.getTop() >= view.getTop() && rect.getBottom() <= view.getBottom();
+	}
+}
+
 SpritePainterEntry::SpritePainterEntry(gsl::span<const Sprite> sprites, int mask, int layer, float tieBreaker, size_t insertOrder, std::optional<Rect4f> clip)
 	: ptr(sprites.empty() ? nullptr : &sprites[0])
 	, count(uint32_t(sprites.size()))
@@ -56,6 +80,21 @@ SpritePainterEntryType SpritePainterEntry::getType() const
 	return type;
 }
 
+int SpritePainterEntry::getLayer() const
+{
+	return layer;
+}
+
+float SpritePainterEntry::getTieBreaker() const
+{
+	return tieBreaker;
+}
+
+size_t SpritePainterEntry::getInsertOrder() const
+{
+	return insertOrder;
+}
+
 gsl::span<const Sprite> SpritePainterEntry::getSprites() const
 {
 	Expects(ptr != nullptr);
@@ -93,9 +132,7 @@ const std::optional<Rect4f>& SpritePainterEntry::getClip() const
 
 void SpritePainter::start()
 {
-	sprites.clear();
-	cachedSprites.clear();
-	cachedText.clear();
+	dynamicEntries.clear();
 }
 
 void SpritePainter::start(size_t)
@@ -106,24 +143,23 @@ void SpritePainter::start(size_t)
 void SpritePainter::add(const Sprite& sprite, int mask, int layer, float tieBreaker, std::optional<Rect4f> clip)
 {
 	Expects(mask >= 0);
-	sprites.push_back(SpritePainterEntry(gsl::span<const Sprite>(&sprite, 1), mask, layer, tieBreaker, sprites.size(), std::move(clip)));
-	dirty = true;
+	auto& entries = dynamicEntries.entries;
+	entries.push_back(SpritePainterEntry(gsl::span<const Sprite>(&sprite, 1), mask, layer, tieBreaker, entries.size(), std::move(clip)));
+	dynamicEntries.dirty = true;
 }
 
 void SpritePainter::addCopy(const Sprite& sprite, int mask, int layer, float tieBreaker, std::optional<Rect4f> clip)
 {
-	Expects(mask >= 0);
-	sprites.push_back(SpritePainterEntry(SpritePainterEntryType::SpriteCached, cachedSprites.size(), 1, mask, layer, tieBreaker, sprites.size(), std::move(clip)));
-	cachedSprites.push_back(sprite);
-	dirty = true;
+	addCopy(gsl::span<const Sprite>(&sprite, 1), mask, layer, tieBreaker, std::move(clip));
 }
 
 void SpritePainter::add(gsl::span<const Sprite> sprites, int mask, int layer, float tieBreaker, std::optional<Rect4f> clip)
 {
 	Expects(mask >= 0);
 	if (!sprites.empty()) {
-		this->sprites.push_back(SpritePainterEntry(sprites, mask, layer, tieBreaker, this->sprites.size(), std::move(clip)));
-		dirty = true;
+		auto& entries = dynamicEntries.entries;
+		entries.push_back(SpritePainterEntry(sprites, mask, layer, tieBreaker, entries.size(), std::move(clip)));
+		dynamicEntries.dirty = true;
 	}
 }
 
@@ -131,73 +167,307 @@ void SpritePainter::addCopy(gsl::span<const Sprite> sprites, int mask, int layer
 {
 	Expects(mask >= 0);
 	if (!sprites.empty()) {
-		this->sprites.push_back(SpritePainterEntry(SpritePainterEntryType::SpriteCached, cachedSprites.size(), sprites.size(), mask, layer, tieBreaker, this->sprites.size(), std::move(clip)));
-		cachedSprites.insert(cachedSprites.end(), sprites.begin(), sprites.end());
-		dirty = true;
+		auto& set = dynamicEntries;
+		set.entries.push_back(SpritePainterEntry(SpritePainterEntryType::SpriteCached, set.cachedSprites.size(), sprites.size(), mask, layer, tieBreaker, set.entries.size(), std::move(clip)));
+		set.cachedSprites.insert(set.cachedSprites.end(), sprites.begin(), sprites.end());
+		set.dirty = true;
 	}
 }
 
 void SpritePainter::add(const TextRenderer& text, int mask, int layer, float tieBreaker, std::optional<Rect4f> clip)
 {
 	Expects(mask >= 0);
-	sprites.push_back(SpritePainterEntry(gsl::span<const TextRenderer>(&text, 1), mask, layer, tieBreaker, sprites.size(), std::move(clip)));
-	dirty = true;
+	auto& entries = dynamicEntries.entries;
+	entries.push_back(SpritePainterEntry(gsl::span<const TextRenderer>(&text, 1), mask, layer, tieBreaker, entries.size(), std::move(clip)));
+	dynamicEntries.dirty = true;
 }
 
 void SpritePainter::addCopy(const TextRenderer& text, int mask, int layer, float tieBreaker, std::optional<Rect4f> clip)
 {
 	Expects(mask >= 0);
-	sprites.push_back(SpritePainterEntry(SpritePainterEntryType::TextCached, cachedText.size(), 1, mask, layer, tieBreaker, sprites.size(), std::move(clip)));
-	cachedText.push_back(text);
-	dirty = true;
+	auto& set = dynamicEntries;
+	set.entries.push_back(SpritePainterEntry(SpritePainterEntryType::TextCached, set.cachedText.size(), 1, mask, layer, tieBreaker, set.entries.size(), std::move(clip)));
+	set.cachedText.push_back(text);
+	set.dirty = true;
 }
 
-void SpritePainter::draw(int mask, Painter& painter)
+void SpritePainter::addStatic(const Sprite& sprite, int mask, int layer, float tieBreaker, std::optional<Rect4f> clip)
 {
-	if (dirty) {
-		// TODO: implement hierarchical bucketing.
-		// - one bucket per layer
-		// - for each layer, one bucket per vertical band of the screen (32px or so)
-		// - sort each leaf bucket
-		std::sort(sprites.begin(), sprites.end()); // lol
-		dirty = false;
+	addStatic(gsl::span<const Sprite>(&sprite, 1), mask, layer, tieBreaker, std::move(clip));
+}
+
+void SpritePainter::addStatic(gsl::span<const Sprite> sprites, int mask, int layer, float tieBreaker, std::optional<Rect4f> clip)
+{
+	Expects(mask >= 0);
+	if (!sprites.empty()) {
+		auto& set = staticEntries;
+		set.entries.push_back(SpritePainterEntry(SpritePainterEntryType::SpriteCached, set.cachedSprites.size(), sprites.size(), mask, layer, tieBreaker, set.entries.size(), std::move(clip)));
+		set.cachedSprites.insert(set.cachedSprites.end(), sprites.begin(), sprites.end());
+		set.dirty = true;
 	}
+}
+
+void SpritePainter::addStatic(const TextRenderer& text, int mask, int layer, float tieBreaker, std::optional<Rect4f> clip)
+{
+	Expects(mask >= 0);
+	auto& set = staticEntries;
+	set.entries.push_back(SpritePainterEntry(SpritePainterEntryType::TextCached, set.cachedText.size(), 1, mask, layer, tieBreaker, set.entries.size(), std::move(clip)));
+	set.cachedText.push_back(text);
+	set.dirty = true;
+}
+
+void SpritePainter::clearStatic()
+{
+	staticEntries.clear();
+}
+
+void SpritePainter::draw(int mask, Painter& painter)
+{
+	dynamicEntries.sort();
+	staticEntries.sort();
 
 	// View
 	auto& cam = painter.getCurrentCamera();
 	Rect4f view = cam.getClippingRectangle();
 
-	// Draw!
-	for (auto& s : sprites) {
-		if ((s.getMask() & mask) != 0) {
-			const auto type = s.getType();
-			
-			if (type == SpritePainterEntryType::SpriteRef) {
-				draw(s.getSprites(), painter, view, s.getClip());
-			} else if (type == SpritePainterEntryType::SpriteCached) {
-				draw(gsl::span<const Sprite>(cachedSprites.data() + s.getIndex(), s.getCount()), painter, view, s.getClip());
-			} else if (type == SpritePainterEntryType::TextRef) {
-				draw(s.getTexts(), painter, view, s.getClip());
-			} else if (type == SpritePainterEntryType::TextCached) {
-				draw(gsl::span<const TextRenderer>(cachedText.data() + s.getIndex(), s.getCount()), painter, view, s.getClip());
-			}
+	// Draw! Both sets of buckets are sorted, so merge them as we go
+	const auto& dynamicBuckets = dynamicEntries.buckets;
+	const auto& staticBuckets = staticEntries.buckets;
+	size_t i = 0;
+	size_t j = 0;
+	while (i < dynamicBuckets.size() || j < staticBuckets.size()) {
+		const auto dynamicKey = i < dynamicBuckets.size() ? makeBucketKey(dynamicBuckets[i].layer, dynamicBuckets[i].band) : std::numeric_limits<uint64_t>::max();
+		const auto staticKey = j < staticBuckets.size() ? makeBucketKey(staticBuckets[j].layer, staticBuckets[j].band) : std::numeric_limits<uint64_t>::max();
+		
+		if (j == staticBuckets.size() || (i < dynamicBuckets.size() && dynamicKey < staticKey)) {
+			draw(dynamicEntries, dynamicBuckets[i++], mask, painter, view);
+		} else if (i == dynamicBuckets.size() || staticKey < dynamicKey) {
+			draw(staticEntries, staticBuckets[j++], mask, painter, view);
+		} else {
+			drawMerged(dynamicBuckets[i++], staticBuckets[j++], mask, painter, view);
 		}
 	}
 	painter.flush();
 }
 
-void SpritePainter::draw(gsl::span<const Sprite> sprites, Painter& painter, Rect4f view, const std::optional<Rect4f>& clip) const
+void SpritePainter::draw(const EntrySet& set, const Bucket& bucket, int mask, Painter& painter, Rect4f view) const
+{
+	if (!isBucketVisible(bucket, mask, view)) {
+		return;
+	}
+
+	// If the whole bucket is in view, there's no need to check each entry
+	const bool cull = !isInside(bucket.bounds, view);
+	for (uint32_t i = bucket.begin; i < bucket.end; ++i) {
+		const auto idx = set.order[i];
+		if ((set.entries[idx].getMask() & mask) != 0) {
+			draw(set, idx, cull, painter, view);
+		}
+	}
+}
+
+void SpritePainter::drawMerged(const Bucket& dynamicBucket, const Bucket& staticBucket, int mask, Painter& painter, Rect4f view) const
+{
+	const bool dynamicVisible = isBucketVisible(dynamicBucket, mask, view);
+	const bool staticVisible = isBucketVisible(staticBucket, mask, view);
+	if (!dynamicVisible || !staticVisible) {
+		if (dynamicVisible) {
+			draw(dynamicEntries, dynamicBucket, mask, painter, view);
+		} else if (staticVisible) {
+			draw(staticEntries, staticBucket, mask, painter, view);
+		}
+		return;
+	}
+
+	const bool cullDynamic = !isInside(dynamicBucket.bounds, view);
+	const bool cullStatic = !isInside(staticBucket.bounds, view);
+	uint32_t i = dynamicBucket.begin;
+	uint32_t j = staticBucket.begin;
+	while (i < dynamicBucket.end || j < staticBucket.end) {
+		const bool takeStatic = i == dynamicBucket.end
+			|| (j < staticBucket.end && staticEntries.entries[staticEntries.order[j]].getTieBreaker() <= dynamicEntries.entries[dynamicEntries.order[i]].getTieBreaker());
+		
+		const auto& set = takeStatic ? staticEntries : dynamicEntries;
+		const auto idx = takeStatic ? set.order[j++] : set.order[i++];
+		if ((set.entries[idx].getMask() & mask) != 0) {
+			draw(set, idx, takeStatic ? cullStatic : cullDynamic, painter, view);
+		}
+	}
+}
+
+void SpritePainter::draw(const EntrySet& set, uint32_t entryIdx, bool cull, Painter& painter, Rect4f view) const
+{
+	const auto& entry = set.entries[entryIdx];
+	const auto type = entry.getType();
+
+	if (type == SpritePainterEntryType::SpriteRef || type == SpritePainterEntryType::SpriteCached) {
+		const auto& bounds = set.bounds[entryIdx];
+		if (!bounds) {
+			// Nothing visible
+			return;
+		}
+		if (cull && !bounds->overlaps(view)) {
+			return;
+		}
+		const auto sprites = set.getSprites(entry);
+		draw(sprites, cull && sprites.size() > 1 && !isInside(*bounds, view), painter, view, entry.getClip());
+	} else {
+		draw(set.getTexts(entry), painter, entry.getClip());
+	}
+}
+
+void SpritePainter::draw(gsl::span<const Sprite> sprites, bool cull, Painter& painter, Rect4f view, const std::optional<Rect4f>& clip) const
 {
 	for (const auto& sprite: sprites) {
-		if (sprite.isInView(view)) {
+		if (cull ? sprite.isInView(view) : sprite.isVisible()) {
 			sprite.draw(painter, clip);
 		}
 	}
 }
 
-void SpritePainter::draw(gsl::span<const TextRenderer> texts, Painter& painter, Rect4f view, const std::optional<Rect4f>& clip) const
+void SpritePainter::draw(gsl::span<const TextRenderer> texts, Painter& painter, const std::optional<Rect4f>& clip) const
 {
 	for (const auto& text: texts) {
 		text.draw(painter, clip);
 	}
 }
+
+bool SpritePainter::isBucketVisible(const Bucket& bucket, int mask, Rect4f view)
+{
+	return (bucket.mask & mask) != 0 && (!bucket.cullable || bucket.bounds.overlaps(view));
+}
+
+void SpritePainter::EntrySet::clear()
+{
+	entries.clear();
+	cachedSprites.clear();
+	cachedText.clear();
+	order.clear();
+	buckets.clear();
+	bounds.clear();
+	dirty = false;
+}
+
+void SpritePainter::EntrySet::sort()
+{
+	if (!dirty) {
+		return;
+	}
+	dirty = false;
+
+	const size_t n = entries.size();
+	keys.resize(n);
+	keysTmp.resize(n);
+	order.resize(n);
+	buckets.clear();
+	if (n == 0) {
+		return;
+	}
+
+	// Radix sort (layer, band) keys, 8 bits at a time. This is stable, and entries are in insert order, so each bucket stays in insert order.
+	std::array<std::array<uint32_t, 256>, 8> histograms = {};
+	for (size_t i = 0; i < n; ++i) {
+		const auto& e = entries[i];
+		const auto key = makeBucketKey(e.getLayer(), getBand(e.getTieBreaker()));
+		keys[i] = { key, uint32_t(i) };
+		for (size_t digit = 0; digit < 8; ++digit) {
+			++histograms[digit][(key >> (digit * 8)) & 0xFF];
+		}
+	}
+
+	for (size_t digit = 0; digit < 8; ++digit) {
+		const size_t shift = digit * 8;
+		auto& histogram = histograms[digit];
+		if (histogram[(keys[0].first >> shift) & 0xFF] == n) {
+			// Every key has the same value for this digit, typical for the upper bits of layer and band
+			continue;
+		}
+
+		uint32_t offset = 0;
+		for (auto& h: histogram) {
+			const auto count = h;
+			h = offset;
+			offset += count;
+		}
+		for (const auto& k: keys) {
+			keysTmp[histogram[(k.first >> shift) & 0xFF]++] = k;
+		}
+		std::swap(keys, keysTmp);
+	}
+
+	// Each run of equal keys is a bucket; sort its entries by tie breaker
+	computeBounds();
+	for (size_t i = 0; i < n; ++i) {
+		order[i] = keys[i].second;
+	}
+	for (size_t begin = 0; begin < n; ) {
+		size_t end = begin + 1;
+		while (end < n && keys[end].first == keys[begin].first) {
+			++end;
+		}
+
+		const auto cmp = [&] (uint32_t a, uint32_t b) { return entries[a] < entries[b]; };
+		std::sort(order.begin() + begin, order.begin() + end, cmp);
+
+		auto& bucket = buckets.emplace_back();
+		const auto& first = entries[order[begin]];
+		bucket.layer = first.getLayer();
+		bucket.band = getBand(first.getTieBreaker());
+		bucket.begin = uint32_t(begin);
+		bucket.end = uint32_t(end);
+
+		std::optional<Rect4f> bucketBounds;
+		for (size_t i = begin; i < end; ++i) {
+			const auto idx = order[i];
+			const auto& entry = entries[idx];
+			bucket.mask |= entry.getMask();
+			const auto type = entry.getType();
+			if (type == SpritePainterEntryType::TextRef || type == SpritePainterEntryType::TextCached) {
+				bucket.cullable = false;
+			} else if (bounds[idx]) {
+				bucketBounds = bucketBounds ? bucketBounds->merge(*bounds[idx]) : *bounds[idx];
+			}
+		}
+		bucket.bounds = bucketBounds.value_or(Rect4f());
+
+		begin = end;
+	}
+}
+
+void SpritePainter::EntrySet::computeBounds()
+{
+	bounds.resize(entries.size());
+	for (size_t i = 0; i < entries.size(); ++i) {
+		const auto& entry = entries[i];
+		auto& result = bounds[i];
+		result.reset();
+
+		const auto type = entry.getType();
+		if (type == SpritePainterEntryType::SpriteRef || type == SpritePainterEntryType::SpriteCached) {
+			for (const auto& sprite: getSprites(entry)) {
+				if (sprite.isVisible()) {
+					const auto aabb = sprite.getAABB();
+					result = result ? result->merge(aabb) : aabb;
+				}
+			}
+		}
+	}
+}
+
+gsl::span<const Sprite> SpritePainter::EntrySet::getSprites(const SpritePainterEntry& entry) const
+{
+	if (entry.getType() == SpritePainterEntryType::SpriteRef) {
+		return entry.getSprites();
+	} else {
+		return gsl::span<const Sprite>(cachedSprites.data() + entry.getIndex(), entry.getCount());
+	}
+}
+
+gsl::span<const TextRenderer> SpritePainter::EntrySet::getTexts(const SpritePainterEntry& entry) const
+{
+	if (entry.getType() == SpritePainterEntryType::TextRef) {
+		return entry.getTexts();
+	} else {
+		return gsl::span<const TextRenderer>(cachedText.data() + entry.getIndex(), entry.getCount());
+	}
+}
@@ -184,6 +184,11 @@ std::shared_ptr<Material> Font::getMaterial() const
 	return material;
 }
 
+void Font::setMaterial(std::shared_ptr<Material> m)
+{
+	material = std::move(m);
+}
+
 void Font::serialize(Serializer& s) const
 {
 	s << name;
@@ -7,9 +7,128 @@
 
 #include "halley/support/logger.h"
 #include "halley/text/i18n.h"
+#include "halley/utils/hash.h"
+#include <mutex>
+#include <unordered_map>
 
 using namespace Halley;
 
+struct TextRenderer::GlyphRun {
+	Vector<Sprite> sprites;
+	Vector<const Font*> fonts; // The font each glyph came from, which can be a fallback
+	std::shared_ptr<const Font> font; // Keeps the font alive, so its address can't be reused while the run is cached
+	int fontVersion = 0;
+};
+
+namespace {
+	// Everything the layout reads, other than the font's own glyphs
+	struct GlyphRunKey {
+		const Font* font;
+		int fontVersion;
+		StringUTF32 text;
+		float size;
+		Colour colour;
+		std::vector<ColourOverride> colourOverrides;
+		float align;
+		Vector2f offset;
+		Vector2f pixelOffset;
+		float lineSpacing;
+
+		bool operator==(const GlyphRunKey& other) const
+		{
+			return font == other.font && fontVersion == other.fontVersion && text == other.text && size == other.size && colour == other.colour
+				&& colourOverrides == other.colourOverrides && align == other.align && offset == other.offset && pixelOffset == other.pixelOffset && lineSpacing == other.lineSpacing;
+		}
+	};
+
+	struct GlyphRunKeyHasher {
+		size_t operator()(const GlyphRunKey& key) const
+		{
+			Hash::Hasher hasher;
+			auto feedFloat = [&] (float v)
+			{
+				hasher.feed(v + 0.0f); // -0 compares equal to 0, so it must hash the same
+			};
+			auto feedColour = [&] (const Colour& c)
+			{
+				feedFloat(c.r);
+				feedFloat(c.g);
+				feedFloat(c.b);
+				feedFloat(c.a);
+			};
+
+			hasher.feed(key.font);
+			hasher.feed(key.fontVersion);
+			hasher.feedBytes(gsl::as_bytes(gsl::span<const char32_t>(key.text.data(), key.text.size())));
+			feedFloat(key.size);
+			feedColour(key.colour);
+			for (const auto& [pos, col]: key.colourOverrides) {
+				hasher.feed(pos);
+				hasher.feed(col.has_value());
+				if (col) {
+					feedColour(col.value());
+				}
+			}
+			feedFloat(key.align);
+			feedFloat(key.offset.x);
+			feedFloat(key.offset.y);
+			feedFloat(key.pixelOffset.x);
+			feedFloat(key.pixelOffset.y);
+			feedFloat(key.lineSpacing);
+			return size_t(hasher.digest());
+		}
+	};
+
+	// Runs stay cached for as long as any renderer holds them, so identical labels are laid out once
+	template <typename Run>
+	class GlyphRunCache {
+	public:
+		template <typename F>
+		std::shared_ptr<const Run> get(const GlyphRunKey& key, F generate)
+		{
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				const auto iter = runs.find(key);
+				if (iter != runs.end()) {
+					if (auto run = iter->second.lock()) {
+						return run;
+					}
+				}
+			}
+
+			// Laid out without the lock, if two threads race for the same key the first one stored wins
+			std::shared_ptr<const Run> run = generate();
+
+			std::unique_lock<std::mutex> lock(mutex);
+			auto& entry = runs[key];
+			if (auto existing = entry.lock()) {
+				return existing;
+			}
+			entry = run;
+
+			if (runs.size() >= sweepThreshold) {
+				for (auto iter = runs.begin(); iter != runs.end();) {
+					if (iter->second.expired()) {
+						iter = runs.erase(iter);
+					} else {
+						++iter;
+					}
+				}
+				sweepThreshold = std::max(minSweepThreshold, runs.size() * 2);
+			}
+
+			return run;
+		}
+
+	private:
+		constexpr static size_t minSweepThreshold = 256;
+
+		std::mutex mutex;
+		std::unordered_map<GlyphRunKey, std::weak_ptr<const Run>, GlyphRunKeyHasher> runs;
+		size_t sweepThreshold = minSweepThreshold;
+	};
+}
+
 TextRenderer::TextRenderer()
 {
 }
@@ -37,6 +156,7 @@ TextRenderer& TextRenderer::setFont(std::shared_ptr<const Font> v)
 {
 	if (font != v) {
 		font = v;
+		glyphsDirty = true;
 
 		if (font->isDistanceField()) {
 			materialDirty = true;
@@ -183,9 +303,67 @@ TextRenderer TextRenderer::clone() const
 }
 
 void TextRenderer::generateSprites(std::vector<Sprite>& sprites) const
+{
+	const auto& run = getGlyphRun();
+	sprites.resize(run.sprites.size());
+	copyGlyphs(run, gsl::span<Sprite>(sprites.data(), sprites.size()));
+	for (size_t i = 0; i < sprites.size(); ++i) {
+		sprites[i].setPos(run.sprites[i].getPosition() + position);
+	}
+}
+
+const TextRenderer::GlyphRun& TextRenderer::getGlyphRun() const
 {
 	Expects(font != nullptr);
 
+	if (font->isDistanceField() && materialDirty) {
+		updateMaterials();
+		materialDirty = false;
+	}
+
+	// The font version catches hot reloads, which keep the same font object
+	if (glyphsDirty || !glyphRun || glyphRun->fontVersion != font->getAssetVersion()) {
+		static GlyphRunCache<GlyphRun> cache;
+		const auto key = GlyphRunKey{ font.get(), font->getAssetVersion(), text, size, colour, colourOverrides, align, offset, pixelOffset, lineSpacing };
+		glyphRun = cache.get(key, [&] ()
+		{
+			auto run = std::make_shared<GlyphRun>();
+			run->font = font;
+			run->fontVersion = font->getAssetVersion();
+			layoutGlyphs(*run);
+			return run;
+		});
+		glyphsDirty = false;
+		spritesDirty = true;
+	}
+
+	return *glyphRun;
+}
+
+void TextRenderer::copyGlyphs(const GlyphRun& run, gsl::span<Sprite> dst) const
+{
+	Expects(dst.size() == run.sprites.size());
+
+	if (!font->isDistanceField()) {
+		std::copy(run.sprites.begin(), run.sprites.end(), dst.begin());
+		return;
+	}
+
+	// Runs are shared, so they hold the font materials. Distance field materials carry this renderer's outline and smoothness.
+	const Font* lastFont = nullptr;
+	std::shared_ptr<Material> material;
+	for (size_t i = 0; i < run.sprites.size(); ++i) {
+		if (run.fonts[i] != lastFont) {
+			lastFont = run.fonts[i];
+			material = getMaterial(*lastFont);
+		}
+		dst[i] = run.sprites[i];
+		dst[i].setMaterial(material, true);
+	}
+}
+
+void TextRenderer::layoutGlyphs(GlyphRun& run) const
+{
 	bool floorEnabled = false;
 	auto floorAlign = [floorEnabled] (Vector2f a) -> Vector2f
 	{
@@ -196,104 +374,115 @@ void TextRenderer::generateSprites(std::vector<Sprite>& sprites) const
 		}
 	};
 
-	const bool hasMaterialOverride = font->isDistanceField();
-	if (hasMaterialOverride && materialDirty) {
-		updateMaterials();
-		materialDirty = false;
-	}
+	auto& sprites = run.sprites;
 
-	if (glyphsDirty || positionDirty) {
-		float mainScale = getScale(*font);
-		Vector2f p = floorAlign(position + Vector2f(0, font->getAscenderDistance() * mainScale));
-		if (offset != Vector2f(0, 0)) {
-			p -= floorAlign(getExtents() * offset);
-		}
+	// Laid out at the origin, the text position is applied when the run is copied out
+	float mainScale = getScale(*font);
+	Vector2f p = floorAlign(Vector2f(0, font->getAscenderDistance() * mainScale));
+	if (offset != Vector2f(0, 0)) {
+		p -= floorAlign(getExtents() * offset);
+	}
 
-		size_t startPos = 0;
-		size_t spritesInserted = 0;
-		Vector2f lineOffset;
+	size_t startPos = 0;
+	size_t spritesInserted = 0;
+	Vector2f lineOffset;
 
-		auto flush = [&] ()
-		{
-			// Line break, update previous characters!
-			if (align != 0) {
-				Vector2f off = floorAlign(-lineOffset * align);
-				for (size_t j = startPos; j < spritesInserted; j++) {
-					auto& sprite = sprites[j];
-					sprite.setPos(sprite.getPosition() + off);
-				}
+	auto flush = [&] ()
+	{
+		// Line break, update previous characters!
+		if (align != 0) {
+			Vector2f off = floorAlign(-lineOffset * align);
+			for (size_t j = startPos; j < spritesInserted; j++) {
+				auto& sprite = sprites[j];
+				sprite.setPos(sprite.getPosition() + off);
 			}
+		}
 
-			// Move pen
-			p.y += getLineHeight();
+		// Move pen
+		p.y += getLineHeight();
 
-			// Reset
-			startPos = spritesInserted;
-			lineOffset.x = 0;
-		};
+		// Reset
+		startPos = spritesInserted;
+		lineOffset.x = 0;
+	};
 
-		auto curCol = colour;
-		size_t curOverride = 0;
+	auto curCol = colour;
+	size_t curOverride = 0;
 
-		const size_t n = text.size();
+	const size_t n = text.size();
 
-		size_t nGlyphs = 0;
-		for (size_t i = 0; i < n; i++) {
-			if (text[i] != '\n') {
-				++nGlyphs;
-			}
+	size_t nGlyphs = 0;
+	for (size_t i = 0; i < n; i++) {
+		if (text[i] != '\n') {
+			++nGlyphs;
 		}
-		sprites.resize(nGlyphs);
+	}
+	sprites.resize(nGlyphs);
+	run.fonts.resize(nGlyphs);
 
-		for (size_t i = 0; i < n; i++) {
-			int c = text[i];
+	for (size_t i = 0; i < n; i++) {
+		int c = text[i];
 
-			// Check for colour override
-			while (curOverride < colourOverrides.size() && colourOverrides[curOverride].first == i) {
-				curCol = colourOverrides[curOverride].second ? colourOverrides[curOverride].second.value() : colour;
-				++curOverride;
-			}
-			
-			if (c == '\n') {
+		// Check for colour override
+		while (curOverride < colourOverrides.size() && colourOverrides[curOverride].first == i) {
+			curCol = colourOverrides[curOverride].second ? colourOverrides[curOverride].second.value() : colour;
+			++curOverride;
+		}
+		
+		if (c == '\n') {
+			flush();
+		} else {
+			const auto& [glyph, fontForGlyph] = font->getGlyph(c);
+			const float scale = getScale(fontForGlyph);
+			const auto fontAdjustment = floorAlign(Vector2f(0, fontForGlyph.getAscenderDistance() - font->getAscenderDistance()) * scale);
+
+			run.fonts[spritesInserted] = &fontForGlyph;
+			sprites[spritesInserted++] = Sprite()
+				.setMaterial(fontForGlyph.getMaterial(), true)
+				.setSize(glyph.size)
+				.setTexRect(glyph.area)
+				.setColour(curCol)
+				.setPivot(glyph.horizontalBearing / glyph.size * Vector2f(-1, 1))
+				.setScale(scale)
+				.setPos(p + lineOffset + pixelOffset + fontAdjustment);
+
+			lineOffset.x += glyph.advance.x * scale;
+
+			if (i == n - 1) {
 				flush();
-			} else {
-				const auto& [glyph, fontForGlyph] = font->getGlyph(c);
-				const float scale = getScale(fontForGlyph);
-				const auto fontAdjustment = floorAlign(Vector2f(0, fontForGlyph.getAscenderDistance() - font->getAscenderDistance()) * scale);
-
-				std::shared_ptr<Material> materialToUse = hasMaterialOverride ? getMaterial(fontForGlyph) : fontForGlyph.getMaterial();
-
-				sprites[spritesInserted++] = Sprite()
-					.setMaterial(std::move(materialToUse), true)
-					.setSize(glyph.size)
-					.setTexRect(glyph.area)
-					.setColour(curCol)
-					.setPivot(glyph.horizontalBearing / glyph.size * Vector2f(-1, 1))
-					.setScale(scale)
-					.setPos(p + lineOffset + pixelOffset + fontAdjustment);
-
-				lineOffset.x += glyph.advance.x * scale;
-
-				if (i == n - 1) {
-					flush();
-				}
 			}
 		}
+	}
+}
 
-		glyphsDirty = false;
+void TextRenderer::updateSpritesCache() const
+{
+	const auto& run = getGlyphRun();
+
+	if (spritesDirty) {
+		// New glyphs, or the sprite filter changed the previous ones
+		spritesCache.resize(run.sprites.size());
+		copyGlyphs(run, gsl::span<Sprite>(spritesCache.data(), spritesCache.size()));
+		positionDirty = true;
+		spritesDirty = false;
+	}
+
+	if (positionDirty) {
+		for (size_t i = 0; i < run.sprites.size(); ++i) {
+			spritesCache[i].setPos(run.sprites[i].getPosition() + position);
+		}
 		positionDirty = false;
 	}
 }
 
 void TextRenderer::draw(Painter& painter, const std::optional<Rect4f>& extClip) const
 {
-	generateSprites(spritesCache);
+	updateSpritesCache();
 
 	if (spriteFilter) {
-		// We don't know what the user will do with glyphs, so mark them as dirty
+		// We don't know what the user will do with glyphs, so they get copied from the glyph run again next time
 		spriteFilter(gsl::span<Sprite>(spritesCache.data(), spritesCache.size()));
-		glyphsDirty = true;
-		positionDirty = true;
+		spritesDirty = true;
 	}
 
 	const std::optional<Rect4f> myClip = clip ? clip.value() + position : std::optional<Rect4f>();
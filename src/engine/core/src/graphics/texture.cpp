@@ -2,6 +2,7 @@
 #include "halley/core/api/halley_api.h"
 #include "halley/core/graphics/texture_descriptor.h"
 #include <halley/file_formats/image.h>
+#include <halley/file_formats/texture_container.h>
 #include <halley/resources/metadata.h>
 #include "halley/concurrency/concurrent.h"
 #include "halley/support/logger.h"
@@ -39,10 +40,49 @@ std::optional<uint32_t> Texture::getPixel(Vector2f texPos) const
 	return {};
 }
 
+size_t Texture::getMemoryUsage() const
+{
+	// Estimated from the metadata, as the descriptor is only filled in once the async load completes
+	const auto& meta = getMeta();
+	size_t bpp = 4;
+	switch (fromString<Image::Format>(meta.getString("format", "rgba"))) {
+	case Image::Format::RGB:
+		bpp = 3;
+		break;
+	case Image::Format::Indexed:
+	case Image::Format::SingleChannel:
+		bpp = 1;
+		break;
+	default:
+		break;
+	}
+
+	const int nLevels = meta.getBool("mipmap", false) ? TextureContainer::getNumMipLevels(size) : 1;
+	size_t total = 0;
+	for (int i = 0; i < nLevels; ++i) {
+		const auto levelSize = TextureContainer::getMipLevelSize(size, i);
+		total += size_t(levelSize.x) * size_t(levelSize.y) * bpp;
+	}
+
+	// CPU copy kept around for getPixel
+	if (retainsPixelData) {
+		total += size_t(size.x) * size_t(size.y) * bpp;
+	}
+	return total;
+}
+
 void Texture::doLoad(TextureDescriptor& descriptor)
 {
 }
 
+namespace {
+	// Set by the texture importer, regardless of the "compression" the source image came in
+	bool isContainer(const Metadata& meta)
+	{
+		return meta.getString("textureFormat", "") == "htex";
+	}
+}
+
 std::shared_ptr<Texture> Texture::loadResource(ResourceLoader& loader)
 {
 	const auto& meta = loader.getMeta();
@@ -55,12 +95,17 @@ std::shared_ptr<Texture> Texture::loadResource(ResourceLoader& loader)
 	std::shared_ptr<Texture> texture = loader.getAPI().video->createTexture(size);
 	texture->setMeta(meta);
 	bool retain = loader.getResources().getOptions().retainPixelData;
+	texture->retainsPixelData = retain;
 
 	loader.getAsync(true)
 	.then([texture](std::unique_ptr<ResourceDataStatic> data) -> TextureDescriptorImageData
 	{
 		auto& meta = texture->getMeta();
-		if (meta.getString("compression") == "png") {
+		if (isContainer(meta)) {
+			// Already in upload layout, only needs its strips decompressed
+			const auto container = TextureContainer(data->getSpan());
+			return TextureDescriptorImageData(container.decode(&Executors::getCPU()));
+		} else if (meta.getString("compression") == "png") {
 			return TextureDescriptorImageData(std::make_unique<Image>(*data, meta));
 		} else {
 			return TextureDescriptorImageData(data->getSpan());
@@ -97,7 +142,8 @@ std::shared_ptr<Texture> Texture::loadResource(ResourceLoader& loader)
 		descriptor.addressMode = fromString<TextureAddressMode>(meta.getString("addressMode", "clamp"));
 		descriptor.format = format;
 		descriptor.pixelData = std::move(img);
-		descriptor.pixelFormat = meta.getString("compression") == "png" ? PixelDataFormat::Image : PixelDataFormat::Precompiled;
+		descriptor.pixelFormat = !isContainer(meta) && meta.getString("compression") == "png" ? PixelDataFormat::Image : PixelDataFormat::Precompiled;
+		descriptor.mipLevels = meta.getInt("mipLevels", 1);
 		descriptor.retainPixelData = retain;
 		texture->load(std::move(descriptor));
 	});
@@ -112,6 +112,7 @@ TextureDescriptor& TextureDescriptor::operator=(TextureDescriptor&& other) noexc
 	format = other.format;
 	pixelFormat = other.pixelFormat;
 	pixelData = std::move(other.pixelData);
+	mipLevels = other.mipLevels;
 	useMipMap = other.useMipMap;
 	useFiltering = other.useFiltering;
 	addressMode = other.addressMode;
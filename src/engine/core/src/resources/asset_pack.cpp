@@ -1,21 +1,98 @@
 #include "resources/asset_pack.h"
 #include "resources/asset_database.h"
 #include "halley/resources/resource_data.h"
+#include "halley/resources/resource.h"
 #include "halley/bytes/byte_serializer.h"
 #include "halley/bytes/compression.h"
 #include "halley/maths/random.h"
 #include "halley/utils/encrypt.h"
+#include "halley/file/mapped_file.h"
 
 using namespace Halley;
 
-void AssetPackHeader::init(size_t assetDbSize)
+namespace {
+	// v1 packs store raw assets as "pos:size", and may be encrypted as a whole
+	// v2 packs store each asset on its own as "pos:storedSize:size:flags"
+	constexpr const char* packIdentifierV1 = "HALLEYPK";
+	constexpr const char* packIdentifierV2 = "HALLEYP2";
+
+	constexpr int entryFlagCompressed = 1;
+	constexpr int entryFlagEncrypted = 2;
+
+	// Reads from a decoded asset, which may be shared with other readers of the same stream
+	class BufferDataReader final : public ResourceDataReader {
+	public:
+		BufferDataReader(std::shared_ptr<const Bytes> data) : data(std::move(data)) {}
+
+		size_t size() const override { return data->size(); }
+		size_t tell() const override { return pos; }
+		void close() override {}
+
+		int read(gsl::span<gsl::byte> dst) override
+		{
+			const size_t toRead = std::min(size_t(dst.size()), data->size() - std::min(pos, data->size()));
+			memcpy(dst.data(), data->data() + pos, toRead);
+			pos += toRead;
+			return int(toRead);
+		}
+
+		void seek(int64_t offset, int whence) override
+		{
+			switch (whence) {
+			case SEEK_SET:
+				pos = size_t(offset);
+				break;
+			case SEEK_CUR:
+				pos = size_t(int64_t(pos) + offset);
+				break;
+			case SEEK_END:
+				pos = size_t(int64_t(data->size()) + offset);
+				break;
+			}
+		}
+
+	private:
+		std::shared_ptr<const Bytes> data;
+		size_t pos = 0;
+	};
+
+	// Decodes a streamed asset when its first reader is opened, and keeps it for as long as the stream is around
+	class SharedDecodedAsset {
+	public:
+		template <typename F>
+		std::shared_ptr<const Bytes> get(F decode)
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			if (!bytes) {
+				bytes = std::make_shared<const Bytes>(decode());
+			}
+			return bytes;
+		}
+
+	private:
+		std::mutex mutex;
+		std::shared_ptr<const Bytes> bytes;
+	};
+}
+
+void AssetPackHeader::init(size_t assetDbSize, int version)
 {
-	memcpy(identifier.data(), "HALLEYPK", 8);
+	memcpy(identifier.data(), version >= 2 ? packIdentifierV2 : packIdentifierV1, 8);
 	assetDbStartPos = sizeof(AssetPackHeader);
 	dataStartPos = assetDbStartPos + assetDbSize;
 	memset(iv.data(), 0, iv.size());
 }
 
+int AssetPackHeader::getVersion() const
+{
+	if (memcmp(identifier.data(), packIdentifierV1, 8) == 0) {
+		return 1;
+	} else if (memcmp(identifier.data(), packIdentifierV2, 8) == 0) {
+		return 2;
+	}
+	return 0;
+}
+
 AssetPack::AssetPack()
 	: assetDb(std::make_unique<AssetDatabase>())
 	, hasReader(false)
@@ -28,9 +105,10 @@ AssetPack::AssetPack(AssetPack&& other) noexcept
 	*this = std::move(other);
 }
 
-AssetPack::AssetPack(std::unique_ptr<ResourceDataReader> _reader, const String& encryptionKey, bool preLoad)
+AssetPack::AssetPack(std::unique_ptr<ResourceDataReader> _reader, const String& _encryptionKey, bool preLoad)
 	: reader(std::move(_reader))
 	, hasReader(true)
+	, encryptionKey(_encryptionKey)
 {
 	// Read header
 	size_t totalSize = reader->size();
@@ -42,11 +120,7 @@ AssetPack::AssetPack(std::unique_ptr<ResourceDataReader> _reader, const String&
 	if (nRead != int(sizeof(header))) {
 		throw Exception("Unable to read header", HalleyExceptions::Resources);
 	}
-	if (memcmp(header.identifier.data(), "HALLEYPK", 8) != 0) {
-		throw Exception("Asset pack is invalid (invalid identifier)", HalleyExceptions::Resources);
-	}
-	iv = header.iv;
-	dataOffset = size_t(header.dataStartPos);
+	readHeader(header);
 
 	// Read asset database
 	{
@@ -56,13 +130,10 @@ AssetPack::AssetPack(std::unique_ptr<ResourceDataReader> _reader, const String&
 		if (nRead != int(assetDbBytes.size())) {
 			throw Exception("Unable to read header", HalleyExceptions::Resources);
 		}
-		assetDb = std::make_unique<AssetDatabase>();
-		Deserializer::fromBytes<AssetDatabase>(*assetDb, Compression::decompress(assetDbBytes));
+		loadAssetDatabase(gsl::as_bytes(gsl::span<Byte>(assetDbBytes)));
 	}
 
-	std::array<char, 16> ivEmpty;
-	memset(ivEmpty.data(), 0, ivEmpty.size());
-	const bool hasCrypt = memcmp(iv.data(), ivEmpty.data(), iv.size()) != 0 && !encryptionKey.isEmpty();
+	const bool hasCrypt = hasPackEncryption();
 
 	if (preLoad || hasCrypt) {
 		readToMemory();
@@ -73,6 +144,124 @@ AssetPack::AssetPack(std::unique_ptr<ResourceDataReader> _reader, const String&
 	}
 }
 
+AssetPack::AssetPack(std::shared_ptr<const MappedFile> _mapping, const String& _encryptionKey, bool)
+	: mapping(std::move(_mapping))
+	, hasReader(false)
+	, encryptionKey(_encryptionKey)
+{
+	const auto bytes = mapping->getSpan();
+	if (size_t(bytes.size()) < sizeof(AssetPackHeader)) {
+		throw Exception("Asset pack is invalid (too small)", HalleyExceptions::Resources);
+	}
+	AssetPackHeader header;
+	memcpy(&header, bytes.data(), sizeof(header));
+	readHeader(header);
+	if (header.dataStartPos < header.assetDbStartPos || header.dataStartPos > uint64_t(bytes.size())) {
+		throw Exception("Asset pack is invalid (truncated)", HalleyExceptions::Resources);
+	}
+	loadAssetDatabase(bytes.subspan(ptrdiff_t(header.assetDbStartPos), ptrdiff_t(header.dataStartPos - header.assetDbStartPos)));
+
+	// Encrypted data has to be decrypted as a whole, so it can't be read from the mapping
+	// There's nothing to preload otherwise, the OS pages the mapping in as it's touched
+	if (hasPackEncryption()) {
+		readToMemory();
+		decrypt(encryptionKey);
+	}
+}
+
+void AssetPack::readHeader(const AssetPackHeader& header)
+{
+	version = header.getVersion();
+	if (version == 0) {
+		throw Exception("Asset pack is invalid (invalid identifier)", HalleyExceptions::Resources);
+	}
+	iv = header.iv;
+	dataOffset = size_t(header.dataStartPos);
+}
+
+void AssetPack::loadAssetDatabase(gsl::span<const gsl::byte> assetDbBytes)
+{
+	assetDb = std::make_unique<AssetDatabase>();
+	Deserializer::fromBytes<AssetDatabase>(*assetDb, Compression::decompress(assetDbBytes));
+	buildIndex();
+}
+
+void AssetPack::buildIndex()
+{
+	// Parse the entry strings once, instead of on every fetch
+	const auto nTypes = EnumNames<AssetType>()().size();
+	index.clear();
+	index.resize(nTypes);
+	for (size_t i = 0; i < nTypes; ++i) {
+		const auto type = AssetType(i);
+		if (assetDb->hasDatabase(type)) {
+			const auto& assets = assetDb->getDatabase(type).getAssets();
+			auto& typeIndex = index[i];
+			typeIndex.reserve(assets.size());
+			for (const auto& a: assets) {
+				if (auto entry = parseIndexEntry(a.second.path)) {
+					typeIndex[a.first] = *entry;
+				}
+			}
+		}
+	}
+}
+
+AssetPack::IndexEntry AssetPack::getIndexEntry(const String& asset, AssetType type) const
+{
+	const auto typeIdx = size_t(type);
+	if (typeIdx < index.size()) {
+		const auto iter = index[typeIdx].find(asset);
+		if (iter != index[typeIdx].end()) {
+			return iter->second;
+		}
+	}
+
+	// Not indexed, e.g. a pack being built
+	const auto& path = assetDb->getDatabase(type).get(asset).path;
+	if (auto entry = parseIndexEntry(path)) {
+		return *entry;
+	}
+	throw Exception("Invalid asset pack entry \"" + path + "\" for \"" + asset + "\".", HalleyExceptions::Resources);
+}
+
+std::optional<AssetPack::IndexEntry> AssetPack::parseIndexEntry(const String& path)
+{
+	const auto ps = path.split(':');
+	IndexEntry entry;
+	if (ps.size() == 2) {
+		entry.pos = size_t(ps[0].toInteger64());
+		entry.size = size_t(ps[1].toInteger64());
+		entry.storedSize = entry.size;
+	} else if (ps.size() == 4) {
+		entry.pos = size_t(ps[0].toInteger64());
+		entry.storedSize = size_t(ps[1].toInteger64());
+		entry.size = size_t(ps[2].toInteger64());
+		const int flags = ps[3].toInteger();
+		entry.compressed = (flags & entryFlagCompressed) != 0;
+		entry.encrypted = (flags & entryFlagEncrypted) != 0;
+	} else {
+		return {};
+	}
+	return entry;
+}
+
+bool AssetPack::hasPackEncryption() const
+{
+	std::array<char, 16> ivEmpty;
+	memset(ivEmpty.data(), 0, ivEmpty.size());
+	return memcmp(iv.data(), ivEmpty.data(), iv.size()) != 0 && !encryptionKey.isEmpty();
+}
+
+const char* AssetPack::getMappedData(size_t pos, size_t size) const
+{
+	const auto bytes = mapping->getSpan();
+	if (dataOffset + pos + size > size_t(bytes.size())) {
+		throw Exception("Asset data is out of pack bounds.", HalleyExceptions::Resources);
+	}
+	return reinterpret_cast<const char*>(bytes.data()) + dataOffset + pos;
+}
+
 AssetPack::~AssetPack()
 {
 }
@@ -82,9 +271,14 @@ AssetPack& AssetPack::operator=(AssetPack&& other) noexcept
 	std::unique_lock<std::mutex> lock(other.readerMutex);
 
 	assetDb = std::move(other.assetDb);
+	encryptionKey = std::move(other.encryptionKey);
+	version = other.version;
 	dataOffset = other.dataOffset;
 	reader = std::move(other.reader);
+	mapping = std::move(other.mapping);
+	index = std::move(other.index);
 	data = std::move(other.data);
+	iv = other.iv;
 	hasReader = !!reader;
 
 	other.hasReader = false;
@@ -117,7 +311,7 @@ Bytes AssetPack::writeOut() const
 {
 	auto assetDbBytes = Compression::compress(Serializer::toBytes(*assetDb));
 	AssetPackHeader header;
-	header.init(assetDbBytes.size());
+	header.init(assetDbBytes.size(), version);
 	header.iv = iv;
 
 	auto result = Bytes(size_t(header.dataStartPos + data.size()));
@@ -130,16 +324,35 @@ Bytes AssetPack::writeOut() const
 std::unique_ptr<ResourceData> AssetPack::getData(const String& asset, AssetType type, bool stream)
 {
 	auto path = asset;
-	auto ps = assetDb->getDatabase(type).get(asset).path.split(':');
-	size_t pos = size_t(ps.at(0).toInteger());
-	size_t size = size_t(ps.at(1).toInteger());
+	const auto entry = getIndexEntry(asset, type);
+	const size_t pos = entry.pos;
+	const size_t size = entry.size;
+
+	if (entry.compressed || entry.encrypted) {
+		// Only the requested asset gets decoded, on whichever thread is loading it
+		if (stream) {
+			// Every playback of a stream opens its own reader, so only decode it once and share it between them
+			auto decoded = std::make_shared<SharedDecodedAsset>();
+			return std::make_unique<ResourceDataStream>(path, [=] () -> std::unique_ptr<ResourceDataReader> {
+				return std::make_unique<BufferDataReader>(decoded->get([&] () { return decodeAsset(entry); }));
+			});
+		} else {
+			auto bytes = std::make_shared<Bytes>(decodeAsset(entry));
+			const auto decodedSize = bytes->size();
+			const auto* decoded = reinterpret_cast<const char*>(bytes->data());
+			return std::make_unique<ResourceDataStatic>(std::shared_ptr<const char>(std::move(bytes), decoded), decodedSize, path);
+		}
+	}
 
 	if (stream) {
 		return std::make_unique<ResourceDataStream>(path, [=] () -> std::unique_ptr<ResourceDataReader> {
 			return std::make_unique<PackDataReader>(*this, pos, size);
 		});
 	} else {
-		if (hasReader) {
+		if (mapping) {
+			// Points straight into the mapping, and keeps it alive for as long as the data is around
+			return std::make_unique<ResourceDataStatic>(std::shared_ptr<const char>(mapping, getMappedData(pos, size)), size, path);
+		} else if (hasReader) {
 			auto result = new char[size];
 			try {
 				readData(pos, gsl::as_writable_bytes(gsl::span<char>(result, size)));
@@ -161,6 +374,14 @@ std::unique_ptr<ResourceData> AssetPack::getData(const String& asset, AssetType
 
 void AssetPack::readToMemory()
 {
+	if (mapping) {
+		const auto packData = mapping->getSpan().subspan(ptrdiff_t(dataOffset));
+		data = Bytes(size_t(packData.size()));
+		memcpy(data.data(), packData.data(), data.size());
+		mapping.reset();
+		return;
+	}
+
 	std::unique_lock<std::mutex> lock(readerMutex);
 	reader->seek(dataOffset, SEEK_SET);
 	data = reader->readAll();
@@ -188,6 +409,11 @@ void AssetPack::decrypt(const String& key)
 
 void AssetPack::readData(size_t pos, gsl::span<gsl::byte> dst)
 {
+	if (mapping) {
+		memcpy(dst.data(), getMappedData(pos, size_t(dst.size())), size_t(dst.size()));
+		return;
+	}
+
 	if (hasReader) {
 		std::unique_lock<std::mutex> lock(readerMutex);
 		if (reader) {
@@ -211,6 +437,94 @@ std::unique_ptr<ResourceDataReader> AssetPack::extractReader()
 	return std::move(reader);
 }
 
+bool AssetPack::isMapped() const
+{
+	return !!mapping;
+}
+
+AssetPackEntryData AssetPack::encodeAsset(gsl::span<const gsl::byte> src, bool compress, const String& encryptionKey, const std::array<char, 16>& iv)
+{
+	AssetPackEntryData result;
+	result.size = size_t(src.size());
+	result.data = Bytes(reinterpret_cast<const Byte*>(src.data()), reinterpret_cast<const Byte*>(src.data()) + src.size());
+
+	// Only keep the compressed version if it's worth the decoding time
+	if (compress) {
+		auto compressed = Compression::compressRaw(src, false);
+		if (compressed.size() + compressed.size() / 16 < result.data.size()) {
+			result.data = std::move(compressed);
+			result.compressed = true;
+		}
+	}
+
+	// Encrypted data is prefixed with its own IV
+	if (!encryptionKey.isEmpty()) {
+		Bytes ivBytes(iv.size());
+		memcpy(ivBytes.data(), iv.data(), iv.size());
+		auto encrypted = Encrypt::encrypt(ivBytes, encryptionKey, result.data);
+		result.data = std::move(ivBytes);
+		result.data.insert(result.data.end(), encrypted.begin(), encrypted.end());
+		result.encrypted = true;
+	}
+
+	return result;
+}
+
+void AssetPack::addAsset(const String& name, AssetType type, const AssetPackEntryData& entry, const Metadata& meta)
+{
+	const size_t pos = data.size();
+	data.reserve(nextPowerOf2(pos + entry.data.size()));
+	data.insert(data.end(), entry.data.begin(), entry.data.end());
+
+	const int flags = (entry.compressed ? entryFlagCompressed : 0) | (entry.encrypted ? entryFlagEncrypted : 0);
+	assetDb->addAsset(name, type, AssetDatabase::Entry(toString(pos) + ":" + toString(entry.data.size()) + ":" + toString(entry.size) + ":" + toString(flags), meta));
+	version = 2;
+}
+
+int AssetPack::getVersion() const
+{
+	return version;
+}
+
+Bytes AssetPack::decodeAsset(const IndexEntry& entry)
+{
+	// Mapped and preloaded packs are decoded in place, otherwise only this asset is read
+	Bytes stored;
+	gsl::span<const gsl::byte> src;
+	if (mapping) {
+		src = gsl::as_bytes(gsl::span<const char>(getMappedData(entry.pos, entry.storedSize), entry.storedSize));
+	} else if (!hasReader) {
+		if (entry.pos + entry.storedSize > data.size()) {
+			throw Exception("Asset data is out of pack bounds.", HalleyExceptions::Resources);
+		}
+		src = gsl::as_bytes(gsl::span<const Byte>(data.data() + entry.pos, entry.storedSize));
+	} else {
+		stored.resize(entry.storedSize);
+		readData(entry.pos, gsl::as_writable_bytes(gsl::span<Byte>(stored)));
+		src = gsl::as_bytes(gsl::span<const Byte>(stored));
+	}
+
+	Bytes decrypted;
+	if (entry.encrypted) {
+		if (encryptionKey.isEmpty()) {
+			throw Exception("Asset is encrypted, but no encryption key was provided.", HalleyExceptions::Resources);
+		}
+		if (size_t(src.size()) < iv.size()) {
+			throw Exception("Encrypted asset is too small.", HalleyExceptions::Resources);
+		}
+		Bytes assetIv(iv.size());
+		memcpy(assetIv.data(), src.data(), iv.size());
+		const auto cipher = src.subspan(ptrdiff_t(iv.size()));
+		decrypted = Encrypt::decrypt(assetIv, encryptionKey, Bytes(reinterpret_cast<const Byte*>(cipher.data()), reinterpret_cast<const Byte*>(cipher.data()) + cipher.size()));
+		src = gsl::as_bytes(gsl::span<const Byte>(decrypted));
+	}
+
+	if (entry.compressed) {
+		return Compression::decompressRaw(src, entry.size, entry.size);
+	}
+	return decrypted;
+}
+
 PackDataReader::PackDataReader(AssetPack& pack, size_t startPos, size_t fileSize)
 	: pack(pack)
 	, startPos(startPos)
@@ -6,6 +6,7 @@
 
 #include "graphics/sprite/sprite.h"
 #include "halley/support/logger.h"
+#include "halley/concurrency/concurrent.h"
 
 using namespace Halley;
 
@@ -18,16 +19,19 @@ ResourceCollectionBase::ResourceCollectionBase(Resources& parent, AssetType type
 
 void ResourceCollectionBase::clear()
 {
+	std::unique_lock<std::mutex> lock(mutex);
 	resources.clear();
 }
 
 void ResourceCollectionBase::unload(const String& assetId)
 {
+	std::unique_lock<std::mutex> lock(mutex);
 	resources.erase(assetId);
 }
 
 void ResourceCollectionBase::unloadAll(int minDepth)
 {
+	std::unique_lock<std::mutex> lock(mutex);
 	for (auto iter = resources.begin(); iter != resources.end(); ) {
 		auto next = iter;
 		++next;
@@ -43,14 +47,21 @@ void ResourceCollectionBase::unloadAll(int minDepth)
 
 void ResourceCollectionBase::reload(const String& assetId)
 {
-	auto res = resources.find(assetId);
-	if (res != resources.end()) {
-		auto& resWrap = res->second;
+	std::shared_ptr<Resource> existing;
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		const auto res = resources.find(assetId);
+		if (res != resources.end()) {
+			existing = res->second.res;
+		}
+	}
+
+	if (existing) {
 		try {
 			const auto [newAsset, loaded] = loadAsset(assetId, ResourceLoadPriority::High, false);
 			newAsset->setAssetId(assetId);
 			newAsset->onLoaded(parent);
-			resWrap.res->reloadResource(std::move(*newAsset));
+			existing->reloadResource(std::move(*newAsset));
 		} catch (std::exception& e) {
 			Logger::logError("Error while reloading " + assetId + ": " + e.what());
 		} catch (...) {
@@ -71,6 +82,62 @@ std::shared_ptr<Resource> ResourceCollectionBase::getUntyped(const String& name,
 	return doGet(name, priority, true);
 }
 
+Future<std::shared_ptr<Resource>> ResourceCollectionBase::getUntypedAsync(const String& assetId, ResourceLoadPriority priority)
+{
+	std::shared_ptr<PendingLoad> load;
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+
+		const auto res = resources.find(assetId);
+		if (res != resources.end()) {
+			res->second.lastAccess = ++accessCounter;
+			Promise<std::shared_ptr<Resource>> promise;
+			promise.setValue(res->second.res);
+			return promise.getFuture();
+		}
+
+		const auto pending = pendingLoads.find(assetId);
+		if (pending != pendingLoads.end()) {
+			return pending->second->promise.getFuture();
+		}
+
+		load = std::make_shared<PendingLoad>();
+		pendingLoads[assetId] = load;
+	}
+
+	getLoadQueue().addToQueue([this, assetId, priority, load] ()
+	{
+		// A synchronous get might have picked this up while it was still queued
+		if (!load->started.exchange(true)) {
+			try {
+				runLoad(assetId, priority, true, *load);
+			} catch (std::exception& e) {
+				Logger::logError("Error while loading " + toString(type) + ":" + assetId + ": " + e.what());
+			} catch (...) {
+				Logger::logError("Unknown error while loading " + toString(type) + ":" + assetId);
+			}
+		}
+	});
+
+	return load->promise.getFuture();
+}
+
+bool ResourceCollectionBase::needsVideoContext() const
+{
+	return type == AssetType::Texture || type == AssetType::Shader || type == AssetType::MaterialDefinition;
+}
+
+ExecutionQueue& ResourceCollectionBase::getLoadQueue() const
+{
+	return needsVideoContext() ? Executors::getVideoAux() : Executors::getCPUAux();
+}
+
+bool ResourceCollectionBase::isLoaded(const String& assetId) const
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	return resources.find(assetId) != resources.end();
+}
+
 std::vector<String> ResourceCollectionBase::enumerate() const
 {
 	if (resourceEnumerator) {
@@ -80,7 +147,7 @@ std::vector<String> ResourceCollectionBase::enumerate() const
 	}
 }
 
-std::pair<std::shared_ptr<Resource>, bool> ResourceCollectionBase::loadAsset(const String& assetId, ResourceLoadPriority priority, bool allowFallback) {
+std::pair<std::shared_ptr<Resource>, bool> ResourceCollectionBase::loadAsset(const String& assetId, ResourceLoadPriority priority, bool allowFallback, size_t* dataSize) {
 	std::shared_ptr<Resource> newRes;
 
 	if (resourceLoader) {
@@ -90,6 +157,9 @@ std::pair<std::shared_ptr<Resource>, bool> ResourceCollectionBase::loadAsset(con
 		// Normal loading
 		auto resLoader = ResourceLoader(*(parent.locator), assetId, type, priority, parent.api, parent);		
 		newRes = loadResource(resLoader);
+		if (dataSize) {
+			*dataSize = resLoader.dataSize;
+		}
 		if (newRes) {
 			newRes->setMeta(resLoader.getMeta());
 		} else if (resLoader.loaded) {
@@ -100,7 +170,7 @@ std::pair<std::shared_ptr<Resource>, bool> ResourceCollectionBase::loadAsset(con
 	if (!newRes) {
 		if (allowFallback && !fallback.isEmpty()) {
 			Logger::logError("Resource not found: \"" + toString(type) + ":" + assetId + "\"");
-			return loadAsset(fallback, priority, false);
+			return loadAsset(fallback, priority, false, dataSize);
 		}
 		
 		throw Exception("Resource not found: \"" + toString(type) + ":" + assetId + "\"", HalleyExceptions::Resources);
@@ -111,30 +181,78 @@ std::pair<std::shared_ptr<Resource>, bool> ResourceCollectionBase::loadAsset(con
 
 std::shared_ptr<Resource> ResourceCollectionBase::doGet(const String& assetId, ResourceLoadPriority priority, bool allowFallback)
 {
-	// Look in cache and return if it's there
-	const auto res = resources.find(assetId);
-	if (res != resources.end()) {
-		return res->second.res;
+	std::shared_ptr<PendingLoad> load;
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+
+		// Look in cache and return if it's there
+		const auto res = resources.find(assetId);
+		if (res != resources.end()) {
+			res->second.lastAccess = ++accessCounter;
+			return res->second.res;
+		}
+
+		const auto pending = pendingLoads.find(assetId);
+		if (pending != pendingLoads.end()) {
+			load = pending->second;
+		} else {
+			load = std::make_shared<PendingLoad>();
+			pendingLoads[assetId] = load;
+		}
 	}
-	
+
+	// If the load is still sitting in a queue, take it over instead of blocking on it, as the queue might be waiting on us
+	if (!load->started.exchange(true)) {
+		return runLoad(assetId, priority, allowFallback, *load);
+	}
+
+	// Someone else is loading it, wait for them
+	auto result = load->promise.getFuture().get();
+	if (load->error) {
+		std::rethrow_exception(load->error);
+	}
+	return result;
+}
+
+std::shared_ptr<Resource> ResourceCollectionBase::runLoad(const String& assetId, ResourceLoadPriority priority, bool allowFallback, PendingLoad& load)
+{
 	// Load resource from disk
-	const auto [newRes, loaded] = loadAsset(assetId, priority, allowFallback);
+	std::shared_ptr<Resource> newRes;
+	size_t dataSize = 0;
+	try {
+		auto [res, loaded] = loadAsset(assetId, priority, allowFallback, &dataSize);
+		if (loaded) {
+			res->setAssetId(assetId);
+			res->onLoaded(parent);
+		}
+		newRes = std::move(res);
+	} catch (...) {
+		load.error = std::current_exception();
+	}
 
 	// Store in cache
-	if (loaded) {
-		newRes->setAssetId(assetId);
-		resources.emplace(assetId, Wrapper(newRes, 0));
-		newRes->onLoaded(parent);
+	Vector<std::shared_ptr<Resource>> evicted;
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		if (newRes) {
+			resources.emplace(assetId, Wrapper(newRes, 0, true, dataSize, ++accessCounter));
+			evicted = enforceBudget();
+		}
+		pendingLoads.erase(assetId);
 	}
+	evicted.clear();
 
+	load.promise.setValue(newRes);
+	if (load.error) {
+		std::rethrow_exception(load.error);
+	}
 	return newRes;
 }
 
 bool ResourceCollectionBase::exists(const String& assetId) const
 {
 	// Look in cache
-	const auto res = resources.find(assetId);
-	if (res != resources.end()) {
+	if (isLoaded(assetId)) {
 		return true;
 	}
 
@@ -147,7 +265,104 @@ void ResourceCollectionBase::setFallback(const String& assetId)
 }
 
 void ResourceCollectionBase::setResource(int curDepth, const String& name, std::shared_ptr<Resource> resource) {
-	resources.emplace(name, Wrapper(std::move(resource), curDepth));
+	std::unique_lock<std::mutex> lock(mutex);
+	resources.emplace(name, Wrapper(std::move(resource), curDepth, false));
+}
+
+void ResourceCollectionBase::setMemoryBudget(size_t bytes)
+{
+	Vector<std::shared_ptr<Resource>> evicted;
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		memoryBudget = bytes;
+		evicted = enforceBudget();
+	}
+}
+
+size_t ResourceCollectionBase::getMemoryBudget() const
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	return memoryBudget;
+}
+
+ResourceMemoryStats ResourceCollectionBase::getMemoryStats() const
+{
+	std::unique_lock<std::mutex> lock(mutex);
+
+	ResourceMemoryStats stats;
+	stats.budget = memoryBudget;
+	stats.evictions = evictions;
+	for (const auto& [name, res]: resources) {
+		const size_t usage = res.getMemoryUsage();
+		++stats.count;
+		stats.memoryUsage += usage;
+		if (res.res.use_count() == 1) {
+			++stats.unreferencedCount;
+			stats.unreferencedMemoryUsage += usage;
+		}
+	}
+	return stats;
+}
+
+Vector<ResourceResidency> ResourceCollectionBase::getResidency() const
+{
+	Vector<ResourceResidency> result;
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		result.reserve(resources.size());
+		for (const auto& [name, res]: resources) {
+			result.push_back(ResourceResidency{ name, res.getMemoryUsage(), res.res.use_count() - 1 });
+		}
+	}
+
+	std::sort(result.begin(), result.end(), [] (const ResourceResidency& a, const ResourceResidency& b)
+	{
+		return a.memoryUsage > b.memoryUsage;
+	});
+	return result;
+}
+
+Vector<std::shared_ptr<Resource>> ResourceCollectionBase::enforceBudget()
+{
+	// Must be called with the lock held. Evicted resources are returned so they're destroyed after it's released.
+	Vector<std::shared_ptr<Resource>> evicted;
+	if (memoryBudget == 0) {
+		return evicted;
+	}
+
+	size_t total = 0;
+	Vector<std::pair<uint64_t, String>> candidates;
+	for (const auto& [name, res]: resources) {
+		total += res.getMemoryUsage();
+
+		// Resources set by hand can't be loaded back, and anything still referenced wouldn't free any memory
+		if (res.loadedFromAssets && res.res.use_count() == 1) {
+			candidates.emplace_back(res.lastAccess, name);
+		}
+	}
+	if (total <= memoryBudget) {
+		return evicted;
+	}
+
+	std::sort(candidates.begin(), candidates.end());
+	for (const auto& candidate: candidates) {
+		if (total <= memoryBudget) {
+			break;
+		}
+		const auto iter = resources.find(candidate.second);
+		total -= iter->second.getMemoryUsage();
+		evicted.push_back(std::move(iter->second.res));
+		resources.erase(iter);
+		++evictions;
+	}
+
+	return evicted;
+}
+
+size_t ResourceCollectionBase::Wrapper::getMemoryUsage() const
+{
+	const size_t usage = res->getMemoryUsage();
+	return usage != 0 ? usage : dataSize;
 }
 
 void ResourceCollectionBase::setResourceLoader(ResourceLoaderFunc loader)
@@ -120,6 +120,12 @@ void ResourceLocator::addFileSystem(const Path& path)
 
 void ResourceLocator::addPack(const Path& path, const String& encryptionKey, bool preLoad, bool allowFailure, std::optional<int> priority)
 {
+	auto mapping = system.getMappedFile(path.string());
+	if (mapping) {
+		add(std::make_unique<PackResourceLocator>(std::move(mapping), path, encryptionKey, preLoad, priority), path);
+		return;
+	}
+
 	auto dataReader = system.getDataReader(path.string());
 	if (dataReader) {
 		auto resourceLocator = std::make_unique<PackResourceLocator>(std::move(dataReader), path, encryptionKey, preLoad, priority);
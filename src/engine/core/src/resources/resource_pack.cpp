@@ -13,6 +13,15 @@ PackResourceLocator::PackResourceLocator(std::unique_ptr<ResourceDataReader> rea
 	assetPack = std::make_unique<AssetPack>(std::move(reader), encryptionKey, preLoad);
 }
 
+PackResourceLocator::PackResourceLocator(std::shared_ptr<const MappedFile> mapping, Path path, String key, bool preLoad, std::optional<int> priority)
+	: path(std::move(path))
+	, encryptionKey(std::move(key))
+	, preLoad(preLoad)
+	, priority(priority)
+{
+	assetPack = std::make_unique<AssetPack>(std::move(mapping), encryptionKey, preLoad);
+}
+
 PackResourceLocator::~PackResourceLocator()
 {
 }
@@ -41,7 +50,12 @@ void PackResourceLocator::purge(SystemAPI& sys)
 
 void PackResourceLocator::loadAfterPurge()
 {
-	assetPack = std::make_unique<AssetPack>(system->getDataReader(path.string()), encryptionKey, preLoad);
+	auto mapping = system->getMappedFile(path.string());
+	if (mapping) {
+		assetPack = std::make_unique<AssetPack>(std::move(mapping), encryptionKey, preLoad);
+	} else {
+		assetPack = std::make_unique<AssetPack>(system->getDataReader(path.string()), encryptionKey, preLoad);
+	}
 }
 
 int PackResourceLocator::getPriority() const
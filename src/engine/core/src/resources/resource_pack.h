@@ -6,10 +6,12 @@
 namespace Halley {
 	class SystemAPI;
 	class AssetPack;
+	class MappedFile;
 
 	class PackResourceLocator final : public IResourceLocatorProvider {
 	public:
 		explicit PackResourceLocator(std::unique_ptr<ResourceDataReader> reader, Path path, String encryptionKey = "", bool preLoad = false, std::optional<int> priority = {});
+		explicit PackResourceLocator(std::shared_ptr<const MappedFile> mapping, Path path, String encryptionKey = "", bool preLoad = false, std::optional<int> priority = {});
 		~PackResourceLocator();
 
 	protected:
@@ -2,6 +2,7 @@
 #include "resources/resource_locator.h"
 #include "api/halley_api.h"
 #include "halley/support/logger.h"
+#include "halley/concurrency/concurrent.h"
 
 using namespace Halley;
 
@@ -63,4 +64,94 @@ void Resources::reloadAssets(const std::map<AssetType, std::vector<String>>& byT
 	}
 }
 
+void Resources::setMemoryBudget(AssetType type, size_t bytes)
+{
+	ofType(type).setMemoryBudget(bytes);
+}
+
+String Resources::getResidencyReport(size_t maxEntriesPerType) const
+{
+	String result;
+	for (size_t i = 0; i < resources.size(); ++i) {
+		if (!resources[i]) {
+			continue;
+		}
+
+		const auto& collection = *resources[i];
+		const auto stats = collection.getMemoryStats();
+		if (stats.count == 0 && stats.evictions == 0) {
+			continue;
+		}
+
+		result += toString(AssetType(i)) + ": " + toString(stats.count) + " resident, " + String::prettySize(stats.memoryUsage);
+		if (stats.budget > 0) {
+			result += " / " + String::prettySize(stats.budget);
+		}
+		result += ", " + toString(stats.unreferencedCount) + " unreferenced (" + String::prettySize(stats.unreferencedMemoryUsage) + "), " + toString(stats.evictions) + " evicted\n";
+
+		const auto residency = collection.getResidency();
+		for (size_t j = 0; j < std::min(maxEntriesPerType, residency.size()); ++j) {
+			const auto& entry = residency[j];
+			result += "    " + entry.assetId + ": " + String::prettySize(entry.memoryUsage) + ", " + toString(entry.useCount) + " refs\n";
+		}
+	}
+	return result;
+}
+
+struct Resources::PrefetchState {
+	std::mutex mutex;
+	std::set<String> visited;
+};
+
+Future<void> Resources::prefetch(Vector<String> ids)
+{
+	return Concurrent::execute(Executors::getCPUAux(), [this, ids = std::move(ids)] ()
+	{
+		PrefetchState state;
+		doPrefetch(state, ids);
+	});
+}
+
+void Resources::doPrefetch(PrefetchState& state, gsl::span<const String> ids)
+{
+	Concurrent::parallelFor(Executors::getCPUAux(), 0, ids.size(), [&] (size_t i)
+	{
+		const auto& id = ids[i];
+		{
+			// Dependencies can be shared or even circular, only visit each once
+			std::unique_lock<std::mutex> lock(state.mutex);
+			if (!state.visited.insert(id).second) {
+				return;
+			}
+		}
+
+		std::shared_ptr<Resource> res;
+		try {
+			const auto splitPos = id.find(':');
+			const auto type = fromString<AssetType>(id.left(splitPos));
+			if (int(type) >= int(resources.size()) || !resources[int(type)]) {
+				throw Exception("Asset type not initialized", HalleyExceptions::Resources);
+			}
+			auto& collection = ofType(type);
+			if (collection.needsVideoContext()) {
+				// Can't be loaded on this thread, so wait for the video aux executor. Failures are logged there.
+				res = collection.getUntypedAsync(id.mid(splitPos + 1)).get();
+			} else {
+				res = collection.getUntyped(id.mid(splitPos + 1));
+			}
+		} catch (std::exception& e) {
+			Logger::logError("Error while prefetching " + id + ": " + e.what());
+			return;
+		}
+		if (!res) {
+			return;
+		}
+
+		const auto deps = res->getMeta().getString("dependencies", "");
+		if (!deps.isEmpty()) {
+			doPrefetch(state, deps.split(','));
+		}
+	});
+}
+
 Resources::~Resources() = default;
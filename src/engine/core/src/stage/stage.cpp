@@ -66,9 +66,14 @@ void Stage::setGame(Game& g)
 	game = &g;
 }
 
-void Stage::doInit(const HalleyAPI* _api, Resources& _resources)
+void Stage::setAPI(const HalleyAPI* _api, Resources& _resources)
 {
 	resources = &_resources;
 	api = _api;
+}
+
+void Stage::doInit(const HalleyAPI* _api, Resources& _resources)
+{
+	setAPI(_api, _resources);
 	init();
 }
@@ -110,6 +110,11 @@ namespace Halley {
 		{
 			return alive;
 		}
+
+		bool isSpawned() const
+		{
+			return spawned;
+		}
 		
 		const UUID& getPrefabUUID() const
 		{
@@ -143,6 +148,7 @@ namespace Halley {
 		bool alive : 1;
 		bool serializable : 1;
 		bool reloaded : 1;
+		bool spawned : 1;
 		
 		uint8_t childrenRevision = 0;
 		uint8_t worldPartition = 0;
@@ -291,7 +297,9 @@ namespace Halley {
 			static_assert(!std::is_polymorphic<T>::value, "Components cannot be polymorphic (i.e. they can't have virtual methods)");
 			static_assert(std::is_default_constructible<T>::value, "Components must have a default constructor");
 
-			auto c = new T(std::move(component));
+			auto& table = entity->getComponentDeleterTable(*world);
+			TypeDeleter<T>::initialize(table);
+			auto c = ::new (table.get(T::componentIndex)->allocate()) T(std::move(component));
 			entity->addComponent(*world, c);
 
 			if constexpr (HasOnAddedToEntityMember<T>::value) {
@@ -518,6 +526,13 @@ namespace Halley {
 			return static_cast<size_t>(entity->liveComponents);
 		}
 
+		void reserve(size_t numComponents, size_t numChildren)
+		{
+			Expects(entity);
+			entity->components.reserve(numComponents);
+			entity->children.reserve(numChildren);
+		}
+
 		std::pair<int, Component*> getRawComponent(size_t idx) const
 		{
 			Expects(entity);
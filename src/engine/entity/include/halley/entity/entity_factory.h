@@ -1,8 +1,10 @@
 #pragma once
 #include <functional>
+#include <optional>
 
 #include "create_functions.h"
 #include "prefab.h"
+#include "prefab_template.h"
 #include "halley/file_formats/config_file.h"
 #include "halley/data_structures/maybe.h"
 #include "halley/entity/entity.h"
@@ -38,6 +40,7 @@ namespace Halley {
 		World& getWorld();
 		
 		EntityRef createEntity(const String& prefabName);
+		Vector<EntityRef> createEntities(const String& prefabName, size_t count);
 		EntityRef createEntity(const EntityData& data, EntityRef parent = EntityRef(), EntityScene* scene = nullptr);
 		EntityScene createScene(const std::shared_ptr<const Prefab>& scene, bool allowReload, uint8_t worldPartition = 0);
 
@@ -56,13 +59,15 @@ namespace Halley {
 		void updateEntityChildrenDelta(EntityRef entity, const EntityDataDelta& delta, const std::shared_ptr<EntityFactoryContext>& context);
 
 		EntityRef getEntity(const UUID& instanceUUID, EntityFactoryContext& context, bool allowWorldLookup);
-		std::shared_ptr<EntityFactoryContext> makeContext(const IEntityData& data, std::optional<EntityRef> existing, EntityScene* scene, bool updateContext);
+		std::shared_ptr<EntityFactoryContext> makeContext(const IEntityData& data, std::optional<EntityRef> existing, EntityScene* scene, bool updateContext, std::shared_ptr<const Prefab> prefab = {});
+		EntityRef doCreateEntity(const EntityData& data, EntityRef parent, EntityScene* scene, std::shared_ptr<const Prefab> prefab);
 		EntityRef instantiateEntity(const EntityData& data, EntityFactoryContext& context, bool allowWorldLookup);
 		void preInstantiateEntities(const IEntityData& data, EntityFactoryContext& context, int depth);
 		void collectExistingEntities(EntityRef entity, EntityFactoryContext& context);
 
 		[[nodiscard]] std::shared_ptr<const Prefab> getPrefab(const String& id) const;
 		[[nodiscard]] std::shared_ptr<const Prefab> getPrefab(std::optional<EntityRef> entity, const IEntityData& data) const;
+		[[nodiscard]] std::shared_ptr<const PrefabTemplate> getPrefabTemplate(const Prefab& prefab);
 	};
 
 	class EntityFactoryContext {
@@ -74,6 +79,23 @@ namespace Halley {
 		{
 			CreateComponentFunctionResult result;
 			result.componentId = T::componentIndex;
+
+			if (compilingTemplate) {
+				// Only resolve the type, and deserialize it if it can be copied. PrefabTemplate adds it to entities later.
+				if (componentData.getType() != ConfigNodeType::Del) {
+					auto prototype = std::make_unique<ComponentPrototypeImpl<T>>(componentData);
+					if constexpr (IsPrefabTemplateCopyable<T>::value) {
+						T component;
+						component.deserialize(configNodeContext, componentData);
+						if (!compiledEntityReference) {
+							prototype->setComponent(std::move(component));
+						}
+						compiledEntityReference = false;
+					}
+					compiledPrototype = std::move(prototype);
+				}
+				return result;
+			}
 			
 			if (componentData.getType() == ConfigNodeType::Del) {
 				e.removeComponent<T>();
@@ -108,6 +130,14 @@ namespace Halley {
 		EntityScene* getScene() const;
 		uint8_t getWorldPartition() const;
 
+		void setCompilingTemplate(bool compiling);
+		std::unique_ptr<ComponentPrototype> takeCompiledPrototype();
+
+		void setPrefabTemplate(std::shared_ptr<const PrefabTemplate> prefabTemplate, const EntityData& instance);
+		const PrefabTemplate::Node* getTemplateNode(const EntityData& data) const;
+		const std::vector<std::pair<String, ConfigNode>>* getTemplateOverrides(const EntityData& data) const;
+		UUID getInstanceUUID(const EntityData& data) const;
+
 	private:
 		ConfigNodeSerializationContext configNodeContext;
 		std::shared_ptr<const Prefab> prefab;
@@ -119,6 +149,62 @@ namespace Halley {
 		const IEntityData* entityData = nullptr;
 		EntityData instancedEntityData;
 
+		std::shared_ptr<const PrefabTemplate> prefabTemplate;
+		const std::vector<std::pair<String, ConfigNode>>* templateOverrides = nullptr;
+		UUID templateInstanceUUID;
+		bool compilingTemplate = false;
+		mutable bool compiledEntityReference = false;
+		mutable std::unique_ptr<ComponentPrototype> compiledPrototype;
+
 		void setEntityData(const IEntityData& iData);
 	};
+
+	template <typename T>
+	class ComponentPrototypeImpl final : public ComponentPrototype {
+	public:
+		explicit ComponentPrototypeImpl(const ConfigNode& componentData)
+			: data(componentData)
+		{}
+
+		void setComponent(T value)
+		{
+			component = std::move(value);
+			data = ConfigNode();
+		}
+
+		int getComponentId() const override
+		{
+			return T::componentIndex;
+		}
+
+		bool isCopy() const override
+		{
+			return component.has_value();
+		}
+
+		void addToEntity(EntityRef& entity, const EntityFactoryContext& context) const override
+		{
+			if constexpr (IsPrefabTemplateCopyable<T>::value) {
+				if (component) {
+					entity.addComponent<T>(T(*component));
+					return;
+				}
+			}
+			context.createComponent<T>(entity, data);
+		}
+
+		void addToEntity(EntityRef& entity, const EntityFactoryContext& context, const ConfigNode& overrideData) const override
+		{
+			context.createComponent<T>(entity, overrideData);
+		}
+
+		void reserve(World& world, size_t count) const override
+		{
+			world.reserveComponents<T>(count);
+		}
+
+	private:
+		ConfigNode data; // Deserialized for each instance, unless there's a component to copy
+		std::optional<T> component;
+	};
 }
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <algorithm>
+#include <limits>
 #include <gsl/gsl_assert>
 #include "family_type.h"
 #include "family_mask.h"
@@ -116,66 +117,42 @@ namespace Halley {
 	protected:
 		void addEntity(Entity& entity) override
 		{
-			auto& e = entities.emplace_back();
-			e.entityId = entity.getEntityId();
-			T::Type::loadComponents(entity, &e.data[0]);
-
-			dirty = true;
+			// Added in bulk on updateEntities()
+			toAdd.push_back(&entity);
 		}
 		
 		void refreshEntity(Entity& entity) override
 		{
-			for (auto& e: entities) {
-				if (e.entityId == entity.getEntityId()) {
-					T::Type::loadComponents(entity, &e.data[0]);
-					break;
-				}
+			const auto idx = findIndex(entity.getEntityId());
+			if (idx != invalidIndex) {
+				T::Type::loadComponents(entity, &entities[idx].data[0]);
 			}
 		}
 
 		void updateEntities() override
 		{
-			if (dirty) {
-				// Notify additions
-				HALLEY_DEBUG_TRACE();
-				size_t prevSize = elemCount;
-				size_t curSize = entities.size();
-				updateElems();
-				Expects(curSize >= prevSize);
-				if (curSize > prevSize) {
-					notifyAdd(entities.data() + prevSize, curSize - prevSize);
-				}
-
-				dirty = false;
-			}
-
-			if (!toReload.empty()) {
-				// Notify reloads
-				HALLEY_DEBUG_TRACE();
-				std::vector<StorageType*> reloadedEntities;
-				for (auto& entity : entities) {
-					if (std::find(toReload.begin(), toReload.end(), entity.entityId) != toReload.end()) {
-						reloadedEntities.push_back(&entity);
-					}
-				}
-				notifyReload(reloadedEntities.data(), reloadedEntities.size());
-				toReload.clear();
-			}
-
-			// Remove
+			// Removals go first, so an entity that is removed and re-added in the same frame ends up in the family
 			removeDeadEntities();
+			addPendingEntities();
+			reloadEntities();
 		}
 
 		void clearEntities() override
 		{
 			notifyRemove(entities.data(), entities.size());
 			entities.clear();
+			toAdd.clear();
+			indices.clear();
 			updateElems();
 		}
 
 	private:
+		constexpr static uint32_t invalidIndex = std::numeric_limits<uint32_t>::max();
+
 		Vector<StorageType> entities;
-		bool dirty = false;
+		Vector<Entity*> toAdd;
+		Vector<StorageType*> reloadedEntities;
+		Vector<uint32_t> indices; // Indexed by the entity's slot in the world, see getSlot()
 
 		void updateElems()
 		{
@@ -184,56 +161,111 @@ namespace Halley {
 			elemSize = sizeof(StorageType);
 		}
 
+		static size_t getSlot(EntityId id)
+		{
+			// The lower 32 bits of the id are its index in the world's entity pool, which is dense and reused
+			return static_cast<size_t>(id.value & 0xFFFFFFFFll);
+		}
+
+		uint32_t findIndex(EntityId id) const
+		{
+			const size_t slot = getSlot(id);
+			if (slot >= indices.size()) {
+				return invalidIndex;
+			}
+			const uint32_t idx = indices[slot];
+			return idx != invalidIndex && entities[idx].entityId == id ? idx : invalidIndex;
+		}
+
+		void setIndex(EntityId id, uint32_t idx)
+		{
+			const size_t slot = getSlot(id);
+			if (slot >= indices.size()) {
+				indices.resize(std::max(slot + 1, indices.size() * 2), invalidIndex);
+			}
+			indices[slot] = idx;
+		}
+
+		void addPendingEntities()
+		{
+			if (toAdd.empty()) {
+				return;
+			}
+
+			HALLEY_DEBUG_TRACE();
+			const size_t prevSize = entities.size();
+			const size_t newSize = prevSize + toAdd.size();
+			if (entities.capacity() < newSize) {
+				entities.reserve(std::max(newSize, entities.capacity() * 2));
+			}
+
+			for (auto* entity: toAdd) {
+				auto& e = entities.emplace_back();
+				e.entityId = entity->getEntityId();
+				T::Type::loadComponents(*entity, &e.data[0]);
+				setIndex(e.entityId, static_cast<uint32_t>(entities.size() - 1));
+			}
+			toAdd.clear();
+
+			updateElems();
+			notifyAdd(entities.data() + prevSize, newSize - prevSize);
+		}
+
+		void reloadEntities()
+		{
+			if (toReload.empty()) {
+				return;
+			}
+
+			HALLEY_DEBUG_TRACE();
+			for (auto& id: toReload) {
+				const auto idx = findIndex(id);
+				if (idx != invalidIndex) {
+					reloadedEntities.push_back(&entities[idx]);
+				}
+			}
+			notifyReload(reloadedEntities.data(), reloadedEntities.size());
+			reloadedEntities.clear();
+			toReload.clear();
+		}
+
 		void removeDeadEntities()
 		{
 			// Performance-critical code
-			// Benchmarks suggest that using a Vector is faster than std::set and std::unordered_set
-			if (!toRemove.empty()) {
-				HALLEY_DEBUG_TRACE();
-				size_t removeCount = toRemove.size();
-				Expects(removeCount > 0);
-				Expects(removeCount <= entities.size());
-				std::sort(toRemove.begin(), toRemove.end());
-
-				for (size_t i = 1; i < toRemove.size(); ++i) {
-					Expects(toRemove[i - 1] != toRemove[i]);
-				}
+			if (toRemove.empty()) {
+				return;
+			}
+
+			HALLEY_DEBUG_TRACE();
 
-				// Move all entities to be removed to the back of the vector
-				{
-					int n = int(entities.size());
-					// Note: it's important to scan it forward. Scanning backwards would improve performance for short-lived entities,
-					// but it causes an issue where an entity is removed and added to the same family in one frame.
-					for (int i = 0; i < n; i++) {
-						EntityId id = entities[i].entityId;
-						auto iter = std::lower_bound(toRemove.begin(), toRemove.end(), id);
-						if (iter != toRemove.end() && id == *iter) {
-							toRemove.erase(iter);
-							if (i != n - 1) {
-								std::swap(entities[i], entities[n - 1]);
-								i--;
-							}
-							n--;
-							if (toRemove.empty()) {
-								break;
-							}
-						}
-					}
-					Ensures(size_t(n) + removeCount == entities.size());
+			// Move all entities to be removed to the back of the vector
+			size_t n = entities.size();
+			for (auto& id: toRemove) {
+				const auto idx = findIndex(id);
+				if (idx == invalidIndex) {
+					// Removed before it was ever added
+					toAdd.erase(std::remove_if(toAdd.begin(), toAdd.end(), [&] (const Entity* e) { return e->getEntityId() == id; }), toAdd.end());
+					continue;
 				}
 
-				Expects(toRemove.empty());
+				--n;
+				if (idx != n) {
+					std::swap(entities[idx], entities[n]);
+					setIndex(entities[idx].entityId, idx);
+				}
+				setIndex(entities[n].entityId, invalidIndex);
+			}
+			toRemove.clear();
 
+			const size_t removeCount = entities.size() - n;
+			if (removeCount > 0) {
 				// Notify removal
-				size_t newSize = entities.size() - removeCount;
-				Ensures(newSize < entities.size());
-				notifyRemove(entities.data() + newSize, removeCount);
+				notifyRemove(entities.data() + n, removeCount);
 
 				// Remove them
-				entities.resize(newSize);
+				entities.resize(n);
 				updateElems();
 			}
-			Ensures(toRemove.empty());
 		}
 	};
 }
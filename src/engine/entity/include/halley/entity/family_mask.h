@@ -58,6 +58,13 @@ namespace Halley {
 			static constexpr int componentIndex = T::componentIndex;
 		};
 
+		// Read-only components are declared as const T (or MaybeRef<const T>)
+		template <typename T>
+		struct IsReadOnlyComponent : std::is_const<T> {};
+
+		template <typename T>
+		struct IsReadOnlyComponent<MaybeRef<T>> : std::is_const<T> {};
+
 
 
 
@@ -100,10 +107,10 @@ namespace Halley {
 		template <typename T, typename... Ts>
 		struct MutableEvaluator <T, Ts...> {
 			constexpr static void makeMask(RealType& mask) {
-				if constexpr (!std::is_const<T>::value) {
+				if constexpr (!IsReadOnlyComponent<T>::value) {
 					FamilyMask::setBit(mask, RetrieveComponentIndex<T>::componentIndex);
 				}
-				Evaluator<Ts...>::makeMask(mask);
+				MutableEvaluator<Ts...>::makeMask(mask);
 			}
 
 			constexpr static HandleType getMask(MaskStorage& storage) {
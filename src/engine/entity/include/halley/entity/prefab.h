@@ -3,7 +3,9 @@
 #include "halley/file_formats/config_file.h"
 #include "entity_data_delta.h"
 
-namespace Halley {	
+namespace Halley {
+	class PrefabTemplate;
+	
 	class Prefab : public Resource {
 	public:
 		static std::unique_ptr<Prefab> loadResource(ResourceLoader& loader);
@@ -45,6 +47,10 @@ namespace Halley {
 
 		virtual std::shared_ptr<Prefab> clone() const;
 
+		// Compiled by EntityFactory on first instantiation, discarded whenever the entity data might change
+		std::shared_ptr<const PrefabTemplate> getTemplate() const;
+		void setTemplate(std::shared_ptr<const PrefabTemplate> prefabTemplate) const;
+
 	protected:
 		struct Deltas {
 			std::map<UUID, EntityDataDelta> entitiesModified;
@@ -60,6 +66,10 @@ namespace Halley {
 		ConfigFile gameData;
 
 		Deltas deltas;
+
+		mutable std::shared_ptr<const PrefabTemplate> compiledTemplate;
+
+		void invalidateTemplate();
 	};
 
 	class Scene final : public Prefab {
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "create_functions.h"
+#include "entity.h"
+#include "world.h"
+#include "halley/data_structures/config_node.h"
+#include "halley/data_structures/hash_map.h"
+#include "halley/maths/uuid.h"
+
+namespace Halley {
+	class EntityData;
+	class EntityFactoryContext;
+
+	// A prefab component with its type resolved, so instances don't have to look it up by name. See ComponentPrototypeImpl.
+	class ComponentPrototype {
+	public:
+		virtual ~ComponentPrototype() = default;
+
+		virtual int getComponentId() const = 0;
+		virtual bool isCopy() const = 0;
+		virtual void addToEntity(EntityRef& entity, const EntityFactoryContext& context) const = 0;
+		virtual void addToEntity(EntityRef& entity, const EntityFactoryContext& context, const ConfigNode& data) const = 0;
+		virtual void reserve(World& world, size_t count) const = 0;
+	};
+
+	// Components opt into being copied from a prefab template with "prefabTemplateCopy: true" in their definition.
+	// Everything else is deserialized for each instance, as a copy would share whatever the component points to.
+	template <typename T, typename = void>
+	struct IsPrefabTemplateCopyable : std::false_type {};
+
+	template <typename T>
+	struct IsPrefabTemplateCopyable<T, std::void_t<decltype(T::prefabTemplateCopy)>> : std::bool_constant<T::prefabTemplateCopy && std::is_copy_constructible_v<T>> {};
+
+	// Defined in entity_factory.h, as it needs EntityFactoryContext
+	template <typename T>
+	class ComponentPrototypeImpl;
+
+	// Components of a prefab, resolved once so that new instances don't need to look them up by name.
+	// Opted in components are also deserialized once and copied, unless they refer to other entities.
+	class PrefabTemplate {
+	public:
+		class Node {
+			friend class PrefabTemplate;
+
+		public:
+			void instantiate(EntityRef& entity, const EntityFactoryContext& context, const CreateComponentFunction& createComponent, const std::vector<std::pair<String, ConfigNode>>* overrides) const;
+
+			size_t getNumComponents() const;
+			size_t getNumCopies() const;
+
+		private:
+			struct Entry {
+				String name;
+				ConfigNode data; // Only kept if there's no prototype
+				std::unique_ptr<ComponentPrototype> prototype;
+			};
+
+			std::vector<Entry> components;
+			size_t numChildren = 0;
+
+			bool hasComponent(const String& name) const;
+		};
+
+		PrefabTemplate(const EntityData& root, const CreateComponentFunction& createComponent, EntityFactoryContext& context);
+
+		const Node* getNode(const UUID& prefabUUID) const;
+		size_t getNumNodes() const;
+
+		// True if every entity in the prefab has a node, so instances don't need their own copy of the prefab's data
+		bool isComplete() const;
+
+		// Preallocates entities, and storage for every component type in the template, for count instances
+		void reserve(World& world, size_t count) const;
+
+	private:
+		HashMap<UUID, Node> nodes;
+		bool complete = true;
+
+		void compileNode(const EntityData& data, const CreateComponentFunction& createComponent, EntityFactoryContext& context, std::vector<UUID>& duplicates);
+	};
+}
@@ -34,6 +34,21 @@ namespace Halley {
 	template <class, class, class = Halley::void_t<>> struct HasOnEntitiesReloaded : std::false_type {};
 	template <class T, class F> struct HasOnEntitiesReloaded<T, F, decltype(std::declval<T>().onEntitiesReloaded(std::declval<Span<F*>>()))> : std::true_type {};
 	
+	// Everything a system declares it touches outside of its families. Generated by codegen.
+	// Systems without a declaration are always run on their own.
+	struct SystemAccessDeclaration {
+		enum Flags {
+			API = 1,
+			World = 2,
+			Resources = 4
+		};
+
+		int access = 0;
+		Vector<String> services;
+		bool sendsMessages = false;
+		bool sendsSystemMessages = false;
+	};
+
 	class System
 	{
 	public:
@@ -57,6 +72,10 @@ namespace Halley {
 		void processSystemMessages();
 		size_t getSystemMessagesInInbox() const;
 
+		const SystemAccessDeclaration* getAccessDeclaration() const;
+		void getComponentAccess(FamilyMask::RealType& read, FamilyMask::RealType& write, MaskStorage& storage) const;
+		const Vector<int>& getMessageTypesReceived() const { return messageTypesReceived; }
+
 	protected:
 		const HalleyAPI& doGetAPI() const { return *api; }
 		World& doGetWorld() const { return *world; }
@@ -69,6 +88,8 @@ namespace Halley {
 		virtual void onMessagesReceived(int, Message**, size_t*, size_t) {}
 		virtual void onSystemMessageReceived(int messageId, SystemMessage& msg, const std::function<void(std::byte*)>& callback) {}
 
+		void declareAccess(SystemAccessDeclaration declaration);
+
 		template <typename F, typename V>
 		static void invokeIndividual(F&& f, V& fam)
 		{
@@ -176,6 +197,7 @@ namespace Halley {
 
 	private:
 		friend class World;
+		friend class SystemScheduler;
 
 		Vector<FamilyBindingBase*> families;
 		Vector<int> messageTypesReceived;
@@ -183,6 +205,7 @@ namespace Halley {
 		Vector<std::pair<EntityId, MessageEntry>> outbox;
 		Vector<const SystemMessageContext*> systemMessageInbox;
 		Vector<const SystemMessageContext*> systemMessages;
+		std::optional<SystemAccessDeclaration> accessDeclaration;
 
 		World* world = nullptr;
 		const HalleyAPI* api = nullptr;
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <memory>
+#include <functional>
+#include <halley/data_structures/vector.h>
+#include <halley/text/halleystring.h>
+#include <halley/time/halleytime.h>
+#include "family_mask.h"
+
+namespace Halley {
+	class System;
+	class ExecutionQueue;
+
+	// Runs the systems of a timeline, dispatching systems which don't touch the same data to the CPU executors.
+	// Conflicting systems always run in the order they were added (i.e. the order in the scene YAML).
+	class SystemScheduler {
+	public:
+		void invalidate();
+		void update(const Vector<std::unique_ptr<System>>& systems, MaskStorage& storage, Time time, const std::function<void()>& onSync);
+
+	private:
+		struct Access {
+			FamilyMask::RealType read;
+			FamilyMask::RealType write;
+			const Vector<String>* services = nullptr;
+			int flags = 0;
+			bool exclusive = false;
+			bool sendsMessages = false;
+			bool receivesMessages = false;
+			bool sendsSystemMessages = false;
+
+			bool conflictsWith(const Access& other) const;
+		};
+
+		struct Node {
+			System* system = nullptr;
+			Vector<size_t> successors;
+			size_t nDependencies = 0;
+		};
+
+		// Either a single exclusive system, which runs on the calling thread, or a graph of systems
+		struct Stage {
+			Vector<Node> nodes;
+			bool exclusive = false;
+		};
+
+		Vector<Stage> stages;
+		bool dirty = true;
+
+		void build(const Vector<std::unique_ptr<System>>& systems, MaskStorage& storage);
+		static Access getAccess(const System& system, MaskStorage& storage);
+		static void runStage(Stage& stage, Time time, ExecutionQueue& queue);
+	};
+}
@@ -1,30 +1,42 @@
 #pragma once
 
+#include <memory>
+#include <algorithm>
 #include <halley/data_structures/vector.h>
+#include <halley/data_structures/memory_pool.h>
 
 namespace Halley {
 	class TypeDeleterBase
 	{
 	public:
+		TypeDeleterBase(size_t size, bool chunked);
 		virtual ~TypeDeleterBase() {}
 		virtual size_t getSize() = 0;
 		virtual void callDestructor(void* ptr) = 0;
+
+		void* allocate();
+		void deallocate(void* ptr);
+		void reserve(size_t n);
+
+	private:
+		SizePool* sizePool = nullptr;
+		std::unique_ptr<ChunkedPool> chunkedPool;
 	};
 
 	class ComponentDeleterTable
 	{
 	public:
-		void set(int idx, TypeDeleterBase* deleter)
+		void set(int idx, std::unique_ptr<TypeDeleterBase> deleter)
 		{
 			if (int(map.size()) <= idx) {
-				map.resize(static_cast<size_t>(idx) * 3 / 2 + 1, nullptr);
+				map.resize(static_cast<size_t>(idx) * 3 / 2 + 1);
 			}
-			map[idx] = deleter;
+			map[idx] = std::move(deleter);
 		}
 
 		TypeDeleterBase* get(int uid) const
 		{
-			return map[uid];
+			return map[uid].get();
 		}
 
 		bool hasComponent(int uid) const
@@ -32,18 +44,41 @@ namespace Halley {
 			return map.size() > size_t(uid) && map[uid] != nullptr;
 		}
 
+		bool isEmpty() const
+		{
+			return std::all_of(map.begin(), map.end(), [] (const auto& d) { return d == nullptr; });
+		}
+
+		// When enabled, each component type gets its own ChunkedPool instead of sharing the global pool of its size
+		void setChunkedStorage(bool enabled)
+		{
+			chunkedStorage = enabled;
+		}
+
+		bool isChunkedStorage() const
+		{
+			return chunkedStorage;
+		}
+
 	private:
-		Vector<TypeDeleterBase*> map;
+		Vector<std::unique_ptr<TypeDeleterBase>> map;
+		bool chunkedStorage = false;
 	};
 
 	template <typename T>
 	class TypeDeleter final : public TypeDeleterBase
 	{
 	public:
+		explicit TypeDeleter(bool chunked)
+			: TypeDeleterBase(sizeof(T), chunked)
+		{
+			static_assert(alignof(T) <= ChunkedPool::maxAlignment, "Component is over-aligned for pooled storage");
+		}
+
 		static void initialize(ComponentDeleterTable& table)
 		{
 			if (!table.hasComponent(T::componentIndex)) {
-				table.set(T::componentIndex, new TypeDeleter<T>());
+				table.set(T::componentIndex, std::make_unique<TypeDeleter<T>>(table.isChunkedStorage()));
 			}
 		}
 
@@ -12,13 +12,15 @@
 #include <halley/time/stopwatch.h>
 #include <halley/data_structures/vector.h>
 #include <halley/data_structures/tree_map.h>
+#include <halley/data_structures/hash_map.h>
+#include "halley/maths/uuid.h"
 #include "service.h"
 #include "create_functions.h"
+#include "system_scheduler.h"
 #include "halley/utils/attributes.h"
 
 namespace Halley {
 	struct SystemMessageContext;
-	class UUID;
 	class ConfigNode;
 	class RenderContext;
 	class Entity;
@@ -78,12 +80,40 @@ namespace Halley {
 		EntityRef createEntity(UUID uuid, String name, EntityId parentId);
 		EntityRef createEntity(UUID uuid, String name = "", std::optional<EntityRef> parent = {}, uint8_t worldPartition = 0);
 
+		// Creates count entities in one go. They're all added to their families together on the next spawnPending()
+		Vector<EntityRef> createEntities(size_t count, uint8_t worldPartition = 0);
+
+		// As above, giving each entity a copy of the given components
+		template <typename... Ts>
+		Vector<EntityRef> createArchetypeEntities(size_t count, const Ts&... components)
+		{
+			(reserveComponents<Ts>(count), ...);
+			auto result = createEntities(count);
+			for (auto& e: result) {
+				e.reserve(sizeof...(Ts), 0);
+				(e.addComponent(Ts(components)), ...);
+			}
+			return result;
+		}
+
+		// Preallocates storage so the next count entities can be created without growing it
+		void reserveEntities(size_t count);
+
+		template <typename T>
+		void reserveComponents(size_t count)
+		{
+			auto& table = getComponentDeleterTable();
+			TypeDeleter<T>::initialize(table);
+			table.get(T::componentIndex)->reserve(count);
+		}
+
 		void destroyEntity(EntityId id);
 		void destroyEntity(EntityRef entity);
 
 		EntityRef getEntity(EntityId id);
 		Entity* tryGetRawEntity(EntityId id);
 		std::optional<EntityRef> findEntity(const UUID& id, bool includePending = false);
+		std::vector<std::optional<EntityRef>> findEntities(gsl::span<const UUID> ids, bool includePending = false);
 
 		size_t numEntities() const;
 		std::vector<EntityRef> getEntities();
@@ -124,19 +154,32 @@ namespace Halley {
 		void setEditor(bool isEditor);
 		bool isEditor() const;
 
+		// Runs non-conflicting systems concurrently on the CPU executors, see SystemScheduler
+		void setParallelSystems(bool enabled);
+		bool isParallelSystems() const;
+
+		// Allocates each component type from its own chunked pool, instead of sharing a pool with every type of the same size.
+		// This keeps each type packed, but an entity's components are no longer next to each other, which can make
+		// families over several components slower to iterate. Must be set before any components are added.
+		void setChunkedComponentStorage(bool enabled);
+
 	private:
 		const HalleyAPI& api;
 		Resources& resources;
 		std::array<Vector<std::unique_ptr<System>>, static_cast<int>(TimeLine::NUMBER_OF_TIMELINES)> systems;
+		std::array<SystemScheduler, static_cast<int>(TimeLine::NUMBER_OF_TIMELINES)> schedulers;
 		CreateComponentFunction createComponent;
 		bool collectMetrics = false;
 		bool entityDirty = false;
 		bool entityReloaded = false;
 		bool editor = false;
+		bool parallelSystems = false;
 		
 		Vector<Entity*> entities;
 		Vector<Entity*> entitiesPendingCreation;
 		MappedPool<Entity*> entityMap;
+		HashMap<UUID, Entity*> uuidMap;
+		HashMap<UUID, Vector<Entity*>> uuidCollisions; // Entities that reused a live UUID, oldest first, waiting to take over lookups
 
 		//TreeMap<FamilyMaskType, std::unique_ptr<Family>> families;
 		Vector<std::unique_ptr<Family>> families;
@@ -144,6 +187,16 @@ namespace Halley {
 
 		TreeMap<FamilyMaskType, std::vector<Family*>> familyCache;
 
+		struct FamilyTodo {
+			std::vector<std::pair<FamilyMaskType, Entity*>> toAdd;
+			std::vector<std::pair<FamilyMaskType, Entity*>> toRemove;
+			std::vector<std::pair<FamilyMaskType, Entity*>> toReload;
+			bool active = false;
+		};
+		TreeMap<FamilyMaskType, FamilyTodo> familyTodos; // Never shrinks, so the vectors can be reused between updates
+		Vector<std::pair<FamilyMaskType, FamilyTodo*>> activeFamilyTodos;
+		Vector<size_t> entitiesRemoved;
+
 		std::shared_ptr<MaskStorage> maskStorage;
 		std::shared_ptr<ComponentDeleterTable> componentDeleterTable;
 
@@ -151,7 +204,10 @@ namespace Halley {
 
 		std::list<SystemMessageContext> pendingSystemMessages;
 
+		Entity* makeEntity(UUID uuid, uint8_t worldPartition);
 		void allocateEntity(Entity* entity);
+		Entity* tryGetRawEntity(const UUID& id, bool includePending);
+		void removeFromUUIDMap(Entity& entity);
 		void updateEntities();
 		void initSystems();
 
@@ -168,6 +224,7 @@ namespace Halley {
 		Service* tryGetService(const String& name) const;
 
 		const std::vector<Family*>& getFamiliesFor(const FamilyMaskType& mask);
+		FamilyTodo& getFamilyTodo(const FamilyMaskType& mask);
 
 		void processSystemMessages(TimeLine timeline);
 	};
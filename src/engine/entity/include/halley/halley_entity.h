@@ -6,6 +6,7 @@ namespace Halley {} // Get GitHub to realise this is C++ :3
 #include "entity/component_reflector.h"
 #include "entity/message.h"
 #include "entity/prefab.h"
+#include "entity/prefab_template.h"
 #include "entity/prefab_scene_data.h"
 #include "entity/registry.h"
 #include "entity/service.h"
@@ -143,7 +143,7 @@ void PerformanceStatsView::drawHeader(Painter& painter)
 		const float totalTimePerBuffer = static_cast<float>(audioSpec->bufferSize) / static_cast<float>(audioSpec->sampleRate);
 		const float audioTimeFloat = audioTime / 1'000'000'000.0f;
 		const int percent = lround(audioTimeFloat / totalTimePerBuffer * 100.0f);
-		str += "\nAudio time: " + formatTime(audioTime) + " ms (" + toString(percent) + "%)";
+		str += "\nAudio time: " + formatTime(audioTime) + " ms (" + toString(percent) + "%), " + toString(api.audio->getStreamUnderruns()) + " stream underruns";
 	}
 	
 	headerText
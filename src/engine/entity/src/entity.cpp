@@ -11,6 +11,7 @@ Entity::Entity()
 	, alive(true)
 	, serializable(true)
 	, reloaded(false)
+	, spawned(false)
 {
 
 }
@@ -83,7 +84,7 @@ void Entity::deleteComponent(Component* component, int id, ComponentDeleterTable
 {
 	TypeDeleterBase* deleter = table.get(id);
 	deleter->callDestructor(component);
-	PoolPool::getPool(deleter->getSize())->free(component);
+	deleter->deallocate(component);
 }
 
 void Entity::keepOnlyComponentsWithIds(const std::vector<int>& ids, World& world)
@@ -101,6 +102,7 @@ void Entity::keepOnlyComponentsWithIds(const std::vector<int>& ids, World& world
 
 void Entity::onReady()
 {
+	spawned = true;
 }
 
 void Entity::markDirty(World& world)
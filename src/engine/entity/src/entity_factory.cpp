@@ -34,6 +34,24 @@ EntityRef EntityFactory::createEntity(const String& prefabName)
 	return createEntity(data);
 }
 
+Vector<EntityRef> EntityFactory::createEntities(const String& prefabName, size_t count)
+{
+	// Look the prefab up once for the whole batch
+	const auto prefab = getPrefab(prefabName);
+	if (prefab && !prefab->isScene()) {
+		getPrefabTemplate(*prefab)->reserve(world, count);
+	}
+
+	Vector<EntityRef> result;
+	result.reserve(count);
+	for (size_t i = 0; i < count; ++i) {
+		EntityData data(UUID::generate());
+		data.setPrefab(prefabName);
+		result.push_back(doCreateEntity(data, EntityRef(), nullptr, prefab));
+	}
+	return result;
+}
+
 EntityScene EntityFactory::createScene(const std::shared_ptr<const Prefab>& prefab, bool allowReload, uint8_t worldPartition)
 {
 	EntityScene curScene(allowReload, worldPartition);
@@ -112,6 +130,19 @@ std::shared_ptr<const Prefab> EntityFactory::getPrefab(std::optional<EntityRef>
 	}
 }
 
+std::shared_ptr<const PrefabTemplate> EntityFactory::getPrefabTemplate(const Prefab& prefab)
+{
+	auto result = prefab.getTemplate();
+	if (!result) {
+		const auto mask = makeMask(EntitySerialization::Type::Prefab, EntitySerialization::Type::SaveData);
+		EntityFactoryContext context(world, resources, mask, false, {}, nullptr, nullptr);
+		context.setCompilingTemplate(true);
+		result = std::make_shared<PrefabTemplate>(prefab.getEntityData(), world.getCreateComponentFunction(), context);
+		prefab.setTemplate(result);
+	}
+	return result;
+}
+
 EntityFactoryContext::EntityFactoryContext(World& world, Resources& resources, int entitySerializationMask, bool update, std::shared_ptr<const Prefab> _prefab, const IEntityData* origEntityData, EntityScene* scene)
 	: world(&world)
 	, scene(scene)
@@ -129,6 +160,12 @@ EntityFactoryContext::EntityFactoryContext(World& world, Resources& resources, i
 
 EntityId EntityFactoryContext::getEntityIdFromUUID(const UUID& uuid) const
 {
+	if (compilingTemplate) {
+		// Entity references are per-instance, so this component can't be precompiled
+		compiledEntityReference = true;
+		return EntityId();
+	}
+	
 	const auto result = getEntity(uuid, true);
 	if (result.isValid()) {
 		return result.getEntityId();
@@ -184,6 +221,51 @@ uint8_t EntityFactoryContext::getWorldPartition() const
 	return scene ? scene->getWorldPartition() : 0;
 }
 
+void EntityFactoryContext::setCompilingTemplate(bool compiling)
+{
+	compilingTemplate = compiling;
+}
+
+std::unique_ptr<ComponentPrototype> EntityFactoryContext::takeCompiledPrototype()
+{
+	return std::move(compiledPrototype);
+}
+
+void EntityFactoryContext::setPrefabTemplate(std::shared_ptr<const PrefabTemplate> _prefabTemplate, const EntityData& instance)
+{
+	prefabTemplate = std::move(_prefabTemplate);
+	templateOverrides = instance.getComponents().empty() ? nullptr : &instance.getComponents();
+
+	if (prefabTemplate->isComplete()) {
+		// Walk the prefab's own data instead of a copy instantiated with the instance, the template and overrides cover the rest
+		entityData = &prefab->getEntityData();
+		templateInstanceUUID = instance.getInstanceUUID();
+	} else {
+		setEntityData(instance);
+	}
+}
+
+const PrefabTemplate::Node* EntityFactoryContext::getTemplateNode(const EntityData& data) const
+{
+	return prefabTemplate ? prefabTemplate->getNode(data.getPrefabUUID()) : nullptr;
+}
+
+const std::vector<std::pair<String, ConfigNode>>* EntityFactoryContext::getTemplateOverrides(const EntityData& data) const
+{
+	// Instance overrides only apply to the root of the prefab
+	return &data == entityData ? templateOverrides : nullptr;
+}
+
+UUID EntityFactoryContext::getInstanceUUID(const EntityData& data) const
+{
+	if (!templateInstanceUUID.isValid()) {
+		return data.getInstanceUUID();
+	}
+
+	// The same UUIDs EntityData::instantiateWith would have given them
+	return &data == entityData ? templateInstanceUUID : UUID::generateFromUUIDs(data.getPrefabUUID(), templateInstanceUUID);
+}
+
 void EntityFactoryContext::setEntityData(const IEntityData& iData)
 {
 	if (prefab) {
@@ -210,7 +292,12 @@ void EntityFactoryContext::notifyEntity(const EntityRef& entity) const
 
 EntityRef EntityFactory::createEntity(const EntityData& data, EntityRef parent, EntityScene* scene)
 {
-	const auto context = makeContext(data, {}, scene, false);
+	return doCreateEntity(data, parent, scene, {});
+}
+
+EntityRef EntityFactory::doCreateEntity(const EntityData& data, EntityRef parent, EntityScene* scene, std::shared_ptr<const Prefab> prefab)
+{
+	const auto context = makeContext(data, {}, scene, false, std::move(prefab));
 	const auto entity = getEntity(data.getInstanceUUID(), *context, false);
 	updateEntityNode(context->getRootEntityData(), entity, parent, context);
 	return entity;
@@ -222,10 +309,23 @@ void EntityFactory::updateEntity(EntityRef& entity, const IEntityData& data, Ent
 	updateEntityNode(context->getRootEntityData(), entity, {}, context);
 }
 
-std::shared_ptr<EntityFactoryContext> EntityFactory::makeContext(const IEntityData& data, std::optional<EntityRef> existing, EntityScene* scene, bool updateContext)
+std::shared_ptr<EntityFactoryContext> EntityFactory::makeContext(const IEntityData& data, std::optional<EntityRef> existing, EntityScene* scene, bool updateContext, std::shared_ptr<const Prefab> prefab)
 {
 	const auto mask = makeMask(EntitySerialization::Type::Prefab, EntitySerialization::Type::SaveData);
-	auto context = std::make_shared<EntityFactoryContext>(world, resources, mask, updateContext, getPrefab(existing, data), &data, scene);
+	if (!prefab) {
+		prefab = getPrefab(existing, data);
+	}
+
+	// Fresh prefab instances can be populated from the precompiled template, unless they override its children
+	std::shared_ptr<const PrefabTemplate> prefabTemplate;
+	if (prefab && !prefab->isScene() && !updateContext && !data.isDelta() && data.asEntityData().getChildren().empty()) {
+		prefabTemplate = getPrefabTemplate(*prefab);
+	}
+
+	auto context = std::make_shared<EntityFactoryContext>(world, resources, mask, updateContext, std::move(prefab), prefabTemplate ? nullptr : &data, scene);
+	if (prefabTemplate) {
+		context->setPrefabTemplate(std::move(prefabTemplate), data.asEntityData());
+	}
 
 	if (existing) {
 		context->notifyEntity(existing.value());
@@ -270,6 +370,12 @@ void EntityFactory::updateEntityComponents(EntityRef entity, const EntityData& d
 	const auto& func = world.getCreateComponentFunction();
 
 	if (entity.getNumComponents() == 0) {
+		if (const auto* node = context.getTemplateNode(data)) {
+			// Copy from precompiled prefab
+			node->instantiate(entity, context, func, context.getTemplateOverrides(data));
+			return;
+		}
+		
 		// Simple population
 		for (const auto& [componentName, componentData]: data.getComponents()) {
 			func(context, componentName, entity, componentData);
@@ -317,7 +423,7 @@ void EntityFactory::updateEntityChildren(EntityRef entity, const EntityData& dat
 		std::vector<EntityRef> toDelete;
 		for (auto c: entity.getChildren()) {
 			const auto& uuid = c.getInstanceUUID();
-			if (!std_ex::contains_if(newChildren, [&] (const EntityData& c) { return c.getInstanceUUID() == uuid; })) {
+			if (!std_ex::contains_if(newChildren, [&] (const EntityData& c) { return context->getInstanceUUID(c) == uuid; })) {
 				toDelete.push_back(c);
 			}
 		}
@@ -332,7 +438,7 @@ void EntityFactory::updateEntityChildren(EntityRef entity, const EntityData& dat
 			const auto newContext = makeContext(child, entity, context->getScene(), context->isUpdateContext());
 			updateEntityNode(newContext->getRootEntityData(), getEntity(child.getInstanceUUID(), *newContext, false), entity, newContext);
 		} else {
-			updateEntityNode(child, getEntity(child.getInstanceUUID(), *context, false), entity, context);
+			updateEntityNode(child, getEntity(context->getInstanceUUID(child), *context, false), entity, context);
 		}
 	}
 }
@@ -384,12 +490,13 @@ void EntityFactory::preInstantiateEntities(const IEntityData& iData, EntityFacto
 
 EntityRef EntityFactory::instantiateEntity(const EntityData& data, EntityFactoryContext& context, bool allowWorldLookup)
 {
-	const auto existing = getEntity(data.getInstanceUUID(), context, allowWorldLookup);
+	const auto instanceUUID = context.getInstanceUUID(data);
+	const auto existing = getEntity(instanceUUID, context, allowWorldLookup);
 	if (existing.isValid()) {
 		return existing;
 	}
 	
-	auto entity = world.createEntity(data.getInstanceUUID(), data.getName(), std::optional<EntityRef>(), context.getWorldPartition());
+	auto entity = world.createEntity(instanceUUID, data.getName(), std::optional<EntityRef>(), context.getWorldPartition());
 	entity.setPrefab(context.getPrefab(), data.getPrefabUUID());
 	context.addEntity(entity);
 
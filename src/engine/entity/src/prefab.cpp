@@ -1,6 +1,7 @@
 #include "prefab.h"
 
 #include "entity_data_delta.h"
+#include "prefab_template.h"
 #include "halley/file_formats/yaml_convert.h"
 #include "halley/resources/resource_data.h"
 
@@ -25,6 +26,7 @@ void Prefab::reload(Resource&& resource)
 	auto newDeltas = generatePrefabDeltas(prefab);
 	*this = std::move(prefab);
 	deltas = std::move(newDeltas);
+	invalidateTemplate();
 }
 
 void Prefab::makeDefault()
@@ -43,6 +45,7 @@ void Prefab::deserialize(Deserializer& s)
 	s >> entityData;
 	s >> gameData;
 	entityData.setSceneRoot(isScene());
+	invalidateTemplate();
 }
 
 void Prefab::parseYAML(gsl::span<const gsl::byte> yaml)
@@ -71,6 +74,7 @@ void Prefab::parseConfigNode(ConfigNode node)
 	}
 
 	entityData.setSceneRoot(isScene());
+	invalidateTemplate();
 }
 
 ConfigNode Prefab::toConfigNode() const
@@ -93,6 +97,7 @@ bool Prefab::isScene() const
 
 EntityData& Prefab::getEntityData()
 {
+	invalidateTemplate();
 	return entityData;
 }
 
@@ -108,6 +113,7 @@ gsl::span<const EntityData> Prefab::getEntityDatas() const
 
 gsl::span<EntityData> Prefab::getEntityDatas()
 {
+	invalidateTemplate();
 	return gsl::span<EntityData>(&entityData, 1);
 }
 
@@ -194,6 +200,7 @@ String Prefab::getPrefabIcon() const
 
 EntityData* Prefab::findEntityData(const UUID& uuid)
 {
+	invalidateTemplate();
 	if (!uuid.isValid()) {
 		if (isScene()) {
 			return &entityData;
@@ -209,6 +216,21 @@ std::shared_ptr<Prefab> Prefab::clone() const
 	return std::make_shared<Prefab>(*this);
 }
 
+std::shared_ptr<const PrefabTemplate> Prefab::getTemplate() const
+{
+	return std::atomic_load(&compiledTemplate);
+}
+
+void Prefab::setTemplate(std::shared_ptr<const PrefabTemplate> prefabTemplate) const
+{
+	std::atomic_store(&compiledTemplate, std::move(prefabTemplate));
+}
+
+void Prefab::invalidateTemplate()
+{
+	std::atomic_store(&compiledTemplate, std::shared_ptr<const PrefabTemplate>());
+}
+
 EntityData Prefab::makeEntityData(const ConfigNode& node) const
 {
 	return EntityData(node, true);
@@ -245,6 +267,7 @@ void Scene::reload(Resource&& resource)
 	auto newDeltas = generateSceneDeltas(scene);
 	*this = std::move(scene);
 	deltas = std::move(newDeltas);
+	invalidateTemplate();
 }
 
 void Scene::makeDefault()
@@ -259,6 +282,7 @@ gsl::span<const EntityData> Scene::getEntityDatas() const
 
 gsl::span<EntityData> Scene::getEntityDatas()
 {
+	invalidateTemplate();
 	return entityData.getChildren();
 }
 
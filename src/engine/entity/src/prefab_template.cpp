@@ -0,0 +1,143 @@
+#include "prefab_template.h"
+
+#include <map>
+
+#include "entity_data.h"
+#include "entity_factory.h"
+#include "halley/utils/algorithm.h"
+
+using namespace Halley;
+
+void PrefabTemplate::Node::instantiate(EntityRef& entity, const EntityFactoryContext& context, const CreateComponentFunction& createComponent, const std::vector<std::pair<String, ConfigNode>>* overrides) const
+{
+	entity.reserve(components.size() + (overrides ? overrides->size() : 0), numChildren);
+
+	for (const auto& c: components) {
+		const ConfigNode* overrideData = nullptr;
+		if (overrides) {
+			const auto iter = std::find_if(overrides->begin(), overrides->end(), [&] (const auto& o) { return o.first == c.name; });
+			if (iter != overrides->end()) {
+				overrideData = &iter->second;
+			}
+		}
+
+		if (c.prototype) {
+			if (overrideData) {
+				c.prototype->addToEntity(entity, context, *overrideData);
+			} else {
+				c.prototype->addToEntity(entity, context);
+			}
+		} else {
+			createComponent(context, c.name, entity, overrideData ? *overrideData : c.data);
+		}
+	}
+
+	if (overrides) {
+		// Components added by the instance
+		for (const auto& [name, data]: *overrides) {
+			if (!hasComponent(name)) {
+				createComponent(context, name, entity, data);
+			}
+		}
+	}
+}
+
+size_t PrefabTemplate::Node::getNumComponents() const
+{
+	return components.size();
+}
+
+size_t PrefabTemplate::Node::getNumCopies() const
+{
+	return std::count_if(components.begin(), components.end(), [] (const Entry& e) { return e.prototype && e.prototype->isCopy(); });
+}
+
+bool PrefabTemplate::Node::hasComponent(const String& name) const
+{
+	return std_ex::contains_if(components, [&] (const Entry& e) { return e.name == name; });
+}
+
+PrefabTemplate::PrefabTemplate(const EntityData& root, const CreateComponentFunction& createComponent, EntityFactoryContext& context)
+{
+	std::vector<UUID> duplicates;
+	compileNode(root, createComponent, context, duplicates);
+
+	// Can't tell these apart by prefab UUID, so let them take the slow path
+	for (const auto& uuid: duplicates) {
+		nodes.erase(uuid);
+		complete = false;
+	}
+}
+
+const PrefabTemplate::Node* PrefabTemplate::getNode(const UUID& prefabUUID) const
+{
+	const auto iter = nodes.find(prefabUUID);
+	return iter != nodes.end() ? &iter->second : nullptr;
+}
+
+size_t PrefabTemplate::getNumNodes() const
+{
+	return nodes.size();
+}
+
+bool PrefabTemplate::isComplete() const
+{
+	return complete;
+}
+
+void PrefabTemplate::reserve(World& world, size_t count) const
+{
+	world.reserveEntities(nodes.size() * count);
+
+	// Several nodes may share a component type
+	std::map<int, std::pair<const ComponentPrototype*, size_t>> prototypes;
+	for (const auto& [uuid, node]: nodes) {
+		for (const auto& c: node.components) {
+			if (c.prototype) {
+				auto& entry = prototypes[c.prototype->getComponentId()];
+				entry.first = c.prototype.get();
+				entry.second += count;
+			}
+		}
+	}
+	for (const auto& [id, entry]: prototypes) {
+		entry.first->reserve(world, entry.second);
+	}
+}
+
+void PrefabTemplate::compileNode(const EntityData& data, const CreateComponentFunction& createComponent, EntityFactoryContext& context, std::vector<UUID>& duplicates)
+{
+	const auto& uuid = data.getPrefabUUID();
+	if (uuid.isValid()) {
+		if (nodes.find(uuid) != nodes.end()) {
+			duplicates.push_back(uuid);
+		} else {
+			Node node;
+			node.numChildren = data.getChildren().size();
+			node.components.reserve(data.getComponents().size());
+			for (const auto& [name, componentData]: data.getComponents()) {
+				EntityRef dummy;
+				createComponent(context, name, dummy, componentData);
+
+				auto& entry = node.components.emplace_back();
+				entry.name = name;
+				entry.prototype = context.takeCompiledPrototype();
+				if (!entry.prototype) {
+					entry.data = ConfigNode(componentData);
+				}
+			}
+			nodes[uuid] = std::move(node);
+		}
+	} else {
+		complete = false;
+	}
+
+	for (const auto& child: data.getChildren()) {
+		// Nested prefab instances are built from their own prefab's template
+		if (child.getPrefab().isEmpty()) {
+			compileNode(child, createComponent, context, duplicates);
+		} else {
+			complete = false;
+		}
+	}
+}
@@ -35,6 +35,24 @@ void System::setCollectSamples(bool collect)
 	collectSamples = collect;
 }
 
+const SystemAccessDeclaration* System::getAccessDeclaration() const
+{
+	return accessDeclaration ? &accessDeclaration.value() : nullptr;
+}
+
+void System::getComponentAccess(FamilyMask::RealType& read, FamilyMask::RealType& write, MaskStorage& storage) const
+{
+	for (auto f : families) {
+		read |= f->readMask.getRealValue(storage);
+		write |= f->writeMask.getRealValue(storage);
+	}
+}
+
+void System::declareAccess(SystemAccessDeclaration declaration)
+{
+	accessDeclaration = std::move(declaration);
+}
+
 void System::onAddedToWorld(World& w, int id) {
 	world = &w;
 	systemId = id;
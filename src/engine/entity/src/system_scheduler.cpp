@@ -0,0 +1,195 @@
+#include "system_scheduler.h"
+#include "system.h"
+#include <halley/concurrency/concurrent.h>
+#include <mutex>
+#include <condition_variable>
+
+using namespace Halley;
+
+bool SystemScheduler::Access::conflictsWith(const Access& other) const
+{
+	if (exclusive || other.exclusive) {
+		return true;
+	}
+
+	// Component data
+	if ((read & other.write).any() || (write & other.read).any()) {
+		return true;
+	}
+
+	// The API and resources aren't thread-safe
+	if ((flags & other.flags & (SystemAccessDeclaration::API | SystemAccessDeclaration::Resources)) != 0) {
+		return true;
+	}
+
+	// Entity inboxes are written by senders and read by receivers, regardless of message type
+	if ((sendsMessages && (other.sendsMessages || other.receivesMessages)) || (other.sendsMessages && receivesMessages)) {
+		return true;
+	}
+
+	// System messages are queued on the world
+	if (sendsSystemMessages && other.sendsSystemMessages) {
+		return true;
+	}
+
+	// Services have no notion of const access, so any sharing is a conflict
+	for (const auto& service: *services) {
+		if (std::find(other.services->begin(), other.services->end(), service) != other.services->end()) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void SystemScheduler::invalidate()
+{
+	dirty = true;
+}
+
+void SystemScheduler::update(const Vector<std::unique_ptr<System>>& systems, MaskStorage& storage, Time time, const std::function<void()>& onSync)
+{
+	if (dirty) {
+		build(systems, storage);
+		dirty = false;
+	}
+
+	auto& queue = Executors::getCPU();
+	const bool hasThreads = queue.threadCount() > 0;
+
+	for (auto& stage: stages) {
+		if (stage.exclusive || stage.nodes.size() == 1 || !hasThreads) {
+			for (auto& node: stage.nodes) {
+				node.system->doUpdate(time);
+				onSync();
+			}
+		} else {
+			runStage(stage, time, queue);
+			onSync();
+		}
+	}
+}
+
+void SystemScheduler::build(const Vector<std::unique_ptr<System>>& systems, MaskStorage& storage)
+{
+	stages.clear();
+	Vector<Access> stageAccess;
+	bool stageOpen = false;
+
+	for (auto& system: systems) {
+		auto access = getAccess(*system, storage);
+
+		if (access.exclusive) {
+			auto& stage = stages.emplace_back();
+			stage.exclusive = true;
+			stage.nodes.emplace_back().system = system.get();
+			stageOpen = false;
+			continue;
+		}
+
+		if (!stageOpen) {
+			stages.emplace_back();
+			stageAccess.clear();
+			stageOpen = true;
+		}
+
+		auto& stage = stages.back();
+		const size_t idx = stage.nodes.size();
+		Node node;
+		node.system = system.get();
+		for (size_t i = 0; i < idx; ++i) {
+			if (stageAccess[i].conflictsWith(access)) {
+				stage.nodes[i].successors.push_back(idx);
+				++node.nDependencies;
+			}
+		}
+		stage.nodes.push_back(std::move(node));
+		stageAccess.push_back(std::move(access));
+	}
+}
+
+SystemScheduler::Access SystemScheduler::getAccess(const System& system, MaskStorage& storage)
+{
+	Access result;
+
+	const auto* declaration = system.getAccessDeclaration();
+	if (!declaration || (declaration->access & SystemAccessDeclaration::World) != 0) {
+		result.exclusive = true;
+		return result;
+	}
+
+	system.getComponentAccess(result.read, result.write, storage);
+	result.services = &declaration->services;
+	result.flags = declaration->access;
+	result.sendsMessages = declaration->sendsMessages;
+	result.receivesMessages = !system.getMessageTypesReceived().empty();
+	result.sendsSystemMessages = declaration->sendsSystemMessages;
+	return result;
+}
+
+void SystemScheduler::runStage(Stage& stage, Time time, ExecutionQueue& queue)
+{
+	const size_t n = stage.nodes.size();
+
+	std::mutex mutex;
+	std::condition_variable condition;
+	Vector<size_t> dependenciesLeft(n);
+	Vector<size_t> ready;
+	size_t nDone = 0;
+	std::exception_ptr error;
+
+	for (size_t i = 0; i < n; ++i) {
+		dependenciesLeft[i] = stage.nodes[i].nDependencies;
+		if (dependenciesLeft[i] == 0) {
+			ready.push_back(i);
+		}
+	}
+
+	auto run = [&] (size_t idx)
+	{
+		auto& node = stage.nodes[idx];
+		std::exception_ptr curError;
+		try {
+			node.system->doUpdate(time);
+		} catch (...) {
+			curError = std::current_exception();
+		}
+
+		// Notify while holding the lock, as the waiting thread owns everything captured here
+		std::unique_lock<std::mutex> lock(mutex);
+		if (curError && !error) {
+			error = curError;
+		}
+		for (auto succ: node.successors) {
+			if (--dependenciesLeft[succ] == 0) {
+				ready.push_back(succ);
+			}
+		}
+		++nDone;
+		condition.notify_one();
+	};
+
+	std::unique_lock<std::mutex> lock(mutex);
+	while (nDone < n) {
+		if (ready.empty()) {
+			condition.wait(lock);
+			continue;
+		}
+
+		// Run one system on this thread, and send any others that are ready to the executors
+		const size_t local = ready.back();
+		ready.pop_back();
+		for (auto idx: ready) {
+			Concurrent::execute(queue, [&run, idx] () { run(idx); });
+		}
+		ready.clear();
+
+		lock.unlock();
+		run(local);
+		lock.lock();
+	}
+
+	if (error) {
+		std::rethrow_exception(error);
+	}
+}
@@ -0,0 +1,34 @@
+#include "type_deleter.h"
+
+using namespace Halley;
+
+TypeDeleterBase::TypeDeleterBase(size_t size, bool chunked)
+{
+	if (chunked) {
+		chunkedPool = std::make_unique<ChunkedPool>(size);
+	} else {
+		sizePool = PoolPool::getPool(size);
+	}
+}
+
+void* TypeDeleterBase::allocate()
+{
+	return chunkedPool ? chunkedPool->alloc() : sizePool->alloc();
+}
+
+void TypeDeleterBase::deallocate(void* ptr)
+{
+	if (chunkedPool) {
+		chunkedPool->free(ptr);
+	} else {
+		sizePool->free(ptr);
+	}
+}
+
+void TypeDeleterBase::reserve(size_t n)
+{
+	// The shared size pools grow on their own
+	if (chunkedPool) {
+		chunkedPool->reserve(n);
+	}
+}
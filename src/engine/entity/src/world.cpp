@@ -71,15 +71,18 @@ System& World::addSystem(std::unique_ptr<System> system, TimeLine timelineType)
 	auto& timeline = getSystems(timelineType);
 	timeline.emplace_back(std::move(system));
 	ref.onAddedToWorld(*this, int(timeline.size()));
+	schedulers[static_cast<int>(timelineType)].invalidate();
 	return ref;
 }
 
 void World::removeSystem(System& system)
 {
-	for (auto& sys : systems) {
+	for (size_t t = 0; t < systems.size(); t++) {
+		auto& sys = systems[t];
 		for (size_t i = 0; i < sys.size(); i++) {
 			if (sys[i].get() == &system) {
 				sys.erase(sys.begin() + i);
+				schedulers[t].invalidate();
 				return;
 			}
 		}
@@ -137,6 +140,13 @@ Service& World::addService(std::shared_ptr<Service> service)
 
 void World::loadSystems(const ConfigNode& root, std::function<std::unique_ptr<System>(String)> createFunction)
 {
+	if (root.hasKey("parallelSystems")) {
+		setParallelSystems(root["parallelSystems"].asBool());
+	}
+	if (root.hasKey("chunkedComponents")) {
+		setChunkedComponentStorage(root["chunkedComponents"].asBool());
+	}
+
 	auto timelines = root["timelines"].asMap();
 	for (auto iter = timelines.begin(); iter != timelines.end(); ++iter) {
 		String timelineName = iter->first;
@@ -184,21 +194,7 @@ EntityRef World::createEntity(UUID uuid, String name, EntityId parentId)
 
 EntityRef World::createEntity(UUID uuid, String name, std::optional<EntityRef> parent, uint8_t worldPartition)
 {
-	if (!uuid.isValid()) {
-		uuid = UUID::generate();
-	}
-	
-	Entity* entity = new(PoolAllocator<Entity>::alloc()) Entity();
-	if (entity == nullptr) {
-		throw Exception("Error creating entity - out of memory?", HalleyExceptions::Entity);
-	}
-	entity->instanceUUID = uuid;
-	entity->worldPartition = worldPartition;
-
-	entitiesPendingCreation.push_back(entity);
-	allocateEntity(entity);
-
-	auto e = EntityRef(*entity, *this);
+	auto e = EntityRef(*makeEntity(uuid, worldPartition), *this);
 	e.setName(std::move(name));
 
 	if (parent) {
@@ -253,21 +249,66 @@ Entity* World::tryGetRawEntity(EntityId id)
 
 std::optional<EntityRef> World::findEntity(const UUID& id, bool includePending)
 {
-	for (auto& e: entities) {
-		if (e->getInstanceUUID() == id && e->isAlive()) {
-			return EntityRef(*e, *this);
+	auto* e = tryGetRawEntity(id, includePending);
+	if (e) {
+		return EntityRef(*e, *this);
+	}
+	return std::optional<EntityRef>();
+}
+
+std::vector<std::optional<EntityRef>> World::findEntities(gsl::span<const UUID> ids, bool includePending)
+{
+	std::vector<std::optional<EntityRef>> result;
+	result.reserve(ids.size());
+	for (const auto& id: ids) {
+		auto* e = tryGetRawEntity(id, includePending);
+		if (e) {
+			result.emplace_back(EntityRef(*e, *this));
+		} else {
+			result.emplace_back();
 		}
 	}
+	return result;
+}
 
-	if (includePending) {
-		for (auto& e : entitiesPendingCreation) {
-			if (e->getInstanceUUID() == id && e->isAlive()) {
-				return EntityRef(*e, *this);
+Entity* World::tryGetRawEntity(const UUID& id, bool includePending)
+{
+	const auto iter = uuidMap.find(id);
+	if (iter == uuidMap.end()) {
+		return nullptr;
+	}
+	auto* e = iter->second;
+	if (!e->isAlive() || (!includePending && !e->isSpawned())) {
+		return nullptr;
+	}
+	return e;
+}
+
+void World::removeFromUUIDMap(Entity& entity)
+{
+	const auto& uuid = entity.getInstanceUUID();
+	const auto collisions = uuidCollisions.find(uuid);
+	const auto iter = uuidMap.find(uuid);
+
+	if (iter != uuidMap.end() && iter->second == &entity) {
+		if (collisions == uuidCollisions.end()) {
+			uuidMap.erase(iter);
+		} else {
+			// The next oldest entity with this UUID takes over
+			auto& others = collisions->second;
+			iter->second = others.front();
+			others.erase(others.begin());
+			if (others.empty()) {
+				uuidCollisions.erase(collisions);
 			}
 		}
+	} else if (collisions != uuidCollisions.end()) {
+		auto& others = collisions->second;
+		others.erase(std::remove(others.begin(), others.end(), &entity), others.end());
+		if (others.empty()) {
+			uuidCollisions.erase(collisions);
+		}
 	}
-	
-	return std::optional<EntityRef>();
 }
 
 size_t World::numEntities() const
@@ -377,6 +418,24 @@ bool World::isEditor() const
 	return editor;
 }
 
+void World::setParallelSystems(bool enabled)
+{
+	parallelSystems = enabled;
+}
+
+bool World::isParallelSystems() const
+{
+	return parallelSystems;
+}
+
+void World::setChunkedComponentStorage(bool enabled)
+{
+	if (enabled != componentDeleterTable->isChunkedStorage() && !componentDeleterTable->isEmpty()) {
+		throw Exception("Component storage must be set before any components are added.", HalleyExceptions::Entity);
+	}
+	componentDeleterTable->setChunkedStorage(enabled);
+}
+
 void World::deleteEntity(Entity* entity)
 {
 	Expects (entity);
@@ -428,6 +487,67 @@ void World::render(RenderContext& rc) const
 	}
 }
 
+Vector<EntityRef> World::createEntities(size_t count, uint8_t worldPartition)
+{
+	reserveEntities(count);
+
+	Vector<EntityRef> result;
+	result.reserve(count);
+	for (size_t i = 0; i < count; ++i) {
+		result.emplace_back(*makeEntity(UUID(), worldPartition), *this);
+	}
+	return result;
+}
+
+void World::reserveEntities(size_t count)
+{
+	// Grow geometrically, so reserving a few at a time doesn't reallocate on every call
+	const auto reserveVector = [] (Vector<Entity*>& v, size_t size)
+	{
+		if (v.capacity() < size) {
+			v.reserve(std::max(size, v.capacity() * 2));
+		}
+	};
+	reserveVector(entitiesPendingCreation, entitiesPendingCreation.size() + count);
+	reserveVector(entities, entities.size() + entitiesPendingCreation.size() + count);
+
+	const size_t uuidCount = uuidMap.size() + count;
+	if (uuidMap.bucket_count() < uuidCount) {
+		uuidMap.reserve(std::max(uuidCount, uuidMap.size() * 2));
+	}
+
+	entityMap.reserve(count);
+}
+
+Entity* World::makeEntity(UUID uuid, uint8_t worldPartition)
+{
+	if (!uuid.isValid()) {
+		uuid = UUID::generate();
+	}
+	
+	Entity* entity = new(PoolAllocator<Entity>::alloc()) Entity();
+	if (entity == nullptr) {
+		throw Exception("Error creating entity - out of memory?", HalleyExceptions::Entity);
+	}
+	entity->instanceUUID = uuid;
+	entity->worldPartition = worldPartition;
+
+	entitiesPendingCreation.push_back(entity);
+	allocateEntity(entity);
+
+	auto& uuidEntry = uuidMap[uuid];
+	if (uuidEntry && uuidEntry->isAlive()) {
+		// Two live entities can't share a UUID, so the first one keeps it until it's removed
+		Logger::logError("Entity UUID collision: " + uuid.toString() + " is already in use, lookups will return the older entity.");
+		uuidCollisions[uuid].push_back(entity);
+	} else {
+		// Replacing a dead entity is fine (e.g. a prefab being reloaded)
+		uuidEntry = entity;
+	}
+
+	return entity;
+}
+
 void World::allocateEntity(Entity* entity) {
 	auto res = entityMap.alloc();
 	*res.first = entity;
@@ -460,15 +580,7 @@ void World::updateEntities()
 
 	HALLEY_DEBUG_TRACE();
 	size_t nEntities = entities.size();
-
-	std::vector<size_t> entitiesRemoved;
-
-	struct FamilyTodo {
-		std::vector<std::pair<FamilyMaskType, Entity*>> toAdd;
-		std::vector<std::pair<FamilyMaskType, Entity*>> toRemove;
-		std::vector<std::pair<FamilyMaskType, Entity*>> toReload;
-	};
-	std::map<FamilyMaskType, FamilyTodo> pending;
+	entitiesRemoved.clear();
 
 	// Update all entities
 	// This loop should be as fast as reasonably possible
@@ -483,7 +595,7 @@ void World::updateEntities()
 			// First of all, let's check if it's dead
 			if (!entity.isAlive()) {
 				// Remove from systems
-				pending[entity.getMask()].toRemove.emplace_back(FamilyMaskType(), &entity);
+				getFamilyTodo(entity.getMask()).toRemove.emplace_back(FamilyMaskType(), &entity);
 				entitiesRemoved.push_back(i);
 			} else {
 				// It's alive, so check old and new system inclusions
@@ -493,8 +605,8 @@ void World::updateEntities()
 
 				// Did it change?
 				if (oldMask != newMask) {
-					pending[oldMask].toRemove.emplace_back(newMask, &entity);
-					pending[newMask].toAdd.emplace_back(oldMask, &entity);
+					getFamilyTodo(oldMask).toRemove.emplace_back(newMask, &entity);
+					getFamilyTodo(newMask).toAdd.emplace_back(oldMask, &entity);
 				}
 			}
 		}
@@ -504,7 +616,7 @@ void World::updateEntities()
 		for (size_t i = 0; i < nEntities; i++) {
 			auto& entity = *entities[i];
 			if (entity.reloaded && entity.isAlive()) {
-				pending[entity.getMask()].toReload.emplace_back(entity.getMask(), &entity);
+				getFamilyTodo(entity.getMask()).toReload.emplace_back(entity.getMask(), &entity);
 				entity.reloaded = false;
 			}
 		}
@@ -514,23 +626,23 @@ void World::updateEntities()
 
 	HALLEY_DEBUG_TRACE();
 	// Go through every family adding/removing entities as needed
-	for (auto& todo: pending) {
-		for (auto* fam: getFamiliesFor(todo.first)) {
+	for (auto& [mask, todo]: activeFamilyTodos) {
+		for (auto* fam: getFamiliesFor(mask)) {
 			const auto& famMask = fam->inclusionMask;
 			const auto& optFamMask = fam->optionalMask;
 			auto& ms = *maskStorage;
 			
-			for (auto& e: todo.second.toRemove) {
+			for (auto& e: todo->toRemove) {
 				// Only remove if the entity is not about to be re-added
 				const auto& newMask = e.first;
 				if (!newMask.contains(famMask, ms)) {
 					fam->removeEntity(*e.second);
 				}
 			}
-			for (auto& e: todo.second.toAdd) {
+			for (auto& e: todo->toAdd) {
 				// Only add if the entity was not already in this
 				const auto& oldMask = e.first;
-				const auto& newMask = todo.first;
+				const auto& newMask = mask;
 				if (!oldMask.contains(famMask, ms)) {
 					fam->addEntity(*e.second);
 				} else if (oldMask.contains(optFamMask, ms) != newMask.contains(optFamMask, ms)) {
@@ -539,11 +651,18 @@ void World::updateEntities()
 				}
 			}
 
-			for (auto& e : todo.second.toReload) {
+			for (auto& e : todo->toReload) {
 				fam->reloadEntity(*e.second);
 			}
 		}
+
+		// Keep the storage around for the next update
+		todo->toAdd.clear();
+		todo->toRemove.clear();
+		todo->toReload.clear();
+		todo->active = false;
 	}
+	activeFamilyTodos.clear();
 
 	HALLEY_DEBUG_TRACE();
 	// Update families
@@ -561,6 +680,7 @@ void World::updateEntities()
 
 			// Remove
 			entityMap.freeId(entity.getEntityId().value);
+			removeFromUUIDMap(entity);
 			deleteEntity(&entity);
 
 			// Put it at the back of the array, so it's removed when the array gets resized
@@ -586,6 +706,11 @@ void World::initSystems()
 
 void World::updateSystems(TimeLine timeline, Time elapsed)
 {
+	if (parallelSystems) {
+		schedulers[static_cast<int>(timeline)].update(getSystems(timeline), *maskStorage, elapsed, [this] () { spawnPending(); });
+		return;
+	}
+
 	for (auto& system : getSystems(timeline)) {
 		system->doUpdate(elapsed);
 		spawnPending();
@@ -620,6 +745,16 @@ void World::onAddFamily(Family& family) noexcept
 	familyCache.clear();
 }
 
+World::FamilyTodo& World::getFamilyTodo(const FamilyMaskType& mask)
+{
+	auto& todo = familyTodos[mask];
+	if (!todo.active) {
+		todo.active = true;
+		activeFamilyTodos.emplace_back(mask, &todo);
+	}
+	return todo;
+}
+
 const std::vector<Family*>& World::getFamiliesFor(const FamilyMaskType& mask)
 {
 	auto i = familyCache.find(mask);
@@ -1,10 +1,13 @@
 #pragma once
 #include <array>
+#include <atomic>
+#include <algorithm>
 #include <functional>
 #include <halley/text/halleystring.h>
 #include "executor.h"
 #include "future.h"
 #include "task.h"
+#include "task_group.h"
 
 #define HAS_THREADS 1
 
@@ -22,7 +25,12 @@ namespace Halley
 		auto execute(ExecutionQueue& e, F f) -> Future<typename std::result_of<F()>::type>
 		{
 			using R = typename std::result_of<F()>::type;
-			return TaskQueueHelper<R>::enqueueOn(e, MovableFunction<R>(std::move(f)));
+			Promise<R> promise;
+			auto future = promise.getFuture();
+			e.addToQueue([f = std::move(f), promise = std::move(promise)] () mutable {
+				TaskHelper<R>::setPromise(promise, f);
+			});
+			return future;
 		}
 
 		template <typename F>
@@ -41,28 +49,60 @@ namespace Halley
 			return future.getFuture();
 		}
 
-		template <typename T, typename F>
-		void foreach(ExecutionQueue& e, T begin, T end, F f)
+		// Calls f(i) for every i in [begin, end). Threads grab chunks of the range as they become free, with chunks getting
+		// smaller as the range runs out, so uneven workloads still balance out. The calling thread takes part and helps out
+		// while waiting, so it's safe to nest.
+		template <typename F>
+		void parallelFor(ExecutionQueue& e, size_t begin, size_t end, F f, size_t minGrain = 1)
 		{
+			if (end <= begin) {
+				return;
+			}
 			const size_t n = end - begin;
-			constexpr size_t maxThreads = 8;
-			size_t nThreads = std::max(size_t(1), std::min(maxThreads, e.threadCount()));
-			std::array<Future<void>, maxThreads> futures;
-
-			size_t prevEnd = 0;
-			for (size_t j = 0; j < nThreads; ++j) {
-				size_t curStart = prevEnd;
-				size_t curEnd = n * (j + 1) / nThreads;
-				prevEnd = curEnd;
+			minGrain = std::max(minGrain, size_t(1));
+			const size_t nWorkers = std::min(e.threadCount() + 1, (n + minGrain - 1) / minGrain);
+			if (nWorkers <= 1) {
+				for (size_t i = begin; i < end; ++i) {
+					f(i);
+				}
+				return;
+			}
 
-				futures[j] = execute([begin, f, curStart, curEnd]() {
-					for (auto i = begin + curStart; i < begin + curEnd; ++i) {
-						f(*i);
+			std::atomic<size_t> next(begin);
+			auto work = [&] ()
+			{
+				while (true) {
+					const size_t cur = next.load(std::memory_order_relaxed);
+					if (cur >= end) {
+						return;
 					}
-				});
+					const size_t chunk = std::max(minGrain, (end - cur) / (2 * nWorkers));
+					const size_t start = next.fetch_add(chunk);
+					const size_t stop = std::min(end, start + chunk);
+					for (size_t i = start; i < stop; ++i) {
+						f(i);
+					}
+				}
+			};
+
+			TaskGroup group(e);
+			for (size_t i = 1; i < nWorkers; ++i) {
+				group.run(work);
 			}
+			work();
+			group.wait();
+		}
+
+		template <typename F>
+		void parallelFor(size_t begin, size_t end, F f, size_t minGrain = 1)
+		{
+			parallelFor(ExecutionQueue::getDefault(), begin, end, std::move(f), minGrain);
+		}
 
-			whenAll(futures.data(), futures.data() + nThreads).wait();
+		template <typename T, typename F>
+		void foreach(ExecutionQueue& e, T begin, T end, F f)
+		{
+			parallelFor(e, 0, size_t(end - begin), [&] (size_t i) { f(*(begin + i)); });
 		}
 
 		template <typename T, typename F>
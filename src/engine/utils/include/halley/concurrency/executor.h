@@ -6,36 +6,146 @@
 #include <functional>
 #include <atomic>
 #include <vector>
+#include <array>
+#include <cstddef>
+#include <type_traits>
+#include <new>
 #include "halley/text/halleystring.h"
 
 namespace Halley
 {
-	using TaskBase = std::function<void()>;
+	// Move-only type-erased task. Functors up to inlineSize bytes are stored in place, so queueing them doesn't allocate.
+	class TaskBase
+	{
+	public:
+		static constexpr size_t inlineSize = 64;
+
+		TaskBase() = default;
+
+		template <typename F, typename std::enable_if<!std::is_same<typename std::decay<F>::type, TaskBase>::value, int>::type = 0>
+		TaskBase(F&& f)
+		{
+			using T = typename std::decay<F>::type;
+			if constexpr (sizeof(T) <= inlineSize && alignof(T) <= alignof(std::max_align_t) && std::is_nothrow_move_constructible<T>::value) {
+				new (&storage) T(std::forward<F>(f));
+				ops = &inlineOps<T>;
+			} else {
+				new (&storage) T*(new T(std::forward<F>(f)));
+				ops = &heapOps<T>;
+			}
+		}
+
+		TaskBase(TaskBase&& other) noexcept;
+		TaskBase& operator=(TaskBase&& other) noexcept;
+		TaskBase(const TaskBase& other) = delete;
+		TaskBase& operator=(const TaskBase& other) = delete;
+		~TaskBase();
+
+		void operator()();
+		explicit operator bool() const { return ops != nullptr; }
+
+	private:
+		struct Ops {
+			void (*invoke)(void* storage);
+			void (*move)(void* dst, void* src);
+			void (*destroy)(void* storage);
+		};
+
+		template <typename T>
+		static constexpr Ops inlineOps = {
+			[] (void* s) { (*static_cast<T*>(s))(); },
+			[] (void* dst, void* src) { new (dst) T(std::move(*static_cast<T*>(src))); static_cast<T*>(src)->~T(); },
+			[] (void* s) { static_cast<T*>(s)->~T(); }
+		};
+
+		template <typename T>
+		static constexpr Ops heapOps = {
+			[] (void* s) { (**static_cast<T**>(s))(); },
+			[] (void* dst, void* src) { *static_cast<T**>(dst) = *static_cast<T**>(src); },
+			[] (void* s) { delete *static_cast<T**>(s); }
+		};
+
+		alignas(std::max_align_t) std::byte storage[inlineSize];
+		const Ops* ops = nullptr;
+	};
 
 	class ExecutionQueue
 	{
 	public:
 		ExecutionQueue();
-		void addToQueue(TaskBase task);
+		virtual ~ExecutionQueue() = default;
+
+		virtual void addToQueue(TaskBase task);
+
+		virtual TaskBase getNext();
+		virtual std::vector<TaskBase> getAll();
 
-		TaskBase getNext();
-		std::vector<TaskBase> getAll();
+		// Runs one queued task on the calling thread, if there's any. Used to help out while waiting on other tasks.
+		virtual bool tryRunNext();
 
 		size_t threadCount() const;
 		void onAttached();
 		void onDetached();
-		void abort();
+		virtual void abort();
 
 		static ExecutionQueue& getDefault();
 
+	protected:
+		std::atomic<int> attachedCount;
+		std::atomic<bool> aborted;
+
 	private:
 		std::deque<TaskBase> queue;
 		std::mutex mutex;
 		std::condition_variable condition;
 
-		std::atomic<int> attachedCount;
 		std::atomic<bool> hasTasks;
-		std::atomic<bool> aborted;
+	};
+
+	// Each worker thread owns a deque: it pushes and pops its own tasks at the back, while idle workers steal from the front.
+	// Tasks queued from threads which aren't workers go to a shared injection queue.
+	class WorkStealingQueue final : public ExecutionQueue
+	{
+	public:
+		WorkStealingQueue();
+		~WorkStealingQueue();
+
+		void addToQueue(TaskBase task) override;
+
+		TaskBase getNext() override;
+		std::vector<TaskBase> getAll() override;
+		bool tryRunNext() override;
+
+		void abort() override;
+
+	private:
+		friend struct WorkStealingLocalWorker;
+
+		struct Worker {
+			std::mutex mutex;
+			std::deque<TaskBase> tasks;
+			std::atomic<size_t> size;
+			std::atomic<bool> active;
+		};
+
+		constexpr static size_t maxWorkers = 256;
+
+		std::array<std::unique_ptr<Worker>, maxWorkers> workers;
+		std::atomic<size_t> nWorkers;
+		std::mutex workersMutex;
+
+		std::deque<TaskBase> injected;
+		std::mutex injectedMutex;
+
+		std::atomic<size_t> pending;
+		std::atomic<int> sleeping;
+		std::mutex sleepMutex;
+		std::condition_variable condition;
+
+		Worker* getLocalWorker(bool create);
+		void releaseWorker(size_t idx);
+		bool tryPop(TaskBase& task, Worker* local);
+		void wakeWorker();
 	};
 
 	class Executors
@@ -53,7 +163,7 @@ namespace Halley
 	private:
 		static Executors* instance;
 
-		ExecutionQueue cpu;
+		WorkStealingQueue cpu;
 		ExecutionQueue cpuAux;
 		ExecutionQueue videoAux;
 		ExecutionQueue mainThread;
@@ -0,0 +1,52 @@
+#pragma once
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include "executor.h"
+
+namespace Halley
+{
+	// A set of tasks which can be waited on together. Waiting runs queued tasks on the waiting thread,
+	// so it's safe to wait on a group from inside another task (e.g. nested parallel loops).
+	class TaskGroup
+	{
+	public:
+		explicit TaskGroup(ExecutionQueue& queue);
+		TaskGroup();
+		~TaskGroup();
+
+		TaskGroup(const TaskGroup& other) = delete;
+		TaskGroup& operator=(const TaskGroup& other) = delete;
+
+		template <typename F>
+		void run(F f)
+		{
+			++pending;
+			queue.addToQueue([this, f = std::move(f)] () mutable
+			{
+				try {
+					f();
+				} catch (...) {
+					onException(std::current_exception());
+				}
+				onTaskDone();
+			});
+		}
+
+		// Blocks until every task in the group is done, then rethrows the first exception thrown by any of them
+		void wait();
+
+	private:
+		ExecutionQueue& queue;
+		std::atomic<size_t> pending;
+		std::atomic<size_t> finishing;
+		std::mutex mutex;
+		std::condition_variable condition;
+		std::exception_ptr error;
+
+		void onTaskDone();
+		void onException(std::exception_ptr e);
+		void waitForTasks();
+	};
+}
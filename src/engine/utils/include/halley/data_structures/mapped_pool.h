@@ -75,6 +75,7 @@ namespace Halley {
 
 			// External index composes the revision with the index, so it's unique, but easily mappable
 			const int64_t externalIdx = static_cast<int64_t>(entryIdx) | (static_cast<int64_t>(rev & 0x7FFFFFFF) << 32); // TODO: compute properly
+			++nAllocated;
 			return std::pair<T*, int64_t>(result, externalIdx);
 		}
 
@@ -85,6 +86,16 @@ namespace Halley {
 
 			// Increase revision so the next one to allocate this gets a unique number
 			++entry->revision;
+			--nAllocated;
+		}
+
+		// Makes sure the next n allocations won't need to create any blocks
+		void reserve(size_t n) {
+			const size_t nBlocks = (nAllocated + n + blockLen - 1) / blockLen;
+			blocks.reserve(nBlocks);
+			while (blocks.size() < nBlocks) {
+				blocks.push_back(Block(blocks.size()));
+			}
 		}
 
 		void freeId(int64_t externalIdx) {
@@ -114,5 +125,6 @@ namespace Halley {
 	private:
 		Vector<Block> blocks;
 		uint32_t next = 0;
+		size_t nAllocated = 0;
 	};
 }
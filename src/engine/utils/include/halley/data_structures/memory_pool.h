@@ -1,6 +1,8 @@
 #pragma once
 
+#include <memory>
 #include "flat_map.h"
+#include "vector.h"
 
 namespace Halley {
 	class SizePool
@@ -18,6 +20,46 @@ namespace Halley {
 		size_t size;
 	};
 
+	// Hands out fixed-size elements from contiguous chunks, always using the lowest free address.
+	// Live elements therefore stay packed together, and walking them in allocation order is mostly linear.
+	// Chunks come from plain new[], so elements are only aligned up to maxAlignment.
+	class ChunkedPool
+	{
+	public:
+		constexpr static size_t maxAlignment = __STDCPP_DEFAULT_NEW_ALIGNMENT__;
+
+		explicit ChunkedPool(size_t size, size_t elementsPerChunk = 256);
+		~ChunkedPool();
+
+		ChunkedPool(const ChunkedPool& other) = delete;
+		ChunkedPool& operator=(const ChunkedPool& other) = delete;
+
+		size_t getSize() const { return size; }
+		void* alloc();
+		void free(void* p);
+		void reserve(size_t n); // Makes sure n more elements fit without adding chunks
+
+		size_t getNumChunks() const { return chunks.size(); }
+		size_t getNumAllocated() const { return nAllocated; }
+
+	private:
+		struct Chunk
+		{
+			std::unique_ptr<char[]> data;
+			Vector<uint64_t> used;
+			size_t nFree = 0;
+		};
+
+		size_t size;
+		size_t elementsPerChunk;
+		size_t firstFreeChunk = 0;
+		size_t nAllocated = 0;
+		Vector<Chunk> chunks; // Sorted by address
+
+		size_t addChunk();
+		size_t findChunk(const char* p) const;
+	};
+
 	// yo dawg
 	class PoolPool
 	{
@@ -1,3 +1,5 @@
+#pragma once
+
 #include <algorithm>
 #include <vector>
 
@@ -40,6 +42,11 @@ namespace Halley {
             return heap.empty();
         }
 
+        void clear()
+        {
+            heap.clear();
+        }
+
         void reserve(size_t size)
         {
 	        heap.reserve(size);
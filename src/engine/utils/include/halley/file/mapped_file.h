@@ -0,0 +1,34 @@
+#pragma once
+
+#include <gsl/span>
+
+namespace Halley
+{
+	class Path;
+
+	// Read-only memory mapping of a whole file
+	// open() returns false if the platform can't map the file, in which case callers should fall back to reading it
+	class MappedFile
+	{
+	public:
+		MappedFile();
+		explicit MappedFile(const Path& path);
+		MappedFile(const MappedFile& other) = delete;
+		MappedFile(MappedFile&& other) noexcept;
+		~MappedFile();
+
+		MappedFile& operator=(const MappedFile& other) = delete;
+		MappedFile& operator=(MappedFile&& other) noexcept;
+
+		bool open(const Path& path);
+		void close();
+
+		bool isOpen() const;
+		size_t getSize() const;
+		gsl::span<const gsl::byte> getSpan() const;
+
+	private:
+		const gsl::byte* data = nullptr;
+		size_t size = 0;
+	};
+}
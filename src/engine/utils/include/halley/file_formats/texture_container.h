@@ -0,0 +1,54 @@
+#pragma once
+
+#include <gsl/gsl>
+#include "halley/maths/vector2.h"
+#include "halley/utils/utils.h"
+#include "halley/data_structures/vector.h"
+
+namespace Halley {
+	class Image;
+	class ExecutionQueue;
+
+	// GPU-ready texture data, produced by the texture importer
+	// Pixels are stored in upload order (RGBA8 or R8, no row padding) with any mip levels after the base level,
+	// so the decoded bytes can be handed straight to the video API. Each level is split into horizontal strips
+	// which are compressed independently, so they can be decoded in parallel.
+	class TextureContainer {
+	public:
+		// Doesn't copy bytes, so they must outlive the container
+		explicit TextureContainer(gsl::span<const gsl::byte> bytes);
+
+		static bool isTextureContainer(gsl::span<const gsl::byte> bytes);
+		static Bytes encode(const Image& image, bool mipMaps, int stripHeight = 32);
+
+		Vector2i getSize() const;
+		int getBytesPerPixel() const;
+		int getNumMipLevels() const;
+		size_t getDecodedSize() const;
+
+		// If queue is set, strips are decoded in parallel on it
+		Bytes decode(ExecutionQueue* queue = nullptr) const;
+		void decode(gsl::span<gsl::byte> dst, ExecutionQueue* queue = nullptr) const;
+
+		static Vector2i getMipLevelSize(Vector2i size, int level);
+		static int getNumMipLevels(Vector2i size);
+
+	private:
+		struct Strip {
+			size_t srcPos;
+			size_t srcSize;
+			size_t dstPos;
+			size_t dstSize;
+			bool compressed;
+		};
+
+		gsl::span<const gsl::byte> data;
+		Vector2i size;
+		int bpp = 0;
+		int nMipLevels = 0;
+		size_t decodedSize = 0;
+		Vector<Strip> strips;
+
+		void decodeStrip(const Strip& strip, gsl::span<gsl::byte> dst) const;
+	};
+}
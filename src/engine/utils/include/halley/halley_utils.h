@@ -5,6 +5,7 @@ namespace Halley {} // Get GitHub to realise this is C++ :3
 #include "concurrency/concurrent.h"
 #include "concurrency/task.h"
 #include "concurrency/task_anchor.h"
+#include "concurrency/task_group.h"
 #include "concurrency/task_set.h"
 
 #include "bytes/byte_serializer.h"
@@ -27,6 +28,7 @@ namespace Halley {} // Get GitHub to realise this is C++ :3
 #include "data_structures/vector.h"
 
 #include "file/directory_monitor.h"
+#include "file/mapped_file.h"
 #include "file/path.h"
 
 #include "file_formats/binary_file.h"
@@ -36,6 +38,7 @@ namespace Halley {} // Get GitHub to realise this is C++ :3
 #include "file_formats/json_file.h"
 #include "file_formats/text_file.h"
 #include "file_formats/text_reader.h"
+#include "file_formats/texture_container.h"
 #include "file_formats/xml_file.h"
 #include "file_formats/yaml_convert.h"
 
@@ -67,6 +70,7 @@ namespace Halley {} // Get GitHub to realise this is C++ :3
 #include "navigation/navigation_query.h"
 #include "navigation/navigation_path.h"
 #include "navigation/navigation_path_follower.h"
+#include "navigation/navigation_search_context.h"
 
 #include "plugin/plugin.h"
 
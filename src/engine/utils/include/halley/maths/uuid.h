@@ -4,6 +4,7 @@
 #include "halley/utils/utils.h"
 #include <gsl/gsl>
 #include <array>
+#include <cstring>
 
 namespace Halley {
 	class Deserializer;
@@ -38,6 +39,23 @@ namespace Halley {
     };
 }
 
+namespace std {
+	template<>
+	struct hash<Halley::UUID>
+	{
+		size_t operator()(const Halley::UUID& uuid) const noexcept
+		{
+			// UUIDs are already random, so just fold the bytes
+			const auto bytes = uuid.getBytes();
+			uint64_t a;
+			uint64_t b;
+			memcpy(&a, bytes.data(), sizeof(a));
+			memcpy(&b, bytes.data() + sizeof(a), sizeof(b));
+			return static_cast<size_t>(a ^ b);
+		}
+	};
+}
+
 namespace natvis {
     struct x4lo {
     	uint8_t v: 4;
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <vector>
+#include "halley/data_structures/priority_queue.h"
+
+namespace Halley {
+	// Scratch space for the A* searches done by Navmesh and NavmeshSet.
+	// States are stamped with the search that last wrote them, so starting a new search doesn't need to clear anything,
+	// and the buffers only ever grow. Use one per thread (see getThreadLocal), as a search takes over the whole context.
+	class NavigationSearchContext {
+	public:
+		using NodeId = uint16_t;
+
+		struct State {
+			float gScore;
+			float fScore;
+			uint32_t generation = 0;
+			NodeId cameFrom;
+			uint16_t cameFromConnection;
+			bool inOpenSet;
+			bool inClosedSet;
+		};
+
+		class NodeComparator {
+		public:
+			NodeComparator(const std::vector<State>& states) : states(states) {}
+
+			bool operator()(NodeId a, NodeId b) const
+			{
+				return states[a].fScore > states[b].fScore;
+			}
+
+		private:
+			const std::vector<State>& states;
+		};
+
+		using OpenSet = PriorityQueue<NodeId, NodeComparator>;
+
+		NavigationSearchContext();
+		NavigationSearchContext(const NavigationSearchContext& other) = delete;
+		NavigationSearchContext(NavigationSearchContext&& other) = delete;
+		NavigationSearchContext& operator=(const NavigationSearchContext& other) = delete;
+		NavigationSearchContext& operator=(NavigationSearchContext&& other) = delete;
+
+		static NavigationSearchContext& getThreadLocal();
+
+		// Invalidates all states and empties the open set
+		void beginSearch(size_t nNodes);
+
+		State& getState(NodeId id)
+		{
+			auto& state = states[id];
+			if (state.generation != generation) {
+				state.gScore = std::numeric_limits<float>::infinity();
+				state.fScore = std::numeric_limits<float>::infinity();
+				state.generation = generation;
+				state.cameFrom = std::numeric_limits<NodeId>::max();
+				state.cameFromConnection = std::numeric_limits<uint16_t>::max();
+				state.inOpenSet = false;
+				state.inClosedSet = false;
+			}
+			return state;
+		}
+
+		// Doesn't reset the state, returns nullptr if it hasn't been touched by the current search
+		const State* tryGetState(NodeId id) const
+		{
+			const auto& state = states[id];
+			return state.generation == generation ? &state : nullptr;
+		}
+
+		OpenSet& getOpenSet() { return openSet; }
+
+	private:
+		std::vector<State> states;
+		OpenSet openSet;
+		uint32_t generation = 0;
+	};
+}
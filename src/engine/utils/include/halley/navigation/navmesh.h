@@ -7,6 +7,7 @@
 
 namespace Halley {
 	class Random;
+	class NavigationSearchContext;
 
 	struct NavmeshBounds {
 		Vector2f origin;
@@ -99,32 +100,12 @@ namespace Halley {
 		void markPortalsDisconnected();
 
 		float getArea() const;
+		Rect4f getBoundingBox() const { return boundingBox; }
 		Vector2f getRandomPoint(Random& rng) const;
 
 		Base2D getNormalisedCoordinatesBase() const { return normalisedCoordinatesBase; }
 
 	private:
-		struct State {
-			float gScore = std::numeric_limits<float>::infinity();
-			float fScore = std::numeric_limits<float>::infinity();
-			NodeAndConn cameFrom;
-			bool inOpenSet = false;
-			bool inClosedSet = false;
-		};
-
-		class NodeComparator {
-		public:
-			NodeComparator(const std::vector<State>& state) : state(state) {}
-			
-			bool operator()(Navmesh::NodeId a, Navmesh::NodeId b) const
-			{
-				return state[a].fScore > state[b].fScore;
-			}
-
-		private:
-			const std::vector<State>& state;
-		};
-
 		std::vector<Node> nodes;
 		std::vector<Polygon> polygons;
 		std::vector<Portal> portals;
@@ -133,6 +114,7 @@ namespace Halley {
 
 		Vector2i gridSize = Vector2i(20, 20);
 		std::vector<std::vector<NodeId>> polyGrid; // Quick lookup of polygons
+		std::vector<std::vector<uint32_t>> openEdgeGrid; // Indices of the open edges near each cell, for getNodeAt
 
 		Vector2f origin;
 		Base2D normalisedCoordinatesBase;
@@ -142,9 +124,10 @@ namespace Halley {
 		Vector2i worldGridPos;
 
 		float totalArea = 0;
+		Rect4f boundingBox;
 
 		std::optional<std::vector<NodeAndConn>> pathfind(int fromId, int toId) const;
-		std::vector<NodeAndConn> makeResult(const std::vector<State>& state, int startId, int endId) const;
+		std::vector<NodeAndConn> makeResult(NavigationSearchContext& context, int startId, int endId) const;
 		std::optional<NavigationPath> makePath(const NavigationQuery& query, const std::vector<NodeAndConn>& nodePath) const;
 		void postProcessPath(std::vector<Vector2f>& points, NavigationQuery::PostProcessingType type) const;
 
@@ -154,13 +137,17 @@ namespace Halley {
 		void addPolygonsToGrid();
 		void addPolygonToGrid(const Polygon& poly, NodeId idx);
 		gsl::span<const NodeId> getPolygonsAt(Vector2f pos, bool allowOutside) const;
+		gsl::span<const uint32_t> getOpenEdgesAt(Vector2f pos) const;
+		Vector2i getGridCell(Vector2f pos) const;
 
 		void addToPortals(NodeAndConn nodeAndConn, int id);
 		Portal& getPortals(int id);
 		void postProcessPortals();
 
 		void computeArea();
+		void computeBoundingBox();
 
 		void generateOpenEdges();
+		void addOpenEdgesToGrid();
 	};
 }
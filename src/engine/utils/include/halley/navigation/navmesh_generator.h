@@ -6,8 +6,24 @@
 namespace Halley {
 	class NavmeshGenerator {
 	public:
+		struct Params {
+			NavmeshBounds bounds;
+			gsl::span<const Polygon> obstacles;
+			gsl::span<const Polygon> regions;
+			int subWorld;
+			float agentSize;
+
+			Params(NavmeshBounds bounds, gsl::span<const Polygon> obstacles, gsl::span<const Polygon> regions, int subWorld, float agentSize)
+				: bounds(std::move(bounds)), obstacles(obstacles), regions(regions), subWorld(subWorld), agentSize(agentSize)
+			{}
+		};
+
 		static NavmeshSet generate(const NavmeshBounds& bounds, gsl::span<const Polygon> obstacles, gsl::span<const Polygon> regions, int subWorld, float agentSize);
 
+		// Chunks don't depend on each other, so they're generated in parallel. Results are in the same order as the input,
+		// ready to be passed to NavmeshSet::addChunk.
+		static std::vector<NavmeshSet> generateChunks(gsl::span<const Params> chunks);
+
 	private:
 		class NavmeshNode {
 		public:
@@ -28,7 +44,7 @@ namespace Halley {
 		
 		constexpr static size_t maxPolygonSides = 8;
 
-		static std::vector<Polygon> generateByPolygonSubtraction(gsl::span<const Polygon> inputPolygons, gsl::span<const Polygon> obstacles, Circle bounds);
+		static std::vector<Polygon> generateByPolygonSubtraction(gsl::span<const Polygon> inputPolygons, gsl::span<const Polygon* const> obstacles, Circle bounds);
 		static std::vector<Polygon> preProcessObstacles(gsl::span<const Polygon> obstacles, float agentSize);
 		static Polygon makeAgentMask(float agentSize);
 
@@ -3,6 +3,9 @@
 #include "navmesh.h"
 #include "navigation_query.h"
 #include "navigation_path.h"
+#include "halley/data_structures/hash_map.h"
+#include <memory>
+#include <mutex>
 
 namespace Halley {
 	class NavmeshSet {
@@ -24,6 +27,9 @@ namespace Halley {
 		std::optional<NavigationPath> pathfind(const NavigationQuery& query) const;
 		std::optional<NavigationPath> pathfindInRegion(const NavigationQuery& query, uint16_t regionId) const;
 
+		// Runs all queries over the CPU executors. Results are in the same order as the queries.
+		std::vector<std::optional<NavigationPath>> pathfindBatch(gsl::span<const NavigationQuery> queries) const;
+
 		gsl::span<const Navmesh> getNavmeshes() const { return navmeshes; }
 		const Navmesh* getNavMeshAt(Vector2f pos, int subWorld) const;
 		size_t getNavMeshIdxAt(Vector2f pos, int subWorld) const;
@@ -45,6 +51,7 @@ namespace Halley {
 		struct PortalNode {
 			Vector2f pos;
 			std::vector<PortalConnection> connections;
+			std::vector<PortalConnection> incomingConnections; // portalId is the portal this connection comes from
 			uint16_t fromRegion;
 			uint16_t fromPortal;
 			uint16_t toRegion;
@@ -63,33 +70,46 @@ namespace Halley {
 		using NodeId = uint16_t;
 		using NodeAndConn = NavigationPath::RegionNode;
 
-		struct State {
-			float gScore = std::numeric_limits<float>::infinity();
-			float fScore = std::numeric_limits<float>::infinity();
-			NodeId cameFrom;
-			bool inOpenSet = false;
-			bool inClosedSet = false;
+		// Shortest distance from each portal node into a given region, and the next portal on that route
+		struct RegionDistances {
+			std::vector<float> distance;
+			std::vector<NodeId> next;
 		};
 
-		class NodeComparator {
+		// Lazily filled as regions get pathed to. Copies start out empty.
+		class RegionDistanceCache {
 		public:
-			NodeComparator(const std::vector<State>& state) : state(state) {}
-			
-			bool operator()(NodeId a, NodeId b) const
-			{
-				return state[a].fScore > state[b].fScore;
-			}
+			RegionDistanceCache() = default;
+			RegionDistanceCache(const RegionDistanceCache& other);
+			RegionDistanceCache& operator=(const RegionDistanceCache& other);
+
+			std::shared_ptr<const RegionDistances> get(NodeId region) const;
+			void set(NodeId region, std::shared_ptr<const RegionDistances> distances);
+			void clear();
 
 		private:
-			const std::vector<State>& state;
+			mutable std::mutex mutex;
+			HashMap<NodeId, std::shared_ptr<const RegionDistances>> entries;
 		};
 
 		std::vector<Navmesh> navmeshes;
 		std::vector<PortalNode> portalNodes;
 		std::vector<RegionNode> regionNodes;
+		mutable RegionDistanceCache regionDistanceCache;
+
+		// Uniform grid over the bounds of each navmesh, per subWorld, so point lookups only test the navmeshes around them
+		using RegionGrid = HashMap<Vector2i, std::vector<uint16_t>>;
+		HashMap<int, RegionGrid> regionGrids;
+		float regionGridCellSize = 0;
 
 		void tryLinkNavMeshes(size_t idxA, size_t idxB);
 
-		std::vector<NavigationPath::RegionNode> findRegionPath(Vector2f startPos, Vector2f endPos, uint16_t fromRegionId, uint16_t toRegionId) const;
+		void rebuildRegionGrids();
+		void addToRegionGrid(size_t idx);
+		void insertIntoRegionGrid(size_t idx);
+		gsl::span<const uint16_t> getRegionsNear(Vector2f pos, int subWorld) const;
+
+		std::vector<NavigationPath::RegionNode> findRegionPath(Vector2f startPos, uint16_t fromRegionId, uint16_t toRegionId) const;
+		std::shared_ptr<const RegionDistances> getRegionDistances(uint16_t toRegionId) const;
 	};
 }
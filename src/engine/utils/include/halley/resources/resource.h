@@ -131,6 +131,9 @@ namespace Halley
 		void setAssetId(String name);
 		const String& getAssetId() const;
 		virtual void onLoaded(Resources& resources);
+
+		// Approximate memory held, for budgeting. If 0, the size of the data it was loaded from is used instead
+		virtual size_t getMemoryUsage() const;
 		
 		int getAssetVersion() const;
 		void reloadResource(Resource&& resource);
@@ -8,8 +8,45 @@ using namespace Halley;
 
 Executors* Executors::instance = nullptr;
 
+TaskBase::TaskBase(TaskBase&& other) noexcept
+	: ops(other.ops)
+{
+	if (ops) {
+		ops->move(&storage, &other.storage);
+		other.ops = nullptr;
+	}
+}
+
+TaskBase& TaskBase::operator=(TaskBase&& other) noexcept
+{
+	if (this != &other) {
+		if (ops) {
+			ops->destroy(&storage);
+		}
+		ops = other.ops;
+		if (ops) {
+			ops->move(&storage, &other.storage);
+			other.ops = nullptr;
+		}
+	}
+	return *this;
+}
+
+TaskBase::~TaskBase()
+{
+	if (ops) {
+		ops->destroy(&storage);
+	}
+}
+
+void TaskBase::operator()()
+{
+	ops->invoke(&storage);
+}
+
 ExecutionQueue::ExecutionQueue()
-	: aborted(false)
+	: attachedCount(0)
+	, aborted(false)
 {
 	hasTasks.store(false);
 }
@@ -27,16 +64,31 @@ TaskBase ExecutionQueue::getNext()
 		}
 	}
 
-	TaskBase value = queue.front();
+	TaskBase value = std::move(queue.front());
 	queue.pop_front();
 	return value;
 }
 
+bool ExecutionQueue::tryRunNext()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	if (queue.empty()) {
+		return false;
+	}
+	TaskBase value = std::move(queue.front());
+	queue.pop_front();
+	hasTasks.store(!queue.empty());
+	lock.unlock();
+
+	value();
+	return true;
+}
+
 std::vector<TaskBase> ExecutionQueue::getAll()
 {
 	std::unique_lock<std::mutex> lock(mutex);
 	hasTasks.store(false);
-	std::vector<TaskBase> tasks(queue.begin(), queue.end());
+	std::vector<TaskBase> tasks(std::make_move_iterator(queue.begin()), std::make_move_iterator(queue.end()));
 	queue.clear();
 	return tasks;
 }
@@ -45,7 +97,7 @@ void ExecutionQueue::addToQueue(TaskBase task)
 {
 #if HAS_THREADS
 	std::unique_lock<std::mutex> lock(mutex);
-	queue.emplace_back(task);
+	queue.emplace_back(std::move(task));
 	hasTasks.store(true);
 
 	condition.notify_one();
@@ -54,6 +106,236 @@ void ExecutionQueue::addToQueue(TaskBase task)
 #endif
 }
 
+namespace Halley {
+	// Binds a worker thread to its deque, and hands the deque back to the queue when the thread exits
+	struct WorkStealingLocalWorker {
+		WorkStealingQueue* queue = nullptr;
+		size_t idx = 0;
+
+		~WorkStealingLocalWorker()
+		{
+			if (queue) {
+				queue->releaseWorker(idx);
+			}
+		}
+	};
+}
+
+#if HAS_THREADS
+static thread_local WorkStealingLocalWorker localWorker;
+#endif
+
+WorkStealingQueue::WorkStealingQueue()
+	: nWorkers(0)
+	, pending(0)
+	, sleeping(0)
+{
+}
+
+WorkStealingQueue::~WorkStealingQueue()
+{
+#if HAS_THREADS
+	if (localWorker.queue == this) {
+		localWorker.queue = nullptr;
+	}
+#endif
+}
+
+void WorkStealingQueue::addToQueue(TaskBase task)
+{
+#if HAS_THREADS
+	if (auto* local = getLocalWorker(false)) {
+		std::unique_lock<std::mutex> lock(local->mutex);
+		local->tasks.push_back(std::move(task));
+		++local->size;
+	} else {
+		std::unique_lock<std::mutex> lock(injectedMutex);
+		injected.push_back(std::move(task));
+	}
+	++pending;
+
+	if (sleeping.load() > 0) {
+		wakeWorker();
+	}
+#else
+	task();
+#endif
+}
+
+TaskBase WorkStealingQueue::getNext()
+{
+	auto* local = getLocalWorker(true);
+
+	while (true) {
+		TaskBase task;
+		if (tryPop(task, local)) {
+			return task;
+		}
+
+		if (aborted) {
+			return TaskBase([] () {});
+		}
+
+		// Queueing increments pending before checking for sleepers, so either we see the task here, or we get woken up
+		std::unique_lock<std::mutex> lock(sleepMutex);
+		++sleeping;
+		if (pending.load() == 0 && !aborted) {
+			condition.wait(lock);
+		}
+		--sleeping;
+	}
+}
+
+std::vector<TaskBase> WorkStealingQueue::getAll()
+{
+	std::vector<TaskBase> result;
+	TaskBase task;
+	while (tryPop(task, getLocalWorker(false))) {
+		result.push_back(std::move(task));
+	}
+	return result;
+}
+
+bool WorkStealingQueue::tryRunNext()
+{
+	TaskBase task;
+	if (tryPop(task, getLocalWorker(false))) {
+		task();
+		return true;
+	}
+	return false;
+}
+
+void WorkStealingQueue::abort()
+{
+	{
+		std::unique_lock<std::mutex> lock(sleepMutex);
+		if (aborted) {
+			return;
+		}
+		aborted = true;
+	}
+	condition.notify_all();
+}
+
+WorkStealingQueue::Worker* WorkStealingQueue::getLocalWorker(bool create)
+{
+#if HAS_THREADS
+	if (localWorker.queue == this) {
+		return workers[localWorker.idx].get();
+	}
+	if (!create || localWorker.queue) {
+		return nullptr;
+	}
+
+	// Reuse the deque of a thread which has exited, if possible
+	std::unique_lock<std::mutex> lock(workersMutex);
+	const size_t n = nWorkers.load();
+	size_t idx = n;
+	for (size_t i = 0; i < n; ++i) {
+		if (!workers[i]->active) {
+			idx = i;
+			break;
+		}
+	}
+	if (idx == maxWorkers) {
+		return nullptr;
+	}
+	if (idx == n) {
+		workers[idx] = std::make_unique<Worker>();
+		workers[idx]->size = 0;
+		nWorkers.store(n + 1);
+	}
+	workers[idx]->active = true;
+
+	localWorker.queue = this;
+	localWorker.idx = idx;
+	return workers[idx].get();
+#else
+	return nullptr;
+#endif
+}
+
+void WorkStealingQueue::releaseWorker(size_t idx)
+{
+	auto& worker = *workers[idx];
+
+	// Anything left behind is moved to the shared queue, so it's not lost until someone else picks up this deque
+	{
+		std::unique_lock<std::mutex> lock(worker.mutex);
+		if (!worker.tasks.empty()) {
+			std::unique_lock<std::mutex> lock2(injectedMutex);
+			for (auto& t: worker.tasks) {
+				injected.push_back(std::move(t));
+			}
+			worker.tasks.clear();
+			worker.size = 0;
+		}
+	}
+
+	std::unique_lock<std::mutex> lock(workersMutex);
+	worker.active = false;
+}
+
+bool WorkStealingQueue::tryPop(TaskBase& task, Worker* local)
+{
+	if (pending.load() == 0) {
+		return false;
+	}
+
+	// Own tasks first, most recent first, as they're the most likely to still be in cache
+	if (local && local->size.load() > 0) {
+		std::unique_lock<std::mutex> lock(local->mutex);
+		if (!local->tasks.empty()) {
+			task = std::move(local->tasks.back());
+			local->tasks.pop_back();
+			--local->size;
+			--pending;
+			return true;
+		}
+	}
+
+	{
+		std::unique_lock<std::mutex> lock(injectedMutex);
+		if (!injected.empty()) {
+			task = std::move(injected.front());
+			injected.pop_front();
+			--pending;
+			return true;
+		}
+	}
+
+	// Steal the oldest task from someone else, starting after ourselves so thieves spread out
+	const size_t n = nWorkers.load();
+#if HAS_THREADS
+	const size_t start = localWorker.queue == this ? localWorker.idx : 0;
+#else
+	const size_t start = 0;
+#endif
+	for (size_t i = 0; i < n; ++i) {
+		auto* victim = workers[(start + i + 1) % n].get();
+		if (victim == local || victim->size.load() == 0) {
+			continue;
+		}
+		std::unique_lock<std::mutex> lock(victim->mutex);
+		if (!victim->tasks.empty()) {
+			task = std::move(victim->tasks.front());
+			victim->tasks.pop_front();
+			--victim->size;
+			--pending;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void WorkStealingQueue::wakeWorker()
+{
+	std::unique_lock<std::mutex> lock(sleepMutex);
+	condition.notify_one();
+}
+
 Executors& Executors::get()
 {
 	if (!instance) {
@@ -0,0 +1,72 @@
+#include "halley/concurrency/task_group.h"
+#include <chrono>
+#include <thread>
+
+using namespace Halley;
+using namespace std::chrono_literals;
+
+TaskGroup::TaskGroup(ExecutionQueue& queue)
+	: queue(queue)
+	, pending(0)
+	, finishing(0)
+{
+}
+
+TaskGroup::TaskGroup()
+	: TaskGroup(ExecutionQueue::getDefault())
+{
+}
+
+TaskGroup::~TaskGroup()
+{
+	// Tasks still hold a pointer to us, so we can't go away before they're done
+	waitForTasks();
+}
+
+void TaskGroup::wait()
+{
+	waitForTasks();
+
+	std::exception_ptr e;
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		std::swap(e, error);
+	}
+	if (e) {
+		std::rethrow_exception(e);
+	}
+}
+
+void TaskGroup::waitForTasks()
+{
+	while (pending.load() > 0) {
+		if (!queue.tryRunNext()) {
+			// Nothing to help with, the remaining tasks are running elsewhere. Time out in case more tasks get queued.
+			std::unique_lock<std::mutex> lock(mutex);
+			condition.wait_for(lock, 100us, [&] () { return pending.load() == 0; });
+		}
+	}
+
+	// The last task might still be notifying us
+	while (finishing.load() > 0) {
+		std::this_thread::yield();
+	}
+}
+
+void TaskGroup::onTaskDone()
+{
+	++finishing;
+	if (--pending == 0) {
+		std::unique_lock<std::mutex> lock(mutex);
+		condition.notify_all();
+	}
+	--finishing;
+}
+
+void TaskGroup::onException(std::exception_ptr e)
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	if (!error) {
+		error = e;
+	}
+}
@@ -1,5 +1,8 @@
 #include <boost/pool/pool.hpp>
+#include <gsl/gsl_assert>
 #include "halley/data_structures/memory_pool.h"
+#include "halley/utils/utils.h"
+#include "halley/support/exception.h"
 
 using namespace Halley;
 
@@ -47,3 +50,89 @@ void SizePool::free(void* p)
 {
 	reinterpret_cast<PoolType*>(pimpl)->free(p);
 }
+
+ChunkedPool::ChunkedPool(size_t size, size_t elementsPerChunk)
+	: size(size)
+	, elementsPerChunk(alignUp(std::max(elementsPerChunk, size_t(1)), size_t(64)))
+{
+}
+
+ChunkedPool::~ChunkedPool() = default;
+
+void* ChunkedPool::alloc()
+{
+	while (firstFreeChunk < chunks.size() && chunks[firstFreeChunk].nFree == 0) {
+		++firstFreeChunk;
+	}
+	if (firstFreeChunk == chunks.size()) {
+		firstFreeChunk = addChunk();
+	}
+
+	auto& chunk = chunks[firstFreeChunk];
+	for (size_t i = 0; i < chunk.used.size(); ++i) {
+		auto& word = chunk.used[i];
+		if (word != ~uint64_t(0)) {
+			size_t bit = 0;
+			while ((word & (uint64_t(1) << bit)) != 0) {
+				++bit;
+			}
+			word |= uint64_t(1) << bit;
+			--chunk.nFree;
+			++nAllocated;
+			return chunk.data.get() + (i * 64 + bit) * size;
+		}
+	}
+
+	throw Exception("ChunkedPool chunk has no free slots, despite reporting so.", HalleyExceptions::Utils);
+}
+
+void ChunkedPool::free(void* p)
+{
+	const auto ptr = static_cast<const char*>(p);
+	const size_t chunkIdx = findChunk(ptr);
+	auto& chunk = chunks[chunkIdx];
+
+	const size_t idx = size_t(ptr - chunk.data.get()) / size;
+	auto& word = chunk.used[idx / 64];
+	const auto mask = uint64_t(1) << (idx % 64);
+	Expects((word & mask) != 0);
+	word &= ~mask;
+
+	++chunk.nFree;
+	--nAllocated;
+	firstFreeChunk = std::min(firstFreeChunk, chunkIdx);
+}
+
+void ChunkedPool::reserve(size_t n)
+{
+	const size_t capacity = chunks.size() * elementsPerChunk;
+	if (nAllocated + n > capacity) {
+		const size_t nNew = (nAllocated + n - capacity + elementsPerChunk - 1) / elementsPerChunk;
+		chunks.reserve(chunks.size() + nNew);
+		for (size_t i = 0; i < nNew; ++i) {
+			firstFreeChunk = std::min(firstFreeChunk, addChunk());
+		}
+	}
+}
+
+size_t ChunkedPool::addChunk()
+{
+	Chunk chunk;
+	chunk.data = std::make_unique<char[]>(size * elementsPerChunk);
+	chunk.used.resize(elementsPerChunk / 64, 0);
+	chunk.nFree = elementsPerChunk;
+
+	const auto iter = std::upper_bound(chunks.begin(), chunks.end(), chunk.data.get(), [] (const char* p, const Chunk& c) { return std::less<>()(p, c.data.get()); });
+	const size_t idx = size_t(iter - chunks.begin());
+	chunks.insert(iter, std::move(chunk));
+	return idx;
+}
+
+size_t ChunkedPool::findChunk(const char* p) const
+{
+	const auto iter = std::upper_bound(chunks.begin(), chunks.end(), p, [] (const char* p, const Chunk& c) { return std::less<>()(p, c.data.get()); });
+	Expects(iter != chunks.begin());
+	const size_t idx = size_t(iter - chunks.begin()) - 1;
+	Expects(p < chunks[idx].data.get() + size * elementsPerChunk);
+	return idx;
+}
@@ -73,7 +73,7 @@ bool RectangleSpatialChecker::updateData(Entry& entry, Rect4i prev, Rect4i next)
 	if (prev.getWidth() > 0 && prev.getHeight() > 0) {
 		Vector2i p1 = pointToCell(prev.getTopLeft());
 		Vector2i p2 = pointToCell(prev.getBottomRight());
-		delRect = Rect4i(p1, p2);
+		delRect = Rect4i(p1, p2 + Vector2i(1, 1)); // p2 is inclusive
 		hasDel = true;
 		x0 = p1.x;
 		x1 = p2.x;
@@ -84,7 +84,7 @@ bool RectangleSpatialChecker::updateData(Entry& entry, Rect4i prev, Rect4i next)
 	if (next.getWidth() > 0 && next.getHeight() > 0) {
 		Vector2i p1 = pointToCell(next.getTopLeft());
 		Vector2i p2 = pointToCell(next.getBottomRight());
-		addRect = Rect4i(p1, p2);
+		addRect = Rect4i(p1, p2 + Vector2i(1, 1)); // p2 is inclusive
 		hasAdd = true;
 		x0 = std::min(x0, p1.x);
 		x1 = std::max(x1, p2.x);
@@ -0,0 +1,161 @@
+#include "halley/file/mapped_file.h"
+#include "halley/file/path.h"
+
+using namespace Halley;
+
+#if defined(_WIN32) && !defined(WINDOWS_STORE)
+
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+
+namespace {
+	const gsl::byte* mapFile(const Path& path, size_t& size)
+	{
+		auto file = CreateFileW(path.getString().getUTF16().c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (file == INVALID_HANDLE_VALUE) {
+			return nullptr;
+		}
+
+		LARGE_INTEGER fileSize;
+		if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+			CloseHandle(file);
+			return nullptr;
+		}
+
+		auto mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		CloseHandle(file);
+		if (!mapping) {
+			return nullptr;
+		}
+
+		// The view keeps the mapping alive
+		auto view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+		CloseHandle(mapping);
+		if (!view) {
+			return nullptr;
+		}
+
+		size = size_t(fileSize.QuadPart);
+		return static_cast<const gsl::byte*>(view);
+	}
+
+	void unmapFile(const gsl::byte* data, size_t)
+	{
+		UnmapViewOfFile(data);
+	}
+}
+
+#elif defined(__unix__) || defined(__APPLE__)
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+	const gsl::byte* mapFile(const Path& path, size_t& size)
+	{
+		const int fd = ::open(path.string().c_str(), O_RDONLY);
+		if (fd < 0) {
+			return nullptr;
+		}
+
+		struct stat st;
+		if (fstat(fd, &st) != 0 || st.st_size == 0) {
+			::close(fd);
+			return nullptr;
+		}
+
+		// The mapping stays valid after the descriptor is closed
+		auto view = mmap(nullptr, size_t(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+		::close(fd);
+		if (view == MAP_FAILED) {
+			return nullptr;
+		}
+
+		size = size_t(st.st_size);
+		return static_cast<const gsl::byte*>(view);
+	}
+
+	void unmapFile(const gsl::byte* data, size_t size)
+	{
+		munmap(const_cast<gsl::byte*>(data), size);
+	}
+}
+
+#else
+
+namespace {
+	// Not implemented
+	const gsl::byte* mapFile(const Path&, size_t&)
+	{
+		return nullptr;
+	}
+
+	void unmapFile(const gsl::byte*, size_t) {}
+}
+
+#endif
+
+MappedFile::MappedFile() = default;
+
+MappedFile::MappedFile(const Path& path)
+{
+	open(path);
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+{
+	*this = std::move(other);
+}
+
+MappedFile::~MappedFile()
+{
+	close();
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+{
+	if (this != &other) {
+		close();
+		data = other.data;
+		size = other.size;
+		other.data = nullptr;
+		other.size = 0;
+	}
+	return *this;
+}
+
+bool MappedFile::open(const Path& path)
+{
+	close();
+	data = mapFile(path, size);
+	if (!data) {
+		size = 0;
+	}
+	return data != nullptr;
+}
+
+void MappedFile::close()
+{
+	if (data) {
+		unmapFile(data, size);
+		data = nullptr;
+		size = 0;
+	}
+}
+
+bool MappedFile::isOpen() const
+{
+	return data != nullptr;
+}
+
+size_t MappedFile::getSize() const
+{
+	return size;
+}
+
+gsl::span<const gsl::byte> MappedFile::getSpan() const
+{
+	return gsl::span<const gsl::byte>(data, size);
+}
@@ -0,0 +1,457 @@
+#include "halley/file_formats/texture_container.h"
+#include "halley/file_formats/image.h"
+#include "halley/concurrency/concurrent.h"
+#include "halley/support/exception.h"
+
+using namespace Halley;
+
+namespace {
+	struct FileHeader {
+		std::array<char, 4> identifier;
+		uint8_t version;
+		uint8_t bpp;
+		uint8_t nMipLevels;
+		uint8_t reserved;
+		uint32_t width;
+		uint32_t height;
+		uint32_t stripHeight;
+		uint32_t nStrips;
+	};
+
+	struct StripHeader {
+		uint32_t size;
+		uint32_t compressed;
+	};
+
+	constexpr const char* identifier = "HTEX";
+	constexpr uint8_t currentVersion = 1;
+
+	// 4 bpp strips use a QOI-style encoding: runs, a 64 entry cache of recent pixels, and small deltas to the previous pixel
+	// Everything else uses a plain byte RLE
+	constexpr uint8_t opIndex = 0x00;
+	constexpr uint8_t opDiff = 0x40;
+	constexpr uint8_t opLuma = 0x80;
+	constexpr uint8_t opRun = 0xC0;
+	constexpr uint8_t opRGB = 0xFE;
+	constexpr uint8_t opRGBA = 0xFF;
+	constexpr int maxRun = 62;
+
+	inline uint8_t channel(uint32_t px, int i)
+	{
+		return uint8_t(px >> (i * 8));
+	}
+
+	inline uint32_t makePixel(uint8_t r, uint8_t g, uint8_t b, uint8_t a)
+	{
+		return uint32_t(r) | (uint32_t(g) << 8) | (uint32_t(b) << 16) | (uint32_t(a) << 24);
+	}
+
+	inline uint32_t hashPixel(uint32_t px)
+	{
+		return (channel(px, 0) * 3 + channel(px, 1) * 5 + channel(px, 2) * 7 + channel(px, 3) * 11) & 63;
+	}
+
+	void encodePixels(gsl::span<const gsl::byte> src, Bytes& out)
+	{
+		const size_t n = size_t(src.size()) / 4;
+		std::array<uint32_t, 64> index = {};
+		uint32_t prev = 0;
+		int run = 0;
+
+		for (size_t i = 0; i < n; ++i) {
+			uint32_t px;
+			memcpy(&px, src.data() + i * 4, 4);
+
+			if (px == prev) {
+				if (++run == maxRun) {
+					out.push_back(uint8_t(opRun | (run - 1)));
+					run = 0;
+				}
+				continue;
+			}
+			if (run > 0) {
+				out.push_back(uint8_t(opRun | (run - 1)));
+				run = 0;
+			}
+
+			const auto h = hashPixel(px);
+			if (index[h] == px) {
+				out.push_back(uint8_t(opIndex | h));
+			} else {
+				index[h] = px;
+				if (channel(px, 3) == channel(prev, 3)) {
+					const int dr = int8_t(channel(px, 0) - channel(prev, 0));
+					const int dg = int8_t(channel(px, 1) - channel(prev, 1));
+					const int db = int8_t(channel(px, 2) - channel(prev, 2));
+					const int drg = int8_t(dr - dg);
+					const int dbg = int8_t(db - dg);
+					if (dr >= -2 && dr <= 1 && dg >= -2 && dg <= 1 && db >= -2 && db <= 1) {
+						out.push_back(uint8_t(opDiff | ((dr + 2) << 4) | ((dg + 2) << 2) | (db + 2)));
+					} else if (dg >= -32 && dg <= 31 && drg >= -8 && drg <= 7 && dbg >= -8 && dbg <= 7) {
+						out.push_back(uint8_t(opLuma | (dg + 32)));
+						out.push_back(uint8_t(((drg + 8) << 4) | (dbg + 8)));
+					} else {
+						out.push_back(opRGB);
+						out.push_back(channel(px, 0));
+						out.push_back(channel(px, 1));
+						out.push_back(channel(px, 2));
+					}
+				} else {
+					out.push_back(opRGBA);
+					out.push_back(channel(px, 0));
+					out.push_back(channel(px, 1));
+					out.push_back(channel(px, 2));
+					out.push_back(channel(px, 3));
+				}
+			}
+			prev = px;
+		}
+
+		if (run > 0) {
+			out.push_back(uint8_t(opRun | (run - 1)));
+		}
+	}
+
+	void decodePixels(gsl::span<const gsl::byte> src, gsl::span<gsl::byte> dst)
+	{
+		const auto* in = reinterpret_cast<const uint8_t*>(src.data());
+		const auto* inEnd = in + src.size();
+		auto* out = reinterpret_cast<uint8_t*>(dst.data());
+		const size_t n = size_t(dst.size()) / 4;
+
+		std::array<uint32_t, 64> index = {};
+		uint32_t px = 0;
+		size_t i = 0;
+
+		auto need = [&] (size_t bytes)
+		{
+			if (size_t(inEnd - in) < bytes) {
+				throw Exception("Texture strip data is truncated.", HalleyExceptions::Utils);
+			}
+		};
+
+		while (i < n) {
+			need(1);
+			const uint8_t op = *in++;
+
+			if (op >= opRun && op < opRGB) {
+				const size_t run = std::min(size_t(op & 0x3F) + 1, n - i);
+				for (size_t j = 0; j < run; ++j) {
+					memcpy(out + (i + j) * 4, &px, 4);
+				}
+				i += run;
+				continue;
+			}
+
+			if (op == opRGBA) {
+				need(4);
+				px = makePixel(in[0], in[1], in[2], in[3]);
+				in += 4;
+			} else if (op == opRGB) {
+				need(3);
+				px = makePixel(in[0], in[1], in[2], channel(px, 3));
+				in += 3;
+			} else if ((op & 0xC0) == opIndex) {
+				px = index[op & 0x3F];
+				memcpy(out + i * 4, &px, 4);
+				++i;
+				continue;
+			} else if ((op & 0xC0) == opDiff) {
+				const int dr = ((op >> 4) & 3) - 2;
+				const int dg = ((op >> 2) & 3) - 2;
+				const int db = (op & 3) - 2;
+				px = makePixel(uint8_t(channel(px, 0) + dr), uint8_t(channel(px, 1) + dg), uint8_t(channel(px, 2) + db), channel(px, 3));
+			} else {
+				need(1);
+				const int dg = (op & 0x3F) - 32;
+				const int drg = (*in >> 4) - 8;
+				const int dbg = (*in & 0x0F) - 8;
+				++in;
+				px = makePixel(uint8_t(channel(px, 0) + dg + drg), uint8_t(channel(px, 1) + dg), uint8_t(channel(px, 2) + dg + dbg), channel(px, 3));
+			}
+
+			index[hashPixel(px)] = px;
+			memcpy(out + i * 4, &px, 4);
+			++i;
+		}
+	}
+
+	// Control byte c < 0x80 is followed by c + 1 literal bytes, otherwise the next byte is repeated c - 0x7D times
+	void encodeBytes(gsl::span<const gsl::byte> src, Bytes& out)
+	{
+		const auto* in = reinterpret_cast<const uint8_t*>(src.data());
+		const size_t n = size_t(src.size());
+		size_t literalStart = 0;
+
+		auto flushLiterals = [&] (size_t end)
+		{
+			while (literalStart < end) {
+				const size_t count = std::min(end - literalStart, size_t(128));
+				out.push_back(uint8_t(count - 1));
+				out.insert(out.end(), in + literalStart, in + literalStart + count);
+				literalStart += count;
+			}
+		};
+
+		size_t i = 0;
+		while (i < n) {
+			size_t run = 1;
+			while (i + run < n && run < 130 && in[i + run] == in[i]) {
+				++run;
+			}
+			if (run >= 3) {
+				flushLiterals(i);
+				out.push_back(uint8_t(0x80 + run - 3));
+				out.push_back(in[i]);
+				i += run;
+				literalStart = i;
+			} else {
+				i += run;
+			}
+		}
+		flushLiterals(n);
+	}
+
+	void decodeBytes(gsl::span<const gsl::byte> src, gsl::span<gsl::byte> dst)
+	{
+		const auto* in = reinterpret_cast<const uint8_t*>(src.data());
+		const auto* inEnd = in + src.size();
+		auto* out = reinterpret_cast<uint8_t*>(dst.data());
+		auto* outEnd = out + dst.size();
+
+		while (out < outEnd) {
+			if (in >= inEnd) {
+				throw Exception("Texture strip data is truncated.", HalleyExceptions::Utils);
+			}
+			const uint8_t c = *in++;
+			if (c < 0x80) {
+				const size_t count = size_t(c) + 1;
+				if (size_t(inEnd - in) < count || size_t(outEnd - out) < count) {
+					throw Exception("Texture strip data is invalid.", HalleyExceptions::Utils);
+				}
+				memcpy(out, in, count);
+				in += count;
+				out += count;
+			} else {
+				const size_t count = size_t(c) - 0x80 + 3;
+				if (in >= inEnd || size_t(outEnd - out) < count) {
+					throw Exception("Texture strip data is invalid.", HalleyExceptions::Utils);
+				}
+				memset(out, *in++, count);
+				out += count;
+			}
+		}
+	}
+
+	// Box filter, which is also what the video APIs use when generating mip maps
+	Bytes downsample(gsl::span<const Byte> src, Vector2i srcSize, int bpp)
+	{
+		const auto dstSize = TextureContainer::getMipLevelSize(srcSize, 1);
+		Bytes result(size_t(dstSize.x * dstSize.y * bpp));
+		for (int y = 0; y < dstSize.y; ++y) {
+			const int y0 = std::min(y * 2, srcSize.y - 1);
+			const int y1 = std::min(y * 2 + 1, srcSize.y - 1);
+			for (int x = 0; x < dstSize.x; ++x) {
+				const int x0 = std::min(x * 2, srcSize.x - 1);
+				const int x1 = std::min(x * 2 + 1, srcSize.x - 1);
+				for (int c = 0; c < bpp; ++c) {
+					const int sum = src[(y0 * srcSize.x + x0) * bpp + c] + src[(y0 * srcSize.x + x1) * bpp + c]
+						+ src[(y1 * srcSize.x + x0) * bpp + c] + src[(y1 * srcSize.x + x1) * bpp + c];
+					result[(y * dstSize.x + x) * bpp + c] = Byte((sum + 2) / 4);
+				}
+			}
+		}
+		return result;
+	}
+}
+
+TextureContainer::TextureContainer(gsl::span<const gsl::byte> bytes)
+	: data(bytes)
+{
+	if (!isTextureContainer(bytes)) {
+		throw Exception("Invalid texture container.", HalleyExceptions::Utils);
+	}
+
+	FileHeader header;
+	memcpy(&header, bytes.data(), sizeof(header));
+	if (header.version != currentVersion) {
+		throw Exception("Unsupported texture container version: " + toString(int(header.version)), HalleyExceptions::Utils);
+	}
+	if (header.stripHeight == 0 || header.nMipLevels == 0) {
+		throw Exception("Invalid texture container.", HalleyExceptions::Utils);
+	}
+
+	size = Vector2i(int(header.width), int(header.height));
+	bpp = header.bpp;
+	nMipLevels = header.nMipLevels;
+
+	const size_t tablePos = sizeof(FileHeader);
+	size_t srcPos = tablePos + header.nStrips * sizeof(StripHeader);
+	if (srcPos > size_t(bytes.size())) {
+		throw Exception("Texture container is truncated.", HalleyExceptions::Utils);
+	}
+
+	// Strips are stored level by level, top to bottom
+	strips.reserve(header.nStrips);
+	size_t dstPos = 0;
+	for (int level = 0; level < nMipLevels; ++level) {
+		const auto levelSize = getMipLevelSize(size, level);
+		const size_t rowSize = size_t(levelSize.x * bpp);
+		for (int y = 0; y < levelSize.y; y += int(header.stripHeight)) {
+			if (strips.size() == header.nStrips) {
+				throw Exception("Texture container is missing strips.", HalleyExceptions::Utils);
+			}
+			StripHeader stripHeader;
+			memcpy(&stripHeader, bytes.data() + tablePos + strips.size() * sizeof(StripHeader), sizeof(StripHeader));
+
+			const size_t rows = std::min(size_t(header.stripHeight), size_t(levelSize.y - y));
+			strips.push_back(Strip{ srcPos, stripHeader.size, dstPos, rows * rowSize, stripHeader.compressed != 0 });
+			srcPos += stripHeader.size;
+			dstPos += rows * rowSize;
+		}
+	}
+
+	if (srcPos > size_t(bytes.size())) {
+		throw Exception("Texture container is truncated.", HalleyExceptions::Utils);
+	}
+	decodedSize = dstPos;
+}
+
+bool TextureContainer::isTextureContainer(gsl::span<const gsl::byte> bytes)
+{
+	return size_t(bytes.size()) >= sizeof(FileHeader) && memcmp(bytes.data(), identifier, 4) == 0;
+}
+
+Bytes TextureContainer::encode(const Image& image, bool mipMaps, int stripHeight)
+{
+	Expects(stripHeight > 0);
+
+	const int bpp = image.getBytesPerPixel();
+	const auto imageSize = image.getSize();
+	const int nLevels = mipMaps ? getNumMipLevels(imageSize) : 1;
+
+	// Generate mip levels
+	Vector<Bytes> levels;
+	const auto pixels = image.getPixelBytes();
+	levels.emplace_back(pixels.begin(), pixels.begin() + size_t(imageSize.x * imageSize.y * bpp));
+	for (int level = 1; level < nLevels; ++level) {
+		levels.push_back(downsample(levels.back(), getMipLevelSize(imageSize, level - 1), bpp));
+	}
+
+	// Encode strips, keeping them raw whenever encoding doesn't help
+	Vector<StripHeader> table;
+	Bytes stripData;
+	Bytes encoded;
+	for (int level = 0; level < nLevels; ++level) {
+		const auto levelSize = getMipLevelSize(imageSize, level);
+		const size_t rowSize = size_t(levelSize.x * bpp);
+		for (int y = 0; y < levelSize.y; y += stripHeight) {
+			const size_t rows = std::min(size_t(stripHeight), size_t(levelSize.y - y));
+			const auto src = gsl::as_bytes(gsl::span<const Byte>(levels[level].data() + y * rowSize, rows * rowSize));
+
+			encoded.clear();
+			if (bpp == 4) {
+				encodePixels(src, encoded);
+			} else {
+				encodeBytes(src, encoded);
+			}
+
+			const bool compressed = encoded.size() < size_t(src.size());
+			const auto* start = compressed ? encoded.data() : reinterpret_cast<const Byte*>(src.data());
+			const size_t stripSize = compressed ? encoded.size() : size_t(src.size());
+			stripData.insert(stripData.end(), start, start + stripSize);
+			table.push_back(StripHeader{ uint32_t(stripSize), compressed ? 1u : 0u });
+		}
+	}
+
+	FileHeader header;
+	memcpy(header.identifier.data(), identifier, 4);
+	header.version = currentVersion;
+	header.bpp = uint8_t(bpp);
+	header.nMipLevels = uint8_t(nLevels);
+	header.reserved = 0;
+	header.width = uint32_t(imageSize.x);
+	header.height = uint32_t(imageSize.y);
+	header.stripHeight = uint32_t(stripHeight);
+	header.nStrips = uint32_t(table.size());
+
+	const size_t tableSize = table.size() * sizeof(StripHeader);
+	Bytes result(sizeof(FileHeader) + tableSize + stripData.size());
+	memcpy(result.data(), &header, sizeof(FileHeader));
+	memcpy(result.data() + sizeof(FileHeader), table.data(), tableSize);
+	memcpy(result.data() + sizeof(FileHeader) + tableSize, stripData.data(), stripData.size());
+	return result;
+}
+
+Vector2i TextureContainer::getSize() const
+{
+	return size;
+}
+
+int TextureContainer::getBytesPerPixel() const
+{
+	return bpp;
+}
+
+int TextureContainer::getNumMipLevels() const
+{
+	return nMipLevels;
+}
+
+size_t TextureContainer::getDecodedSize() const
+{
+	return decodedSize;
+}
+
+Bytes TextureContainer::decode(ExecutionQueue* queue) const
+{
+	Bytes result(decodedSize);
+	decode(gsl::as_writable_bytes(gsl::span<Byte>(result)), queue);
+	return result;
+}
+
+void TextureContainer::decode(gsl::span<gsl::byte> dst, ExecutionQueue* queue) const
+{
+	Expects(size_t(dst.size()) >= decodedSize);
+
+	if (queue && strips.size() > 1) {
+		Concurrent::parallelFor(*queue, 0, strips.size(), [&] (size_t i)
+		{
+			decodeStrip(strips[i], dst);
+		});
+	} else {
+		for (const auto& strip: strips) {
+			decodeStrip(strip, dst);
+		}
+	}
+}
+
+void TextureContainer::decodeStrip(const Strip& strip, gsl::span<gsl::byte> dst) const
+{
+	const auto src = data.subspan(ptrdiff_t(strip.srcPos), ptrdiff_t(strip.srcSize));
+	const auto out = dst.subspan(ptrdiff_t(strip.dstPos), ptrdiff_t(strip.dstSize));
+	if (!strip.compressed) {
+		if (src.size() != out.size()) {
+			throw Exception("Texture strip has the wrong size.", HalleyExceptions::Utils);
+		}
+		memcpy(out.data(), src.data(), size_t(src.size()));
+	} else if (bpp == 4) {
+		decodePixels(src, out);
+	} else {
+		decodeBytes(src, out);
+	}
+}
+
+Vector2i TextureContainer::getMipLevelSize(Vector2i size, int level)
+{
+	return Vector2i(std::max(1, size.x >> level), std::max(1, size.y >> level));
+}
+
+int TextureContainer::getNumMipLevels(Vector2i size)
+{
+	int levels = 1;
+	while ((size.x >> levels) > 0 || (size.y >> levels) > 0) {
+		++levels;
+	}
+	return levels;
+}
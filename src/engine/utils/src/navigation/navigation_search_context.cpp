@@ -0,0 +1,31 @@
+#include "halley/navigation/navigation_search_context.h"
+using namespace Halley;
+
+NavigationSearchContext::NavigationSearchContext()
+	: openSet(NodeComparator(states))
+{
+	openSet.reserve(100);
+}
+
+NavigationSearchContext& NavigationSearchContext::getThreadLocal()
+{
+	static thread_local NavigationSearchContext context;
+	return context;
+}
+
+void NavigationSearchContext::beginSearch(size_t nNodes)
+{
+	if (states.size() < nNodes) {
+		states.resize(nNodes);
+	}
+	openSet.clear();
+
+	++generation;
+	if (generation == 0) {
+		// Wrapped around, so old stamps could be mistaken for current ones
+		for (auto& state: states) {
+			state.generation = 0;
+		}
+		generation = 1;
+	}
+}
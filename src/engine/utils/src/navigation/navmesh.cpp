@@ -1,10 +1,13 @@
 #include "halley/navigation/navmesh.h"
 
-#include "halley/data_structures/priority_queue.h"
+#include "halley/navigation/navigation_search_context.h"
 #include "halley/maths/random.h"
 #include "halley/maths/ray.h"
 using namespace Halley;
 
+// How far off the navmesh a position can be and still be snapped to it by getNodeAt
+constexpr static float maxDistanceToPolygon = 5.0f;
+
 Navmesh::Navmesh()
 {}
 
@@ -95,8 +98,6 @@ std::optional<Navmesh::NodeId> Navmesh::getNodeAt(Vector2f position) const
 		}
 	}
 
-	const float maxDistanceToPolygon = 5.0f;
-
 	// Haven't found, look for the closest one in this grid cell...
 	{
 		float bestDist = std::numeric_limits<float>::infinity();
@@ -104,7 +105,7 @@ std::optional<Navmesh::NodeId> Navmesh::getNodeAt(Vector2f position) const
 		for (auto i: polyIndices) {
 			const auto p = polygons[i].getClosestPoint(position);
 			const float distSquared = (p - position).squaredLength();
-			if (distSquared < bestDist && std::sqrt(distSquared) < maxDistanceToPolygon) {
+			if (distSquared < bestDist && distSquared < maxDistanceToPolygon * maxDistanceToPolygon) {
 				bestDist = distSquared;
 				bestNode = i;
 			}
@@ -114,13 +115,14 @@ std::optional<Navmesh::NodeId> Navmesh::getNodeAt(Vector2f position) const
 		}
 	}
 
-	// If we don't find it even in this cell, then look on the open edges
+	// If we don't find it even in this cell, then look on the open edges near it
 	{
 		float bestDist = std::numeric_limits<float>::infinity();
 		int bestNode = -1;
-		for (const auto& edge: openEdges) {
+		for (const auto edgeIdx: getOpenEdgesAt(position)) {
+			const auto& edge = openEdges[edgeIdx];
 			const float distSquared = (position - edge.second.getClosestPoint(position)).squaredLength();
-			if (distSquared < bestDist && std::sqrt(distSquared) < maxDistanceToPolygon) {
+			if (distSquared < bestDist && distSquared < maxDistanceToPolygon * maxDistanceToPolygon) {
 				bestDist = distSquared;
 				bestNode = edge.first;
 			}
@@ -217,14 +219,16 @@ std::optional<NavigationPath> Navmesh::pathfind(const NavigationQuery& query) co
 	return makePath(query, nodePath.value());
 }
 
-std::vector<Navmesh::NodeAndConn> Navmesh::makeResult(const std::vector<State>& state, int startId, int endId) const
+std::vector<Navmesh::NodeAndConn> Navmesh::makeResult(NavigationSearchContext& context, int startId, int endId) const
 {
 	std::vector<NodeAndConn> result;
-	for (NodeAndConn curNode(endId); true; curNode = state[curNode.node].cameFrom) {
+	for (NodeAndConn curNode(endId); true;) {
 		result.push_back(curNode);
 		if (curNode.node == startId) {
 			break;
 		}
+		const auto& state = context.getState(curNode.node);
+		curNode = NodeAndConn(state.cameFrom, state.cameFromConnection);
 	}
 	std::reverse(result.begin(), result.end());
 	return result;
@@ -238,13 +242,10 @@ std::optional<std::vector<Navmesh::NodeAndConn>> Navmesh::pathfind(int fromId, i
 		return {};
 	}
 
-	// State map. Using vector for perf, trading space for CPU.
-	// TODO: measure this vs unordered_map or some other hashtable, it's not impossible that it'd perform better (compact memory)
-	std::vector<State> state(nodes.size(), State{});
-
-	// Open set
-	auto openSet = PriorityQueue<NodeId, NodeComparator>(NodeComparator(state));
-	openSet.reserve(std::min(static_cast<size_t>(100), nodes.size()));
+	// State map and open set are reused between queries on this thread
+	auto& context = NavigationSearchContext::getThreadLocal();
+	context.beginSearch(nodes.size());
+	auto& openSet = context.getOpenSet();
 
 	// Define heuristic function
 	const Vector2f endPos = nodes[toId].pos;
@@ -256,12 +257,11 @@ std::optional<std::vector<Navmesh::NodeAndConn>> Navmesh::pathfind(int fromId, i
 
 	// Initialize the query
 	{
-		auto& firstNodeState = state[fromId];
-		firstNodeState.cameFrom = NodeAndConn();
+		auto& firstNodeState = context.getState(static_cast<NodeId>(fromId));
 		firstNodeState.gScore = 0;
 		firstNodeState.fScore = h(nodes[fromId].pos);
 		firstNodeState.inOpenSet = true;
-		openSet.push(fromId);
+		openSet.push(static_cast<NodeId>(fromId));
 	}
 
 	// Run A*
@@ -269,24 +269,26 @@ std::optional<std::vector<Navmesh::NodeAndConn>> Navmesh::pathfind(int fromId, i
 		const auto curId = openSet.top();
 		if (curId == toId) {
 			// Done!
-			return makeResult(state, fromId, toId);
+			return makeResult(context, fromId, toId);
 		}
 
-		state[curId].inOpenSet = false;
-		state[curId].inClosedSet = true;
+		auto& curState = context.getState(curId);
+		curState.inOpenSet = false;
+		curState.inClosedSet = true;
 		openSet.pop();
 		
-		const float gScore = state[curId].gScore;
+		const float gScore = curState.gScore;
 		const auto& curNode = nodes[curId];
 		for (size_t i = 0; i < curNode.nConnections; ++i) {
 			if (curNode.connections[i]) {
 				const auto nodeId = curNode.connections[i].value();
-				if (!state[nodeId].inClosedSet) {
-					auto& neighState = state[nodeId];
+				auto& neighState = context.getState(nodeId);
+				if (!neighState.inClosedSet) {
 					const float neighScore = gScore + curNode.costs[i];
 
 					if (neighScore < neighState.gScore) {
-						neighState.cameFrom = NodeAndConn(curId, i);
+						neighState.cameFrom = curId;
+						neighState.cameFromConnection = static_cast<uint16_t>(i);
 						neighState.gScore = neighScore;
 						neighState.fScore = neighScore + h(nodes[nodeId].pos);
 						if (!neighState.inOpenSet) {
@@ -409,6 +411,7 @@ void Navmesh::setWorldPosition(Vector2f newOffset, Vector2i gridPos)
 		edge.second.b += delta;
 	}
 	origin += delta;
+	boundingBox += delta;
 }
 
 void Navmesh::markPortalConnected(size_t idx)
@@ -471,7 +474,9 @@ void Navmesh::processPolygons()
 {
 	addPolygonsToGrid();
 	computeArea();
+	computeBoundingBox();
 	generateOpenEdges();
+	addOpenEdgesToGrid();
 }
 
 void Navmesh::addPolygonsToGrid()
@@ -509,7 +514,7 @@ void Navmesh::addPolygonToGrid(const Polygon& poly, NodeId idx)
 
 gsl::span<const Navmesh::NodeId> Navmesh::getPolygonsAt(Vector2f pos, bool allowOutside) const
 {
-	const auto p = Vector2i((normalisedCoordinatesBase.inverseTransform(pos - origin) * Vector2f(gridSize)).floor());
+	const auto p = getGridCell(pos);
 	const int x = clamp(p.x, 0, gridSize.x - 1);
 	const int y = clamp(p.y, 0, gridSize.y - 1);
 
@@ -520,6 +525,19 @@ gsl::span<const Navmesh::NodeId> Navmesh::getPolygonsAt(Vector2f pos, bool allow
 	return polyGrid[x + y * gridSize.x];
 }
 
+gsl::span<const uint32_t> Navmesh::getOpenEdgesAt(Vector2f pos) const
+{
+	const auto p = getGridCell(pos);
+	const int x = clamp(p.x, 0, gridSize.x - 1);
+	const int y = clamp(p.y, 0, gridSize.y - 1);
+	return openEdgeGrid[x + y * gridSize.x];
+}
+
+Vector2i Navmesh::getGridCell(Vector2f pos) const
+{
+	return Vector2i((normalisedCoordinatesBase.inverseTransform(pos - origin) * Vector2f(gridSize)).floor());
+}
+
 float Navmesh::getArea() const
 {
 	return totalArea;
@@ -550,6 +568,14 @@ void Navmesh::computeArea()
 	}
 }
 
+void Navmesh::computeBoundingBox()
+{
+	boundingBox = polygons.empty() ? Rect4f() : polygons[0].getAABB();
+	for (const auto& p: polygons) {
+		boundingBox = boundingBox.merge(p.getAABB());
+	}
+}
+
 void Navmesh::generateOpenEdges()
 {
 	openEdges.clear();
@@ -563,6 +589,38 @@ void Navmesh::generateOpenEdges()
 	}
 }
 
+void Navmesh::addOpenEdgesToGrid()
+{
+	openEdgeGrid.resize(gridSize.x * gridSize.y);
+	for (auto& c: openEdgeGrid) {
+		c.clear();
+	}
+
+	for (size_t i = 0; i < openEdges.size(); ++i) {
+		// Every cell that has a point within snapping distance of this edge.
+		// The base may be skewed, so take the cells under all four corners of the grown box.
+		const auto& edge = openEdges[i].second;
+		const auto box = Rect4f(Vector2f(std::min(edge.a.x, edge.b.x), std::min(edge.a.y, edge.b.y)), Vector2f(std::max(edge.a.x, edge.b.x), std::max(edge.a.y, edge.b.y))).grow(maxDistanceToPolygon);
+		int minX = gridSize.x - 1;
+		int minY = gridSize.y - 1;
+		int maxX = 0;
+		int maxY = 0;
+		for (const auto& v: { box.getTopLeft(), box.getTopRight(), box.getBottomLeft(), box.getBottomRight() }) {
+			const auto p = getGridCell(v);
+			minX = std::min(minX, std::max(0, p.x));
+			maxX = std::max(maxX, std::min(gridSize.x - 1, p.x));
+			minY = std::min(minY, std::max(0, p.y));
+			maxY = std::max(maxY, std::min(gridSize.y - 1, p.y));
+		}
+
+		for (int y = minY; y <= maxY; ++y) {
+			for (int x = minX; x <= maxX; ++x) {
+				openEdgeGrid[x + y * gridSize.x].push_back(static_cast<uint32_t>(i));
+			}
+		}
+	}
+}
+
 void Navmesh::addToPortals(NodeAndConn nodeAndConn, int id)
 {
 	getPortals(id).connections.push_back(nodeAndConn);
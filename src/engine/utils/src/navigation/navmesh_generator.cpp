@@ -1,7 +1,81 @@
 #include "halley/navigation/navmesh_generator.h"
 #include "halley/navigation/navmesh_set.h"
+#include "halley/concurrency/concurrent.h"
+#include "halley/data_structures/rect_spatial_checker.h"
 using namespace Halley;
 
+namespace {
+	// Slack added around bounding boxes, so that polygons which merely touch (e.g. share an edge) are still reported
+	constexpr float aabbMargin = 0.01f;
+
+	bool aabbOverlaps(const Rect4f& a, const Rect4f& b)
+	{
+		return a.grow(aabbMargin).overlaps(b);
+	}
+
+	// Grid over a set of bounding boxes, used so that each polygon only gets tested against its neighbourhood
+	class PolygonIndex {
+	public:
+		explicit PolygonIndex(gsl::span<const Rect4f> aabbs)
+			: origin(getOrigin(aabbs))
+			, index(getResolution(aabbs))
+		{
+			for (size_t i = 0; i < aabbs.size(); ++i) {
+				index.add(toGridRect(aabbs[i]), static_cast<int>(i));
+			}
+		}
+
+		// Returns the indices of all boxes near aabb, in ascending order
+		const std::vector<int>& query(const Rect4f& aabb)
+		{
+			const auto found = index.query(toGridRect(aabb));
+			results.assign(found.results, found.results + found.n);
+			std::sort(results.begin(), results.end());
+			return results;
+		}
+
+	private:
+		Vector2f origin;
+		RectangleSpatialChecker index;
+		std::vector<int> results;
+
+		Rect4i toGridRect(const Rect4f& aabb) const
+		{
+			// Relative to the origin, so the grid doesn't grow to cover the space between (0, 0) and the chunk
+			const auto p1 = aabb.getTopLeft() - origin;
+			const auto p2 = aabb.getBottomRight() - origin;
+			return Rect4i(Vector2i(static_cast<int>(std::floor(p1.x)) - 1, static_cast<int>(std::floor(p1.y)) - 1), Vector2i(static_cast<int>(std::ceil(p2.x)) + 1, static_cast<int>(std::ceil(p2.y)) + 1));
+		}
+
+		static Vector2f getOrigin(gsl::span<const Rect4f> aabbs)
+		{
+			if (aabbs.empty()) {
+				return {};
+			}
+			auto result = aabbs[0].getTopLeft();
+			for (const auto& aabb: aabbs) {
+				result = Vector2f(std::min(result.x, aabb.getLeft()), std::min(result.y, aabb.getTop()));
+			}
+			return result;
+		}
+
+		static int getResolution(gsl::span<const Rect4f> aabbs)
+		{
+			// Cells about as big as the average box
+			double totalSize = 0;
+			for (const auto& aabb: aabbs) {
+				totalSize += std::max(aabb.getWidth(), aabb.getHeight());
+			}
+			const double averageSize = aabbs.empty() ? 1.0 : totalSize / aabbs.size();
+			int resolution = 0;
+			while (resolution < 16 && double(1 << resolution) < averageSize) {
+				++resolution;
+			}
+			return resolution;
+		}
+	};
+}
+
 NavmeshSet NavmeshGenerator::generate(const NavmeshBounds& bounds, gsl::span<const Polygon> rawObstacles, gsl::span<const Polygon> regions, int subWorld, float agentSize)
 {
 	auto obstacles = preProcessObstacles(rawObstacles, agentSize);
@@ -10,28 +84,54 @@ NavmeshSet NavmeshGenerator::generate(const NavmeshBounds& bounds, gsl::span<con
 	const auto v = bounds.side1 / bounds.side1Divisions;
 	const float maxSize = (u - v).length() * 0.6f;
 
-	std::vector<NavmeshNode> polygons;
-	
+	std::vector<Polygon> cells;
+	cells.reserve(bounds.side0Divisions * bounds.side1Divisions);
 	for (size_t i = 0; i < bounds.side0Divisions; ++i) {
 		for (size_t j = 0; j < bounds.side1Divisions; ++j) {
-			const auto cell = Polygon(VertexList{{
+			cells.push_back(Polygon(VertexList{{
 				bounds.origin + (i + 1) * u + j * v,
 				bounds.origin + (i + 1) * u + (j + 1) * v,
 				bounds.origin + i * u + (j + 1) * v,
 				bounds.origin + i * u + j * v
-			}});
-
-			auto cellPolygons = toNavmeshNode(generateByPolygonSubtraction(gsl::span<const Polygon>(&cell, 1), obstacles, cell.getBoundingCircle()));
-			generateConnectivity(cellPolygons);
-			postProcessPolygons(cellPolygons, maxSize);
-
-			const int startIdx = static_cast<int>(polygons.size());
-			for (auto& p: cellPolygons) {
-				polygons.emplace_back(std::move(p));
-				for (auto& c: polygons.back().connections) {
-					if (c != -1) {
-						c += startIdx;
-					}
+			}}));
+		}
+	}
+
+	// Find the obstacles near each cell up front, as the index can't be queried concurrently.
+	// Indices come out sorted, so obstacles are still subtracted in their original order.
+	std::vector<std::vector<const Polygon*>> cellObstacles(cells.size());
+	{
+		std::vector<Rect4f> obstacleAABBs;
+		obstacleAABBs.reserve(obstacles.size());
+		for (const auto& o: obstacles) {
+			obstacleAABBs.push_back(o.getAABB());
+		}
+		auto obstacleIndex = PolygonIndex(obstacleAABBs);
+		for (size_t i = 0; i < cells.size(); ++i) {
+			for (const int idx: obstacleIndex.query(cells[i].getAABB())) {
+				cellObstacles[i].push_back(&obstacles[idx]);
+			}
+		}
+	}
+
+	// Cells are independent of each other until they're stitched together below
+	std::vector<std::vector<NavmeshNode>> cellPolygons(cells.size());
+	Concurrent::parallelFor(0, cells.size(), [&] (size_t i)
+	{
+		auto& nodes = cellPolygons[i];
+		nodes = toNavmeshNode(generateByPolygonSubtraction(gsl::span<const Polygon>(&cells[i], 1), cellObstacles[i], cells[i].getBoundingCircle()));
+		generateConnectivity(nodes);
+		postProcessPolygons(nodes, maxSize);
+	});
+
+	std::vector<NavmeshNode> polygons;
+	for (auto& cellPolygon: cellPolygons) {
+		const int startIdx = static_cast<int>(polygons.size());
+		for (auto& p: cellPolygon) {
+			polygons.emplace_back(std::move(p));
+			for (auto& c: polygons.back().connections) {
+				if (c != -1) {
+					c += startIdx;
 				}
 			}
 		}
@@ -49,7 +149,18 @@ NavmeshSet NavmeshGenerator::generate(const NavmeshBounds& bounds, gsl::span<con
 	return result;
 }
 
-std::vector<Polygon> NavmeshGenerator::generateByPolygonSubtraction(gsl::span<const Polygon> inputPolygons, gsl::span<const Polygon> obstacles, Circle bounds)
+std::vector<NavmeshSet> NavmeshGenerator::generateChunks(gsl::span<const Params> chunks)
+{
+	std::vector<NavmeshSet> result(chunks.size());
+	Concurrent::parallelFor(0, chunks.size(), [&] (size_t i)
+	{
+		const auto& chunk = chunks[i];
+		result[i] = generate(chunk.bounds, chunk.obstacles, chunk.regions, chunk.subWorld, chunk.agentSize);
+	});
+	return result;
+}
+
+std::vector<Polygon> NavmeshGenerator::generateByPolygonSubtraction(gsl::span<const Polygon> inputPolygons, gsl::span<const Polygon* const> obstacles, Circle bounds)
 {
 	// Start with the given input polygons
 	std::vector<Polygon> output;
@@ -62,7 +173,8 @@ std::vector<Polygon> NavmeshGenerator::generateByPolygonSubtraction(gsl::span<co
 	}
 
 	// Subtract all obstacles
-	for (const auto& obstacle: obstacles) {
+	for (const auto* obstaclePtr: obstacles) {
+		const auto& obstacle = *obstaclePtr;
 		if (!obstacle.getBoundingCircle().overlaps(bounds)) {
 			continue;
 		}
@@ -71,6 +183,10 @@ std::vector<Polygon> NavmeshGenerator::generateByPolygonSubtraction(gsl::span<co
 		std::vector<Polygon> toAdd;
 		
 		for (int i = 0; i < nPolys; ++i) {
+			if (!aabbOverlaps(output[i].getAABB(), obstacle.getAABB())) {
+				continue;
+			}
+
 			// Subtract this obstacle from this polygon, then update the list
 			auto subResult = output[i].subtract(obstacle);
 			if (subResult) {
@@ -159,14 +275,33 @@ std::vector<NavmeshGenerator::NavmeshNode> NavmeshGenerator::toNavmeshNode(std::
 
 void NavmeshGenerator::generateConnectivity(gsl::span<NavmeshNode> polygons)
 {
+	std::vector<Rect4f> aabbs;
+	aabbs.reserve(polygons.size());
+	for (const auto& p: polygons) {
+		aabbs.push_back(p.polygon.getAABB());
+	}
+	auto index = PolygonIndex(aabbs);
+	std::vector<size_t> candidates;
+
 	for (size_t polyAIdx = 0; polyAIdx < polygons.size(); ++polyAIdx) {
 		NavmeshNode& a = polygons[polyAIdx];
+		if (std::find(a.connections.begin(), a.connections.end(), -1) == a.connections.end()) {
+			continue;
+		}
+
+		// Only polygons whose bounds touch this one can share an edge with it
+		candidates.clear();
+		for (const int idx: index.query(aabbs[polyAIdx])) {
+			if (static_cast<size_t>(idx) > polyAIdx && aabbOverlaps(aabbs[polyAIdx], aabbs[idx])) {
+				candidates.push_back(static_cast<size_t>(idx));
+			}
+		}
 
 		for (size_t edgeAIdx = 0; edgeAIdx < a.connections.size(); ++edgeAIdx) {
 			if (a.connections[edgeAIdx] == -1) {
 				auto edgeA = a.polygon.getEdge(edgeAIdx);
 				
-				for (size_t polyBIdx = polyAIdx + 1; polyBIdx < polygons.size(); ++polyBIdx) {
+				for (const size_t polyBIdx: candidates) {
 					NavmeshNode& b = polygons[polyBIdx];
 
 					auto edgeBIdx = b.polygon.findEdge(edgeA, 0.0001f);
@@ -1,6 +1,7 @@
 #include "halley/navigation/navmesh_set.h"
 
-#include "halley/data_structures/priority_queue.h"
+#include "halley/concurrency/concurrent.h"
+#include "halley/navigation/navigation_search_context.h"
 #include "halley/support/logger.h"
 using namespace Halley;
 
@@ -13,6 +14,7 @@ NavmeshSet::NavmeshSet(const ConfigNode& nodeData)
 	if (nodeData.getType() == ConfigNodeType::Map) {
 		navmeshes = nodeData["navmeshes"].asVector<Navmesh>();
 	}
+	rebuildRegionGrids();
 }
 
 ConfigNode NavmeshSet::toConfigNode() const
@@ -25,6 +27,7 @@ ConfigNode NavmeshSet::toConfigNode() const
 void NavmeshSet::add(Navmesh navmesh)
 {
 	navmeshes.push_back(std::move(navmesh));
+	addToRegionGrid(navmeshes.size() - 1);
 }
 
 void NavmeshSet::addChunk(NavmeshSet navmeshSet, Vector2f origin, Vector2i gridPosition)
@@ -38,18 +41,22 @@ void NavmeshSet::addChunk(NavmeshSet navmeshSet, Vector2f origin, Vector2i gridP
 void NavmeshSet::addRaw(NavmeshSet navmeshSet)
 {
 	for (auto& navmesh: navmeshSet.navmeshes) {
-		navmeshes.push_back(std::move(navmesh));
+		add(std::move(navmesh));
 	}
 }
 
 void NavmeshSet::clear()
 {
 	navmeshes.clear();
+	regionDistanceCache.clear();
+	rebuildRegionGrids();
 }
 
 void NavmeshSet::clearSubWorld(int subWorld)
 {
 	navmeshes.erase(std::remove_if(navmeshes.begin(), navmeshes.end(), [&] (const Navmesh& nav) { return nav.getSubWorld() == subWorld; }), navmeshes.end());
+	regionDistanceCache.clear();
+	rebuildRegionGrids(); // Indices have shifted
 }
 
 std::optional<NavigationPath> NavmeshSet::pathfind(const NavigationQuery& query) const
@@ -66,7 +73,7 @@ std::optional<NavigationPath> NavmeshSet::pathfind(const NavigationQuery& query)
 		return pathfindInRegion(query, fromRegion);
 	} else {
 		// Gotta path between regions first
-		auto regionPath = findRegionPath(query.from, query.to, fromRegion, toRegion);
+		auto regionPath = findRegionPath(query.from, static_cast<uint16_t>(fromRegion), static_cast<uint16_t>(toRegion));
 		if (regionPath.size() <= 1) {
 			// Failed
 			return {};
@@ -81,35 +88,92 @@ std::optional<NavigationPath> NavmeshSet::pathfindInRegion(const NavigationQuery
 	return navmeshes[regionId].pathfind(query);
 }
 
+std::vector<std::optional<NavigationPath>> NavmeshSet::pathfindBatch(gsl::span<const NavigationQuery> queries) const
+{
+	std::vector<std::optional<NavigationPath>> result(queries.size());
+	Concurrent::parallelFor(0, queries.size(), [&] (size_t i)
+	{
+		result[i] = pathfind(queries[i]);
+	}, 8);
+	return result;
+}
+
 const Navmesh* NavmeshSet::getNavMeshAt(Vector2f pos, int subWorld) const
 {
-	for (const auto& navmesh: navmeshes) {
-		if (navmesh.getSubWorld() == subWorld && navmesh.containsPoint(pos)) {
-			return &navmesh;
-		}
-	}
-	
-	return nullptr;
+	const size_t idx = getNavMeshIdxAt(pos, subWorld);
+	return idx != std::numeric_limits<size_t>::max() ? &navmeshes[idx] : nullptr;
 }
 
 size_t NavmeshSet::getNavMeshIdxAt(Vector2f pos, int subWorld) const
 {
-	size_t i = 0;
-	for (const auto& navmesh: navmeshes) {
-		if (navmesh.getSubWorld() == subWorld && navmesh.containsPoint(pos)) {
+	// Candidates are in ascending order, so overlaps resolve the same way as a linear search would
+	for (const auto i: getRegionsNear(pos, subWorld)) {
+		if (navmeshes[i].containsPoint(pos)) {
 			return i;
 		}
-		i++;
 	}
 	
 	return std::numeric_limits<size_t>::max();
 }
 
+void NavmeshSet::rebuildRegionGrids()
+{
+	// Cells are about as big as the largest navmesh (usually a whole chunk), so each one only lands in a few cells
+	regionGrids.clear();
+	regionGridCellSize = 1.0f;
+	for (const auto& navmesh: navmeshes) {
+		const auto size = navmesh.getBoundingBox().getSize();
+		regionGridCellSize = std::max(regionGridCellSize, std::max(size.x, size.y));
+	}
+
+	for (size_t i = 0; i < navmeshes.size(); ++i) {
+		insertIntoRegionGrid(i);
+	}
+}
+
+void NavmeshSet::addToRegionGrid(size_t idx)
+{
+	const auto size = navmeshes[idx].getBoundingBox().getSize();
+	if (regionGridCellSize <= 0 || std::max(size.x, size.y) > regionGridCellSize * 2) {
+		rebuildRegionGrids();
+	} else {
+		insertIntoRegionGrid(idx);
+	}
+}
+
+void NavmeshSet::insertIntoRegionGrid(size_t idx)
+{
+	const auto& navmesh = navmeshes[idx];
+	const auto box = navmesh.getBoundingBox();
+	auto& grid = regionGrids[navmesh.getSubWorld()];
+	const auto p1 = Vector2i((box.getTopLeft() / regionGridCellSize).floor());
+	const auto p2 = Vector2i((box.getBottomRight() / regionGridCellSize).floor());
+	for (int y = p1.y; y <= p2.y; ++y) {
+		for (int x = p1.x; x <= p2.x; ++x) {
+			grid[Vector2i(x, y)].push_back(static_cast<uint16_t>(idx));
+		}
+	}
+}
+
+gsl::span<const uint16_t> NavmeshSet::getRegionsNear(Vector2f pos, int subWorld) const
+{
+	const auto gridIter = regionGrids.find(subWorld);
+	if (gridIter == regionGrids.end()) {
+		return {};
+	}
+	const auto cellIter = gridIter->second.find(Vector2i((pos / regionGridCellSize).floor()));
+	if (cellIter == gridIter->second.end()) {
+		return {};
+	}
+	return cellIter->second;
+}
+
 void NavmeshSet::linkNavmeshes()
 {
 	regionNodes.clear();
 	regionNodes.resize(navmeshes.size());
 	portalNodes.clear();
+	regionDistanceCache.clear();
 
 	for (auto& navmesh: navmeshes) {
 		navmesh.markPortalsDisconnected();
@@ -140,6 +204,13 @@ void NavmeshSet::linkNavmeshes()
 			}
 		}
 	}
+
+	// Reverse the graph, for searching backwards from a destination
+	for (size_t curPortalId = 0; curPortalId < portalNodes.size(); ++curPortalId) {
+		for (const auto& conn: portalNodes[curPortalId].connections) {
+			portalNodes[conn.portalId].incomingConnections.emplace_back(static_cast<uint16_t>(curPortalId), conn.regionId, conn.cost);
+		}
+	}
 }
 
 void NavmeshSet::reportUnlinkedPortals() const
@@ -224,7 +295,7 @@ void NavmeshSet::tryLinkNavMeshes(size_t idxA, size_t idxB)
 	}
 }
 
-std::vector<NavmeshSet::NodeAndConn> NavmeshSet::findRegionPath(Vector2f startPos, Vector2f endPos, NodeId fromRegionId, NodeId toRegionId) const
+std::vector<NavmeshSet::NodeAndConn> NavmeshSet::findRegionPath(Vector2f startPos, NodeId fromRegionId, NodeId toRegionId) const
 {
 	// Ensure the query is valid
 	if (fromRegionId >= static_cast<int>(regionNodes.size()) || toRegionId >= static_cast<int>(regionNodes.size())) {
@@ -232,85 +303,124 @@ std::vector<NavmeshSet::NodeAndConn> NavmeshSet::findRegionPath(Vector2f startPo
 		return {};
 	}
 
-	// State map. Using vector for perf, trading space for CPU.
-	// TODO: measure this vs unordered_map or some other hashtable, it's not impossible that it'd perform better (compact memory)
-	std::vector<State> state(portalNodes.size(), State{});
+	const auto distances = getRegionDistances(toRegionId);
+
+	// Leave through whichever portal has the shortest route from here
+	constexpr auto none = std::numeric_limits<NodeId>::max();
+	NodeId bestPortal = none;
+	float bestCost = std::numeric_limits<float>::infinity();
+	for (const auto portalId: regionNodes[fromRegionId].portals) {
+		const float cost = (portalNodes[portalId].pos - startPos).length() + distances->distance[portalId];
+		if (cost < bestCost) {
+			bestCost = cost;
+			bestPortal = portalId;
+		}
+	}
+	if (bestPortal == none) {
+		return {};
+	}
 
-	// Open set
-	auto openSet = PriorityQueue<NodeId, NodeComparator>(NodeComparator(state));
-	openSet.reserve(std::min(static_cast<size_t>(100), portalNodes.size()));
+	std::vector<NodeAndConn> result;
+	for (NodeId i = bestPortal; true; i = distances->next[i]) {
+		const auto& nodeData = portalNodes[i];
+		result.push_back(NodeAndConn(nodeData.fromRegion, nodeData.fromPortal));
+		if (nodeData.toRegion == toRegionId) {
+			result.push_back(NodeAndConn(toRegionId));
+			break;
+		}
+	}
+	return result;
+}
 
-	// Define heuristic function
-	auto h = [&] (Vector2f pos) -> float
-	{
-		return (pos - endPos).length();
-	};
+std::shared_ptr<const NavmeshSet::RegionDistances> NavmeshSet::getRegionDistances(NodeId toRegionId) const
+{
+	if (auto cached = regionDistanceCache.get(toRegionId)) {
+		return cached;
+	}
 
-	// Initialize the query
-	{
-		const auto& startRegion = regionNodes[fromRegionId];
-		for (const auto portalId : startRegion.portals) {
-			auto& nodeState = state[portalId];
-			const auto pos = portalNodes[portalId].pos;
-			nodeState.cameFrom = std::numeric_limits<uint16_t>::max();
-			nodeState.gScore = (pos - startPos).length();
-			nodeState.fScore = h(pos);
-			nodeState.inOpenSet = true;
-			openSet.push(portalId);
-		}
+	// Dijkstra backwards from every portal leading into the region.
+	// Portal nodes are created in pairs, so the way into the region is the pair of each way out of it.
+	auto& context = NavigationSearchContext::getThreadLocal();
+	context.beginSearch(portalNodes.size());
+	auto& openSet = context.getOpenSet();
+
+	for (const auto exitPortalId: regionNodes[toRegionId].portals) {
+		const auto portalId = static_cast<NodeId>(exitPortalId ^ 1);
+		assert(portalNodes[portalId].toRegion == toRegionId);
+		auto& state = context.getState(portalId);
+		state.gScore = 0;
+		state.fScore = 0;
+		state.inOpenSet = true;
+		openSet.push(portalId);
 	}
 
-	// Run A*
 	while (!openSet.empty()) {
 		const auto curId = openSet.top();
-		const auto& curNode = portalNodes[curId];
-		if (curNode.toRegion == toRegionId) {
-			// A* is done! Generate result and return it
-			std::vector<NodeAndConn> result;
-			uint16_t portal = std::numeric_limits<uint16_t>::max();
-			for (uint16_t i = curId; true;) {
-				const auto& nodeData = portalNodes[i];
-				result.push_back(NodeAndConn(nodeData.toRegion, portal));
-				portal = nodeData.fromPortal;
-				
-				i = state[i].cameFrom;
-				if (i == std::numeric_limits<uint16_t>::max()) {
-					result.push_back(NodeAndConn(fromRegionId, portal));
-					break;
-				}
-			}
-			std::reverse(result.begin(), result.end());
-			return result;
-		}
-
-		// Process current node
-		state[curId].inOpenSet = false;
-		state[curId].inClosedSet = true;
+		auto& curState = context.getState(curId);
+		curState.inOpenSet = false;
+		curState.inClosedSet = true;
 		openSet.pop();
 
-		// Process neighbours
-		const float gScore = state[curId].gScore;
-		for (size_t i = 0; i < curNode.connections.size(); ++i) {
-			const auto nodeId = curNode.connections[i].portalId;
-			if (!state[nodeId].inClosedSet) {
-				auto& neighState = state[nodeId];
-				const float neighScore = gScore + curNode.connections[i].cost;
-
-				// This neighbour needs updating
+		const float gScore = curState.gScore;
+		for (const auto& conn: portalNodes[curId].incomingConnections) {
+			auto& neighState = context.getState(conn.portalId);
+			if (!neighState.inClosedSet) {
+				const float neighScore = gScore + conn.cost;
 				if (neighScore < neighState.gScore) {
 					neighState.cameFrom = curId;
 					neighState.gScore = neighScore;
-					neighState.fScore = neighScore + h(portalNodes[nodeId].pos);
+					neighState.fScore = neighScore;
 					if (!neighState.inOpenSet) {
 						neighState.inOpenSet = true;
-						openSet.push(nodeId);
+						openSet.push(conn.portalId);
 					} else {
-						openSet.update(nodeId);
+						openSet.update(conn.portalId);
 					}
 				}
 			}
 		}
 	}
-	
-	return {};
+
+	auto result = std::make_shared<RegionDistances>();
+	result->distance.resize(portalNodes.size(), std::numeric_limits<float>::infinity());
+	result->next.resize(portalNodes.size(), std::numeric_limits<NodeId>::max());
+	for (size_t i = 0; i < portalNodes.size(); ++i) {
+		if (const auto* state = context.tryGetState(static_cast<NodeId>(i))) {
+			result->distance[i] = state->gScore;
+			result->next[i] = state->cameFrom;
+		}
+	}
+
+	// Another thread might have got here first, but the result would be the same
+	regionDistanceCache.set(toRegionId, result);
+	return result;
+}
+
+NavmeshSet::RegionDistanceCache::RegionDistanceCache(const RegionDistanceCache& other)
+{
+}
+
+NavmeshSet::RegionDistanceCache& NavmeshSet::RegionDistanceCache::operator=(const RegionDistanceCache& other)
+{
+	clear();
+	return *this;
+}
+
+std::shared_ptr<const NavmeshSet::RegionDistances> NavmeshSet::RegionDistanceCache::get(NodeId region) const
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	const auto iter = entries.find(region);
+	return iter != entries.end() ? iter->second : std::shared_ptr<const RegionDistances>();
+}
+
+void NavmeshSet::RegionDistanceCache::set(NodeId region, std::shared_ptr<const RegionDistances> distances)
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	entries[region] = std::move(distances);
+}
+
+void NavmeshSet::RegionDistanceCache::clear()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	entries.clear();
 }
@@ -33,6 +33,13 @@ ResourceDataStatic::ResourceDataStatic(const void* _data, size_t _size, String p
 	set(_data, _size, owning);
 }
 
+ResourceDataStatic::ResourceDataStatic(std::shared_ptr<const char> _data, size_t _size, String path)
+	: ResourceData(path)
+	, loaded(false)
+{
+	set(std::move(_data), _size);
+}
+
 static void deleter(const char* data)
 {
 	delete[] data;
@@ -49,6 +56,13 @@ void ResourceDataStatic::set(const void* _data, size_t _size, bool owning)
 	loaded = true;
 }
 
+void ResourceDataStatic::set(std::shared_ptr<const char> _data, size_t _size)
+{
+	data = std::move(_data);
+	size = _size;
+	loaded = true;
+}
+
 const void* ResourceDataStatic::getData() const
 {
 	if (!loaded) throw Exception("Resource data not yet loaded", HalleyExceptions::Resources);
@@ -155,6 +169,7 @@ std::unique_ptr<ResourceDataStatic> ResourceLoader::getStatic(bool throwOnFail)
 			}
 		}
 		loaded = true;
+		dataSize += result->getSize();
 	}
 	return result;
 }
@@ -1,6 +1,7 @@
 #include "dx11_texture.h"
 #include "dx11_video.h"
 #include "halley/core/graphics/texture_descriptor.h"
+#include "halley/file_formats/texture_container.h"
 using namespace Halley;
 
 DX11Texture::DX11Texture(DX11Video& video, Vector2i size)
@@ -65,7 +66,8 @@ void DX11Texture::doLoad(TextureDescriptor& descriptor)
 	CD3D11_TEXTURE2D_DESC desc;
 	desc.Width = size.x;
 	desc.Height = size.y;
-	desc.MipLevels = desc.ArraySize = 1;
+	desc.MipLevels = UINT(std::max(1, descriptor.mipLevels));
+	desc.ArraySize = 1;
 
 	switch (descriptor.format) {
 	case TextureFormat::Indexed:
@@ -104,7 +106,7 @@ void DX11Texture::doLoad(TextureDescriptor& descriptor)
 	format = desc.Format;
 
 	D3D11_SUBRESOURCE_DATA* res = nullptr;
-	D3D11_SUBRESOURCE_DATA subResData;
+	Vector<D3D11_SUBRESOURCE_DATA> subResData(desc.MipLevels);
 
 	if (descriptor.pixelData.empty()) {
 		desc.Usage = D3D11_USAGE_DEFAULT;
@@ -116,10 +118,20 @@ void DX11Texture::doLoad(TextureDescriptor& descriptor)
 			desc.Usage = D3D11_USAGE_IMMUTABLE;
 		}
 		desc.CPUAccessFlags = 0;
-		subResData.pSysMem = descriptor.pixelData.getSpan().data();
-		subResData.SysMemPitch = descriptor.pixelData.getStrideOr(bpp * size.x);
-		subResData.SysMemSlicePitch = subResData.SysMemPitch;
-		res = &subResData;
+		subResData[0].pSysMem = descriptor.pixelData.getSpan().data();
+		subResData[0].SysMemPitch = descriptor.pixelData.getStrideOr(bpp * size.x);
+		subResData[0].SysMemSlicePitch = subResData[0].SysMemPitch;
+
+		// Precomputed mip levels follow the base level
+		size_t offset = size_t(size.x * size.y * bpp);
+		for (UINT level = 1; level < desc.MipLevels; ++level) {
+			const auto levelSize = TextureContainer::getMipLevelSize(size, int(level));
+			subResData[level].pSysMem = descriptor.pixelData.getSpan().data() + offset;
+			subResData[level].SysMemPitch = UINT(bpp * levelSize.x);
+			subResData[level].SysMemSlicePitch = subResData[level].SysMemPitch;
+			offset += size_t(levelSize.x * levelSize.y * bpp);
+		}
+		res = subResData.data();
 	}
 
 	HRESULT result = video.getDevice().CreateTexture2D(&desc, res, &texture);
@@ -131,7 +143,7 @@ void DX11Texture::doLoad(TextureDescriptor& descriptor)
 		CD3D11_SHADER_RESOURCE_VIEW_DESC srvDesc;
 		srvDesc.Format = desc.Format;
 		srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
-		srvDesc.Texture2D.MipLevels = 1;
+		srvDesc.Texture2D.MipLevels = desc.MipLevels;
 		srvDesc.Texture2D.MostDetailedMip = 0;
 
 		result = video.getDevice().CreateShaderResourceView(texture, &srvDesc, &srv);
@@ -8,6 +8,10 @@
 
 using namespace Halley;
 
+#if defined(WITH_OPENGL) || defined(WITH_OPENGL_ES3)
+#define HAS_INSTANCING
+#endif
+
 PainterOpenGL::PainterOpenGL(Resources& resources)
 	: Painter(resources)
 {}
@@ -38,6 +42,7 @@ void PainterOpenGL::doStartRender()
 	vertexBuffer.init(GL_ARRAY_BUFFER);
 	elementBuffer.init(GL_ELEMENT_ARRAY_BUFFER);
 	stdQuadElementBuffer.init(GL_ELEMENT_ARRAY_BUFFER, GL_STATIC_DRAW);
+	cornerBuffer.init(GL_ARRAY_BUFFER, GL_STATIC_DRAW);
 
 #ifdef WITH_OPENGL
 	if (vao == 0) {
@@ -159,14 +164,7 @@ void PainterOpenGL::setVertices(const MaterialDefinition& material, size_t numVe
 
 	// Load indices into VBO
 	if (standardQuadsOnly) {
-		if (stdQuadElementBuffer.getSize() < numIndices * sizeof(unsigned short)) {
-			size_t indicesToAllocate = nextPowerOf2(numIndices);
-			std::vector<unsigned short> tmp(indicesToAllocate);
-			generateQuadIndices(0, indicesToAllocate / 6, tmp.data());
-			stdQuadElementBuffer.setData(gsl::as_bytes(gsl::span<unsigned short>(tmp)));
-		} else {
-			stdQuadElementBuffer.bind();
-		}
+		bindStandardQuadIndices(numIndices);
 	} else {
 		elementBuffer.setData(gsl::as_bytes(gsl::span<unsigned short>(indices, numIndices)));
 	}
@@ -176,10 +174,53 @@ void PainterOpenGL::setVertices(const MaterialDefinition& material, size_t numVe
 	vertexBuffer.setData(gsl::as_bytes(gsl::span<char>(static_cast<char*>(vertexData), bytesSize)));
 
 	// Set attributes
-	setupVertexAttributes(material);
+	setupVertexAttributes(material, false);
+}
+
+void PainterOpenGL::bindStandardQuadIndices(size_t numIndices)
+{
+	if (stdQuadElementBuffer.getSize() < numIndices * sizeof(unsigned short)) {
+		size_t indicesToAllocate = nextPowerOf2(numIndices);
+		std::vector<unsigned short> tmp(indicesToAllocate);
+		generateQuadIndices(0, indicesToAllocate / 6, tmp.data());
+		stdQuadElementBuffer.setData(gsl::as_bytes(gsl::span<unsigned short>(tmp)));
+	} else {
+		stdQuadElementBuffer.bind();
+	}
+}
+
+bool PainterOpenGL::supportsInstancing() const
+{
+#ifdef HAS_INSTANCING
+	return true;
+#else
+	return false;
+#endif
 }
 
-void PainterOpenGL::setupVertexAttributes(const MaterialDefinition& material)
+void PainterOpenGL::setInstances(const MaterialDefinition& material, size_t numInstances, void* instanceData)
+{
+	Expects(numInstances > 0);
+	Expects(instanceData);
+
+	// Every instance is one quad
+	bindStandardQuadIndices(6);
+
+	// The corners are shared by all instances
+	if (cornerBuffer.getSize() == 0) {
+		const float corners[16] = { 0, 0, 0, 0, 1, 0, 1, 0, 1, 1, 1, 1, 0, 1, 0, 1 };
+		cornerBuffer.setData(gsl::as_bytes(gsl::span<const float>(corners)));
+	}
+
+	// Load instances into VBO
+	size_t bytesSize = numInstances * material.getVertexStride();
+	vertexBuffer.setData(gsl::as_bytes(gsl::span<char>(static_cast<char*>(instanceData), bytesSize)));
+
+	// Set attributes
+	setupVertexAttributes(material, true);
+}
+
+void PainterOpenGL::setupVertexAttributes(const MaterialDefinition& material, bool instanced)
 {
 	// Set vertex attribute pointers in VBO
 	size_t vertexStride = material.getVertexStride();
@@ -224,7 +265,17 @@ void PainterOpenGL::setupVertexAttributes(const MaterialDefinition& material)
 		}
 		glEnableVertexAttribArray(attribute.location);
 		size_t offset = attribute.offset;
-		glVertexAttribPointer(attribute.location, count, type, GL_FALSE, GLsizei(vertexStride), reinterpret_cast<GLvoid*>(offset));
+		if (instanced && offset == material.getVertexPosOffset()) {
+			// vertPos comes from the corner stream, everything else advances per instance
+			cornerBuffer.bind();
+			glVertexAttribPointer(attribute.location, count, type, GL_FALSE, 0, nullptr);
+			vertexBuffer.bind();
+		} else {
+			glVertexAttribPointer(attribute.location, count, type, GL_FALSE, GLsizei(vertexStride), reinterpret_cast<GLvoid*>(offset));
+		}
+#ifdef HAS_INSTANCING
+		glVertexAttribDivisor(attribute.location, instanced && offset != material.getVertexPosOffset() ? 1 : 0);
+#endif
 		glCheckError();
 	}
 
@@ -239,3 +290,15 @@ void PainterOpenGL::drawTriangles(size_t numIndices)
 	glDrawElements(GL_TRIANGLES, int(numIndices), GL_UNSIGNED_SHORT, nullptr);
 	glCheckError();
 }
+
+void PainterOpenGL::drawInstancedQuads(size_t numInstances)
+{
+	Expects(numInstances > 0);
+
+#ifdef HAS_INSTANCING
+	glDrawElementsInstanced(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, nullptr, GLsizei(numInstances));
+	glCheckError();
+#else
+	Painter::drawInstancedQuads(numInstances);
+#endif
+}
@@ -27,6 +27,9 @@ namespace Halley
 	protected:
 		void setVertices(const MaterialDefinition& material, size_t numVertices, void* vertexData, size_t numIndices, unsigned short* indices, bool standardQuadsOnly) override;
 		void drawTriangles(size_t numIndices) override;
+		bool supportsInstancing() const override;
+		void setInstances(const MaterialDefinition& material, size_t numInstances, void* instanceData) override;
+		void drawInstancedQuads(size_t numInstances) override;
 		void setViewPort(Rect4i rect) override;
 		void onUpdateProjection(Material& material) override;
 
@@ -37,8 +40,10 @@ namespace Halley
 		GLBuffer vertexBuffer;
 		GLBuffer elementBuffer;
 		GLBuffer stdQuadElementBuffer;
+		GLBuffer cornerBuffer;
 		std::unique_ptr<GLUtils> glUtils;
 
-		void setupVertexAttributes(const MaterialDefinition& material);
+		void bindStandardQuadIndices(size_t numIndices);
+		void setupVertexAttributes(const MaterialDefinition& material, bool instanced);
 	};
 }
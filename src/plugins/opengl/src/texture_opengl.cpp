@@ -3,6 +3,7 @@
 #include "halley_gl.h"
 #include "texture_opengl.h"
 #include "halley/core/graphics/texture_descriptor.h"
+#include "halley/file_formats/texture_container.h"
 #include <gsl/gsl_assert>
 #include "video_opengl.h"
 #include "halley/support/logger.h"
@@ -46,9 +47,9 @@ void TextureOpenGL::doLoad(TextureDescriptor& d)
 	glUtils.bindTexture(textureId);
 	
 	if (texSize != d.size) {
-		create(d.size, d.format, d.useMipMap, d.useFiltering, d.addressMode, d.pixelData);
+		create(d.size, d.format, d.useMipMap, d.mipLevels, d.useFiltering, d.addressMode, d.pixelData);
 	} else if (!d.pixelData.empty()) {
-		updateImage(d.pixelData, d.format, d.useMipMap);
+		updateImage(d.pixelData, d.format, d.useMipMap, d.mipLevels);
 	}
 	finishLoading();
 }
@@ -106,7 +107,7 @@ void TextureOpenGL::bind(int textureUnit) const
 	glUtils.bindTexture(textureId);
 }
 
-void TextureOpenGL::create(Vector2i size, TextureFormat format, bool useMipMap, bool useFiltering, TextureAddressMode addressMode, TextureDescriptorImageData& pixelData)
+void TextureOpenGL::create(Vector2i size, TextureFormat format, bool useMipMap, int mipLevels, bool useFiltering, TextureAddressMode addressMode, TextureDescriptorImageData& pixelData)
 {
 	Expects(size.x > 0);
 	Expects(size.y > 0);
@@ -149,13 +150,29 @@ void TextureOpenGL::create(Vector2i size, TextureFormat format, bool useMipMap,
 		glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, size.x, size.y, 0, pixelFormat, GL_UNSIGNED_BYTE, blank.data());
 	} else {
 		glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, size.x, size.y, 0, pixelFormat, GL_UNSIGNED_BYTE, pixelData.getBytes());
+
+		// Precomputed mip levels follow the base level
+		const int bpp = TextureDescriptor::getBitsPerPixel(format);
+		size_t offset = size_t(size.x * size.y * bpp);
+		for (int level = 1; level < mipLevels; ++level) {
+			const auto levelSize = TextureContainer::getMipLevelSize(size, level);
+			glTexImage2D(GL_TEXTURE_2D, level, internalFormat, levelSize.x, levelSize.y, 0, pixelFormat, GL_UNSIGNED_BYTE, pixelData.getBytes() + offset);
+			offset += size_t(levelSize.x * levelSize.y * bpp);
+		}
 	}
 	glCheckError();
 
+#if defined (WITH_OPENGL) || defined(WITH_OPENGL_ES3)
+	if (useMipMap && mipLevels == 1 && !pixelData.empty()) {
+		glGenerateMipmap(GL_TEXTURE_2D);
+		glCheckError();
+	}
+#endif
+
 	texSize = size;
 }
 
-void TextureOpenGL::updateImage(TextureDescriptorImageData& pixelData, TextureFormat format, bool useMipMap)
+void TextureOpenGL::updateImage(TextureDescriptorImageData& pixelData, TextureFormat format, bool useMipMap, int mipLevels)
 {
 	int stride = pixelData.getStrideOr(size.x);
 
@@ -164,11 +181,21 @@ void TextureOpenGL::updateImage(TextureDescriptorImageData& pixelData, TextureFo
 	glPixelStorei(GL_PACK_ROW_LENGTH, stride);
 #endif
 	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, size.x, size.y, getGLPixelFormat(format), GL_UNSIGNED_BYTE, pixelData.getBytes());
+
+	// Precomputed mip levels follow the base level. The texture may have been created with a different number of them, so they're respecified.
+	const GLuint internalFormat = getGLInternalFormat(format);
+	const int bpp = TextureDescriptor::getBitsPerPixel(format);
+	size_t offset = size_t(size.x * size.y * bpp);
+	for (int level = 1; level < mipLevels; ++level) {
+		const auto levelSize = TextureContainer::getMipLevelSize(size, level);
+		glTexImage2D(GL_TEXTURE_2D, level, internalFormat, levelSize.x, levelSize.y, 0, getGLPixelFormat(format), GL_UNSIGNED_BYTE, pixelData.getBytes() + offset);
+		offset += size_t(levelSize.x * levelSize.y * bpp);
+	}
 	glCheckError();
 
 #if defined (WITH_OPENGL) || defined(WITH_OPENGL_ES3)
-	// Generate mipmap
-	if (useMipMap) {
+	// Generate mipmap, unless they were precomputed
+	if (useMipMap && mipLevels == 1) {
 		glGenerateMipmap(GL_TEXTURE_2D);
 		glCheckError();
 	}
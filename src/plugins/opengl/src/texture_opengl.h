@@ -24,8 +24,8 @@ namespace Halley
 		void reload(Resource&& resource) override;
 
 	private:
-		void updateImage(TextureDescriptorImageData& pixelData, TextureFormat format, bool useMipMap);
-		void create(Vector2i size, TextureFormat format, bool useMipMap, bool useFiltering, TextureAddressMode addressMode, TextureDescriptorImageData& imgData);
+		void updateImage(TextureDescriptorImageData& pixelData, TextureFormat format, bool useMipMap, int mipLevels);
+		void create(Vector2i size, TextureFormat format, bool useMipMap, int mipLevels, bool useFiltering, TextureAddressMode addressMode, TextureDescriptorImageData& imgData);
 
 		static unsigned int getGLInternalFormat(TextureFormat format);
 		static unsigned int getGLPixelFormat(TextureFormat format);
@@ -7,6 +7,7 @@
 #include "sdl_rw_ops.h"
 #include "halley/core/graphics/window.h"
 #include "halley/os/os.h"
+#include "halley/file/mapped_file.h"
 #include "sdl_window.h"
 #include "sdl_gl_context.h"
 #include "input_sdl.h"
@@ -168,6 +169,15 @@ std::unique_ptr<ResourceDataReader> SystemSDL::getDataReader(String path, int64_
 	return SDLRWOps::fromPath(path, start, end);
 }
 
+std::shared_ptr<const MappedFile> SystemSDL::getMappedFile(String path)
+{
+	auto file = std::make_shared<MappedFile>();
+	if (file->open(Path(path))) {
+		return file;
+	}
+	return {};
+}
+
 std::shared_ptr<Window> SystemSDL::createWindow(const WindowDefinition& windowDef)
 {
 	initVideo();
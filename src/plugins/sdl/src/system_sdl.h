@@ -25,6 +25,7 @@ namespace Halley
 		bool generateEvents(VideoAPI* video, InputAPI* input) override;
 
 		std::unique_ptr<ResourceDataReader> getDataReader(String path, int64_t start, int64_t end) override;
+		std::shared_ptr<const MappedFile> getMappedFile(String path) override;
 
 		std::shared_ptr<Window> createWindow(const WindowDefinition& window) override;
 		void destroyWindow(std::shared_ptr<Window> window) override;
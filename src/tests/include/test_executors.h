@@ -0,0 +1,49 @@
+#pragma once
+#include <halley.hpp>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace Halley {
+	// Installs a fresh set of executors for the duration of a test, with a thread pool on each queue that asks for one
+	class TestExecutors {
+	public:
+		TestExecutors(size_t nCPUThreads, size_t nCPUAuxThreads = 0, size_t nDiskIOThreads = 0)
+		{
+			addPool("Test", Executors::getCPU(), nCPUThreads);
+			addPool("TestAux", Executors::getCPUAux(), nCPUAuxThreads);
+			addPool("TestIO", Executors::getDiskIO(), nDiskIOThreads);
+		}
+
+	private:
+		struct ExecutorsInstance {
+			ExecutorsInstance() { Executors::setInstance(executors); }
+			Executors executors;
+		};
+
+		ExecutorsInstance executors;
+		std::vector<std::unique_ptr<ThreadPool>> pools;
+
+		void addPool(const String& name, ExecutionQueue& queue, size_t nThreads)
+		{
+			if (nThreads > 0) {
+				pools.push_back(std::make_unique<ThreadPool>(name, queue, nThreads, [] (String name, std::function<void()> f) { return std::thread(f); }));
+			}
+		}
+	};
+
+	// Runs a thread pool on a queue of its own, without touching the global executors
+	template <typename Queue = ExecutionQueue>
+	class TestQueue {
+	public:
+		TestQueue(size_t nThreads)
+			: pool("Test", queue, nThreads, [] (String name, std::function<void()> f) { return std::thread(f); })
+		{}
+
+		Queue& operator*() { return queue; }
+
+	private:
+		Queue queue;
+		ThreadPool pool;
+	};
+}
@@ -0,0 +1,206 @@
+#include <gtest/gtest.h>
+#include <halley.hpp>
+#include <fstream>
+using namespace Halley;
+
+namespace {
+	class BytesReader final : public ResourceDataReader {
+	public:
+		BytesReader(Bytes bytes) : bytes(std::move(bytes)) {}
+
+		size_t size() const override { return bytes.size(); }
+		void seek(int64_t p, int whence) override { pos = size_t(whence == SEEK_SET ? p : whence == SEEK_CUR ? int64_t(pos) + p : int64_t(bytes.size()) + p); }
+		size_t tell() const override { return pos; }
+		void close() override {}
+
+		int read(gsl::span<gsl::byte> dst) override
+		{
+			const size_t n = std::min(size_t(dst.size()), bytes.size() - pos);
+			memcpy(dst.data(), bytes.data() + pos, n);
+			pos += n;
+			return int(n);
+		}
+
+	private:
+		Bytes bytes;
+		size_t pos = 0;
+	};
+
+	String getAssetName(size_t i)
+	{
+		return "asset_" + toString(i);
+	}
+
+	// Writes a pack with nAssets binary files to disk, asset i is filled with the value i
+	Bytes writeTestPack(const Path& path, size_t nAssets, size_t assetSize)
+	{
+		AssetPack pack;
+		auto& data = pack.getData();
+		for (size_t i = 0; i < nAssets; ++i) {
+			const size_t size = assetSize + i % 7;
+			pack.getAssetDatabase().addAsset(getAssetName(i), AssetType::BinaryFile, AssetDatabase::Entry(toString(data.size()) + ":" + toString(size), Metadata()));
+			data.resize(data.size() + size, Byte(i));
+		}
+
+		// Not using Path::writeFile, as that needs an OS instance
+		auto bytes = pack.writeOut();
+		std::ofstream fp(path.string(), std::ios::binary | std::ios::out);
+		fp.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+		return bytes;
+	}
+
+	// Same contents as writeTestPack, but as a v2 pack, with compressible assets
+	Bytes writeTestPackV2(const Path& path, size_t nAssets, size_t assetSize, const String& encryptionKey)
+	{
+		AssetPack pack;
+		Random rng(1234);
+		for (size_t i = 0; i < nAssets; ++i) {
+			Bytes asset(assetSize + i % 7, Byte(i));
+			std::array<char, 16> iv;
+			rng.getBytes(gsl::as_writable_bytes(gsl::span<char>(iv)));
+			pack.addAsset(getAssetName(i), AssetType::BinaryFile, AssetPack::encodeAsset(gsl::as_bytes(gsl::span<const Byte>(asset)), true, encryptionKey, iv), Metadata());
+		}
+		EXPECT_EQ(pack.getVersion(), 2);
+		EXPECT_LT(pack.getData().size(), nAssets * assetSize / 2);
+
+		auto bytes = pack.writeOut();
+		std::ofstream fp(path.string(), std::ios::binary | std::ios::out);
+		fp.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+		return bytes;
+	}
+
+	std::shared_ptr<const MappedFile> mapTestPack(const Path& path)
+	{
+		auto file = std::make_shared<MappedFile>();
+		EXPECT_TRUE(file->open(path));
+		return file;
+	}
+
+	void checkAsset(AssetPack& pack, size_t i, size_t assetSize)
+	{
+		auto data = pack.getData(getAssetName(i), AssetType::BinaryFile, false);
+		auto& staticData = dynamic_cast<ResourceDataStatic&>(*data);
+		const auto span = staticData.getSpan();
+		ASSERT_EQ(size_t(span.size()), assetSize + i % 7);
+		EXPECT_TRUE(std::all_of(span.begin(), span.end(), [&] (gsl::byte b) { return b == gsl::byte(i); }));
+	}
+}
+
+TEST(HalleyAssetPack, MappedMatchesReader)
+{
+	const Path path = "asset_pack_test.dat";
+	constexpr size_t nAssets = 100;
+	constexpr size_t assetSize = 50;
+	auto bytes = writeTestPack(path, nAssets, assetSize);
+
+	AssetPack readerPack(std::make_unique<BytesReader>(std::move(bytes)));
+	auto mappedPack = std::make_unique<AssetPack>(mapTestPack(path));
+	EXPECT_FALSE(readerPack.isMapped());
+	EXPECT_TRUE(mappedPack->isMapped());
+
+	for (size_t i = 0; i < nAssets; ++i) {
+		checkAsset(readerPack, i, assetSize);
+		checkAsset(*mappedPack, i, assetSize);
+	}
+
+	// Streams read from the mapping too
+	auto stream = mappedPack->getData(getAssetName(42), AssetType::BinaryFile, true);
+	auto reader = dynamic_cast<ResourceDataStream&>(*stream).getReader();
+	reader->seek(10, SEEK_SET);
+	std::array<gsl::byte, 16> buffer;
+	EXPECT_EQ(reader->read(buffer), 16);
+	EXPECT_EQ(buffer[15], gsl::byte(42));
+
+	// Data handed out keeps the mapping alive after the pack is gone
+	auto data = mappedPack->getData(getAssetName(7), AssetType::BinaryFile, false);
+	mappedPack.reset();
+	EXPECT_EQ(dynamic_cast<ResourceDataStatic&>(*data).getSpan()[0], gsl::byte(7));
+	data.reset();
+
+	Path::removeFile(path);
+}
+
+TEST(HalleyAssetPack, CompressedAndEncryptedAssets)
+{
+	const Path path = "asset_pack_v2_test.dat";
+	const String key = "0123456789abcdef";
+	constexpr size_t nAssets = 50;
+	constexpr size_t assetSize = 500;
+	auto bytes = writeTestPackV2(path, nAssets, assetSize, key);
+
+	{
+		AssetPack readerPack(std::make_unique<BytesReader>(bytes), key);
+		AssetPack mappedPack(mapTestPack(path), key);
+		EXPECT_EQ(mappedPack.getVersion(), 2);
+		EXPECT_TRUE(mappedPack.isMapped());
+
+		for (size_t i = 0; i < nAssets; ++i) {
+			checkAsset(readerPack, i, assetSize);
+			checkAsset(mappedPack, i, assetSize);
+		}
+
+		auto stream = readerPack.getData(getAssetName(42), AssetType::BinaryFile, true);
+		auto reader = dynamic_cast<ResourceDataStream&>(*stream).getReader();
+		EXPECT_EQ(reader->size(), assetSize + 42 % 7);
+		reader->seek(-16, SEEK_END);
+		std::array<gsl::byte, 32> buffer;
+		EXPECT_EQ(reader->read(buffer), 16);
+		EXPECT_EQ(buffer[15], gsl::byte(42));
+
+		// Readers opened on the same stream share the decoded asset, but not their position
+		auto reader2 = dynamic_cast<ResourceDataStream&>(*stream).getReader();
+		EXPECT_EQ(reader2->tell(), 0);
+		EXPECT_EQ(reader2->size(), reader->size());
+		reader2->seek(-16, SEEK_END);
+		std::array<gsl::byte, 32> buffer2;
+		EXPECT_EQ(reader2->read(buffer2), 16);
+		EXPECT_EQ(memcmp(buffer2.data(), buffer.data(), 16), 0);
+		EXPECT_EQ(reader->read(buffer), 0);
+
+		// The key is only needed when an asset is actually decoded
+		AssetPack noKeyPack(std::make_unique<BytesReader>(bytes));
+		EXPECT_THROW(noKeyPack.getData(getAssetName(0), AssetType::BinaryFile, false), Exception);
+	}
+
+	Path::removeFile(path);
+}
+
+TEST(HalleyAssetPack, DISABLED_BenchmarkConcurrentLoads)
+{
+	const Path path = "asset_pack_bench.dat";
+	constexpr size_t nAssets = 5000;
+	constexpr size_t assetSize = 2000;
+	const size_t nThreads = std::max(2u, std::thread::hardware_concurrency());
+	auto bytes = writeTestPack(path, nAssets, assetSize);
+
+	auto benchmark = [&] (AssetPack& pack)
+	{
+		Stopwatch stopwatch;
+		std::vector<std::thread> threads;
+		std::atomic<size_t> total(0);
+		for (size_t t = 0; t < nThreads; ++t) {
+			threads.emplace_back([&, t] ()
+			{
+				for (size_t i = t; i < nAssets; i += nThreads) {
+					auto data = pack.getData(getAssetName(i), AssetType::BinaryFile, false);
+					total += size_t(dynamic_cast<ResourceDataStatic&>(*data).getSpan()[0]);
+				}
+			});
+		}
+		for (auto& t: threads) {
+			t.join();
+		}
+		stopwatch.pause();
+		EXPECT_GT(total.load(), 0);
+		return stopwatch.elapsedNanoseconds();
+	};
+
+	AssetPack readerPack(std::make_unique<BytesReader>(std::move(bytes)));
+	AssetPack mappedPack(mapTestPack(path));
+	const auto readerTime = benchmark(readerPack);
+	const auto mappedTime = benchmark(mappedPack);
+
+	std::cout << "Loading " << nAssets << " assets on " << nThreads << " threads: reader " << (readerTime / 1000) << " us, mapped " << (mappedTime / 1000) << " us" << std::endl;
+
+	Path::removeFile(path);
+}
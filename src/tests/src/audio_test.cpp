@@ -0,0 +1,671 @@
+#include <gtest/gtest.h>
+#include <halley.hpp>
+#include "audio_clip_streamer.h"
+#include "audio_engine.h"
+#include "audio_filter_resample.h"
+#include "audio_source_clip.h"
+#include "audio_voice.h"
+#include "halley/audio/vorbis_dec.h"
+#include "ogg/ogg.h"
+#include "vorbis/vorbisenc.h"
+#include "test_executors.h"
+using namespace Halley;
+
+namespace {
+	// Triangle wave with a distinct value at every sample, so any offset in playback shows up
+	class RampClip : public IAudioClip {
+	public:
+		RampClip(size_t length, size_t loopPoint)
+			: length(length)
+			, loopPoint(loopPoint)
+		{}
+
+		size_t copyChannelData(size_t channelN, size_t pos, size_t len, gsl::span<AudioConfig::SampleFormat> dst) const override
+		{
+			for (size_t i = 0; i < len; ++i) {
+				dst[i] = getSample(pos + i);
+			}
+			return len;
+		}
+
+		uint8_t getNumberOfChannels() const override { return 1; }
+		size_t getLength() const override { return length; }
+		size_t getLoopPoint() const override { return loopPoint; }
+
+		static float getSample(size_t pos)
+		{
+			const size_t p = pos % 65536;
+			return float(p < 32768 ? p : 65536 - p) / 64.0f;
+		}
+
+	private:
+		size_t length;
+		size_t loopPoint;
+	};
+
+	// Relies on AudioSource's default skipAudioData
+	class CountingSource : public AudioSource {
+	public:
+		size_t pos = 0;
+		size_t length = 1000;
+
+		uint8_t getNumberOfChannels() const override { return 2; }
+
+		bool getAudioData(size_t numSamples, AudioSourceData& dst) override
+		{
+			for (size_t i = 0; i < numSamples; ++i) {
+				dst[0][i] = float(pos + i);
+				dst[1][i] = -float(pos + i);
+			}
+			pos += numSamples;
+			return pos < length;
+		}
+	};
+
+	class NullAudioOutput : public AudioOutputAPI {
+	public:
+		Vector<std::unique_ptr<const AudioDevice>> getAudioDevices() override { return {}; }
+		AudioSpec openAudioDevice(const AudioSpec& requestedFormat, const AudioDevice* device, AudioCallback prepareAudioCallback) override { return requestedFormat; }
+		void closeAudioDevice() override {}
+		void startPlayback() override {}
+		void stopPlayback() override {}
+		bool needsMoreAudio() override { return true; }
+		bool needsAudioThread() const override { return false; }
+
+		void onAudioAvailable() override
+		{
+			// Discard it, so the engine never runs out of room
+			auto& src = getAudioOutputInterface();
+			std::vector<gsl::byte> buffer(src.getAvailable());
+			src.output(buffer, false);
+		}
+	};
+
+	std::vector<float> readSamples(AudioSource& source, size_t n, bool& playing)
+	{
+		std::vector<float> result(n);
+		AudioSourceData dst;
+		dst[0] = result;
+		playing = source.getAudioData(n, dst);
+		return result;
+	}
+
+	// Reads a and b side by side, except that a skips the frames where shouldSkip is true.
+	// Returns the largest difference between them on the frames a did read, ignoring the first ignoreAfterSkip samples after a skip.
+	float compareWithSkipping(AudioSource& a, AudioSource& b, size_t frameSize, int nFrames, std::function<bool(int)> shouldSkip, size_t ignoreAfterSkip = 0)
+	{
+		float maxError = 0;
+		bool skipped = false;
+		for (int frame = 0; frame < nFrames; ++frame) {
+			bool playingA;
+			bool playingB;
+			const auto expected = readSamples(b, frameSize, playingB);
+			if (shouldSkip(frame)) {
+				playingA = a.skipAudioData(frameSize);
+				skipped = true;
+			} else {
+				const auto actual = readSamples(a, frameSize, playingA);
+				for (size_t i = skipped ? ignoreAfterSkip : 0; i < frameSize; ++i) {
+					maxError = std::max(maxError, std::abs(actual[i] - expected[i]));
+				}
+				skipped = false;
+			}
+			EXPECT_EQ(playingA, playingB) << "frame " << frame;
+			if (!playingA || !playingB) {
+				break;
+			}
+		}
+		return maxError;
+	}
+
+	class TestAudioEngine {
+	public:
+		TestAudioEngine(size_t maxRealVoices)
+		{
+			engine.start(AudioSpec(AudioConfig::sampleRate, 2, 256, AudioSampleFormat::Float), output);
+			engine.setMaxRealVoices(maxRealVoices);
+		}
+
+		AudioVoice& addVoice(uint32_t id, float gain)
+		{
+			auto source = std::make_shared<AudioSourceClip>(clip, true, 0);
+			engine.addEmitter(id, std::make_unique<AudioVoice>(source, AudioPosition::makeUI(), gain, uint8_t(engine.getGroupId(""))));
+			return *engine.getSources(id).at(0);
+		}
+
+		AudioEngine* operator->() { return &engine; }
+
+	private:
+		std::shared_ptr<RampClip> clip = std::make_shared<RampClip>(100000, 0);
+		NullAudioOutput output;
+		AudioEngine engine;
+	};
+
+	class CallCountingSource final : public AudioSource {
+	public:
+		uint8_t getNumberOfChannels() const override { return 1; }
+
+		bool getAudioData(size_t numSamples, AudioSourceData& dst) override
+		{
+			++reads;
+			std::fill_n(dst[0].data(), numSamples, 1.0f);
+			return true;
+		}
+
+		bool skipAudioData(size_t numSamples) override
+		{
+			++skips;
+			return true;
+		}
+
+		int reads = 0;
+		int skips = 0;
+	};
+
+	// Passes everything through, keeping track of what gets played
+	class RecordingSource final : public AudioSource {
+	public:
+		RecordingSource(std::shared_ptr<AudioSource> source) : source(std::move(source)) {}
+
+		uint8_t getNumberOfChannels() const override { return source->getNumberOfChannels(); }
+		bool isReady() const override { return source->isReady(); }
+
+		bool getAudioData(size_t numSamples, AudioSourceData& dst) override
+		{
+			++reads;
+			const bool playing = source->getAudioData(numSamples, dst);
+			const auto* samples = dst[0].data();
+			lastPeak = 0;
+			for (size_t i = 0; i < numSamples; ++i) {
+				lastPeak = std::max(lastPeak, std::abs(samples[i]));
+			}
+			return playing;
+		}
+
+		bool skipAudioData(size_t numSamples) override
+		{
+			++skips;
+			return source->skipAudioData(numSamples);
+		}
+
+		int reads = 0;
+		int skips = 0;
+		float lastPeak = 0;
+
+	private:
+		std::shared_ptr<AudioSource> source;
+	};
+
+	class MemoryDataReader final : public ResourceDataReader {
+	public:
+		MemoryDataReader(std::shared_ptr<const Bytes> data) : data(std::move(data)) {}
+
+		size_t size() const override { return data->size(); }
+		size_t tell() const override { return pos; }
+		void close() override {}
+
+		int read(gsl::span<gsl::byte> dst) override
+		{
+			const size_t toRead = std::min(size_t(dst.size()), data->size() - std::min(pos, data->size()));
+			memcpy(dst.data(), data->data() + pos, toRead);
+			pos += toRead;
+			return int(toRead);
+		}
+
+		void seek(int64_t offset, int whence) override
+		{
+			if (whence == SEEK_SET) {
+				pos = size_t(offset);
+			} else if (whence == SEEK_CUR) {
+				pos = size_t(int64_t(pos) + offset);
+			} else {
+				pos = size_t(int64_t(data->size()) + offset);
+			}
+		}
+
+	private:
+		std::shared_ptr<const Bytes> data;
+		size_t pos = 0;
+	};
+
+	// Same steps as AudioImporter::encodeVorbis, minus the error reporting
+	Bytes encodeVorbis(const std::vector<std::vector<float>>& src)
+	{
+		Bytes result;
+		auto writePage = [&] (const ogg_page& page)
+		{
+			const size_t start = result.size();
+			result.resize(start + page.header_len + page.body_len);
+			memcpy(result.data() + start, page.header, page.header_len);
+			memcpy(result.data() + start + page.header_len, page.body, page.body_len);
+		};
+
+		vorbis_info vi;
+		vorbis_info_init(&vi);
+		vorbis_encode_init_vbr(&vi, long(src.size()), long(AudioConfig::sampleRate), 0.5f);
+		vorbis_dsp_state v;
+		vorbis_analysis_init(&v, &vi);
+		vorbis_comment vc;
+		vorbis_comment_init(&vc);
+		vorbis_block vb;
+		vorbis_block_init(&v, &vb);
+		ogg_stream_state os;
+		ogg_stream_init(&os, 0);
+
+		ogg_packet header;
+		ogg_packet headerComm;
+		ogg_packet headerCode;
+		vorbis_analysis_headerout(&v, &vc, &header, &headerComm, &headerCode);
+		ogg_stream_packetin(&os, &header);
+		ogg_stream_packetin(&os, &headerComm);
+		ogg_stream_packetin(&os, &headerCode);
+		ogg_page page;
+		while (ogg_stream_flush(&os, &page)) {
+			writePage(page);
+		}
+
+		constexpr size_t bufferSize = 1024;
+		size_t pos = 0;
+		while (true) {
+			// Writing 0 samples marks the end of the stream
+			const size_t n = std::min(src[0].size() - pos, bufferSize);
+			float** buffers = vorbis_analysis_buffer(&v, int(bufferSize));
+			for (size_t i = 0; i < src.size(); ++i) {
+				memcpy(buffers[i], src[i].data() + pos, n * sizeof(float));
+			}
+			vorbis_analysis_wrote(&v, int(n));
+			pos += n;
+
+			ogg_packet packet;
+			while (vorbis_analysis_blockout(&v, &vb) == 1) {
+				vorbis_analysis(&vb, nullptr);
+				vorbis_bitrate_addblock(&vb);
+				while (vorbis_bitrate_flushpacket(&v, &packet)) {
+					ogg_stream_packetin(&os, &packet);
+					while (ogg_stream_pageout(&os, &page)) {
+						writePage(page);
+					}
+				}
+			}
+
+			if (n == 0) {
+				break;
+			}
+		}
+		while (ogg_stream_flush(&os, &page)) {
+			writePage(page);
+		}
+
+		ogg_stream_clear(&os);
+		vorbis_block_clear(&vb);
+		vorbis_dsp_clear(&v);
+		vorbis_comment_clear(&vc);
+		vorbis_info_clear(&vi);
+		return result;
+	}
+
+	class StreamedClip {
+	public:
+		std::shared_ptr<AudioClip> clip;
+		std::vector<std::vector<float>> reference; // What the clip decodes to, start to end
+
+		StreamedClip(size_t length, int loopPoint)
+		{
+			std::vector<std::vector<float>> src(2, std::vector<float>(length));
+			for (size_t i = 0; i < length; ++i) {
+				src[0][i] = 0.5f * std::sin(float(i) * 0.01f);
+				src[1][i] = 0.5f * std::sin(float(i) * 0.013f + float(i) * float(i) * 1e-8f);
+			}
+			const auto bytes = std::make_shared<const Bytes>(encodeVorbis(src));
+			auto stream = std::make_shared<ResourceDataStream>("test", [bytes] () { return std::make_unique<MemoryDataReader>(bytes); });
+
+			VorbisData vorbis(stream);
+			reference.resize(2, std::vector<float>(vorbis.getNumSamples()));
+			vorbis.read(reference);
+
+			Metadata meta;
+			meta.set("loopPoint", loopPoint);
+			clip = std::make_shared<AudioClip>(2);
+			clip->loadFromStream(stream, meta);
+		}
+
+		size_t getLength() const { return reference[0].size(); }
+	};
+
+	void waitUntilReady(const AudioSource& source)
+	{
+		while (!source.isReady()) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+	}
+}
+
+TEST(HalleyAudio, SourceClipSkipMatchesReading)
+{
+	for (const bool looping: { false, true }) {
+		// Skips through the delay, then keeps crossing the loop point
+		const auto clip = std::make_shared<RampClip>(5000, 1000);
+		AudioSourceClip a(clip, looping, 700);
+		AudioSourceClip b(clip, looping, 700);
+		ASSERT_TRUE(a.isReady());
+		ASSERT_TRUE(b.isReady());
+
+		const float error = compareWithSkipping(a, b, 512, 100, [] (int frame) { return frame % 5 < 3; });
+		EXPECT_EQ(error, 0.0f) << "looping " << looping;
+	}
+}
+
+TEST(HalleyAudio, SourceClipSkipStopsAtEnd)
+{
+	const auto clip = std::make_shared<RampClip>(1000, 0);
+	AudioSourceClip source(clip, false, 200);
+	ASSERT_TRUE(source.isReady());
+
+	EXPECT_TRUE(source.skipAudioData(1000));
+	EXPECT_TRUE(source.skipAudioData(200));
+	EXPECT_FALSE(source.skipAudioData(1));
+}
+
+TEST(HalleyAudio, DefaultSkipRendersAndDiscards)
+{
+	CountingSource source;
+	EXPECT_TRUE(source.skipAudioData(300));
+	EXPECT_EQ(source.pos, 300);
+
+	std::array<float, 10> left;
+	std::array<float, 10> right;
+	AudioSourceData dst;
+	dst[0] = left;
+	dst[1] = right;
+	source.getAudioData(10, dst);
+	EXPECT_EQ(left[0], 300.0f);
+	EXPECT_EQ(right[9], -309.0f);
+
+	EXPECT_FALSE(source.skipAudioData(1000));
+}
+
+TEST(HalleyAudio, ResampleSkipStaysInSync)
+{
+	struct Case {
+		size_t frameSize;
+		std::function<bool(int)> shouldSkip;
+	};
+	const auto cases = std::array<Case, 2>{
+		// 512 samples at 48 kHz is 470.4 samples at 44.1 kHz, so dropping the fraction on every skip would lose a sample every few frames
+		Case{ 512, [] (int frame) { return frame % 100 >= 1 && frame % 100 <= 90; } },
+		// Alternating, with a frame size that leaves a different fraction behind every time
+		Case{ 333, [] (int frame) { return frame % 2 == 1; } }
+	};
+
+	AudioBufferPool pool;
+	for (const auto& c: cases) {
+		for (const bool looping: { false, true }) {
+			const auto clip = std::make_shared<RampClip>(2000000, 1000);
+			AudioFilterResample a(std::make_shared<AudioSourceClip>(clip, looping, 700), 44100, 48000, pool);
+			AudioFilterResample b(std::make_shared<AudioSourceClip>(clip, looping, 700), 44100, 48000, pool);
+			ASSERT_TRUE(a.isReady());
+			ASSERT_TRUE(b.isReady());
+
+			// The resampler's filter state is stale right after a skip, so give it a moment to settle.
+			// Being a single sample out would be about 0.014 here, at every sample, and it only gets worse from there.
+			const float error = compareWithSkipping(a, b, c.frameSize, 5000, c.shouldSkip, 128);
+			EXPECT_LT(error, 0.05f) << "frame size " << c.frameSize << ", looping " << looping;
+		}
+	}
+}
+
+TEST(HalleyAudio, ResampleSkipUsesLeftovers)
+{
+	AudioBufferPool pool;
+	const auto clip = std::make_shared<RampClip>(100000, 0);
+	AudioFilterResample a(std::make_shared<AudioSourceClip>(clip, false, 0), 44100, 48000, pool);
+	AudioFilterResample b(std::make_shared<AudioSourceClip>(clip, false, 0), 44100, 48000, pool);
+	ASSERT_TRUE(a.isReady());
+	ASSERT_TRUE(b.isReady());
+
+	bool playing;
+	readSamples(a, 512, playing);
+	readSamples(b, 512, playing);
+
+	// The read above resampled a little more than it returned, so a short skip is taken from that and never reaches the source
+	EXPECT_TRUE(a.skipAudioData(1));
+	const auto actual = readSamples(a, 511, playing);
+	const auto expected = readSamples(b, 512, playing);
+	for (size_t i = 0; i < actual.size(); ++i) {
+		EXPECT_NEAR(actual[i], expected[i + 1], 0.001f) << "sample " << i;
+	}
+}
+
+TEST(HalleyAudio, VirtualiseQuietestVoices)
+{
+	TestAudioEngine engine(2);
+	auto& loud = engine.addVoice(1, 1.0f);
+	auto& medium = engine.addVoice(2, 0.8f);
+	auto& quiet = engine.addVoice(3, 0.6f);
+	auto& quietest = engine.addVoice(4, 0.4f);
+	auto& silent = engine.addVoice(5, 0.0f);
+
+	engine->generateBuffer();
+	EXPECT_FALSE(loud.isVirtual());
+	EXPECT_FALSE(medium.isVirtual());
+	EXPECT_TRUE(quiet.isVirtual());
+	EXPECT_TRUE(quietest.isVirtual());
+	EXPECT_FALSE(silent.isVirtual()); // Doesn't take up a real voice either way
+
+	// Priority wins over volume
+	quietest.setPriority(1);
+	engine->generateBuffer();
+	EXPECT_FALSE(quietest.isVirtual());
+	EXPECT_FALSE(loud.isVirtual());
+	EXPECT_TRUE(medium.isVirtual());
+	EXPECT_TRUE(quiet.isVirtual());
+
+	// Every voice is real when they all fit
+	engine->setMaxRealVoices(5);
+	engine->generateBuffer();
+	for (auto* voice: { &loud, &medium, &quiet, &quietest, &silent }) {
+		EXPECT_FALSE(voice->isVirtual());
+	}
+}
+
+TEST(HalleyAudio, VirtualiseVoicesWithHysteresis)
+{
+	TestAudioEngine engine(1);
+	auto& a = engine.addVoice(1, 0.5f);
+	auto& b = engine.addVoice(2, 0.45f);
+
+	engine->generateBuffer();
+	EXPECT_FALSE(a.isVirtual());
+	EXPECT_TRUE(b.isVirtual());
+
+	// Slightly louder isn't enough to take over a real voice
+	b.setBaseGain(0.6f);
+	engine->generateBuffer();
+	EXPECT_FALSE(a.isVirtual());
+	EXPECT_TRUE(b.isVirtual());
+
+	// Clearly louder is
+	b.setBaseGain(0.7f);
+	engine->generateBuffer();
+	EXPECT_TRUE(a.isVirtual());
+	EXPECT_FALSE(b.isVirtual());
+
+	// And now the other one gets the edge
+	a.setBaseGain(0.8f);
+	engine->generateBuffer();
+	EXPECT_TRUE(a.isVirtual());
+	EXPECT_FALSE(b.isVirtual());
+}
+
+TEST(HalleyAudio, VoiceVirtualOnFirstUpdateIsSilent)
+{
+	TestAudioEngine engine(1);
+	engine.addVoice(1, 1.0f);
+
+	// Quieter than the only real voice from the start, so it must never be heard, not even fading out
+	auto source = std::make_shared<CallCountingSource>();
+	engine->addEmitter(2, std::make_unique<AudioVoice>(source, AudioPosition::makeUI(), 0.5f, uint8_t(engine->getGroupId(""))));
+	auto& voice = *engine->getSources(2).at(0);
+
+	engine->generateBuffer();
+	EXPECT_TRUE(voice.isVirtual());
+	EXPECT_EQ(source->reads, 0);
+	EXPECT_EQ(source->skips, 1);
+
+	engine->generateBuffer();
+	EXPECT_EQ(source->reads, 0);
+	EXPECT_EQ(source->skips, 2);
+}
+
+TEST(HalleyAudio, StreamedClipVoices)
+{
+	TestExecutors executors(0, 0, 1);
+	constexpr int loopPoint = 12345;
+	const StreamedClip data(6 * AudioConfig::sampleRate, loopPoint);
+	const int64_t length = int64_t(data.getLength());
+
+	constexpr size_t nVoices = 4;
+	constexpr size_t frameSize = 512;
+	std::vector<std::shared_ptr<AudioSourceClip>> voices;
+	std::vector<int64_t> positions;
+	for (size_t i = 0; i < nVoices; ++i) {
+		voices.push_back(std::make_shared<AudioSourceClip>(data.clip, true, int64_t(i * 3000)));
+		positions.push_back(-int64_t(i * 3000));
+	}
+	for (const auto& voice: voices) {
+		waitUntilReady(*voice);
+	}
+
+	std::vector<float> left(frameSize);
+	std::vector<float> right(frameSize);
+	std::vector<bool> skipped(nVoices, false);
+	float maxError = 0;
+	size_t nLoops = 0;
+	size_t nCompared = 0;
+	size_t nWaits = 0;
+	const auto underrunsBefore = AudioClipStreamer::getTotalUnderruns();
+
+	// Long enough to go around the ring buffer many times, and through the loop point
+	for (int frame = 0; frame < 700; ++frame) {
+		for (size_t i = 0; i < nVoices; ++i) {
+			// Each voice is virtual for 50 frames out of 150, which skips past everything it had buffered.
+			// Like AudioVoice, it then keeps skipping until the source is ready again.
+			const bool isVirtual = (frame / 50 + i) % 3 == 0;
+			if (isVirtual || (skipped[i] && !voices[i]->isReady())) {
+				EXPECT_TRUE(voices[i]->skipAudioData(frameSize));
+				skipped[i] = true;
+				nWaits += isVirtual ? 0 : 1;
+			} else {
+				skipped[i] = false;
+				AudioSourceData dst;
+				dst[0] = left;
+				dst[1] = right;
+				EXPECT_TRUE(voices[i]->getAudioData(frameSize, dst));
+
+				for (size_t j = 0; j < frameSize; ++j) {
+					int64_t pos = positions[i] + int64_t(j);
+					while (pos >= length) {
+						pos = loopPoint + (pos - length);
+					}
+					const float expectedLeft = pos < 0 ? 0.0f : data.reference[0][pos];
+					const float expectedRight = pos < 0 ? 0.0f : data.reference[1][pos];
+					maxError = std::max(maxError, std::max(std::abs(left[j] - expectedLeft), std::abs(right[j] - expectedRight)));
+				}
+				++nCompared;
+			}
+
+			positions[i] += int64_t(frameSize);
+			if (positions[i] >= length) {
+				positions[i] = loopPoint + (positions[i] - length);
+				++nLoops;
+			}
+		}
+
+		// Four times faster than real time
+		std::this_thread::sleep_for(std::chrono::microseconds(1000000 * frameSize / AudioConfig::sampleRate / 4));
+	}
+
+	EXPECT_LT(maxError, 0.0001f);
+	EXPECT_EQ(AudioClipStreamer::getTotalUnderruns(), underrunsBefore);
+	EXPECT_EQ(nLoops, nVoices);
+	EXPECT_GT(nCompared, 700 * nVoices / 2);
+	EXPECT_GT(nWaits, 0);
+}
+
+TEST(HalleyAudio, StreamedClipStopsDecodingWhileSkipping)
+{
+	TestExecutors executors(0, 0, 1);
+	const StreamedClip data(AudioConfig::sampleRate * 2, 0);
+
+	AudioSourceClip voice(data.clip, true, 0);
+	waitUntilReady(voice);
+
+	// Skip past everything that was buffered. Nothing new gets decoded, no matter how long we wait.
+	constexpr size_t frameSize = 512;
+	for (int i = 0; i < 60; ++i) {
+		EXPECT_TRUE(voice.skipAudioData(frameSize));
+	}
+	std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+	// So reading straight away comes up empty, but that's the skip's doing, not an underrun
+	std::vector<float> left(frameSize, 1.0f);
+	std::vector<float> right(frameSize, 1.0f);
+	AudioSourceData dst;
+	dst[0] = left;
+	dst[1] = right;
+	const auto underrunsBefore = AudioClipStreamer::getTotalUnderruns();
+	EXPECT_TRUE(voice.getAudioData(frameSize, dst));
+	EXPECT_EQ(AudioClipStreamer::getTotalUnderruns(), underrunsBefore);
+	EXPECT_EQ(left, std::vector<float>(frameSize, 0.0f));
+
+	// Once it's caught up, it's right where it should be
+	waitUntilReady(voice);
+	EXPECT_TRUE(voice.getAudioData(frameSize, dst));
+	EXPECT_EQ(AudioClipStreamer::getTotalUnderruns(), underrunsBefore);
+	const size_t pos = 61 * frameSize;
+	for (size_t i = 0; i < frameSize; ++i) {
+		EXPECT_NEAR(left[i], data.reference[0][pos + i], 0.0001f) << "sample " << i;
+		EXPECT_NEAR(right[i], data.reference[1][pos + i], 0.0001f) << "sample " << i;
+	}
+}
+
+TEST(HalleyAudio, StreamedVoiceResumesAfterDucking)
+{
+	TestExecutors executors(0, 0, 1);
+	const StreamedClip data(AudioConfig::sampleRate * 4, 0);
+
+	// Music on a loop, recording everything it plays
+	TestAudioEngine engine(4);
+	auto source = std::make_shared<RecordingSource>(std::make_shared<AudioSourceClip>(data.clip, true, 0));
+	engine->addEmitter(1, std::make_unique<AudioVoice>(source, AudioPosition::makeFixed(), 1.0f, uint8_t(engine->getGroupId(""))));
+	auto& voice = *engine->getSources(1).at(0);
+	while (!voice.isPlaying()) {
+		engine->generateBuffer();
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	const auto underrunsBefore = AudioClipStreamer::getTotalUnderruns();
+
+	// Ducked all the way down for longer than the ring buffer, so nothing it had buffered is left
+	voice.setBaseGain(0.0f);
+	for (int i = 0; i < 300; ++i) {
+		engine->generateBuffer();
+	}
+	EXPECT_GT(source->skips, 0);
+
+	// Back up, and it waits for the stream to catch up before it's heard again
+	voice.setBaseGain(1.0f);
+	const int readsBefore = source->reads;
+	for (int i = 0; i < 1000 && source->reads == readsBefore; ++i) {
+		engine->generateBuffer();
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	ASSERT_GT(source->reads, readsBefore);
+	EXPECT_GT(source->lastPeak, 0.01f); // The fade in isn't spent on silence
+	EXPECT_EQ(AudioClipStreamer::getTotalUnderruns(), underrunsBefore);
+
+	// And keeps up from then on
+	for (int i = 0; i < 50; ++i) {
+		engine->generateBuffer();
+	}
+	EXPECT_EQ(AudioClipStreamer::getTotalUnderruns(), underrunsBefore);
+}
@@ -0,0 +1,117 @@
+#include <gtest/gtest.h>
+#include <halley.hpp>
+#include "halley/tools/distance_field/distance_field_generator.h"
+#include "test_executors.h"
+using namespace Halley;
+
+namespace {
+	// Stand-in for a supersampled glyph: a ring with a bar through it, so there are holes, thin strokes and corners
+	std::unique_ptr<Image> makeGlyph(Vector2i size)
+	{
+		auto image = std::make_unique<Image>(Image::Format::RGBA, size);
+		auto px = image->getPixels4BPP();
+		const auto centre = Vector2f(size) * 0.5f;
+		const float outer = std::min(size.x, size.y) * 0.4f;
+		const float inner = outer * 0.6f;
+		for (int y = 0; y < size.y; ++y) {
+			for (int x = 0; x < size.x; ++x) {
+				const float dist = (Vector2f(float(x), float(y)) - centre).length();
+				const bool ring = dist < outer && dist > inner;
+				const bool bar = std::abs(float(y) - centre.y) < size.y * 0.05f && std::abs(float(x) - centre.x) < outer;
+				px[y * size.x + x] = ring || bar ? int(Image::convertRGBAToInt(255, 255, 255, 255)) : 0;
+			}
+		}
+		return image;
+	}
+
+	// The brute force search that DistanceFieldGenerator used to do.
+	// When not windowed, it searches the whole image instead of just around each texel, which is what the transform computes.
+	std::unique_ptr<Image> referenceDistanceField(const Image& srcImg, Vector2i size, float radius, bool windowed)
+	{
+		const int srcW = srcImg.getWidth();
+		const int srcH = srcImg.getHeight();
+		const auto src = srcImg.getPixels4BPP();
+		auto isInside = [&] (int x, int y) { return ((src[x + y * srcW] & 0xFF000000) >> 24) > 127; };
+
+		auto dstImg = std::make_unique<Image>(Image::Format::SingleChannel, size);
+		auto dst = dstImg->getPixelBytes();
+		const int texelW = srcW / size.x;
+		const int texelH = srcH / size.y;
+		const float srcRadius = radius * srcW / size.x;
+		const int window = windowed ? int(ceil(srcRadius)) : std::max(srcW, srcH);
+
+		for (int y = 0; y < size.y; ++y) {
+			for (int x = 0; x < size.x; ++x) {
+				float distAcc = 0;
+				for (int j = 0; j < texelH; ++j) {
+					for (int i = 0; i < texelW; ++i) {
+						const int sx = x * srcW / size.x + i;
+						const int sy = y * srcH / size.y + j;
+						const bool inside = isInside(sx, sy);
+						int bestDistSqr = 2147483647;
+						for (int v = std::max(0, sy - window); v <= std::min(sy + window, srcH - 1); ++v) {
+							for (int u = std::max(0, sx - window); u <= std::min(sx + window, srcW - 1); ++u) {
+								if (isInside(u, v) != inside) {
+									bestDistSqr = std::min(bestDistSqr, (u - sx) * (u - sx) + (v - sy) * (v - sy));
+								}
+							}
+						}
+						const float dist = float(sqrt(bestDistSqr));
+						const float normalDistance = (2 * dist - 1) / (2 * srcRadius);
+						distAcc += 0.5f * (inside ? 1.0f + normalDistance : 1.0f - normalDistance);
+					}
+				}
+				dst[x + y * size.x] = static_cast<unsigned char>(clamp(int(distAcc * 255 / (texelW * texelH)), 0, 255));
+			}
+		}
+		return dstImg;
+	}
+
+}
+
+TEST(HalleyDistanceField, MatchesBruteForce)
+{
+	TestExecutors executors(4);
+
+	const auto glyph = makeGlyph(Vector2i(48, 40));
+	const auto result = DistanceFieldGenerator::generate(*glyph, Vector2i(12, 10), 2.0f);
+	const auto expected = referenceDistanceField(*glyph, Vector2i(12, 10), 2.0f, false);
+
+	ASSERT_EQ(result->getFormat(), Image::Format::SingleChannel);
+	ASSERT_EQ(result->getSize(), Vector2i(12, 10));
+	const auto a = result->getPixelBytes();
+	const auto b = expected->getPixelBytes();
+	for (size_t i = 0; i < size_t(a.size()); ++i) {
+		EXPECT_NEAR(int(a[i]), int(b[i]), 1) << "at texel " << i;
+	}
+}
+
+TEST(HalleyDistanceField, DISABLED_BenchmarkGlyphs)
+{
+	TestExecutors executors(std::max(2u, std::thread::hardware_concurrency()));
+
+	// Font importer defaults: 4x supersampling, radius 8, glyphs taking up most of a 512x512 atlas
+	constexpr int superSample = 4;
+	for (const int glyphSize: { 32, 64, 128 }) {
+		for (const float radius: { 8.0f, 16.0f }) {
+			const auto glyph = makeGlyph(Vector2i(glyphSize, glyphSize) * superSample);
+			const int nGlyphs = std::max(1, (512 * 512) / (glyphSize * glyphSize * 4));
+
+			Stopwatch transformTime;
+			for (int i = 0; i < nGlyphs; ++i) {
+				const auto result = DistanceFieldGenerator::generate(*glyph, Vector2i(glyphSize, glyphSize), radius);
+				EXPECT_EQ(result->getSize(), Vector2i(glyphSize, glyphSize));
+			}
+			transformTime.pause();
+
+			// The old search is slow enough that a single glyph gives a good estimate
+			Stopwatch searchTime;
+			referenceDistanceField(*glyph, Vector2i(glyphSize, glyphSize), radius, true);
+			searchTime.pause();
+
+			std::cout << nGlyphs << " glyphs of " << glyphSize << "x" << glyphSize << ", radius " << radius << ": "
+				<< "transform " << transformTime.elapsedMilliseconds() << " ms, "
+				<< "windowed search " << (searchTime.elapsedMilliseconds() * nGlyphs) << " ms (estimated)" << std::endl;
+		}
+	}
+}
@@ -0,0 +1,135 @@
+#include <gtest/gtest.h>
+#include <halley.hpp>
+#include "test_executors.h"
+using namespace Halley;
+
+namespace {
+	template <typename Queue>
+	int64_t benchmarkThroughput(size_t nThreads, size_t nTasks)
+	{
+		TestQueue<Queue> pool(nThreads);
+		std::atomic<size_t> done(0);
+
+		// Tasks are spawned from other tasks, as they would be by nested parallel work
+		Stopwatch stopwatch;
+		for (size_t j = 0; j < nThreads; ++j) {
+			(*pool).addToQueue([&pool, &done, n = nTasks / nThreads] ()
+			{
+				for (size_t i = 0; i < n; ++i) {
+					(*pool).addToQueue([&done] () { ++done; });
+				}
+			});
+		}
+		nTasks = nTasks / nThreads * nThreads;
+		while (done.load() < nTasks) {
+			std::this_thread::yield();
+		}
+		stopwatch.pause();
+		return stopwatch.elapsedNanoseconds();
+	}
+
+	template <typename Queue>
+	int64_t benchmarkLatency(size_t nThreads, size_t nRounds)
+	{
+		TestQueue<Queue> pool(nThreads);
+
+		Stopwatch stopwatch;
+		for (size_t i = 0; i < nRounds; ++i) {
+			std::atomic<bool> done(false);
+			(*pool).addToQueue([&done] () { done = true; });
+			while (!done.load()) {
+				std::this_thread::yield();
+			}
+		}
+		stopwatch.pause();
+		return stopwatch.elapsedNanoseconds() / int64_t(nRounds);
+	}
+}
+
+TEST(HalleyExecutor, TaskStorage)
+{
+	int calls = 0;
+	std::array<char, TaskBase::inlineSize * 2> big = {};
+	big[0] = 1;
+
+	TaskBase small([&calls] () { ++calls; });
+	TaskBase large([&calls, big] () { calls += big[0]; });
+	auto moved = std::move(large);
+	EXPECT_FALSE(large);
+
+	small();
+	moved();
+	EXPECT_EQ(calls, 2);
+}
+
+TEST(HalleyExecutor, ParallelFor)
+{
+	TestQueue<WorkStealingQueue> pool(4);
+
+	constexpr size_t n = 1000;
+	std::vector<std::atomic<int>> hits(n * n);
+	Concurrent::parallelFor(*pool, 0, n, [&] (size_t i)
+	{
+		Concurrent::parallelFor(*pool, 0, n, [&] (size_t j)
+		{
+			++hits[i * n + j];
+		});
+	});
+
+	EXPECT_TRUE(std::all_of(hits.begin(), hits.end(), [] (const std::atomic<int>& h) { return h.load() == 1; }));
+}
+
+TEST(HalleyExecutor, TaskGroupRethrows)
+{
+	TestQueue<WorkStealingQueue> pool(2);
+
+	std::atomic<int> done(0);
+	TaskGroup group(*pool);
+	for (int i = 0; i < 100; ++i) {
+		group.run([&done, i] ()
+		{
+			++done;
+			if (i == 50) {
+				throw Exception("Task failed", HalleyExceptions::Concurrency);
+			}
+		});
+	}
+	EXPECT_THROW(group.wait(), Exception);
+	EXPECT_EQ(done.load(), 100);
+}
+
+TEST(HalleyExecutor, DISABLED_BenchmarkQueues)
+{
+	const size_t nThreads = std::max(2u, std::thread::hardware_concurrency());
+	constexpr size_t nTasks = 1000000;
+	constexpr size_t nRounds = 10000;
+
+	std::cout << "Throughput (" << nTasks << " tasks, " << nThreads << " threads): "
+		<< "ExecutionQueue " << (benchmarkThroughput<ExecutionQueue>(nThreads, nTasks) / 1000000) << " ms, "
+		<< "WorkStealingQueue " << (benchmarkThroughput<WorkStealingQueue>(nThreads, nTasks) / 1000000) << " ms" << std::endl;
+
+	std::cout << "Latency: "
+		<< "ExecutionQueue " << benchmarkLatency<ExecutionQueue>(nThreads, nRounds) << " ns, "
+		<< "WorkStealingQueue " << benchmarkLatency<WorkStealingQueue>(nThreads, nRounds) << " ns" << std::endl;
+}
+
+TEST(HalleyExecutor, DISABLED_BenchmarkNestedParallelFor)
+{
+	TestQueue<WorkStealingQueue> pool(std::max(2u, std::thread::hardware_concurrency()));
+
+	constexpr size_t n = 2000;
+	std::vector<float> values(n * n, 1.0f);
+
+	Stopwatch stopwatch;
+	Concurrent::parallelFor(*pool, 0, n, [&] (size_t i)
+	{
+		// Triangular workload, so static splitting would be unbalanced
+		Concurrent::parallelFor(*pool, 0, i, [&] (size_t j)
+		{
+			values[i * n + j] = std::sqrt(values[i * n + j] + float(j));
+		}, 256);
+	});
+	stopwatch.pause();
+
+	std::cout << "Nested parallelFor over " << (n * n / 2) << " elements: " << (stopwatch.elapsedNanoseconds() / 1000) << " us" << std::endl;
+}
@@ -0,0 +1,307 @@
+#include <gtest/gtest.h>
+#include <halley.hpp>
+#include "halley/tools/assets/import_assets_cache.h"
+#include "halley/tools/assets/import_assets_database.h"
+#include "halley/tools/assets/import_scheduler.h"
+#include "halley/tools/file/filesystem.h"
+#include "halley/utils/hash.h"
+#include "test_executors.h"
+using namespace Halley;
+
+namespace {
+	class TemporaryDir {
+	public:
+		TemporaryDir()
+			: path(FileSystem::getTemporaryPath())
+		{
+			FileSystem::createDir(path);
+		}
+
+		~TemporaryDir()
+		{
+			FileSystem::remove(path);
+		}
+
+		const Path& getPath() const { return path; }
+
+	private:
+		Path path;
+	};
+
+	ImportAssetsDatabaseEntry makeAsset(uint64_t hash, int64_t timestamp = 1000)
+	{
+		auto asset = ImportAssetsDatabaseEntry("sprites/test", Path("assets_src"), { AssetPath(TimestampedPath(Path("sprites/test.png"), timestamp), hash) });
+		asset.assetType = ImportAssetType::Image;
+		return asset;
+	}
+
+	std::vector<AssetResource> makeOutput()
+	{
+		AssetResource out;
+		out.name = "sprites/test";
+		out.type = AssetType::Sprite;
+		out.platformVersions["pc"].filepath = "sprite/sprites/test";
+		out.primaryInputFile = Path("sprites/test.png");
+		return { out };
+	}
+
+	Path getCacheEntryPath(const Path& dir, uint64_t key)
+	{
+		const auto name = toString(key, 16, 16);
+		return dir / name.substr(0, 2) / (name + ".cache");
+	}
+
+	int getTestLimit(ImportAssetType type)
+	{
+		switch (type) {
+		case ImportAssetType::Font:
+			return 1;
+		case ImportAssetType::SpriteSheet:
+			return 2;
+		default:
+			return 0;
+		}
+	}
+}
+
+TEST(ImportAssets, ImportKeyFollowsContent)
+{
+	TemporaryDir dir;
+	ImportAssetsDatabase db(dir.getPath(), dir.getPath() / "import.db", dir.getPath() / "assets.db", { "pc" });
+
+	const auto key = db.getImportKey(makeAsset(0x1234), 1);
+	EXPECT_NE(key, 0);
+
+	// Only the contents matter, not when the file was touched
+	EXPECT_EQ(db.getImportKey(makeAsset(0x1234, 2000), 1), key);
+	EXPECT_NE(db.getImportKey(makeAsset(0x5678), 1), key);
+	EXPECT_NE(db.getImportKey(makeAsset(0x1234), 2), key);
+
+	// Can't identify the output if any input hash is unknown
+	EXPECT_EQ(db.getImportKey(makeAsset(0), 1), 0);
+
+	Metadata meta;
+	meta.set("pivotX", 0.5f);
+	db.setInputFileMetadata(Path("sprites/test.png"), { 1000, 0, 0 }, 0x1234, meta, Path("assets_src"));
+	const auto keyWithMeta = db.getImportKey(makeAsset(0x1234), 1);
+	EXPECT_NE(keyWithMeta, key);
+
+	meta.set("pivotX", 0.25f);
+	db.setInputFileMetadata(Path("sprites/test.png"), { 1000, 0, 0 }, 0x1234, meta, Path("assets_src"));
+	EXPECT_NE(db.getImportKey(makeAsset(0x1234), 1), keyWithMeta);
+}
+
+TEST(ImportAssets, NeedsImportingComparesHashes)
+{
+	TemporaryDir dir;
+	ImportAssetsDatabase db(dir.getPath(), dir.getPath() / "import.db", dir.getPath() / "assets.db", { "pc" });
+
+	EXPECT_TRUE(db.needsImporting(makeAsset(0x1234), false));
+	db.markAsImported(makeAsset(0x1234));
+	EXPECT_FALSE(db.needsImporting(makeAsset(0x1234), false));
+
+	// e.g. after a checkout, the timestamp moves but the contents are the same
+	EXPECT_FALSE(db.needsImporting(makeAsset(0x1234, 2000), false));
+	EXPECT_TRUE(db.needsImporting(makeAsset(0x5678), false));
+	EXPECT_TRUE(db.needsImporting(makeAsset(0), false));
+
+	db.markFailed(makeAsset(0x5678));
+	EXPECT_TRUE(db.needsImporting(makeAsset(0x5678), true));
+	EXPECT_FALSE(db.needsImporting(makeAsset(0x5678), false));
+}
+
+TEST(ImportAssets, CacheHitAndMiss)
+{
+	TemporaryDir dir;
+	const ImportAssetsCache cache(dir.getPath() / "cache");
+
+	const auto includePath = dir.getPath() / "include.txt";
+	FileSystem::writeFile(includePath, String("original"));
+	const auto includes = std::vector<AssetPath>{ AssetPath(TimestampedPath(includePath, 0), Hash::hash(FileSystem::readFile(includePath))) };
+	const auto outFiles = std::vector<std::pair<Path, Bytes>>{ { Path("sprite/sprites/test"), Bytes{ 1, 2, 3 } } };
+
+	constexpr uint64_t key = 0x0123456789ABCDEFull;
+	EXPECT_FALSE(cache.get(key));
+	cache.put(key, makeOutput(), outFiles, includes);
+
+	const auto entry = cache.get(key);
+	ASSERT_TRUE(entry);
+	ASSERT_EQ(entry->out.size(), 1);
+	EXPECT_EQ(entry->out[0].name, "sprites/test");
+	EXPECT_EQ(entry->out[0].type, AssetType::Sprite);
+	EXPECT_EQ(entry->out[0].platformVersions.at("pc").filepath, "sprite/sprites/test");
+	EXPECT_EQ(entry->outFiles, outFiles);
+	ASSERT_EQ(entry->additionalInputs.size(), 1);
+	EXPECT_EQ(entry->additionalInputs[0].getHash(), includes[0].getHash());
+	EXPECT_EQ(entry->additionalInputs[0].getTimestamp(), FileSystem::getLastWriteTime(includePath));
+
+	EXPECT_FALSE(cache.get(key + 1));
+
+	// Key 0 means the inputs aren't known, so nothing is stored under it
+	cache.put(0, makeOutput(), outFiles, includes);
+	EXPECT_FALSE(cache.get(0));
+	EXPECT_FALSE(FileSystem::exists(getCacheEntryPath(dir.getPath() / "cache", 0)));
+
+	// Files read by the importer aren't part of the key, but still invalidate the entry
+	FileSystem::writeFile(includePath, String("modified"));
+	EXPECT_FALSE(cache.get(key));
+}
+
+TEST(ImportAssets, CachePrunesLeastRecentlyUsed)
+{
+	TemporaryDir dir;
+	const auto cacheDir = dir.getPath() / "cache";
+	const ImportAssetsCache cache(cacheDir);
+
+	const auto keys = std::array<uint64_t, 3>{ 0x1111111111111111ull, 0x2222222222222222ull, 0x3333333333333333ull };
+	size_t totalSize = 0;
+	for (size_t i = 0; i < keys.size(); ++i) {
+		cache.put(keys[i], makeOutput(), {}, {});
+		const auto path = getCacheEntryPath(cacheDir, keys[i]);
+		FileSystem::setLastWriteTime(path, 1000 * int64_t(i + 1));
+		totalSize += FileSystem::fileSize(path);
+	}
+
+	// Within budget, nothing goes
+	cache.prune();
+	for (auto key: keys) {
+		EXPECT_TRUE(FileSystem::exists(getCacheEntryPath(cacheDir, key)));
+	}
+
+	// Using the oldest entry refreshes it, so the next oldest is evicted instead
+	const ImportAssetsCache smallCache(cacheDir, totalSize - 1);
+	EXPECT_TRUE(smallCache.get(keys[0]));
+	smallCache.prune();
+	EXPECT_TRUE(smallCache.get(keys[0]));
+	EXPECT_FALSE(smallCache.get(keys[1]));
+	EXPECT_TRUE(smallCache.get(keys[2]));
+}
+
+TEST(ImportAssets, SchedulerRespectsImporterLimits)
+{
+	TestExecutors executors(4);
+
+	std::vector<ImportAssetType> types;
+	for (int i = 0; i < 6; ++i) {
+		types.push_back(ImportAssetType::Font);
+		types.push_back(ImportAssetType::Image);
+		types.push_back(ImportAssetType::Image);
+		types.push_back(ImportAssetType::SpriteSheet);
+	}
+
+	std::map<ImportAssetType, std::atomic<int>> inFlight;
+	std::map<ImportAssetType, std::atomic<int>> mostInFlight;
+	for (const auto type: types) {
+		inFlight[type] = 0;
+		mostInFlight[type] = 0;
+	}
+	std::vector<std::atomic<int>> timesRun(types.size());
+	std::vector<int> timesFinished(types.size(), 0);
+	const auto schedulingThread = std::this_thread::get_id();
+	bool finishedOnSchedulingThread = true;
+
+	ImportScheduler scheduler(types, getTestLimit);
+	scheduler.run(&Executors::getCPU(), [&] (size_t i)
+	{
+		const auto type = types[i];
+		const int n = ++inFlight.at(type);
+		int prev = mostInFlight.at(type);
+		while (n > prev && !mostInFlight.at(type).compare_exchange_weak(prev, n)) {}
+		++timesRun[i];
+		std::this_thread::sleep_for(std::chrono::milliseconds(2));
+		--inFlight.at(type);
+	}, [&] (const std::vector<ImportScheduler::FinishedJob>& finished)
+	{
+		finishedOnSchedulingThread = finishedOnSchedulingThread && std::this_thread::get_id() == schedulingThread;
+		for (const auto& job: finished) {
+			EXPECT_FALSE(job.error);
+			++timesFinished[job.index];
+		}
+	}, [] () { return false; });
+
+	for (size_t i = 0; i < types.size(); ++i) {
+		EXPECT_EQ(timesRun[i], 1);
+		EXPECT_EQ(timesFinished[i], 1);
+	}
+	EXPECT_TRUE(finishedOnSchedulingThread);
+	EXPECT_EQ(mostInFlight[ImportAssetType::Font], 1);
+	EXPECT_LE(mostInFlight[ImportAssetType::SpriteSheet], 2);
+}
+
+TEST(ImportAssets, SchedulerStopsStartingWhenCancelled)
+{
+	TestExecutors executors(4);
+
+	const auto types = std::vector<ImportAssetType>(10, ImportAssetType::Font);
+	std::atomic<int> nRun = 0;
+	size_t nFinished = 0;
+	bool cancelled = false;
+
+	ImportScheduler scheduler(types, getTestLimit);
+	scheduler.run(&Executors::getCPU(), [&] (size_t i)
+	{
+		++nRun;
+	}, [&] (const std::vector<ImportScheduler::FinishedJob>& finished)
+	{
+		nFinished += finished.size();
+		cancelled = true;
+	}, [&] () { return cancelled; });
+
+	// Only one font at a time, so the first one is all that ran
+	EXPECT_EQ(nRun, 1);
+	EXPECT_EQ(nFinished, 1);
+}
+
+TEST(ImportAssets, SchedulerRunsInlineWithoutQueue)
+{
+	const auto types = std::vector<ImportAssetType>{ ImportAssetType::Font, ImportAssetType::Font, ImportAssetType::Image, ImportAssetType::SpriteSheet, ImportAssetType::SpriteSheet, ImportAssetType::SpriteSheet };
+	std::vector<int> timesRun(types.size(), 0);
+	size_t nFinished = 0;
+	const auto callingThread = std::this_thread::get_id();
+	bool ranOnCallingThread = true;
+
+	ImportScheduler scheduler(types, getTestLimit);
+	scheduler.run(nullptr, [&] (size_t i)
+	{
+		ranOnCallingThread = ranOnCallingThread && std::this_thread::get_id() == callingThread;
+		++timesRun[i];
+	}, [&] (const std::vector<ImportScheduler::FinishedJob>& finished)
+	{
+		nFinished += finished.size();
+	}, [] () { return false; });
+
+	EXPECT_TRUE(ranOnCallingThread);
+	EXPECT_EQ(timesRun, std::vector<int>(types.size(), 1));
+	EXPECT_EQ(nFinished, types.size());
+}
+
+TEST(ImportAssets, SchedulerReportsThrowingJobs)
+{
+	TestExecutors executors(4);
+
+	// Throwing jobs must still free up their slot, or the other fonts would never start
+	const auto types = std::vector<ImportAssetType>(6, ImportAssetType::Font);
+	std::vector<int> timesFinished(types.size(), 0);
+	std::vector<String> errors(types.size());
+
+	ImportScheduler scheduler(types, getTestLimit);
+	scheduler.run(&Executors::getCPU(), [&] (size_t i)
+	{
+		if (i % 3 == 0) {
+			throw Exception("Import " + toString(i) + " failed", HalleyExceptions::Tools);
+		} else if (i % 3 == 1) {
+			throw std::runtime_error("Import " + std::to_string(i) + " failed");
+		}
+	}, [&] (const std::vector<ImportScheduler::FinishedJob>& finished)
+	{
+		for (const auto& job: finished) {
+			++timesFinished[job.index];
+			errors[job.index] = job.error.value_or("");
+		}
+	}, [] () { return false; });
+
+	EXPECT_EQ(timesFinished, std::vector<int>(types.size(), 1));
+	for (size_t i = 0; i < types.size(); ++i) {
+		EXPECT_EQ(errors[i], i % 3 == 2 ? String() : "Import " + toString(i) + " failed");
+	}
+}
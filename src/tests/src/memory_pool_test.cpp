@@ -0,0 +1,128 @@
+#include <gtest/gtest.h>
+#include <halley.hpp>
+using namespace Halley;
+
+TEST(HalleyChunkedPool, ReusesLowestAddress)
+{
+	ChunkedPool pool(sizeof(int), 64);
+
+	// Fill the chunks completely, as they aren't necessarily allocated in address order
+	std::vector<void*> ptrs;
+	for (int i = 0; i < 256; ++i) {
+		ptrs.push_back(pool.alloc());
+	}
+	EXPECT_EQ(pool.getNumAllocated(), 256);
+	EXPECT_EQ(pool.getNumChunks(), 4);
+
+	// Free a few, the lowest one should be handed out first
+	pool.free(ptrs[150]);
+	pool.free(ptrs[10]);
+	pool.free(ptrs[70]);
+	EXPECT_EQ(pool.getNumAllocated(), 253);
+
+	auto a = static_cast<char*>(pool.alloc());
+	auto b = static_cast<char*>(pool.alloc());
+	auto c = static_cast<char*>(pool.alloc());
+	EXPECT_EQ(std::set<void*>({ a, b, c }), std::set<void*>({ ptrs[10], ptrs[70], ptrs[150] }));
+	EXPECT_TRUE(std::less<>()(a, b));
+	EXPECT_TRUE(std::less<>()(b, c));
+	EXPECT_EQ(pool.getNumChunks(), 4);
+
+	for (auto& p: ptrs) {
+		pool.free(p);
+	}
+	EXPECT_EQ(pool.getNumAllocated(), 0);
+}
+
+TEST(HalleyChunkedPool, Reserve)
+{
+	ChunkedPool pool(sizeof(int), 64);
+	pool.reserve(100);
+	EXPECT_EQ(pool.getNumChunks(), 2);
+
+	std::vector<void*> ptrs;
+	for (int i = 0; i < 100; ++i) {
+		ptrs.push_back(pool.alloc());
+	}
+	EXPECT_EQ(pool.getNumChunks(), 2);
+
+	// Only adds what's missing on top of the live elements
+	pool.reserve(28);
+	EXPECT_EQ(pool.getNumChunks(), 2);
+	pool.reserve(29);
+	EXPECT_EQ(pool.getNumChunks(), 3);
+
+	for (auto& p: ptrs) {
+		pool.free(p);
+	}
+}
+
+namespace {
+	template <size_t N>
+	struct BenchComponent {
+		std::array<float, N> data;
+	};
+
+	// Emulates a family of 100k entities with 4 components, after some churn
+	template <typename Alloc, typename Free>
+	int64_t benchmarkPool(Alloc alloc, Free free)
+	{
+		constexpr size_t nEntities = 100000;
+		constexpr size_t nComponents = 4;
+		std::vector<std::array<float*, nComponents>> family(nEntities);
+		for (auto& e: family) {
+			for (size_t i = 0; i < nComponents; ++i) {
+				e[i] = static_cast<float*>(alloc(i));
+				e[i][0] = 1.0f;
+			}
+		}
+
+		// Churn: destroy and respawn a third of the entities
+		Random rng(1234);
+		for (size_t j = 0; j < nEntities / 3; ++j) {
+			auto& e = family[rng.getSizeT(0, nEntities - 1)];
+			for (size_t i = 0; i < nComponents; ++i) {
+				free(i, e[i]);
+				e[i] = static_cast<float*>(alloc(i));
+				e[i][0] = 1.0f;
+			}
+		}
+
+		Stopwatch stopwatch;
+		float total = 0;
+		for (int k = 0; k < 20; ++k) {
+			for (auto& e: family) {
+				total += e[0][0] * e[1][0] + e[2][0] * e[3][0];
+				e[0][0] = total * 0.0001f;
+			}
+		}
+		stopwatch.pause();
+
+		for (auto& e: family) {
+			for (size_t i = 0; i < nComponents; ++i) {
+				free(i, e[i]);
+			}
+		}
+
+		EXPECT_GT(total, 0.0f);
+		return stopwatch.elapsedNanoseconds();
+	}
+}
+
+TEST(HalleyChunkedPool, DISABLED_BenchmarkPoolIteration)
+{
+	constexpr size_t componentSize = sizeof(BenchComponent<8>);
+
+	// Current layout: every component of the same size shares a pool
+	auto sizePool = PoolPool::getPool(componentSize);
+	const auto pooled = benchmarkPool([&] (size_t) { return sizePool->alloc(); }, [&] (size_t, void* p) { sizePool->free(p); });
+
+	// Chunked layout: one pool per component type
+	std::array<std::unique_ptr<ChunkedPool>, 4> chunkedPools;
+	for (auto& p: chunkedPools) {
+		p = std::make_unique<ChunkedPool>(componentSize);
+	}
+	const auto chunked = benchmarkPool([&] (size_t i) { return chunkedPools[i]->alloc(); }, [&] (size_t i, void* p) { chunkedPools[i]->free(p); });
+
+	std::cout << "Shared size pool: " << (pooled / 1000) << " us, per-type chunked pool: " << (chunked / 1000) << " us" << std::endl;
+}
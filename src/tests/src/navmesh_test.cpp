@@ -0,0 +1,383 @@
+#include <gtest/gtest.h>
+#include <halley.hpp>
+#include "halley/data_structures/rect_spatial_checker.h"
+#include "test_executors.h"
+using namespace Halley;
+
+namespace {
+	NavmeshBounds makeBounds(Vector2f origin, float size, size_t divisions)
+	{
+		return NavmeshBounds(origin, Vector2f(size, 0), Vector2f(0, size), divisions, divisions, Vector2f(1, 1));
+	}
+
+	// A scattering of boxes and diamonds, some of them straddling cell boundaries
+	std::vector<Polygon> makeObstacles(Vector2f origin, float size, int count, Random& rng)
+	{
+		std::vector<Polygon> result;
+		for (int i = 0; i < count; ++i) {
+			const auto pos = origin + Vector2f(rng.getFloat(0.05f, 0.9f), rng.getFloat(0.05f, 0.9f)) * size;
+			const float w = rng.getFloat(0.01f, 0.04f) * size;
+			if (i % 2 == 0) {
+				result.push_back(Polygon::makePolygon(pos, w, w * 1.5f));
+			} else {
+				result.push_back(Polygon(VertexList{{ pos + Vector2f(w, 0), pos + Vector2f(2 * w, w), pos + Vector2f(w, 2 * w), pos + Vector2f(0, w) }}));
+			}
+		}
+		return result;
+	}
+
+	float getTotalArea(const NavmeshSet& set)
+	{
+		float area = 0;
+		for (const auto& navmesh: set.getNavmeshes()) {
+			area += navmesh.getArea();
+		}
+		return area;
+	}
+
+	size_t getTotalNodes(const NavmeshSet& set)
+	{
+		size_t n = 0;
+		for (const auto& navmesh: set.getNavmeshes()) {
+			n += navmesh.getNumNodes();
+		}
+		return n;
+	}
+
+	// Grid of chunks, each with its own obstacles, stitched together the way a game would
+	NavmeshSet makeWorld(int chunksPerSide, int obstaclesPerChunk, Random& rng)
+	{
+		constexpr float chunkSize = 512;
+		std::vector<std::vector<Polygon>> obstacles;
+		std::vector<NavmeshGenerator::Params> chunks;
+		for (int i = 0; i < chunksPerSide * chunksPerSide; ++i) {
+			obstacles.push_back(makeObstacles(Vector2f(), chunkSize, obstaclesPerChunk, rng));
+		}
+		for (auto& o: obstacles) {
+			chunks.emplace_back(makeBounds(Vector2f(), chunkSize, 4), o, gsl::span<const Polygon>(), 0, 4.0f);
+		}
+
+		auto chunkSets = NavmeshGenerator::generateChunks(chunks);
+		NavmeshSet world;
+		for (int i = 0; i < chunksPerSide * chunksPerSide; ++i) {
+			const auto gridPos = Vector2i(i % chunksPerSide, i / chunksPerSide);
+			world.addChunk(std::move(chunkSets[i]), Vector2f(gridPos) * chunkSize, gridPos);
+		}
+		world.linkNavmeshes();
+		return world;
+	}
+
+	// NavigationPath::operator== only compares the queries
+	void expectSamePath(const std::optional<NavigationPath>& a, const std::optional<NavigationPath>& b)
+	{
+		ASSERT_EQ(a.has_value(), b.has_value());
+		if (a) {
+			EXPECT_EQ(a->path, b->path);
+			ASSERT_EQ(a->regions.size(), b->regions.size());
+			for (size_t i = 0; i < a->regions.size(); ++i) {
+				EXPECT_EQ(a->regions[i].regionNodeId, b->regions[i].regionNodeId);
+				EXPECT_EQ(a->regions[i].exitEdgeId, b->regions[i].exitEdgeId);
+			}
+		}
+	}
+
+	std::vector<NavigationQuery> makeQueries(const NavmeshSet& world, size_t count, Random& rng)
+	{
+		const auto navmeshes = world.getNavmeshes();
+		std::vector<NavigationQuery> result;
+		for (size_t i = 0; i < count; ++i) {
+			const auto from = navmeshes[rng.getSizeT(0, navmeshes.size() - 1)].getRandomPoint(rng);
+			const auto to = navmeshes[rng.getSizeT(0, navmeshes.size() - 1)].getRandomPoint(rng);
+			result.emplace_back(from, 0, to, 0, NavigationQuery::PostProcessingType::Simple);
+		}
+		return result;
+	}
+}
+
+TEST(HalleyNavmesh, GenerateAvoidsObstacles)
+{
+	TestExecutors executors(4);
+
+	const auto obstacles = std::vector<Polygon>{
+		Polygon::makePolygon(Vector2f(100, 100), 50, 50),
+		Polygon::makePolygon(Vector2f(240, 90), 40, 200) // Crosses into the next cell
+	};
+	const auto set = NavmeshGenerator::generate(makeBounds(Vector2f(), 512, 2), obstacles, {}, 0, 4.0f);
+
+	ASSERT_EQ(set.getNavmeshes().size(), 1);
+	const auto& navmesh = set.getNavmeshes()[0];
+	EXPECT_FALSE(navmesh.containsPoint(Vector2f(125, 125)));
+	EXPECT_FALSE(navmesh.containsPoint(Vector2f(260, 270)));
+	EXPECT_TRUE(navmesh.containsPoint(Vector2f(400, 400)));
+	EXPECT_TRUE(navmesh.containsPoint(Vector2f(40, 400)));
+
+	// Obstacles are grown by the agent size, so a bit more than their own area goes missing
+	const float area = navmesh.getArea();
+	EXPECT_LT(area, 512.0f * 512.0f - 50 * 50 - 40 * 200);
+	EXPECT_GT(area, 512.0f * 512.0f - 70 * 70 - 60 * 220);
+
+	// Every connection between nodes goes both ways
+	const auto& nodes = navmesh.getNodes();
+	for (size_t i = 0; i < nodes.size(); ++i) {
+		for (size_t j = 0; j < nodes[i].nConnections; ++j) {
+			if (nodes[i].connections[j]) {
+				const auto& other = nodes[nodes[i].connections[j].value()];
+				const auto back = std::find_if(other.connections.begin(), other.connections.begin() + other.nConnections, [&] (const OptionalLite<Navmesh::NodeId>& c) { return c && c.value() == i; });
+				EXPECT_NE(back, other.connections.begin() + other.nConnections);
+			}
+		}
+	}
+}
+
+TEST(HalleyNavmesh, GenerateMatchesBruteForce)
+{
+	TestExecutors executors(4);
+
+	// Plenty of obstacles straddling cell boundaries, so any obstacle or neighbour the index misses shows up below
+	Random rng(321);
+	const auto obstacles = makeObstacles(Vector2f(), 512, 80, rng);
+	const auto set = NavmeshGenerator::generate(makeBounds(Vector2f(), 512, 4), obstacles, {}, 0, 4.0f);
+	ASSERT_FALSE(set.getNavmeshes().empty());
+
+	// No point inside any of the obstacles is walkable. Grown obstacles get simplified, which can shave a little
+	// off them, so only points well inside are checked.
+	const auto isWellInside = [] (const Polygon& o, Vector2f pos)
+	{
+		return o.isPointInside(pos + Vector2f(3, 0)) && o.isPointInside(pos - Vector2f(3, 0)) && o.isPointInside(pos + Vector2f(0, 3)) && o.isPointInside(pos - Vector2f(0, 3));
+	};
+	for (float y = 2; y < 512; y += 4) {
+		for (float x = 2; x < 512; x += 4) {
+			const auto pos = Vector2f(x, y);
+			const bool blocked = std::any_of(obstacles.begin(), obstacles.end(), [&] (const Polygon& o) { return isWellInside(o, pos); });
+			if (blocked) {
+				for (const auto& navmesh: set.getNavmeshes()) {
+					EXPECT_FALSE(navmesh.containsPoint(pos)) << "at " << pos;
+				}
+			}
+		}
+	}
+
+	// Every pair of nodes that shares an edge is connected through it, and every connection is through a shared edge
+	for (const auto& navmesh: set.getNavmeshes()) {
+		const auto& nodes = navmesh.getNodes();
+		const auto& polygons = navmesh.getPolygons();
+		for (size_t a = 0; a < nodes.size(); ++a) {
+			ASSERT_EQ(nodes[a].nConnections, polygons[a].getNumSides());
+			for (size_t edge = 0; edge < nodes[a].nConnections; ++edge) {
+				std::optional<size_t> expected;
+				for (size_t b = 0; b < nodes.size(); ++b) {
+					if (b != a && polygons[b].findEdge(polygons[a].getEdge(edge), 0.0001f)) {
+						expected = b;
+					}
+				}
+
+				const auto& connection = nodes[a].connections[edge];
+				ASSERT_EQ(connection.has_value(), expected.has_value()) << "node " << a << ", edge " << edge;
+				if (connection) {
+					EXPECT_EQ(connection.value(), expected.value());
+				}
+			}
+		}
+	}
+}
+
+TEST(HalleyNavmesh, GenerateChunksMatchesSerial)
+{
+	TestExecutors executors(4);
+
+	Random rng(1234);
+	std::vector<std::vector<Polygon>> obstacles;
+	std::vector<NavmeshGenerator::Params> chunks;
+	for (int i = 0; i < 4; ++i) {
+		const auto origin = Vector2f(float(i % 2), float(i / 2)) * 512.0f;
+		obstacles.push_back(makeObstacles(origin, 512, 30, rng));
+	}
+	for (int i = 0; i < 4; ++i) {
+		const auto origin = Vector2f(float(i % 2), float(i / 2)) * 512.0f;
+		chunks.emplace_back(makeBounds(origin, 512, 4), obstacles[i], gsl::span<const Polygon>(), 0, 4.0f);
+	}
+
+	const auto results = NavmeshGenerator::generateChunks(chunks);
+	ASSERT_EQ(results.size(), chunks.size());
+	for (size_t i = 0; i < chunks.size(); ++i) {
+		const auto& c = chunks[i];
+		const auto expected = NavmeshGenerator::generate(c.bounds, c.obstacles, c.regions, c.subWorld, c.agentSize);
+		EXPECT_EQ(results[i].getNavmeshes().size(), expected.getNavmeshes().size());
+		EXPECT_EQ(getTotalNodes(results[i]), getTotalNodes(expected));
+		EXPECT_FLOAT_EQ(getTotalArea(results[i]), getTotalArea(expected));
+	}
+}
+
+TEST(HalleyNavmesh, PathfindAcrossChunks)
+{
+	TestExecutors executors(4);
+
+	Random rng(99);
+	auto world = makeWorld(3, 10, rng);
+	const auto queries = makeQueries(world, 200, rng);
+
+	const auto batch = world.pathfindBatch(queries);
+	ASSERT_EQ(batch.size(), queries.size());
+
+	size_t nCrossRegion = 0;
+	for (size_t i = 0; i < queries.size(); ++i) {
+		const auto path = world.pathfind(queries[i]);
+		expectSamePath(path, batch[i]);
+		if (!path) {
+			continue;
+		}
+
+		// Region paths start where the query starts, end where it ends, and only step between linked regions
+		const auto& regions = path->regions;
+		if (!regions.empty()) {
+			++nCrossRegion;
+			EXPECT_TRUE(world.getNavmeshes()[regions.front().regionNodeId].containsPoint(queries[i].from));
+			EXPECT_TRUE(world.getNavmeshes()[regions.back().regionNodeId].containsPoint(queries[i].to));
+			for (size_t j = 0; j + 1 < regions.size(); ++j) {
+				EXPECT_NE(regions[j].exitEdgeId, std::numeric_limits<uint16_t>::max());
+				EXPECT_NE(regions[j].regionNodeId, regions[j + 1].regionNodeId);
+			}
+		}
+	}
+	EXPECT_GT(nCrossRegion, 0);
+
+	// Relinking drops the cached routes, but finds the same ones again
+	world.linkNavmeshes();
+	for (size_t i = 0; i < queries.size(); ++i) {
+		expectSamePath(world.pathfind(queries[i]), batch[i]);
+	}
+}
+
+TEST(HalleyNavmesh, RegionLookupMatchesLinearSearch)
+{
+	TestExecutors executors(4);
+
+	Random rng(5);
+	const auto world = makeWorld(4, 10, rng);
+	const auto navmeshes = world.getNavmeshes();
+
+	for (int i = 0; i < 2000; ++i) {
+		const auto pos = Vector2f(rng.getFloat(-100, 2148), rng.getFloat(-100, 2148));
+
+		size_t expected = std::numeric_limits<size_t>::max();
+		for (size_t j = 0; j < navmeshes.size(); ++j) {
+			if (navmeshes[j].containsPoint(pos)) {
+				expected = j;
+				break;
+			}
+		}
+		EXPECT_EQ(world.getNavMeshIdxAt(pos, 0), expected);
+		EXPECT_EQ(world.getNavMeshIdxAt(pos, 1), std::numeric_limits<size_t>::max());
+
+		// Positions just off the navmesh snap to the closest polygon
+		if (expected == std::numeric_limits<size_t>::max()) {
+			for (const auto& navmesh: navmeshes) {
+				float bestDist = std::numeric_limits<float>::infinity();
+				for (const auto& poly: navmesh.getPolygons()) {
+					bestDist = std::min(bestDist, (poly.getClosestPoint(pos) - pos).length());
+				}
+				const auto node = navmesh.getNodeAt(pos);
+				ASSERT_EQ(node.has_value(), bestDist < 5.0f) << "at " << pos;
+				if (node) {
+					EXPECT_NEAR((navmesh.getPolygon(node.value()).getClosestPoint(pos) - pos).length(), bestDist, 0.01f);
+				}
+			}
+		}
+	}
+}
+
+TEST(HalleyNavmesh, SpatialCheckerSingleCellRect)
+{
+	// Cells are 128 units wide, so this rect starts and ends in the same cell
+	RectangleSpatialChecker checker(7);
+	const auto firstCell = Rect4i(0, 0, 128, 128);
+	const auto otherCell = Rect4i(256, 256, 128, 128);
+
+	checker.add(Rect4i(10, 10, 20, 20), 1);
+	EXPECT_EQ(checker.query(firstCell).n, 1);
+	EXPECT_EQ(checker.query(otherCell).n, 0);
+
+	checker.update(Rect4i(300, 300, 20, 20), 1);
+	EXPECT_EQ(checker.query(firstCell).n, 0);
+	ASSERT_EQ(checker.query(otherCell).n, 1);
+	EXPECT_EQ(checker.query(otherCell).results[0], 1);
+
+	checker.remove(1);
+	EXPECT_EQ(checker.query(firstCell).n, 0);
+	EXPECT_EQ(checker.query(otherCell).n, 0);
+}
+
+TEST(HalleyNavmesh, DISABLED_BenchmarkRegionLookup)
+{
+	TestExecutors executors(std::max(2u, std::thread::hardware_concurrency()));
+
+	Random rng(11);
+	const auto world = makeWorld(16, 10, rng);
+	const auto navmeshes = world.getNavmeshes();
+	std::vector<Vector2f> points;
+	for (int i = 0; i < 10000; ++i) {
+		points.push_back(Vector2f(rng.getFloat(0, 16 * 512), rng.getFloat(0, 16 * 512)));
+	}
+
+	Stopwatch linearTime;
+	size_t linearFound = 0;
+	for (const auto& p: points) {
+		for (const auto& navmesh: navmeshes) {
+			if (navmesh.containsPoint(p)) {
+				++linearFound;
+				break;
+			}
+		}
+	}
+	linearTime.pause();
+
+	Stopwatch indexedTime;
+	size_t indexedFound = 0;
+	for (const auto& p: points) {
+		indexedFound += world.getNavMeshIdxAt(p, 0) != std::numeric_limits<size_t>::max() ? 1 : 0;
+	}
+	indexedTime.pause();
+
+	EXPECT_EQ(linearFound, indexedFound);
+	std::cout << points.size() << " lookups over " << navmeshes.size() << " navmeshes: "
+		<< "linear " << linearTime.elapsedMilliseconds() << " ms, indexed " << indexedTime.elapsedMilliseconds() << " ms" << std::endl;
+}
+
+TEST(HalleyNavmesh, DISABLED_BenchmarkPathfind)
+{
+	TestExecutors executors(std::max(2u, std::thread::hardware_concurrency()));
+
+	Random rng(7);
+	const auto world = makeWorld(8, 10, rng);
+	const auto queries = makeQueries(world, 1000, rng);
+
+	Stopwatch serialTime;
+	size_t nFound = 0;
+	for (const auto& query: queries) {
+		nFound += world.pathfind(query) ? 1 : 0;
+	}
+	serialTime.pause();
+
+	Stopwatch batchTime;
+	const auto results = world.pathfindBatch(queries);
+	batchTime.pause();
+
+	std::cout << queries.size() << " queries over " << world.getNavmeshes().size() << " navmeshes (" << nFound << " found): "
+		<< "serial " << serialTime.elapsedMilliseconds() << " ms, batch " << batchTime.elapsedMilliseconds() << " ms" << std::endl;
+}
+
+TEST(HalleyNavmesh, DISABLED_BenchmarkGenerate)
+{
+	TestExecutors executors(std::max(2u, std::thread::hardware_concurrency()));
+
+	for (const int nObstacles: { 100, 200, 400 }) {
+		Random rng(42);
+		const auto obstacles = makeObstacles(Vector2f(), 4096, nObstacles, rng);
+
+		Stopwatch time;
+		const auto set = NavmeshGenerator::generate(makeBounds(Vector2f(), 4096, 16), obstacles, {}, 0, 8.0f);
+		time.pause();
+
+		std::cout << nObstacles << " obstacles: " << time.elapsedMilliseconds() << " ms, " << getTotalNodes(set) << " nodes, area " << getTotalArea(set) << std::endl;
+	}
+}
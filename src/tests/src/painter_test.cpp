@@ -0,0 +1,438 @@
+#include <gtest/gtest.h>
+#include <halley.hpp>
+using namespace Halley;
+
+namespace {
+	Vector<SpriteVertexAttrib> makeSpriteData(size_t n)
+	{
+		Vector<SpriteVertexAttrib> result(n);
+		for (size_t i = 0; i < n; ++i) {
+			auto& v = result[i];
+			v.pos = Vector2f(float(i), float(i * 2));
+			v.size = Vector2f(16, 16);
+			v.scale = Vector2f(1, 1);
+			v.colour = Colour4f(1, 0.5f, 0.25f, 1);
+			v.texRect0 = Rect4f(0, 0, 1, 1);
+			v.rotation = float(i) * 0.01f;
+		}
+		return result;
+	}
+
+	// The per-vertex loop drawSprites used before the batched path
+	void expandSpriteVerticesReference(char* dst, const char* src, size_t numSprites, size_t vertexSize, size_t vertexStride, size_t vertPosOffset)
+	{
+		for (size_t i = 0; i < numSprites; i++) {
+			for (size_t j = 0; j < 4; j++) {
+				const size_t dstOffset = (i * 4 + j) * vertexStride;
+				memmove(dst + dstOffset, src + i * vertexStride, vertexSize);
+				const float x = ((j & 1) ^ ((j & 2) >> 1)) * 1.0f;
+				const float y = ((j & 2) >> 1) * 1.0f;
+				const Vector4f vertPos(x, y, x, y);
+				memcpy(dst + dstOffset + vertPosOffset, &vertPos, sizeof(vertPos));
+			}
+		}
+	}
+
+	ConfigNode makeAttribute(const char* name, const char* type, const char* semantic, bool vertPos = false)
+	{
+		ConfigNode::MapType attribute;
+		attribute["name"] = ConfigNode(name);
+		attribute["type"] = ConfigNode(type);
+		attribute["semantic"] = ConfigNode(semantic);
+		if (vertPos) {
+			attribute["special"] = ConfigNode("vertPos");
+		}
+		return ConfigNode(std::move(attribute));
+	}
+
+	// Definitions have no passes, so nothing is actually drawn, but everything up to the backend calls still runs
+	std::shared_ptr<MaterialDefinition> makeMaterialDefinition(const char* name, bool instanced)
+	{
+		ConfigNode::SequenceType attributes;
+		attributes.push_back(makeAttribute("a_position", "vec2", "POSITION"));
+		attributes.push_back(makeAttribute("a_vertPos", "vec4", "VERTPOS", true));
+		attributes.push_back(makeAttribute("a_colour", "vec4", "COLOR"));
+
+		ConfigNode::MapType root;
+		root["name"] = ConfigNode(name);
+		root["instanced"] = ConfigNode(instanced);
+		root["attributes"] = ConfigNode(std::move(attributes));
+
+		auto definition = std::make_shared<MaterialDefinition>();
+		definition->load(ConfigNode(std::move(root)));
+		return definition;
+	}
+
+	// Matches SpriteVertexAttrib, so sprites can be drawn with it
+	std::shared_ptr<MaterialDefinition> makeSpriteMaterialDefinition()
+	{
+		ConfigNode::SequenceType attributes;
+		attributes.push_back(makeAttribute("a_vertPos", "vec4", "VERTPOS", true));
+		attributes.push_back(makeAttribute("a_position", "vec2", "POSITION"));
+		attributes.push_back(makeAttribute("a_pivot", "vec2", "TEXCOORD"));
+		attributes.push_back(makeAttribute("a_size", "vec2", "TEXCOORD"));
+		attributes.push_back(makeAttribute("a_scale", "vec2", "TEXCOORD"));
+		attributes.push_back(makeAttribute("a_colour", "vec4", "COLOR"));
+		attributes.push_back(makeAttribute("a_texCoord0", "vec4", "TEXCOORD"));
+		attributes.push_back(makeAttribute("a_texCoord1", "vec4", "TEXCOORD"));
+		attributes.push_back(makeAttribute("a_custom0", "vec4", "TEXCOORD"));
+		attributes.push_back(makeAttribute("a_custom1", "vec4", "TEXCOORD"));
+		attributes.push_back(makeAttribute("a_rotation", "float", "TEXCOORD"));
+		attributes.push_back(makeAttribute("a_textureRotation", "float", "TEXCOORD"));
+
+		ConfigNode::MapType root;
+		root["name"] = ConfigNode("Sprite");
+		root["instanced"] = ConfigNode(true);
+		root["attributes"] = ConfigNode(std::move(attributes));
+
+		auto definition = std::make_shared<MaterialDefinition>();
+		definition->load(ConfigNode(std::move(root)));
+		return definition;
+	}
+
+	std::shared_ptr<MaterialDefinition> makeGlobalMaterialDefinition()
+	{
+		ConfigNode::MapType mvp;
+		mvp["u_mvp"] = ConfigNode("mat4");
+		ConfigNode::MapType viewPortSize;
+		viewPortSize["u_viewPortSize"] = ConfigNode("vec2");
+		ConfigNode::SequenceType uniforms;
+		uniforms.push_back(ConfigNode(std::move(mvp)));
+		uniforms.push_back(ConfigNode(std::move(viewPortSize)));
+		ConfigNode::MapType block;
+		block["HalleyBlock"] = ConfigNode(std::move(uniforms));
+		ConfigNode::SequenceType blocks;
+		blocks.push_back(ConfigNode(std::move(block)));
+
+		ConfigNode::MapType root;
+		root["name"] = ConfigNode("Halley/MaterialBase");
+		root["uniforms"] = ConfigNode(std::move(blocks));
+
+		auto definition = std::make_shared<MaterialDefinition>();
+		definition->load(ConfigNode(std::move(root)));
+		return definition;
+	}
+
+	class TestRenderTarget final : public RenderTarget {
+	public:
+		Rect4i getViewPort() const override { return Rect4i(0, 0, 1280, 720); }
+	};
+
+	struct SubmittedBatch {
+		bool instanced;
+		size_t numVertices;
+		size_t numIndices;
+	};
+
+	// Painter without a video backend, which records what would have been sent to the GPU
+	class HeadlessPainter final : public Painter {
+	public:
+		HeadlessPainter(Resources& resources, bool instancing)
+			: Painter(resources)
+			, instancing(instancing)
+		{}
+
+		void begin()
+		{
+			bind(camera, renderTarget);
+		}
+
+		void clear(std::optional<Colour> colour, std::optional<float> depth, std::optional<uint32_t> stencil) override {}
+		void setMaterialPass(const Material& material, int pass) override {}
+		void setMaterialData(const Material& material) override {}
+
+		std::vector<SubmittedBatch> batches;
+		std::vector<Vector2f> spritesDrawn; // Positions of the sprites drawn with a sprite material, in order
+
+	protected:
+		void doStartRender() override {}
+		void doEndRender() override {}
+		void setVertices(const MaterialDefinition& material, size_t numVertices, void* vertexData, size_t numIndices, IndexType* indices, bool standardQuadsOnly) override
+		{
+			batches.push_back(SubmittedBatch{ false, numVertices, numIndices });
+		}
+		void drawTriangles(size_t numIndices) override {}
+		bool supportsInstancing() const override { return instancing; }
+		void setInstances(const MaterialDefinition& material, size_t numInstances, void* instanceData) override
+		{
+			batches.push_back(SubmittedBatch{ true, numInstances, 0 });
+			if (material.getVertexStride() == sizeof(SpriteVertexAttrib)) {
+				const auto* sprites = static_cast<const SpriteVertexAttrib*>(instanceData);
+				for (size_t i = 0; i < numInstances; ++i) {
+					spritesDrawn.push_back(sprites[i].pos);
+				}
+			}
+		}
+		void drawInstancedQuads(size_t numInstances) override {}
+		void setViewPort(Rect4i rect) override {}
+		void setClip(Rect4i clip, bool enable) override {}
+		void onUpdateProjection(Material& material) override {}
+
+	private:
+		bool instancing;
+		Camera camera;
+		TestRenderTarget renderTarget;
+	};
+
+	class TestPainterResources {
+	public:
+		TestPainterResources()
+			: resources(std::unique_ptr<ResourceLocator>(), api, {})
+		{
+			resources.init<MaterialDefinition>();
+			auto& materials = resources.of<MaterialDefinition>();
+			materials.setResource(0, "Halley/MaterialBase", makeGlobalMaterialDefinition());
+			materials.setResource(0, "Halley/SolidLine", makeMaterialDefinition("Halley/SolidLine", false));
+			materials.setResource(0, "Halley/SolidPolygon", makeMaterialDefinition("Halley/SolidPolygon", false));
+		}
+
+		Resources& operator*() { return resources; }
+
+	private:
+		HalleyAPI api{};
+		Resources resources;
+	};
+}
+
+TEST(HalleyPainter, ExpandSpriteVertices)
+{
+	constexpr size_t n = 37;
+	constexpr size_t stride = sizeof(SpriteVertexAttrib);
+	const auto sprites = makeSpriteData(n);
+	const auto* src = reinterpret_cast<const char*>(sprites.data());
+
+	Vector<char> expected(n * 4 * stride);
+	Vector<char> actual(n * 4 * stride);
+	expandSpriteVerticesReference(expected.data(), src, n, stride, stride, 0);
+	Painter::expandSpriteVertices(actual.data(), src, n, stride, stride, stride, 0);
+	EXPECT_EQ(expected, actual);
+
+	// Odd layouts take the scalar path
+	Vector<char> expectedOdd(n * 4 * stride);
+	Vector<char> actualOdd(n * 4 * stride);
+	expandSpriteVerticesReference(expectedOdd.data(), src, n, stride - 8, stride, 8);
+	Painter::expandSpriteVertices(actualOdd.data(), src, n, stride, stride - 8, stride, 8);
+	for (size_t i = 0; i < n * 4; ++i) {
+		EXPECT_EQ(memcmp(expectedOdd.data() + i * stride, actualOdd.data() + i * stride, stride - 8), 0);
+	}
+}
+
+TEST(HalleyPainter, GenerateQuadIndices)
+{
+	for (size_t n: { 0, 1, 3, 4, 5, 17 }) {
+		Vector<IndexType> indices(n * 6);
+		Painter::generateQuadIndices(100, n, indices.data());
+		for (size_t i = 0; i < n; ++i) {
+			const IndexType base = IndexType(100 + i * 4);
+			const Vector<IndexType> quad = { base, IndexType(base + 1), IndexType(base + 2), IndexType(base + 2), IndexType(base + 3), base };
+			EXPECT_EQ(Vector<IndexType>(indices.begin() + i * 6, indices.begin() + i * 6 + 6), quad);
+		}
+	}
+}
+
+TEST(HalleyPainter, InstancedSprites)
+{
+	TestPainterResources resources;
+	const auto instanced = std::make_shared<Material>(makeMaterialDefinition("Instanced", true));
+	const auto regular = std::make_shared<Material>(makeMaterialDefinition("Regular", false));
+	const size_t stride = instanced->getDefinition().getVertexStride();
+	Vector<char> data(100 * stride);
+
+	for (const bool instancing: { true, false }) {
+		HeadlessPainter painter(*resources, instancing);
+		painter.begin();
+
+		painter.drawSprites(instanced, 60, data.data());
+		painter.drawSprites(instanced, 40, data.data());
+		painter.drawSprites(regular, 10, data.data());
+		painter.drawSprites(instanced, 5, data.data());
+		painter.flush();
+
+		if (instancing) {
+			// Consecutive instanced runs batch together, and switching modes flushes
+			ASSERT_EQ(painter.batches.size(), 3);
+			EXPECT_TRUE(painter.batches[0].instanced);
+			EXPECT_EQ(painter.batches[0].numVertices, 100);
+			EXPECT_FALSE(painter.batches[1].instanced);
+			EXPECT_EQ(painter.batches[1].numVertices, 40);
+			EXPECT_EQ(painter.batches[1].numIndices, 60);
+			EXPECT_TRUE(painter.batches[2].instanced);
+			EXPECT_EQ(painter.batches[2].numVertices, 5);
+			EXPECT_EQ(painter.getNumBytesUploaded(), 105 * stride + 40 * stride + 60 * sizeof(IndexType));
+		} else {
+			// Backends without instancing get the regular expanded quads
+			ASSERT_EQ(painter.batches.size(), 3);
+			for (auto& batch: painter.batches) {
+				EXPECT_FALSE(batch.instanced);
+			}
+			EXPECT_EQ(painter.batches[0].numVertices, 400);
+			EXPECT_EQ(painter.getNumBytesUploaded(), 115 * 4 * stride + 115 * 6 * sizeof(IndexType));
+		}
+	}
+}
+
+TEST(HalleyPainter, SpritePainterOrder)
+{
+	TestPainterResources resources;
+	const auto material = std::make_shared<Material>(makeSpriteMaterialDefinition());
+	ASSERT_EQ(material->getDefinition().getVertexStride(), sizeof(SpriteVertexAttrib));
+
+	struct Entry {
+		int layer;
+		float tieBreaker;
+		bool isStatic;
+		size_t id;
+	};
+
+	// Spread over a few layers and bands, with plenty of ties, all on screen; the x position identifies each sprite
+	Random rng(1234);
+	std::vector<Entry> entries;
+	std::vector<Sprite> sprites(300);
+	for (size_t i = 0; i < sprites.size(); ++i) {
+		const auto& e = entries.emplace_back(Entry{ rng.getInt(-2, 2), float(rng.getInt(-10, 10) * 10), rng.getInt(0, 3) == 0, i });
+		sprites[i].setMaterial(material).setSize(Vector2f(4, 4)).setPosition(Vector2f(float(i), e.tieBreaker));
+	}
+
+	SpritePainter spritePainter;
+	for (int frame = 0; frame < 2; ++frame) {
+		// Static entries are only added once, and kept across frames
+		spritePainter.start();
+		for (const auto& e: entries) {
+			if (!e.isStatic) {
+				spritePainter.add(sprites[e.id], 1, e.layer, e.tieBreaker);
+			} else if (frame == 0) {
+				spritePainter.addStatic(sprites[e.id], 1, e.layer, e.tieBreaker);
+			}
+		}
+
+		HeadlessPainter painter(*resources, true);
+		painter.begin();
+		spritePainter.draw(1, painter);
+
+		// Layer first, then tie breaker, with static entries before dynamic ones and otherwise in insert order
+		auto expected = entries;
+		std::stable_sort(expected.begin(), expected.end(), [] (const Entry& a, const Entry& b)
+		{
+			return std::make_tuple(a.layer, a.tieBreaker, !a.isStatic) < std::make_tuple(b.layer, b.tieBreaker, !b.isStatic);
+		});
+		ASSERT_EQ(painter.spritesDrawn.size(), expected.size());
+		for (size_t i = 0; i < expected.size(); ++i) {
+			EXPECT_EQ(painter.spritesDrawn[i].x, float(expected[i].id));
+		}
+	}
+}
+
+TEST(HalleyPainter, SpritePainterCulling)
+{
+	TestPainterResources resources;
+	const auto material = std::make_shared<Material>(makeSpriteMaterialDefinition());
+
+	HeadlessPainter painter(*resources, true);
+	painter.begin();
+	const auto view = painter.getCurrentCamera().getClippingRectangle();
+
+	auto makeSprite = [&] (Vector2f pos)
+	{
+		Sprite sprite;
+		sprite.setMaterial(material).setSize(Vector2f(4, 4)).setPosition(pos);
+		return sprite;
+	};
+
+	// Band 0 is entirely in view, band 1 straddles its edge, and band 2 is entirely out of it
+	const float right = view.getRight();
+	std::vector<Sprite> sprites;
+	sprites.push_back(makeSprite(Vector2f(0, 0)));
+	sprites.push_back(makeSprite(Vector2f(right - 10, 40)));
+	sprites.push_back(makeSprite(Vector2f(right + 10, 40)));
+	sprites.push_back(makeSprite(Vector2f(right + 10, 70)));
+	sprites.push_back(makeSprite(Vector2f(0, 1)).setVisible(false));
+	sprites.push_back(makeSprite(Vector2f(0, 2)));
+
+	SpritePainter spritePainter;
+	spritePainter.start();
+	for (size_t i = 0; i < 4; ++i) {
+		spritePainter.add(sprites[i], 1, 0, sprites[i].getPosition().y);
+	}
+	spritePainter.add(sprites[4], 1, 0, 0);
+	spritePainter.add(sprites[5], 2, 0, 0);
+
+	// Several sprites in one entry are culled individually when the entry is only partially in view
+	spritePainter.addCopy(gsl::span<const Sprite>(sprites.data() + 1, 2), 1, 0, 50);
+	spritePainter.draw(1, painter);
+
+	const std::vector<Vector2f> expected = { Vector2f(0, 0), Vector2f(right - 10, 40), Vector2f(right - 10, 40) };
+	EXPECT_EQ(painter.spritesDrawn, expected);
+
+	// Masks select which entries get drawn
+	painter.spritesDrawn.clear();
+	spritePainter.draw(2, painter);
+	EXPECT_EQ(painter.spritesDrawn, std::vector<Vector2f>{ Vector2f(0, 2) });
+}
+
+TEST(HalleyPainter, DISABLED_BenchmarkSpriteExpansion)
+{
+	constexpr size_t n = 10000;
+	constexpr size_t nFrames = 200;
+	constexpr size_t stride = sizeof(SpriteVertexAttrib);
+	const auto sprites = makeSpriteData(n);
+	const auto* src = reinterpret_cast<const char*>(sprites.data());
+	Vector<char> vertices(n * 4 * stride);
+	Vector<IndexType> indices(n * 6);
+
+	auto measure = [&] (auto f)
+	{
+		Stopwatch stopwatch;
+		for (size_t i = 0; i < nFrames; ++i) {
+			f();
+		}
+		stopwatch.pause();
+		return double(n * nFrames) / (double(stopwatch.elapsedNanoseconds()) / 1000000.0);
+	};
+
+	const auto reference = measure([&] ()
+	{
+		expandSpriteVerticesReference(vertices.data(), src, n, stride, stride, 0);
+		for (size_t i = 0; i < n; ++i) {
+			const IndexType pos = IndexType(i * 4);
+			IndexType* target = indices.data() + i * 6;
+			target[0] = pos;
+			target[1] = pos + 1;
+			target[2] = pos + 2;
+			target[3] = pos + 2;
+			target[4] = pos + 3;
+			target[5] = pos;
+		}
+	});
+
+	const auto batched = measure([&] ()
+	{
+		Painter::expandSpriteVertices(vertices.data(), src, n, stride, stride, stride, 0);
+		Painter::generateQuadIndices(0, n, indices.data());
+	});
+
+	std::cout << "Sprites per ms: per-vertex " << size_t(reference) << ", batched " << size_t(batched) << std::endl;
+}
+
+TEST(HalleyPainter, DISABLED_BenchmarkInstancedSprites)
+{
+	constexpr size_t n = 10000;
+	constexpr size_t nFrames = 200;
+	TestPainterResources resources;
+	const auto material = std::make_shared<Material>(makeMaterialDefinition("Instanced", true));
+	Vector<char> data(n * material->getDefinition().getVertexStride());
+
+	for (const bool instancing: { false, true }) {
+		HeadlessPainter painter(*resources, instancing);
+		painter.begin();
+
+		Stopwatch stopwatch;
+		for (size_t i = 0; i < nFrames; ++i) {
+			painter.drawSprites(material, n, data.data());
+			painter.flush();
+		}
+		stopwatch.pause();
+
+		std::cout << (instancing ? "Instanced" : "Per-vertex") << ": " << size_t(double(n * nFrames) / (double(stopwatch.elapsedNanoseconds()) / 1000000.0))
+			<< " sprites per ms, " << (painter.getNumBytesUploaded() / nFrames / 1024) << " KiB per frame" << std::endl;
+	}
+}
@@ -0,0 +1,209 @@
+#include <gtest/gtest.h>
+#include <halley.hpp>
+#include "test_executors.h"
+using namespace Halley;
+
+namespace {
+	class TestParticles {
+	public:
+		TestParticles()
+			: resources(std::unique_ptr<ResourceLocator>(), api, {})
+		{}
+
+		Particles make(ConfigNode::MapType config, size_t nSprites = 1)
+		{
+			Particles particles(ConfigNode(std::move(config)), resources);
+			particles.setSprites(makeSprites(nSprites, Vector2f(4, 4)));
+			return particles;
+		}
+
+		std::vector<Sprite> makeSprites(size_t n, Vector2f size)
+		{
+			auto material = std::make_shared<Material>(std::make_shared<MaterialDefinition>());
+			std::vector<Sprite> sprites;
+			for (size_t i = 0; i < n; ++i) {
+				sprites.push_back(Sprite().setMaterial(material).setSize(size).setColour(Colour4f(1, 1, 1, 0.5f)));
+			}
+			return sprites;
+		}
+
+	private:
+		HalleyAPI api{};
+		Resources resources;
+	};
+
+	ConfigNode::MapType makeConfig(int burst, float ttl)
+	{
+		ConfigNode::MapType config;
+		config["burst"] = ConfigNode(burst);
+		config["ttl"] = ConfigNode(ttl);
+		config["speed"] = ConfigNode(10.0f);
+		config["angle"] = ConfigNode(0.0f);
+		return config;
+	}
+}
+
+TEST(HalleyParticles, Simulation)
+{
+	TestParticles factory;
+	auto config = makeConfig(100, 1.0f);
+	config["acceleration"] = ConfigNode(Vector2f(0, 20));
+	config["fadeOutTime"] = ConfigNode(0.5f);
+	auto particles = factory.make(config);
+
+	particles.update(0.25);
+	particles.update(0.25);
+	ASSERT_EQ(particles.getNumParticlesAlive(), 100);
+
+	// Two steps of semi-implicit Euler, and halfway through the fade out
+	const auto sprites = particles.getSprites();
+	ASSERT_EQ(sprites.size(), 100);
+	for (auto& sprite: sprites) {
+		EXPECT_NEAR(sprite.getPosition().x, 5.0f, 0.001f);
+		EXPECT_NEAR(sprite.getPosition().y, 3.75f, 0.001f);
+		EXPECT_NEAR(sprite.getColour().a, 1.0f, 0.001f);
+		EXPECT_NEAR(sprite.getSize().x, 4.0f, 0.001f);
+	}
+
+	particles.update(0.25);
+	for (auto& sprite: particles.getSprites()) {
+		EXPECT_NEAR(sprite.getColour().a, 0.5f, 0.001f);
+	}
+
+	particles.update(0.25);
+	EXPECT_EQ(particles.getNumParticlesAlive(), 0);
+	EXPECT_EQ(particles.getSprites().size(), 0);
+}
+
+TEST(HalleyParticles, RemovesOnlyDeadParticles)
+{
+	TestParticles factory;
+	auto config = makeConfig(1000, 1.0f);
+	config["ttlScatter"] = ConfigNode(0.5f);
+	auto particles = factory.make(config, 3);
+
+	size_t prevAlive = 1000;
+	for (int i = 0; i < 20; ++i) {
+		particles.update(0.1);
+		const float time = float(i + 1) * 0.1f;
+		const size_t alive = particles.getNumParticlesAlive();
+		EXPECT_LE(alive, prevAlive);
+		prevAlive = alive;
+
+		// Everyone left moved the same distance
+		for (auto& sprite: particles.getSprites()) {
+			EXPECT_NEAR(sprite.getPosition().x, 10.0f * time, 0.001f);
+		}
+	}
+	EXPECT_EQ(prevAlive, 0);
+}
+
+TEST(HalleyParticles, CullsSpritesOutsideArea)
+{
+	TestParticles factory;
+	auto config = makeConfig(200, 10.0f);
+	config["spawnArea"] = ConfigNode(Vector2f(1000, 0));
+	auto particles = factory.make(config);
+	particles.update(0.1);
+
+	const auto all = particles.getSprites();
+	const auto expected = std::count_if(all.begin(), all.end(), [] (const Sprite& s) { return s.getPosition().x < 0; });
+	const auto visible = particles.getSprites(Rect4f(-600, -100, 592, 200));
+	EXPECT_EQ(visible.size(), expected);
+	for (auto& sprite: visible) {
+		EXPECT_LT(sprite.getPosition().x, 0);
+	}
+}
+
+TEST(HalleyParticles, ChangeSpritesWhileAlive)
+{
+	TestParticles factory;
+	auto particles = factory.make(makeConfig(100, 10.0f), 3);
+	particles.update(0.1);
+	ASSERT_EQ(particles.getSprites().size(), 100);
+
+	// Fewer sprites than before, so existing particles can't keep the ones they had
+	particles.setSprites(factory.makeSprites(1, Vector2f(8, 8)));
+	particles.update(0.1);
+	auto sprites = particles.getSprites();
+	ASSERT_EQ(sprites.size(), 100);
+	for (auto& sprite: sprites) {
+		EXPECT_NEAR(sprite.getSize().x, 8.0f, 0.001f);
+	}
+
+	// Also without an update in between
+	particles.setSprites(factory.makeSprites(2, Vector2f(16, 16)));
+	sprites = particles.getSprites();
+	ASSERT_EQ(sprites.size(), 100);
+	for (auto& sprite: sprites) {
+		EXPECT_NEAR(sprite.getSize().x, 16.0f, 0.001f);
+	}
+}
+
+TEST(HalleyParticles, ParallelUpdate)
+{
+	TestExecutors executors(2); // Parallel updates run on the default executor
+	TestParticles factory;
+	auto config = makeConfig(20000, 1.0f);
+	config["ttlScatter"] = ConfigNode(0.5f);
+	config["acceleration"] = ConfigNode(Vector2f(3, 7));
+	config["speedDamp"] = ConfigNode(0.5f);
+	config["fadeInTime"] = ConfigNode(0.2f);
+
+	auto serial = factory.make(config);
+	auto parallel = factory.make(config);
+	parallel.setParallelUpdate(true);
+
+	// Same setup apart from the spawn randomness, so every particle should be in the same place
+	for (int i = 0; i < 10; ++i) {
+		serial.update(0.05);
+		parallel.update(0.05);
+	}
+	const auto a = serial.getSprites();
+	const auto b = parallel.getSprites();
+	ASSERT_GT(a.size(), 0);
+	ASSERT_GT(b.size(), 0);
+	for (size_t i = 0; i < b.size(); ++i) {
+		EXPECT_NEAR(b[i].getPosition().x, a[0].getPosition().x, 0.001f);
+		EXPECT_NEAR(b[i].getPosition().y, a[0].getPosition().y, 0.001f);
+		EXPECT_NEAR(b[i].getColour().a, 1.0f, 0.001f);
+	}
+}
+
+TEST(HalleyParticles, DISABLED_BenchmarkUpdate)
+{
+	TestExecutors executors(2); // Parallel updates run on the default executor
+	TestParticles factory;
+	auto config = makeConfig(0, 2.0f);
+	config["spawnRate"] = ConfigNode(50000.0f);
+	config["spawnArea"] = ConfigNode(Vector2f(4000, 4000));
+	config["acceleration"] = ConfigNode(Vector2f(0, 10));
+	config["speedDamp"] = ConfigNode(0.1f);
+	config["fadeInTime"] = ConfigNode(0.2f);
+	config["fadeOutTime"] = ConfigNode(0.5f);
+	config.erase("burst");
+
+	for (const bool parallel: { false, true }) {
+		auto particles = factory.make(config, 4);
+		particles.setParallelUpdate(parallel);
+		for (int i = 0; i < 120; ++i) {
+			particles.update(1.0 / 60.0);
+		}
+
+		constexpr int nFrames = 300;
+		size_t nDrawn = 0;
+		Stopwatch update(false);
+		Stopwatch draw(false);
+		for (int i = 0; i < nFrames; ++i) {
+			update.start();
+			particles.update(1.0 / 60.0);
+			update.pause();
+			draw.start();
+			nDrawn += particles.getSprites(Rect4f(-640, -360, 1280, 720)).size();
+			draw.pause();
+		}
+
+		std::cout << (parallel ? "Parallel" : "Serial") << " update of " << particles.getNumParticlesAlive() << " particles: " << (update.elapsedNanoseconds() / nFrames / 1000) << " us/frame, "
+			<< "sprites for " << (nDrawn / nFrames) << " visible: " << (draw.elapsedNanoseconds() / nFrames / 1000) << " us/frame" << std::endl;
+	}
+}
@@ -0,0 +1,199 @@
+#include <gtest/gtest.h>
+#include <halley.hpp>
+#include "test_executors.h"
+using namespace Halley;
+
+namespace {
+	class SizedConfigFile final : public ConfigFile {
+	public:
+		SizedConfigFile(size_t size) : size(size) {}
+		size_t getMemoryUsage() const override { return size; }
+
+	private:
+		size_t size;
+	};
+
+	class TestResources {
+	public:
+		TestResources(size_t nThreads)
+			: executors(0, nThreads)
+			, resources(std::unique_ptr<ResourceLocator>(), api, {})
+		{
+			resources.init<ConfigFile>();
+			resources.of<ConfigFile>().setResourceLoader([this] (const String& name, ResourceLoadPriority) -> std::shared_ptr<Resource>
+			{
+				++loads;
+				std::this_thread::sleep_for(std::chrono::milliseconds(20));
+				if (name == "missing") {
+					throw Exception("Missing", HalleyExceptions::Resources);
+				}
+				auto result = std::make_shared<SizedConfigFile>(resourceSize);
+				Metadata meta;
+				const auto deps = dependencies.find(name);
+				if (deps != dependencies.end()) {
+					meta.set("dependencies", deps->second);
+				}
+				result->setMeta(meta);
+				return result;
+			});
+		}
+
+		Resources& operator*() { return resources; }
+		Resources* operator->() { return &resources; }
+
+		std::atomic<int> loads = 0;
+		std::map<String, String> dependencies;
+		size_t resourceSize = 0;
+
+	private:
+		TestExecutors executors;
+		HalleyAPI api{};
+		Resources resources;
+	};
+}
+
+TEST(HalleyResources, ConcurrentGetsShareLoad)
+{
+	TestResources resources(4);
+	auto& configs = resources->of<ConfigFile>();
+
+	auto async = configs.getUntypedAsync("b");
+	std::vector<std::shared_ptr<const ConfigFile>> results(8);
+	std::vector<std::thread> threads;
+	for (size_t i = 0; i < results.size(); ++i) {
+		threads.emplace_back([&, i] ()
+		{
+			results[i] = configs.get(i % 2 == 0 ? "a" : "b");
+		});
+	}
+	for (auto& t: threads) {
+		t.join();
+	}
+
+	EXPECT_EQ(resources.loads.load(), 2);
+	EXPECT_EQ(async.get(), std::static_pointer_cast<const Resource>(results[1]));
+	for (size_t i = 2; i < results.size(); ++i) {
+		EXPECT_EQ(results[i], results[i % 2]);
+	}
+	EXPECT_NE(results[0], results[1]);
+	EXPECT_EQ(configs.getUntypedAsync("a").get(), std::static_pointer_cast<const Resource>(results[0]));
+}
+
+TEST(HalleyResources, LoadFailure)
+{
+	TestResources resources(2);
+	auto& configs = resources->of<ConfigFile>();
+
+	EXPECT_EQ(configs.getUntypedAsync("missing").get(), std::shared_ptr<Resource>());
+	EXPECT_THROW(configs.get("missing"), Exception);
+	EXPECT_FALSE(configs.isLoaded("missing"));
+}
+
+TEST(HalleyResources, PrefetchFollowsDependencies)
+{
+	TestResources resources(4);
+	resources.dependencies["root"] = "configFile:a,configFile:b,configFile:missing";
+	resources.dependencies["a"] = "configFile:root,configFile:c";
+	resources.dependencies["b"] = "configFile:c";
+
+	resources->prefetch({ "configFile:root" }).wait();
+
+	auto& configs = resources->of<ConfigFile>();
+	for (const char* name: { "root", "a", "b", "c" }) {
+		EXPECT_TRUE(configs.isLoaded(name));
+	}
+	EXPECT_FALSE(configs.isLoaded("missing"));
+	EXPECT_EQ(resources.loads.load(), 5);
+}
+
+TEST(HalleyResources, MemoryBudgetEvictsLeastRecentlyUsed)
+{
+	TestResources resources(1);
+	resources.resourceSize = 100;
+	auto& configs = resources->of<ConfigFile>();
+	configs.setMemoryBudget(250);
+
+	auto a = configs.get("a");
+	configs.get("b");
+	configs.get("c");
+
+	// Over budget, and "b" is the oldest that isn't held elsewhere
+	EXPECT_TRUE(configs.isLoaded("a"));
+	EXPECT_FALSE(configs.isLoaded("b"));
+	EXPECT_TRUE(configs.isLoaded("c"));
+
+	configs.get("d");
+	EXPECT_TRUE(configs.isLoaded("a"));
+	EXPECT_FALSE(configs.isLoaded("c"));
+	EXPECT_TRUE(configs.isLoaded("d"));
+
+	const auto stats = configs.getMemoryStats();
+	EXPECT_EQ(stats.count, 2);
+	EXPECT_EQ(stats.memoryUsage, 200);
+	EXPECT_EQ(stats.unreferencedCount, 1);
+	EXPECT_EQ(stats.evictions, 2);
+
+	const auto residency = configs.getResidency();
+	ASSERT_EQ(residency.size(), 2);
+	EXPECT_EQ(residency[0].useCount + residency[1].useCount, 1);
+
+	// Dropping the budget evicts everything that isn't held
+	configs.setMemoryBudget(1);
+	EXPECT_TRUE(configs.isLoaded("a"));
+	EXPECT_FALSE(configs.isLoaded("d"));
+	EXPECT_NE(resources->getResidencyReport().find("configFile: 1 resident"), std::string::npos);
+}
+
+TEST(HalleyResources, MemoryBudgetKeepsResourcesSetByHand)
+{
+	TestResources resources(1);
+	resources.resourceSize = 100;
+	auto& configs = resources->of<ConfigFile>();
+	configs.setMemoryBudget(150);
+
+	// Nothing could load this back, so it must stay even though nothing holds on to it
+	configs.setResource(0, "manual", std::make_shared<SizedConfigFile>(100));
+	configs.get("a");
+	configs.get("b");
+
+	EXPECT_TRUE(configs.isLoaded("manual"));
+	EXPECT_FALSE(configs.isLoaded("a"));
+	EXPECT_TRUE(configs.isLoaded("b"));
+	EXPECT_EQ(configs.getMemoryStats().evictions, 1);
+}
+
+TEST(HalleyResources, VideoResourcesLoadOnVideoAux)
+{
+	// Nothing runs the video aux executor here, so loads queued on it only happen when the test runs them
+	TestResources resources(2);
+	resources->init<Texture>();
+	std::atomic<int> textureLoads = 0;
+	std::thread::id loadThread;
+	resources->of<Texture>().setResourceLoader([&] (const String& name, ResourceLoadPriority) -> std::shared_ptr<Resource>
+	{
+		++textureLoads;
+		loadThread = std::this_thread::get_id();
+		return std::make_shared<Texture>(Vector2i(1, 1));
+	});
+	resources.dependencies["root"] = "texture:a";
+
+	auto async = resources->of<Texture>().getUntypedAsync("b");
+	auto prefetch = resources->prefetch({ "configFile:root" });
+	std::this_thread::sleep_for(std::chrono::milliseconds(50));
+	EXPECT_FALSE(async.isReady());
+	EXPECT_FALSE(prefetch.isReady());
+	EXPECT_EQ(textureLoads.load(), 0);
+
+	Executor videoAux(Executors::getVideoAux());
+	for (int i = 0; i < 1000 && !prefetch.isReady(); ++i) {
+		videoAux.runPending();
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	ASSERT_TRUE(prefetch.isReady());
+	EXPECT_TRUE(async.isReady());
+	EXPECT_EQ(textureLoads.load(), 2);
+	EXPECT_EQ(loadThread, std::this_thread::get_id());
+	EXPECT_TRUE(resources->of<Texture>().isLoaded("a"));
+	EXPECT_TRUE(resources->of<Texture>().isLoaded("b"));
+	EXPECT_EQ(resources.loads.load(), 1);
+}
@@ -0,0 +1,103 @@
+#include <gtest/gtest.h>
+#include <halley.hpp>
+using namespace Halley;
+
+namespace {
+	std::unique_ptr<Font> makeFont(float advance)
+	{
+		auto font = std::make_unique<Font>("Test", "test", 8.0f, 10.0f, 10.0f, 1.0f, Vector2i(64, 64));
+		for (int c: { 0, int(' '), int('a'), int('b'), int('c') }) {
+			font->addGlyph(Font::Glyph(c, Rect4f(0, 0, 0.1f, 0.1f), Vector2f(6, 8), Vector2f(0, 8), Vector2f(), Vector2f(advance, 0)));
+		}
+		font->setMaterial(std::make_shared<Material>(std::make_shared<MaterialDefinition>()));
+		return font;
+	}
+
+	std::vector<Sprite> getSprites(const TextRenderer& text)
+	{
+		std::vector<Sprite> sprites;
+		text.generateSprites(sprites);
+		return sprites;
+	}
+}
+
+TEST(HalleyTextRenderer, GlyphsFollowLayoutChanges)
+{
+	const std::shared_ptr<const Font> font = makeFont(6.0f);
+	TextRenderer text(font, "ab", 10.0f);
+
+	auto sprites = getSprites(text);
+	ASSERT_EQ(sprites.size(), 2);
+	EXPECT_FLOAT_EQ(sprites[1].getPosition().x - sprites[0].getPosition().x, 6.0f);
+
+	// Moving only translates the glyphs
+	text.setPosition(Vector2f(100, 50));
+	auto moved = getSprites(text);
+	ASSERT_EQ(moved.size(), 2);
+	for (size_t i = 0; i < moved.size(); ++i) {
+		EXPECT_EQ(moved[i].getPosition(), sprites[i].getPosition() + Vector2f(100, 50));
+	}
+
+	text.setText("abc");
+	EXPECT_EQ(getSprites(text).size(), 3);
+
+	text.setColour(Colour4f(1, 0, 0, 1));
+	for (const auto& sprite: getSprites(text)) {
+		EXPECT_EQ(sprite.getColour(), Colour4f(1, 0, 0, 1));
+	}
+
+	text.setColourOverride({ ColourOverride(1, Colour4f(0, 1, 0, 1)), ColourOverride(2, std::nullopt) });
+	auto overridden = getSprites(text);
+	EXPECT_EQ(overridden[0].getColour(), Colour4f(1, 0, 0, 1));
+	EXPECT_EQ(overridden[1].getColour(), Colour4f(0, 1, 0, 1));
+	EXPECT_EQ(overridden[2].getColour(), Colour4f(1, 0, 0, 1));
+
+	text.setSize(20.0f);
+	auto resized = getSprites(text);
+	EXPECT_FLOAT_EQ(resized[1].getPosition().x - resized[0].getPosition().x, 12.0f);
+	EXPECT_EQ(resized[0].getScale(), Vector2f(2, 2));
+
+	text.setAlignment(1.0f);
+	auto aligned = getSprites(text);
+	EXPECT_FLOAT_EQ(aligned[0].getPosition().x, resized[0].getPosition().x - 36.0f);
+}
+
+TEST(HalleyTextRenderer, IdenticalTextSharesLayout)
+{
+	const std::shared_ptr<const Font> font = makeFont(6.0f);
+	TextRenderer a(font, "abc");
+	TextRenderer b(font, "abc");
+	b.setPosition(Vector2f(0, 30));
+
+	const auto spritesA = getSprites(a);
+	const auto spritesB = getSprites(b);
+	ASSERT_EQ(spritesA.size(), spritesB.size());
+	for (size_t i = 0; i < spritesA.size(); ++i) {
+		EXPECT_EQ(spritesB[i].getPosition(), spritesA[i].getPosition() + Vector2f(0, 30));
+	}
+
+	// Changing one renderer must not leak into the other's copy of the layout
+	b.setColour(Colour4f(0, 0, 1, 1));
+	b.setText("ab");
+	EXPECT_EQ(getSprites(b).size(), 2);
+	EXPECT_EQ(getSprites(b)[0].getColour(), Colour4f(0, 0, 1, 1));
+
+	const auto unchanged = getSprites(a);
+	ASSERT_EQ(unchanged.size(), 3);
+	for (size_t i = 0; i < unchanged.size(); ++i) {
+		EXPECT_EQ(unchanged[i].getPosition(), spritesA[i].getPosition());
+		EXPECT_EQ(unchanged[i].getColour(), spritesA[i].getColour());
+	}
+}
+
+TEST(HalleyTextRenderer, FontReloadInvalidatesLayout)
+{
+	const std::shared_ptr<Font> font = makeFont(6.0f);
+	TextRenderer text(font, "ab", 10.0f);
+	auto sprites = getSprites(text);
+	EXPECT_FLOAT_EQ(sprites[1].getPosition().x - sprites[0].getPosition().x, 6.0f);
+
+	font->reloadResource(std::move(*makeFont(9.0f)));
+	sprites = getSprites(text);
+	EXPECT_FLOAT_EQ(sprites[1].getPosition().x - sprites[0].getPosition().x, 9.0f);
+}
@@ -0,0 +1,115 @@
+#include <gtest/gtest.h>
+#include <halley.hpp>
+#include "test_executors.h"
+using namespace Halley;
+
+namespace {
+	// Roughly what a packed sprite sheet looks like: shaded sprites with transparent gaps between them
+	std::unique_ptr<Image> makeSpriteSheet(Vector2i size, int seed)
+	{
+		auto image = std::make_unique<Image>(Image::Format::RGBAPremultiplied, size);
+		auto px = image->getPixels4BPP();
+		Random rng(seed);
+		for (int i = 0; i < size.x * size.y / 2000; ++i) {
+			const int w = rng.getInt(8, 64);
+			const int h = rng.getInt(8, 64);
+			const int x0 = rng.getInt(0, size.x - w);
+			const int y0 = rng.getInt(0, size.y - h);
+			const int r = rng.getInt(0, 200);
+			const int g = rng.getInt(0, 200);
+			const int b = rng.getInt(0, 200);
+			for (int y = y0; y < y0 + h; ++y) {
+				for (int x = x0; x < x0 + w; ++x) {
+					const int shade = (x - x0 + y - y0) / 4 + rng.getInt(0, 3);
+					px[y * size.x + x] = int(Image::convertRGBAToInt(r + shade, g + shade, b + shade, 255));
+				}
+			}
+		}
+		return image;
+	}
+
+	gsl::span<const gsl::byte> getSpan(const Bytes& bytes)
+	{
+		return gsl::as_bytes(gsl::span<const Byte>(bytes));
+	}
+}
+
+TEST(HalleyTextureContainer, RoundTrip)
+{
+	const auto image = makeSpriteSheet(Vector2i(300, 200), 1);
+	const auto bytes = TextureContainer::encode(*image, true, 16);
+	EXPECT_LT(bytes.size(), image->getByteSize() / 2);
+
+	const auto container = TextureContainer(getSpan(bytes));
+	EXPECT_EQ(container.getSize(), Vector2i(300, 200));
+	EXPECT_EQ(container.getBytesPerPixel(), 4);
+	EXPECT_EQ(container.getNumMipLevels(), 9);
+
+	TestQueue<> queue(2);
+	const auto decoded = container.decode(&*queue);
+	ASSERT_EQ(decoded.size(), container.getDecodedSize());
+	const auto pixels = image->getPixelBytes();
+	EXPECT_TRUE(std::equal(pixels.begin(), pixels.begin() + 300 * 200 * 4, decoded.begin()));
+
+	// Mip levels follow the base level, down to 1x1
+	size_t expectedSize = 0;
+	for (int level = 0; level < container.getNumMipLevels(); ++level) {
+		const auto levelSize = TextureContainer::getMipLevelSize(Vector2i(300, 200), level);
+		expectedSize += size_t(levelSize.x * levelSize.y * 4);
+	}
+	EXPECT_EQ(TextureContainer::getMipLevelSize(Vector2i(300, 200), 8), Vector2i(1, 1));
+	EXPECT_EQ(decoded.size(), expectedSize);
+	EXPECT_EQ(container.decode(), decoded);
+}
+
+TEST(HalleyTextureContainer, SingleChannel)
+{
+	Image image(Image::Format::SingleChannel, Vector2i(100, 70));
+	auto px = image.getPixelBytes();
+	Random rng(2);
+	for (size_t i = 0; i < size_t(px.size()); ++i) {
+		px[i] = i % 1000 < 600 ? 0 : static_cast<unsigned char>(rng.getInt(0, 255));
+	}
+
+	const auto bytes = TextureContainer::encode(image, false);
+	const auto container = TextureContainer(getSpan(bytes));
+	EXPECT_EQ(container.getBytesPerPixel(), 1);
+	EXPECT_EQ(container.getNumMipLevels(), 1);
+
+	const auto decoded = container.decode();
+	ASSERT_EQ(decoded.size(), size_t(100 * 70));
+	EXPECT_TRUE(std::equal(px.begin(), px.begin() + 100 * 70, decoded.begin()));
+}
+
+TEST(HalleyTextureContainer, DISABLED_BenchmarkDecode)
+{
+	constexpr int nRounds = 10;
+	const auto image = makeSpriteSheet(Vector2i(2048, 2048), 3);
+	const auto png = image->savePNGToBytes();
+	const auto htex = TextureContainer::encode(*image, false);
+	const double megabytes = 2048.0 * 2048.0 * 4.0 * nRounds / (1024.0 * 1024.0);
+
+	Stopwatch pngTime;
+	for (int i = 0; i < nRounds; ++i) {
+		Image decoded(getSpan(png), Image::Format::RGBAPremultiplied);
+		EXPECT_EQ(decoded.getSize(), image->getSize());
+	}
+	pngTime.pause();
+
+	Stopwatch htexTime;
+	for (int i = 0; i < nRounds; ++i) {
+		EXPECT_EQ(TextureContainer(getSpan(htex)).decode().size(), size_t(2048 * 2048 * 4));
+	}
+	htexTime.pause();
+
+	TestQueue<> queue(std::max(2u, std::thread::hardware_concurrency()));
+	Stopwatch parallelTime;
+	for (int i = 0; i < nRounds; ++i) {
+		EXPECT_EQ(TextureContainer(getSpan(htex)).decode(&*queue).size(), size_t(2048 * 2048 * 4));
+	}
+	parallelTime.pause();
+
+	auto throughput = [&] (const Stopwatch& s) { return int(megabytes / (double(s.elapsedNanoseconds()) / 1000000000.0)); };
+	std::cout << "2048x2048 sprite sheet, PNG " << png.size() / 1024 << " KB, htex " << htex.size() / 1024 << " KB" << std::endl;
+	std::cout << "Decode throughput: lodepng " << throughput(pngTime) << " MB/s, htex " << throughput(htexTime) << " MB/s, htex parallel " << throughput(parallelTime) << " MB/s" << std::endl;
+}
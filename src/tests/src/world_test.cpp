@@ -0,0 +1,727 @@
+#include <gtest/gtest.h>
+#include <halley.hpp>
+#include "test_executors.h"
+using namespace Halley;
+
+namespace Halley {
+	// Normally generated by codegen for each game
+	ComponentReflector& getComponentReflector(int componentId)
+	{
+		throw Exception("No component reflectors in tests", HalleyExceptions::Entity);
+	}
+}
+
+namespace {
+	class TestCoreAPI final : public CoreAPI {
+	public:
+		void quit(int exitCode) override {}
+		void setStage(StageID stage) override {}
+		void setStage(std::unique_ptr<Stage> stage) override {}
+		void initStage(Stage& stage) override {}
+		Stage& getCurrentStage() override { throw Exception("Not available in tests", HalleyExceptions::Core); }
+		HalleyStatics& getStatics() override { throw Exception("Not available in tests", HalleyExceptions::Core); }
+		const Environment& getEnvironment() override { throw Exception("Not available in tests", HalleyExceptions::Core); }
+		int64_t getTime(CoreAPITimer timer, TimeLine tl, StopwatchRollingAveraging::Mode mode) const override { return 0; }
+		void setTimerPaused(CoreAPITimer timer, TimeLine tl, bool paused) override {}
+		bool isDevMode() override { return false; }
+	};
+
+	class TestWorld {
+	public:
+		TestWorld(CreateComponentFunction createComponent = {})
+			: resources(std::unique_ptr<ResourceLocator>(), api, {})
+		{
+			api.core = &core;
+			world = std::make_unique<World>(api, resources, false, std::move(createComponent));
+		}
+
+		World& operator*() { return *world; }
+		World* operator->() { return world.get(); }
+		Resources& getResources() { return resources; }
+
+	private:
+		TestCoreAPI core;
+		HalleyAPI api{};
+		Resources resources;
+		std::unique_ptr<World> world;
+	};
+
+	class PositionTestComponent final : public Component {
+	public:
+		static constexpr int componentIndex = 250;
+		static constexpr bool prefabTemplateCopy = true;
+		static inline int deserializations = 0;
+		Vector2f position;
+
+		PositionTestComponent() = default;
+		PositionTestComponent(Vector2f position) : position(position) {}
+
+		void deserialize(const ConfigNodeSerializationContext& context, const ConfigNode& node)
+		{
+			position = node.asVector2f();
+			++deserializations;
+		}
+	};
+
+	class VelocityTestComponent final : public Component {
+	public:
+		static constexpr int componentIndex = 251;
+		static inline int deserializations = 0;
+		Vector2f velocity;
+
+		VelocityTestComponent() = default;
+		VelocityTestComponent(Vector2f velocity) : velocity(velocity) {}
+
+		void deserialize(const ConfigNodeSerializationContext& context, const ConfigNode& node)
+		{
+			velocity = node.asVector2f();
+			++deserializations;
+		}
+	};
+
+	class TargetTestComponent final : public Component {
+	public:
+		static constexpr int componentIndex = 252;
+		EntityId target;
+
+		void deserialize(const ConfigNodeSerializationContext& context, const ConfigNode& node)
+		{
+			target = context.entityContext->getEntityIdFromUUID(UUID(node.asString()));
+		}
+	};
+
+	class MovingFamily : public FamilyBaseOf<MovingFamily> {
+	public:
+		PositionTestComponent& position;
+		const VelocityTestComponent& velocity;
+
+		using Type = FamilyType<PositionTestComponent, const VelocityTestComponent>;
+
+	protected:
+		MovingFamily(PositionTestComponent& position, const VelocityTestComponent& velocity)
+			: position(position)
+			, velocity(velocity)
+		{}
+	};
+
+	CreateComponentFunctionResult createTestComponent(const EntityFactoryContext& context, const String& name, EntityRef& e, const ConfigNode& node)
+	{
+		if (name == "PositionTest") {
+			return context.createComponent<PositionTestComponent>(e, node);
+		} else if (name == "VelocityTest") {
+			return context.createComponent<VelocityTestComponent>(e, node);
+		} else if (name == "TargetTest") {
+			return context.createComponent<TargetTestComponent>(e, node);
+		}
+		throw Exception("Component not found: " + name, HalleyExceptions::Entity);
+	}
+
+	std::vector<MovingFamily*> getMembers(Family& family)
+	{
+		std::vector<MovingFamily*> result;
+		for (size_t i = 0; i < family.count(); ++i) {
+			result.push_back(static_cast<MovingFamily*>(family.getElement(i)));
+		}
+		return result;
+	}
+}
+
+TEST(HalleyWorld, FamilyMembership)
+{
+	TestWorld world;
+	auto& family = world->getFamily<MovingFamily>();
+
+	std::vector<EntityRef> moving;
+	for (int i = 0; i < 100; ++i) {
+		moving.push_back(world->createEntity()
+			.addComponent(PositionTestComponent(Vector2f(float(i), 0)))
+			.addComponent(VelocityTestComponent(Vector2f(0, float(i)))));
+		world->createEntity().addComponent(PositionTestComponent());
+	}
+	world->spawnPending();
+	EXPECT_EQ(family.count(), 100);
+
+	// Destroy half of them
+	for (size_t i = 0; i < moving.size(); i += 2) {
+		world->destroyEntity(moving[i]);
+	}
+	world->spawnPending();
+	EXPECT_EQ(family.count(), 50);
+	for (auto* e: getMembers(family)) {
+		EXPECT_EQ(int(e->position.position.x) % 2, 1);
+		EXPECT_EQ(e->position.position.x, e->velocity.velocity.y);
+	}
+
+	// Stop some from moving, then let them move again
+	world->getEntity(moving[1].getEntityId()).removeComponent<VelocityTestComponent>();
+	world->getEntity(moving[3].getEntityId()).removeComponent<VelocityTestComponent>();
+	world->spawnPending();
+	EXPECT_EQ(family.count(), 48);
+
+	world->getEntity(moving[3].getEntityId()).addComponent(VelocityTestComponent(Vector2f(0, 3)));
+	world->spawnPending();
+	EXPECT_EQ(family.count(), 49);
+
+	std::set<int64_t> ids;
+	for (auto* e: getMembers(family)) {
+		ids.insert(e->entityId.value);
+		EXPECT_EQ(e->position.position.x, e->velocity.velocity.y);
+	}
+	EXPECT_EQ(ids.size(), 49);
+	EXPECT_EQ(ids.count(moving[1].getEntityId().value), 0);
+	EXPECT_EQ(ids.count(moving[3].getEntityId().value), 1);
+}
+
+TEST(HalleyWorld, FindEntityByUUID)
+{
+	TestWorld world;
+
+	std::vector<UUID> uuids;
+	for (int i = 0; i < 100; ++i) {
+		uuids.push_back(UUID::generate());
+		world->createEntity(uuids.back(), "entity" + toString(i));
+	}
+
+	// Pending entities are only found when asked for
+	EXPECT_FALSE(world->findEntity(uuids[0]).has_value());
+	ASSERT_TRUE(world->findEntity(uuids[0], true).has_value());
+
+	world->spawnPending();
+	for (int i = 0; i < 100; ++i) {
+		auto e = world->findEntity(uuids[i]);
+		ASSERT_TRUE(e.has_value());
+		EXPECT_EQ(e->getName(), "entity" + toString(i));
+		EXPECT_EQ(e->getInstanceUUID(), uuids[i]);
+	}
+	EXPECT_FALSE(world->findEntity(UUID::generate()).has_value());
+
+	// Destroyed entities stop being found straight away, and leave the index once removed
+	world->destroyEntity(world->findEntity(uuids[10]).value());
+	EXPECT_FALSE(world->findEntity(uuids[10]).has_value());
+	world->spawnPending();
+	EXPECT_FALSE(world->findEntity(uuids[10], true).has_value());
+	EXPECT_TRUE(world->findEntity(uuids[11]).has_value());
+
+	// Recreating an entity with the UUID of one that is being destroyed (e.g. reloading it) must not lose the new one
+	world->destroyEntity(world->findEntity(uuids[20]).value());
+	world->createEntity(uuids[20], "replacement");
+	world->spawnPending();
+	auto replacement = world->findEntity(uuids[20]);
+	ASSERT_TRUE(replacement.has_value());
+	EXPECT_EQ(replacement->getName(), "replacement");
+	EXPECT_EQ(world->numEntities(), 99);
+
+	// Reusing a live UUID is an error, but lookups keep finding the first entity, then fall back to the survivor
+	world->createEntity(uuids[30], "duplicate");
+	world->createEntity(uuids[30], "second duplicate");
+	world->spawnPending();
+	EXPECT_EQ(world->findEntity(uuids[30])->getName(), "entity30");
+
+	world->destroyEntity(world->findEntity(uuids[30]).value());
+	world->spawnPending();
+	ASSERT_TRUE(world->findEntity(uuids[30]).has_value());
+	EXPECT_EQ(world->findEntity(uuids[30])->getName(), "duplicate");
+
+	world->destroyEntity(world->findEntity(uuids[30]).value());
+	world->spawnPending();
+	ASSERT_TRUE(world->findEntity(uuids[30]).has_value());
+	EXPECT_EQ(world->findEntity(uuids[30])->getName(), "second duplicate");
+
+	world->destroyEntity(world->findEntity(uuids[30]).value());
+	world->spawnPending();
+	EXPECT_FALSE(world->findEntity(uuids[30], true).has_value());
+}
+
+TEST(HalleyWorld, PrefabTemplateCopiesComponents)
+{
+	TestWorld world;
+	CreateComponentFunction createComponent = createTestComponent;
+
+	auto targetEntity = world->createEntity(UUID::generate());
+
+	EntityData root(UUID::generate());
+	root.setPrefabUUID(UUID::generate());
+	root.getComponents().emplace_back("PositionTest", ConfigNode(Vector2f(1, 2)));
+	root.getComponents().emplace_back("TargetTest", ConfigNode(targetEntity.getInstanceUUID().toString()));
+	root.getComponents().emplace_back("VelocityTest", ConfigNode(Vector2f(7, 8)));
+	EntityData child(UUID::generate());
+	child.setPrefabUUID(UUID::generate());
+	child.getComponents().emplace_back("PositionTest", ConfigNode(Vector2f(3, 4)));
+	root.getChildren().push_back(std::move(child));
+
+	EntityFactoryContext compileContext(*world, world.getResources(), 0, false);
+	compileContext.setCompilingTemplate(true);
+	const PrefabTemplate prefabTemplate(root, createComponent, compileContext);
+	ASSERT_EQ(prefabTemplate.getNumNodes(), 2);
+	const auto* rootNode = prefabTemplate.getNode(root.getPrefabUUID());
+	ASSERT_NE(rootNode, nullptr);
+	EXPECT_EQ(rootNode->getNumComponents(), 3);
+	EXPECT_EQ(rootNode->getNumCopies(), 1); // The entity reference has to be resolved per instance, and velocity isn't opted in
+	EXPECT_TRUE(prefabTemplate.isComplete());
+
+	EntityFactoryContext context(*world, world.getResources(), 0, false);
+	context.addEntity(targetEntity);
+
+	auto a = world->createEntity();
+	rootNode->instantiate(a, context, createComponent, nullptr);
+	EXPECT_EQ(a.getComponent<PositionTestComponent>().position, Vector2f(1, 2));
+	EXPECT_EQ(a.getComponent<TargetTestComponent>().target, targetEntity.getEntityId());
+	EXPECT_EQ(a.getComponent<VelocityTestComponent>().velocity, Vector2f(7, 8));
+
+	std::vector<std::pair<String, ConfigNode>> overrides;
+	overrides.emplace_back("PositionTest", ConfigNode(Vector2f(5, 6)));
+	auto b = world->createEntity();
+	rootNode->instantiate(b, context, createComponent, &overrides);
+	EXPECT_EQ(b.getComponent<PositionTestComponent>().position, Vector2f(5, 6));
+	EXPECT_EQ(a.getComponent<PositionTestComponent>().position, Vector2f(1, 2));
+
+	const auto* childNode = prefabTemplate.getNode(root.getChildren()[0].getPrefabUUID());
+	ASSERT_NE(childNode, nullptr);
+	EXPECT_EQ(childNode->getNumCopies(), 1);
+}
+
+TEST(HalleyWorld, PrefabTemplateResolvesComponentsOnce)
+{
+	auto prefab = std::make_shared<Prefab>();
+	auto& root = prefab->getEntityData();
+	root.setInstanceUUID(UUID::generate());
+	root.setPrefabUUID(UUID::generate());
+	root.getComponents().emplace_back("PositionTest", ConfigNode(Vector2f(1, 2)));
+	root.getComponents().emplace_back("VelocityTest", ConfigNode(Vector2f(3, 4)));
+
+	int lookups = 0;
+	TestWorld world([&] (const EntityFactoryContext& context, const String& name, EntityRef& e, const ConfigNode& node)
+	{
+		++lookups;
+		return createTestComponent(context, name, e, node);
+	});
+	world.getResources().init<Prefab>();
+	world.getResources().of<Prefab>().setResource(0, "test", prefab);
+	EntityFactory factory(*world, world.getResources());
+	auto& family = world->getFamily<MovingFamily>();
+
+	PositionTestComponent::deserializations = 0;
+	VelocityTestComponent::deserializations = 0;
+	constexpr int nInstances = 10;
+	for (int i = 0; i < nInstances; ++i) {
+		EntityData instance(UUID::generate());
+		instance.setPrefab("test");
+		factory.createEntity(instance);
+	}
+	world->spawnPending();
+
+	// Components are only looked up by name while compiling the template, and the opted in one is only deserialized then too
+	EXPECT_EQ(lookups, 2);
+	EXPECT_EQ(PositionTestComponent::deserializations, 1);
+	EXPECT_EQ(VelocityTestComponent::deserializations, nInstances);
+	EXPECT_EQ(family.count(), nInstances);
+
+	// Batches go through the same template
+	const auto batch = factory.createEntities("test", nInstances);
+	world->spawnPending();
+	EXPECT_EQ(batch.size(), nInstances);
+	EXPECT_EQ(lookups, 2);
+	EXPECT_EQ(VelocityTestComponent::deserializations, 2 * nInstances);
+	EXPECT_EQ(family.count(), 2 * nInstances);
+	EXPECT_NE(batch[0].getInstanceUUID(), batch[1].getInstanceUUID());
+	EXPECT_EQ(batch[0].getPrefabUUID(), root.getPrefabUUID());
+}
+
+TEST(HalleyWorld, PrefabTemplateMatchesInstantiation)
+{
+	auto prefab = std::make_shared<Prefab>();
+	auto& root = prefab->getEntityData();
+	root.setInstanceUUID(UUID::generate());
+	root.setPrefabUUID(UUID::generate());
+	root.setName("root");
+	EntityData child(UUID::generate());
+	child.setPrefabUUID(UUID::generate());
+	child.setName("child");
+	child.getComponents().emplace_back("PositionTest", ConfigNode(Vector2f(3, 4)));
+	child.getComponents().emplace_back("TargetTest", ConfigNode(root.getPrefabUUID().toString()));
+	root.getComponents().emplace_back("PositionTest", ConfigNode(Vector2f(1, 2)));
+	root.getComponents().emplace_back("TargetTest", ConfigNode(child.getPrefabUUID().toString()));
+	root.getChildren().push_back(std::move(child));
+
+	// The instance overrides one component and adds another
+	EntityData instance(UUID::generate());
+	instance.setPrefab("test");
+	instance.getComponents().emplace_back("PositionTest", ConfigNode(Vector2f(7, 7)));
+	instance.getComponents().emplace_back("VelocityTest", ConfigNode(Vector2f(9, 9)));
+
+	// Same thing, instantiated by hand without going through the prefab
+	const auto instantiated = prefab->getEntityData().instantiateWithAsCopy(instance);
+
+	TestWorld templateWorld(createTestComponent);
+	templateWorld.getResources().init<Prefab>();
+	templateWorld.getResources().of<Prefab>().setResource(0, "test", prefab);
+	EntityFactory templateFactory(*templateWorld, templateWorld.getResources());
+	auto a = templateFactory.createEntity(instance);
+	ASSERT_NE(prefab->getTemplate(), nullptr);
+	EXPECT_TRUE(prefab->getTemplate()->isComplete());
+
+	TestWorld plainWorld(createTestComponent);
+	EntityFactory plainFactory(*plainWorld, plainWorld.getResources());
+	auto b = plainFactory.createEntity(instantiated);
+
+	templateWorld->spawnPending();
+	plainWorld->spawnPending();
+
+	auto compare = [] (EntityRef a, EntityRef b)
+	{
+		EXPECT_EQ(a.getInstanceUUID(), b.getInstanceUUID());
+		EXPECT_EQ(a.getPrefabUUID(), b.getPrefabUUID());
+		EXPECT_EQ(a.getName(), b.getName());
+		EXPECT_EQ(a.getNumComponents(), b.getNumComponents());
+		EXPECT_EQ(a.getComponent<PositionTestComponent>().position, b.getComponent<PositionTestComponent>().position);
+		EXPECT_EQ(a.tryGetComponent<VelocityTestComponent>() != nullptr, b.tryGetComponent<VelocityTestComponent>() != nullptr);
+		if (a.tryGetComponent<VelocityTestComponent>() && b.tryGetComponent<VelocityTestComponent>()) {
+			EXPECT_EQ(a.getComponent<VelocityTestComponent>().velocity, b.getComponent<VelocityTestComponent>().velocity);
+		}
+	};
+
+	auto getChildren = [] (EntityRef e)
+	{
+		std::vector<EntityRef> result;
+		for (auto c: e.getChildren()) {
+			result.push_back(c);
+		}
+		return result;
+	};
+
+	compare(a, b);
+	EXPECT_EQ(a.getComponent<PositionTestComponent>().position, Vector2f(7, 7));
+	EXPECT_EQ(a.getComponent<VelocityTestComponent>().velocity, Vector2f(9, 9));
+	ASSERT_EQ(getChildren(a).size(), 1);
+	ASSERT_EQ(getChildren(b).size(), 1);
+	const auto aChild = getChildren(a)[0];
+	const auto bChild = getChildren(b)[0];
+	compare(aChild, bChild);
+
+	// Entity references resolve to the entities of this instance
+	EXPECT_EQ(a.getComponent<TargetTestComponent>().target, aChild.getEntityId());
+	EXPECT_EQ(aChild.getComponent<TargetTestComponent>().target, a.getEntityId());
+	EXPECT_EQ(b.getComponent<TargetTestComponent>().target, bChild.getEntityId());
+
+	// A second instance gets its own entities
+	EntityData instance2(UUID::generate());
+	instance2.setPrefab("test");
+	auto c = templateFactory.createEntity(instance2);
+	templateWorld->spawnPending();
+	ASSERT_EQ(getChildren(c).size(), 1);
+	const auto cChild = getChildren(c)[0];
+	EXPECT_EQ(cChild.getInstanceUUID(), UUID::generateFromUUIDs(aChild.getPrefabUUID(), instance2.getInstanceUUID()));
+	EXPECT_EQ(c.getComponent<PositionTestComponent>().position, Vector2f(1, 2));
+	EXPECT_EQ(c.tryGetComponent<VelocityTestComponent>(), nullptr);
+	EXPECT_EQ(c.getComponent<TargetTestComponent>().target, cChild.getEntityId());
+}
+
+TEST(HalleyWorld, DISABLED_BenchmarkSpawnAndDestroy)
+{
+	TestWorld world;
+	auto& family = world->getFamily<MovingFamily>();
+
+	constexpr int nFrames = 60;
+	constexpr int nPerFrame = 10000;
+	std::vector<EntityId> previous;
+	std::vector<EntityId> current;
+
+	Stopwatch stopwatch;
+	for (int frame = 0; frame < nFrames; ++frame) {
+		for (auto& id: previous) {
+			world->destroyEntity(id);
+		}
+		for (int i = 0; i < nPerFrame; ++i) {
+			current.push_back(world->createEntity()
+				.addComponent(PositionTestComponent())
+				.addComponent(VelocityTestComponent())
+				.getEntityId());
+		}
+		world->spawnPending();
+		EXPECT_EQ(family.count(), nPerFrame);
+		std::swap(previous, current);
+		current.clear();
+	}
+	stopwatch.pause();
+
+	std::cout << "Spawn and destroy " << nPerFrame << " entities: " << (stopwatch.elapsedNanoseconds() / nFrames / 1000) << " us/frame" << std::endl;
+}
+
+TEST(HalleyWorld, BatchSpawn)
+{
+	TestWorld world;
+	world->setChunkedComponentStorage(true);
+	auto& family = world->getFamily<MovingFamily>();
+
+	auto moving = world->createArchetypeEntities(1000, PositionTestComponent(Vector2f(1, 2)), VelocityTestComponent(Vector2f(3, 4)));
+	auto still = world->createEntities(500);
+	ASSERT_EQ(moving.size(), 1000);
+	ASSERT_EQ(still.size(), 500);
+	EXPECT_EQ(family.count(), 0);
+
+	world->spawnPending();
+	EXPECT_EQ(family.count(), 1000);
+	EXPECT_EQ(world->numEntities(), 1500);
+	for (auto* e: getMembers(family)) {
+		EXPECT_EQ(e->position.position, Vector2f(1, 2));
+		EXPECT_EQ(e->velocity.velocity, Vector2f(3, 4));
+	}
+
+	// Each one gets its own copy
+	moving[0].getComponent<PositionTestComponent>().position = Vector2f(5, 6);
+	EXPECT_EQ(moving[1].getComponent<PositionTestComponent>().position, Vector2f(1, 2));
+
+	std::set<int64_t> ids;
+	for (auto& e: moving) {
+		ids.insert(e.getEntityId().value);
+		EXPECT_TRUE(world->findEntity(e.getInstanceUUID()).has_value());
+	}
+	EXPECT_EQ(ids.size(), 1000);
+}
+
+TEST(HalleyWorld, DISABLED_BenchmarkBatchSpawn)
+{
+	constexpr int nEntities = 50000;
+
+	int64_t individual;
+	{
+		TestWorld world;
+		auto& family = world->getFamily<MovingFamily>();
+		Stopwatch stopwatch;
+		for (int i = 0; i < nEntities; ++i) {
+			world->createEntity()
+				.addComponent(PositionTestComponent())
+				.addComponent(VelocityTestComponent());
+		}
+		world->spawnPending();
+		stopwatch.pause();
+		individual = stopwatch.elapsedNanoseconds();
+		EXPECT_EQ(family.count(), nEntities);
+	}
+
+	int64_t batched;
+	{
+		TestWorld world;
+		auto& family = world->getFamily<MovingFamily>();
+		Stopwatch stopwatch;
+		world->createArchetypeEntities(nEntities, PositionTestComponent(), VelocityTestComponent());
+		world->spawnPending();
+		stopwatch.pause();
+		batched = stopwatch.elapsedNanoseconds();
+		EXPECT_EQ(family.count(), nEntities);
+	}
+
+	std::cout << "Spawn " << nEntities << " entities in one frame: " << (individual / 1000) << " us individually, " << (batched / 1000) << " us batched" << std::endl;
+}
+
+TEST(HalleyWorld, DISABLED_BenchmarkFamilyIteration)
+{
+	constexpr size_t nEntities = 100000;
+
+	auto benchmark = [&] (bool chunked) -> int64_t
+	{
+		TestWorld world;
+		world->setChunkedComponentStorage(chunked);
+		auto& family = world->getFamily<MovingFamily>();
+
+		// Entities outside the family share the component types, so they're interleaved in memory
+		auto spawn = [&] (size_t i)
+		{
+			auto e = world->createEntity().addComponent(PositionTestComponent());
+			if (i % 2 == 0) {
+				e.addComponent(VelocityTestComponent(Vector2f(1, 1)));
+			}
+			return e.getEntityId();
+		};
+
+		std::vector<EntityId> ids;
+		for (size_t i = 0; i < nEntities * 2; ++i) {
+			ids.push_back(spawn(i));
+		}
+		world->spawnPending();
+
+		// Churn: destroy and respawn a third of the entities, a frame at a time
+		Random rng(1234);
+		for (int frame = 0; frame < 10; ++frame) {
+			for (size_t j = 0; j < ids.size() / 30; ++j) {
+				auto& id = ids[rng.getSizeT(0, ids.size() - 1)];
+				world->destroyEntity(id);
+				id = spawn(j);
+			}
+			world->spawnPending();
+		}
+
+		Stopwatch stopwatch;
+		for (int k = 0; k < 20; ++k) {
+			for (size_t i = 0; i < family.count(); ++i) {
+				auto& e = *static_cast<MovingFamily*>(family.getElement(i));
+				e.position.position += e.velocity.velocity;
+			}
+		}
+		stopwatch.pause();
+
+		EXPECT_GT(family.count(), 0);
+		return stopwatch.elapsedNanoseconds();
+	};
+
+	const auto shared = benchmark(false);
+	const auto chunked = benchmark(true);
+	std::cout << "Iterate a " << nEntities << " entity family 20 times: " << (shared / 1000) << " us with shared size pools, " << (chunked / 1000) << " us with chunked storage" << std::endl;
+}
+
+namespace {
+	class PositionFamily : public FamilyBaseOf<PositionFamily> {
+	public:
+		PositionTestComponent& position;
+
+		using Type = FamilyType<PositionTestComponent>;
+
+	protected:
+		PositionFamily(PositionTestComponent& position) : position(position) {}
+	};
+
+	class ConstPositionFamily : public FamilyBaseOf<ConstPositionFamily> {
+	public:
+		const PositionTestComponent& position;
+
+		using Type = FamilyType<const PositionTestComponent>;
+
+	protected:
+		ConstPositionFamily(const PositionTestComponent& position) : position(position) {}
+	};
+
+	class VelocityFamily : public FamilyBaseOf<VelocityFamily> {
+	public:
+		VelocityTestComponent& velocity;
+
+		using Type = FamilyType<VelocityTestComponent>;
+
+	protected:
+		VelocityFamily(VelocityTestComponent& velocity) : velocity(velocity) {}
+	};
+
+	// Stands in for a generated system; systems without an access declaration are scheduled on their own
+	template <typename F>
+	class SchedulerTestSystem final : public System {
+	public:
+		SchedulerTestSystem(std::function<void()> onUpdate, bool declared = true)
+			: System({ &family }, {})
+			, onUpdate(std::move(onUpdate))
+		{
+			if (declared) {
+				declareAccess({});
+			}
+		}
+
+	protected:
+		void updateBase(Time) override
+		{
+			onUpdate();
+		}
+
+	private:
+		FamilyBinding<F> family;
+		std::function<void()> onUpdate;
+	};
+
+	class UpdateLog {
+	public:
+		std::function<void()> add(String name, int sleepMs = 0)
+		{
+			return [this, name, sleepMs] ()
+			{
+				std::this_thread::sleep_for(std::chrono::milliseconds(sleepMs));
+				std::unique_lock<std::mutex> lock(mutex);
+				entries.push_back(name);
+			};
+		}
+
+		size_t indexOf(const String& name) const
+		{
+			return size_t(std::find(entries.begin(), entries.end(), name) - entries.begin());
+		}
+
+		size_t size() const { return entries.size(); }
+
+	private:
+		std::mutex mutex;
+		std::vector<String> entries;
+	};
+
+	template <typename F>
+	void addTestSystem(World& world, std::function<void()> onUpdate, bool declared = true)
+	{
+		world.addSystem(std::make_unique<SchedulerTestSystem<F>>(std::move(onUpdate), declared), TimeLine::FixedUpdate);
+	}
+}
+
+TEST(HalleyWorld, ParallelSystemsKeepConflictingOrder)
+{
+	TestExecutors executors(4);
+	TestWorld world;
+	world->setParallelSystems(true);
+
+	UpdateLog log;
+	addTestSystem<PositionFamily>(*world, log.add("write0", 20)); // The sleep gives later systems a chance to overtake it, if they weren't ordered
+	addTestSystem<ConstPositionFamily>(*world, log.add("read0", 10));
+	addTestSystem<VelocityFamily>(*world, log.add("velocity"));
+	addTestSystem<PositionFamily>(*world, log.add("write1"));
+	addTestSystem<ConstPositionFamily>(*world, log.add("exclusive", 10), false);
+	addTestSystem<ConstPositionFamily>(*world, log.add("read1"));
+
+	for (int i = 0; i < 3; ++i) {
+		world->step(TimeLine::FixedUpdate, 0.01);
+	}
+	ASSERT_EQ(log.size(), 18);
+
+	// indexOf finds the first step, which is as good as any other
+	EXPECT_LT(log.indexOf("write0"), log.indexOf("read0"));
+	EXPECT_LT(log.indexOf("read0"), log.indexOf("write1"));
+	EXPECT_LT(log.indexOf("write1"), log.indexOf("exclusive"));
+	EXPECT_LT(log.indexOf("velocity"), log.indexOf("exclusive"));
+	EXPECT_LT(log.indexOf("exclusive"), log.indexOf("read1"));
+}
+
+TEST(HalleyWorld, ParallelSystemsRunConcurrently)
+{
+	TestExecutors executors(4);
+	TestWorld world;
+	world->setParallelSystems(true);
+
+	// Each system waits for the others to start, which can only happen if they run at the same time
+	std::mutex mutex;
+	std::condition_variable condition;
+	int arrived = 0;
+	int metOthers = 0;
+	auto rendezvous = [&] ()
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		++arrived;
+		condition.notify_all();
+		if (condition.wait_for(lock, std::chrono::seconds(5), [&] { return arrived == 3; })) {
+			++metOthers;
+		}
+	};
+
+	addTestSystem<ConstPositionFamily>(*world, rendezvous);
+	addTestSystem<ConstPositionFamily>(*world, rendezvous);
+	addTestSystem<VelocityFamily>(*world, rendezvous);
+
+	world->step(TimeLine::FixedUpdate, 0.01);
+	EXPECT_EQ(metOthers, 3);
+}
+
+TEST(HalleyWorld, LoadSystemsKeepsUnsetOptions)
+{
+	TestWorld world;
+	world->setParallelSystems(true);
+
+	// Switching storage with components around throws, so this also checks it's left alone
+	world->setChunkedComponentStorage(true);
+	world->createEntity().addComponent(PositionTestComponent());
+
+	ConfigNode::MapType config;
+	config["timelines"] = ConfigNode(ConfigNode::MapType());
+	world->loadSystems(ConfigNode(std::move(config)), [] (String name) -> std::unique_ptr<System> { return {}; });
+	EXPECT_TRUE(world->isParallelSystems());
+}
@@ -777,6 +777,8 @@ public:
 		container->add(context.makeField("bool", pars.withSubKey("rotateTowardsMovement", "false"), ComponentEditorLabelCreation::Never));
 		container->add(context.makeLabel("destroyWhenDone"));
 		container->add(context.makeField("bool", pars.withSubKey("destroyWhenDone", "false"), ComponentEditorLabelCreation::Never));
+		container->add(context.makeLabel("parallelUpdate"));
+		container->add(context.makeField("bool", pars.withSubKey("parallelUpdate", "false"), ComponentEditorLabelCreation::Never));
 		
 		auto containerWeak = std::weak_ptr<UIWidget>(container);
 
@@ -1,14 +1,28 @@
 #include "console_window.h"
+#include "halley/core/devcon/devcon_server.h"
+#include "halley/tools/project/project.h"
 
 using namespace Halley;
 
-ConsoleWindow::ConsoleWindow(UIFactory& ui)
+ConsoleWindow::ConsoleWindow(UIFactory& ui, Project& project)
 	: UIWidget("console", {}, UISizer())
 	, factory(ui)
 {
 	controller = std::make_shared<UIDebugConsoleController>();
 	console = std::make_shared<UIDebugConsole>("debugConsole", ui, controller);
 
+	commands.addCommand("residency", [&project] (std::vector<String> args) -> UIDebugConsoleResponse
+	{
+		// Connected games reply through the log
+		auto* server = project.getDevConServer();
+		if (!server) {
+			return UIDebugConsoleResponse("DevCon server not running.");
+		}
+		server->listResidency();
+		return UIDebugConsoleResponse("Requested resource residency from connected games.");
+	});
+	controller->addCommands(commands);
+
 	Logger::addSink(*this);
 	ConsoleWindow::add(console, 1);
 	ConsoleWindow::log(LoggerLevel::Info, "Welcome to the Halley Game Engine Editor.");
@@ -16,6 +30,7 @@ ConsoleWindow::ConsoleWindow(UIFactory& ui)
 
 ConsoleWindow::~ConsoleWindow()
 {
+	controller->removeCommands(commands);
 	Logger::removeSink(*this);
 }
 
@@ -10,11 +10,12 @@
 namespace Halley
 {
 	class Painter;
+	class Project;
 
 	class ConsoleWindow : public UIWidget, public ILoggerSink
 	{
 	public:
-		explicit ConsoleWindow(UIFactory& ui);
+		ConsoleWindow(UIFactory& ui, Project& project);
 		~ConsoleWindow();
 
 		void log(LoggerLevel level, const String& msg) override;
@@ -29,6 +30,7 @@ namespace Halley
 		std::shared_ptr<UIDebugConsole> console;
 
 		std::shared_ptr<UIDebugConsoleController> controller;
+		UIDebugConsoleCommands commands;
 
 		mutable std::mutex mutex;
 	};
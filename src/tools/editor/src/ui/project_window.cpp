@@ -92,7 +92,7 @@ void ProjectWindow::makePagedPane()
 	}
 
 	assetEditorWindow = std::make_shared<AssetsBrowser>(factory, project, *this);
-	consoleWindow = std::make_shared<ConsoleWindow>(factory);
+	consoleWindow = std::make_shared<ConsoleWindow>(factory, project);
 	auto settings = std::make_shared<EditorSettingsWindow>(factory, editor.getPreferences(), project, editor.getProjectLoader(), *this);
 	auto properties = std::make_shared<GamePropertiesWindow>(factory, project);
 	auto ecs = std::make_shared<ECSWindow>(factory);
@@ -99,6 +99,13 @@ namespace Halley
 		virtual void import(const ImportingAsset&, IAssetCollector&) {}
 		virtual int dropFrontCount() const { return importByExtension ? 0 : 1; }
 
+		// Bump this whenever the output of the importer changes, so cached imports are discarded
+		virtual int getVersion() const { return 0; }
+
+		// How many assets of this type may be imported at the same time, 0 for no limit
+		// Importers which are already parallel internally, or which use a lot of memory, should set this
+		virtual int getMaxParallelImports() const { return 0; }
+
 		virtual String getAssetId(const Path& file, const std::optional<Metadata>& metadata) const
 		{
 			return file.dropFront(dropFrontCount()).string();
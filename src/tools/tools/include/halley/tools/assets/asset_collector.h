@@ -1,5 +1,6 @@
 #pragma once
 #include "halley/plugin/iasset_importer.h"
+#include "import_assets_database.h"
 
 namespace Halley {
 	class AssetCollector final : public IAssetCollector
@@ -19,7 +20,7 @@ namespace Halley {
 		std::vector<ImportingAsset> collectAdditionalAssets();
 		std::vector<std::pair<Path, Bytes>> collectOutFiles();
 		const std::vector<AssetResource>& getAssets() const;
-		const std::vector<TimestampedPath>& getAdditionalInputs() const;
+		const std::vector<AssetPath>& getAdditionalInputs() const;
 		
 	private:
 		const ImportingAsset& asset;
@@ -29,7 +30,7 @@ namespace Halley {
 
 		std::vector<AssetResource> assets;
 		std::vector<ImportingAsset> additionalAssets;
-		std::vector<TimestampedPath> additionalInputs;
+		std::vector<AssetPath> additionalInputs;
 		std::vector<std::pair<Path, Bytes>> outFiles;
 	};
 }
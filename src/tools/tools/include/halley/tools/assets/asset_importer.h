@@ -17,11 +17,14 @@ namespace Halley
 		IAssetImporter& getRootImporter(const Path& path) const;
 		std::vector<std::reference_wrapper<IAssetImporter>> getImporters(ImportAssetType type) const;
 		const std::vector<Path>& getAssetsSrc() const;
+		uint64_t getVersionHash() const;
+		int getMaxParallelImports(ImportAssetType type) const;
 
 	private:
 		std::map<ImportAssetType, std::vector<std::unique_ptr<IAssetImporter>>> importers;
 		std::vector<Path> assetsSrc;
 		bool importByExtension = false;
+		uint64_t versionHash = 0;
 
 		void addImporter(std::vector<std::unique_ptr<IAssetImporter>>& dst, std::unique_ptr<IAssetImporter> importer);
 	};
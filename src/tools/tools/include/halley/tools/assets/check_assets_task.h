@@ -46,6 +46,7 @@ namespace Halley
 		bool requestImport(ImportAssetsDatabase& db, std::map<String, ImportAssetsDatabaseEntry> assets, Path dstPath, String taskName, bool packAfter);
 		std::optional<Path> findDirectoryMeta(const std::vector<Path>& metas, const Path& path) const;
 		bool importFile(ImportAssetsDatabase& db, std::map<String, ImportAssetsDatabaseEntry>& assets, bool isCodegen, bool skipGen, const std::vector<Path>& directoryMetas, const Path& srcPath, const Path& filePath);
+		static uint64_t hashInputFile(const Path& path, const std::optional<Path>& dirMetaPath, const std::optional<Path>& privateMetaPath);
 		void sleep(int ms);
 	};
 }
@@ -0,0 +1,39 @@
+#pragma once
+#include "halley/file/path.h"
+#include "import_assets_database.h"
+#include <optional>
+
+namespace Halley
+{
+	// Local content-addressed store of import results, keyed by ImportAssetsDatabase::getImportKey.
+	// Lets identical inputs (e.g. after switching branches back and forth) be restored instead of re-imported.
+	class ImportAssetsCache
+	{
+	public:
+		class Entry
+		{
+		public:
+			std::vector<AssetResource> out;
+			std::vector<std::pair<Path, Bytes>> outFiles;
+			std::vector<AssetPath> additionalInputs;
+
+			void deserialize(Deserializer& s);
+		};
+
+		constexpr static size_t defaultMaxSize = size_t(1024) * 1024 * 1024;
+
+		explicit ImportAssetsCache(Path directory, size_t maxSize = defaultMaxSize);
+
+		std::optional<Entry> get(uint64_t key) const;
+		void put(uint64_t key, const std::vector<AssetResource>& out, const std::vector<std::pair<Path, Bytes>>& outFiles, const std::vector<AssetPath>& additionalInputs) const;
+
+		// Evicts the least recently used entries until the cache fits in maxSize
+		void prune() const;
+
+	private:
+		Path directory;
+		size_t maxSize;
+
+		Path getEntryPath(uint64_t key) const;
+	};
+}
@@ -17,12 +17,13 @@ namespace Halley
 	class AssetPath {
 	public:
 		AssetPath();
-		AssetPath(TimestampedPath path);
-		AssetPath(TimestampedPath path, Path dataPath);
+		AssetPath(TimestampedPath path, uint64_t hash = 0);
+		AssetPath(TimestampedPath path, Path dataPath, uint64_t hash = 0);
 
 		const Path& getPath() const;
 		const Path& getDataPath() const;
 		int64_t getTimestamp() const;
+		uint64_t getHash() const; // Content hash, 0 if unknown
 
 		void serialize(Serializer& s) const;
 		void deserialize(Deserializer& s);
@@ -30,6 +31,7 @@ namespace Halley
 	private:
 		TimestampedPath path;
 		Path dataPath;
+		uint64_t hash = 0;
 	};
 	
 	class ImportAssetsDatabaseEntry
@@ -38,7 +40,7 @@ namespace Halley
 		String assetId;
 		Path srcDir;
 		std::vector<AssetPath> inputFiles;
-		std::vector<TimestampedPath> additionalInputFiles; // These were requested by the importer, rather than enumerated directly
+		std::vector<AssetPath> additionalInputFiles; // These were requested by the importer, rather than enumerated directly
 		std::vector<AssetResource> outputFiles;
 		ImportAssetType assetType = ImportAssetType::Undefined;
 
@@ -80,6 +82,7 @@ namespace Halley
 		{
 		public:
 			std::array<int64_t, 3> timestamp;
+			uint64_t hash = 0;
 			Metadata metadata;
 			Path basePath;
 			bool missing = false; // Not serialized
@@ -96,7 +99,8 @@ namespace Halley
 		std::unique_ptr<AssetDatabase> makeAssetDatabase(const String& platform) const;
 
 		bool needToLoadInputMetadata(const Path& path, std::array<int64_t, 3> timestamps) const;
-		void setInputFileMetadata(const Path& path, std::array<int64_t, 3> timestamps, const Metadata& data, Path basePath);
+		void setInputFileMetadata(const Path& path, std::array<int64_t, 3> timestamps, uint64_t hash, const Metadata& data, Path basePath);
+		uint64_t getInputFileHash(const Path& path) const;
 		std::optional<Metadata> getMetadata(const Path& path) const;
 		std::optional<Metadata> getMetadata(AssetType type, const String& assetId) const;
 
@@ -108,6 +112,7 @@ namespace Halley
 
 		bool needsImporting(const ImportAssetsDatabaseEntry& asset, bool includeFailed) const;
 		void markAsImported(const ImportAssetsDatabaseEntry& asset);
+		uint64_t getImportKey(const ImportAssetsDatabaseEntry& asset, uint64_t importerVersion) const;
 		void markDeleted(const ImportAssetsDatabaseEntry& asset);
 		void markFailed(const ImportAssetsDatabaseEntry& asset);
 		void markAssetsAsStillPresent(const std::map<String, ImportAssetsDatabaseEntry>& assets);
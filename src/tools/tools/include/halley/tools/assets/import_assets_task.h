@@ -17,7 +17,7 @@ namespace Halley
 		struct ImportResult {
 			std::vector<AssetResource> out;
 			std::vector<std::pair<Path, Bytes>> outFiles;
-			std::vector<TimestampedPath> additionalInputs;
+			std::vector<AssetPath> additionalInputs;
 			bool success = false;
 			String errorMsg;
 		};
@@ -29,6 +29,22 @@ namespace Halley
 		void run() override;
 
 	private:
+		enum class ImportOutcome {
+			Imported,
+			Failed,
+			Cancelled
+		};
+
+		// Result of importing files[i], filled in by the worker that imported it
+		struct ImportJob {
+			ImportAssetType type = ImportAssetType::Undefined;
+			bool launched = false;
+
+			ImportOutcome outcome = ImportOutcome::Cancelled;
+			int64_t startTime = 0; // Nanoseconds since the task started
+			int64_t endTime = 0;
+		};
+
 		ImportAssetsDatabase& db;
 		std::shared_ptr<AssetImporter> importer;
 		Path assetsPath;
@@ -39,15 +55,12 @@ namespace Halley
 		std::vector<String> deletedAssets;
 		std::set<String> outputAssets;
 		
-		std::atomic<int64_t> totalImportTime;
-		std::atomic<size_t> assetsImported{};
-		size_t assetsToImport{};
+		std::vector<ImportJob> jobs;
 
-		std::mutex mutex;
-		
-		std::string curFileLabel;
+		void commitFinished(const std::vector<size_t>& finished);
+		void logTimings(int64_t realTimeNs);
 
-		bool doImportAsset(ImportAssetsDatabaseEntry& asset);
+		ImportOutcome doImportAsset(ImportAssetsDatabaseEntry& asset);
 
 		std::vector<Path> loadFont(const ImportAssetsDatabaseEntry& asset, Path dstDir);
 		std::vector<Path> genericImporter(const ImportAssetsDatabaseEntry& asset, Path dstDir);
@@ -0,0 +1,35 @@
+#pragma once
+#include "halley/resources/resource.h"
+#include <functional>
+#include <optional>
+#include <vector>
+
+namespace Halley
+{
+	class ExecutionQueue;
+
+	// Runs a batch of imports, keeping no more than the importer's limit of each asset type in flight at once
+	class ImportScheduler
+	{
+	public:
+		struct FinishedJob {
+			size_t index;
+			std::optional<String> error; // Set if the job threw
+		};
+
+		using LimitCallback = std::function<int(ImportAssetType)>; // 0 means unlimited
+		using JobCallback = std::function<void(size_t)>;
+		using FinishedCallback = std::function<void(const std::vector<FinishedJob>&)>;
+		using CancelledCallback = std::function<bool()>;
+
+		ImportScheduler(std::vector<ImportAssetType> types, LimitCallback getLimit);
+
+		// Jobs run on queue, or inline if it's null. onFinished is called on this thread, in batches, including for jobs that threw.
+		// Once cancelled, nothing else is started, but this still waits for the running jobs to finish.
+		void run(ExecutionQueue* queue, const JobCallback& runJob, const FinishedCallback& onFinished, const CancelledCallback& isCancelled);
+
+	private:
+		std::vector<ImportAssetType> types;
+		LimitCallback getLimit;
+	};
+}
@@ -18,6 +18,7 @@ namespace Halley {
 		static bool createParentDir(const Path& p);
 
 		static int64_t getLastWriteTime(const Path& p);
+		static void setLastWriteTime(const Path& p, int64_t time);
 		static bool isFile(const Path& p);
 		static bool isDirectory(const Path& p);
 
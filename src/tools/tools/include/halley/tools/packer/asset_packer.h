@@ -4,6 +4,7 @@
 #include "halley/resources/resource.h"
 #include "halley/core/resources/asset_database.h"
 #include "halley/data_structures/maybe.h"
+#include "halley/utils/utils.h"
 #include <set>
 
 namespace Halley {
@@ -50,6 +51,6 @@ namespace Halley {
 	private:
 		static std::map<String, AssetPackListing> sortIntoPacks(const AssetPackManifest& manifest, const AssetDatabase& srcAssetDb, std::optional<std::set<String>> assetsToPack, const std::vector<String>& deletedAssets);
 		static void generatePacks(std::map<String, AssetPackListing> packs, const Path& src, const Path& dst);
-		static void generatePack(const String& packId, const AssetPackListing& pack, const Path& src, const Path& dst);
+		static void generatePack(const String& packId, const AssetPackListing& pack, const Path& src, const Path& dst, const Bytes& seed);
 	};
 }
@@ -15,6 +15,7 @@ namespace Halley
 {
 	class ProjectLoader;
 	class ImportAssetsDatabase;
+	class ImportAssetsCache;
 
 	class HalleyStatics;
 	class IHalleyPlugin;
@@ -65,12 +66,14 @@ namespace Halley
 		ImportAssetsDatabase& getImportAssetsDatabase() const;
 		ImportAssetsDatabase& getCodegenDatabase() const;
 		ImportAssetsDatabase& getSharedCodegenDatabase() const;
+		ImportAssetsCache& getImportAssetsCache() const;
 		ECSData& getECSData();
 
 		const std::shared_ptr<AssetImporter>& getAssetImporter() const;
 		std::vector<std::unique_ptr<IAssetImporter>> getAssetImportersFromPlugins(ImportAssetType type) const;
 
 		void setDevConServer(DevConServer* server);
+		DevConServer* getDevConServer() const;
 		void addAssetReloadCallback(AssetReloadCallback callback);
 		void addAssetPackReloadCallback(AssetReloadCallback callback);
 		void addAssetLoadedListener(IAssetLoadListener* listener);
@@ -123,6 +126,7 @@ namespace Halley
 		Path rootPath;
 		Path halleyRootPath;
 		Path assetPackManifest;
+		DevConServer* devConServer = nullptr;
 
 		std::vector<AssetReloadCallback> assetReloadCallbacks;
 		std::vector<AssetReloadCallback> assetPackedReloadCallbacks;
@@ -132,6 +136,7 @@ namespace Halley
 		std::unique_ptr<ImportAssetsDatabase> importAssetsDatabase;
 		std::unique_ptr<ImportAssetsDatabase> codegenDatabase;
 		std::unique_ptr<ImportAssetsDatabase> sharedCodegenDatabase;
+		std::unique_ptr<ImportAssetsCache> importAssetsCache;
 		std::shared_ptr<AssetImporter> assetImporter;
 		std::unique_ptr<ProjectProperties> properties;
 		std::unique_ptr<ECSData> ecsData;
@@ -5,6 +5,7 @@
 #include "halley/support/logger.h"
 #include "halley/bytes/compression.h"
 #include "halley/utils/algorithm.h"
+#include "halley/utils/hash.h"
 
 using namespace Halley;
 
@@ -73,10 +74,11 @@ Bytes AssetCollector::readAdditionalFile(const Path& filePath)
 	for (const auto& path: assetsSrc) {
 		Path f = path / filePath;
 		if (FileSystem::exists(f)) {
-			if (!std_ex::contains_if(additionalInputs, [&] (const auto& e) { return e.first == f; })) {
-				additionalInputs.push_back(TimestampedPath(f, FileSystem::getLastWriteTime(f)));			
+			auto data = FileSystem::readFile(f);
+			if (!std_ex::contains_if(additionalInputs, [&] (const auto& e) { return e.getPath() == f; })) {
+				additionalInputs.push_back(AssetPath(TimestampedPath(f, FileSystem::getLastWriteTime(f)), Hash::hash(data)));
 			}
-			return FileSystem::readFile(f);
+			return data;
 		}
 	}
 	throw Exception("Unable to find asset dependency: \"" + filePath.getString() + "\"", HalleyExceptions::Tools);
@@ -97,7 +99,7 @@ std::vector<std::pair<Path, Bytes>> AssetCollector::collectOutFiles()
 	return std::move(outFiles);
 }
 
-const std::vector<TimestampedPath>& AssetCollector::getAdditionalInputs() const
+const std::vector<AssetPath>& AssetCollector::getAdditionalInputs() const
 {
 	return additionalInputs;
 }
@@ -19,6 +19,7 @@
 #include "importers/texture_importer.h"
 #include "importers/variable_importer.h"
 #include "importers/mesh_importer.h"
+#include "halley/utils/hash.h"
 
 using namespace Halley;
 
@@ -58,6 +59,16 @@ AssetImporter::AssetImporter(Project& project, std::vector<Path> assetsSrc)
 			addImporter(importerSet, std::move(pluginImporter));
 		}
 	}
+
+	// Importers can spawn assets of other types, so cached imports are tied to the whole set
+	Hash::Hasher hasher;
+	for (const auto& [type, importerSet]: importers) {
+		hasher.feed(int(type));
+		for (const auto& importer: importerSet) {
+			hasher.feed(importer->getVersion());
+		}
+	}
+	versionHash = hasher.digest();
 }
 
 void AssetImporter::addImporter(std::vector<std::unique_ptr<IAssetImporter>>& dst, std::unique_ptr<IAssetImporter> importer)
@@ -125,6 +136,26 @@ std::vector<std::reference_wrapper<IAssetImporter>> AssetImporter::getImporters(
 	throw Exception("Unknown asset type: " + toString(int(type)), HalleyExceptions::Tools);
 }
 
+uint64_t AssetImporter::getVersionHash() const
+{
+	return versionHash;
+}
+
+int AssetImporter::getMaxParallelImports(ImportAssetType type) const
+{
+	int result = 0;
+	const auto i = importers.find(type);
+	if (i != importers.end()) {
+		for (const auto& importer: i->second) {
+			const int limit = importer->getMaxParallelImports();
+			if (limit > 0) {
+				result = result > 0 ? std::min(result, limit) : limit;
+			}
+		}
+	}
+	return result;
+}
+
 const std::vector<Path>& AssetImporter::getAssetsSrc() const
 {
 	return assetsSrc;
@@ -10,6 +10,7 @@
 #include "halley/resources/resource_data.h"
 #include "halley/tools/assets/metadata_importer.h"
 #include "halley/concurrency/concurrent.h"
+#include "halley/utils/hash.h"
 
 using namespace Halley;
 using namespace std::chrono_literals;
@@ -125,15 +126,18 @@ bool CheckAssetsTask::importFile(ImportAssetsDatabase& db, std::map<String, Impo
 		privateMetaPath = {};
 	}
 
-	// Load metadata if needed
+	// Load metadata and hash contents if needed
+	uint64_t hash;
 	if (db.needToLoadInputMetadata(filePath, timestamps)) {
 		Metadata meta = MetadataImporter::getMetaData(filePath, dirMetaPath, privateMetaPath);
 		if (skipGen) {
 			meta.set("skipGen", true);
 		}
-		db.setInputFileMetadata(filePath, timestamps, meta, srcPath);
+		hash = hashInputFile(srcPath / filePath, dirMetaPath, privateMetaPath);
+		db.setInputFileMetadata(filePath, timestamps, hash, meta, srcPath);
 		dbChanged = true;
 	} else {
+		hash = db.getInputFileHash(filePath);
 		db.markInputPresent(filePath);
 	}
 
@@ -155,7 +159,7 @@ bool CheckAssetsTask::importFile(ImportAssetsDatabase& db, std::map<String, Impo
 		asset.assetId = assetId;
 		asset.assetType = assetImporter.getType();
 		asset.srcDir = srcPath;
-		asset.inputFiles.push_back(input);
+		asset.inputFiles.emplace_back(input, hash);
 	} else {
 		// Already exists
 		auto& asset = iter->second;
@@ -163,10 +167,10 @@ bool CheckAssetsTask::importFile(ImportAssetsDatabase& db, std::map<String, Impo
 			throw Exception("AssetId conflict on " + assetId, HalleyExceptions::Tools);
 		}
 		if (asset.srcDir == srcPath) {
-			asset.inputFiles.push_back(input);
+			asset.inputFiles.emplace_back(input, hash);
 		} else {
 			auto relPath = (srcPath / input.first).makeRelativeTo(asset.srcDir);
-			asset.inputFiles.emplace_back(input, relPath);
+			asset.inputFiles.emplace_back(input, relPath, hash);
 
 			// Don't mix files from two different source paths
 			//throw Exception("Mixed source dir input for " + assetId, HalleyExceptions::Tools);
@@ -176,6 +180,21 @@ bool CheckAssetsTask::importFile(ImportAssetsDatabase& db, std::map<String, Impo
 	return dbChanged;
 }
 
+uint64_t CheckAssetsTask::hashInputFile(const Path& path, const std::optional<Path>& dirMetaPath, const std::optional<Path>& privateMetaPath)
+{
+	Hash::Hasher hasher;
+	for (const auto& p: { std::optional<Path>(path), dirMetaPath, privateMetaPath }) {
+		if (p) {
+			const auto data = FileSystem::readFile(p.value());
+			hasher.feed(data.size());
+			hasher.feedBytes(gsl::as_bytes(gsl::span<const Byte>(data)));
+		} else {
+			hasher.feed(size_t(0));
+		}
+	}
+	return hasher.digest();
+}
+
 void CheckAssetsTask::sleep(int timeMs)
 {
 	std::unique_lock<std::mutex> lock(mutex);
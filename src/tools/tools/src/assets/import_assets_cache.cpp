@@ -0,0 +1,127 @@
+#include "halley/tools/assets/import_assets_cache.h"
+#include "halley/bytes/byte_serializer.h"
+#include "halley/support/logger.h"
+#include "halley/text/string_converter.h"
+#include "halley/tools/file/filesystem.h"
+#include "halley/utils/hash.h"
+#include <algorithm>
+#include <ctime>
+
+constexpr static int currentCacheVersion = 1;
+
+using namespace Halley;
+
+void ImportAssetsCache::Entry::deserialize(Deserializer& s)
+{
+	s >> out;
+	s >> outFiles;
+	s >> additionalInputs;
+}
+
+ImportAssetsCache::ImportAssetsCache(Path directory, size_t maxSize)
+	: directory(std::move(directory))
+	, maxSize(maxSize)
+{}
+
+std::optional<ImportAssetsCache::Entry> ImportAssetsCache::get(uint64_t key) const
+{
+	if (key == 0) {
+		return {};
+	}
+
+	const auto entryPath = getEntryPath(key);
+	const auto data = FileSystem::readFile(entryPath);
+	if (data.empty()) {
+		return {};
+	}
+
+	try {
+		auto s = Deserializer(data);
+		int version;
+		uint64_t storedKey;
+		s >> version;
+		s >> storedKey;
+		if (version != currentCacheVersion || storedKey != key) {
+			return {};
+		}
+
+		Entry entry;
+		s >> entry;
+
+		// Files read by the importer aren't part of the key, so make sure they still match
+		for (auto& input: entry.additionalInputs) {
+			if (!FileSystem::exists(input.getPath()) || Hash::hash(FileSystem::readFile(input.getPath())) != input.getHash()) {
+				return {};
+			}
+			input = AssetPath(TimestampedPath(input.getPath(), FileSystem::getLastWriteTime(input.getPath())), input.getHash());
+		}
+
+		// The write time doubles as the last use, for prune()
+		FileSystem::setLastWriteTime(entryPath, std::time(nullptr));
+
+		return entry;
+	} catch (const std::exception& e) {
+		// Most likely a partially written entry, just import again
+		Logger::logWarning("Discarding import cache entry " + getEntryPath(key).getString() + ": " + e.what());
+		return {};
+	}
+}
+
+void ImportAssetsCache::put(uint64_t key, const std::vector<AssetResource>& out, const std::vector<std::pair<Path, Bytes>>& outFiles, const std::vector<AssetPath>& additionalInputs) const
+{
+	if (key == 0) {
+		return;
+	}
+
+	const auto bytes = Serializer::toBytes([&] (Serializer& s)
+	{
+		s << currentCacheVersion;
+		s << key;
+		s << out; // Same layout as Entry::deserialize
+		s << outFiles;
+		s << additionalInputs;
+	});
+	FileSystem::writeFile(getEntryPath(key), bytes);
+}
+
+void ImportAssetsCache::prune() const
+{
+	struct CacheFile {
+		Path path;
+		int64_t lastUsed;
+		size_t size;
+	};
+
+	std::vector<CacheFile> files;
+	size_t totalSize = 0;
+	for (const auto& file: FileSystem::enumerateDirectory(directory)) {
+		if (file.getExtension() == ".cache") {
+			const auto path = directory / file;
+			const auto size = FileSystem::fileSize(path);
+			files.push_back(CacheFile{ path, FileSystem::getLastWriteTime(path), size });
+			totalSize += size;
+		}
+	}
+
+	if (totalSize <= maxSize) {
+		return;
+	}
+
+	std::sort(files.begin(), files.end(), [] (const CacheFile& a, const CacheFile& b)
+	{
+		return a.lastUsed < b.lastUsed;
+	});
+	for (const auto& file: files) {
+		if (totalSize <= maxSize) {
+			break;
+		}
+		FileSystem::remove(file.path);
+		totalSize -= file.size;
+	}
+}
+
+Path ImportAssetsCache::getEntryPath(uint64_t key) const
+{
+	const auto name = toString(key, 16, 16);
+	return directory / name.substr(0, 2) / (name + ".cache");
+}
@@ -3,21 +3,24 @@
 #include "halley/bytes/byte_serializer.h"
 #include "halley/resources/resource_data.h"
 #include "halley/tools/file/filesystem.h"
+#include "halley/utils/hash.h"
 
-constexpr static int currentAssetVersion = 82;
+constexpr static int currentAssetVersion = 86;
 
 using namespace Halley;
 
 AssetPath::AssetPath()
 {}
 
-AssetPath::AssetPath(TimestampedPath path)
+AssetPath::AssetPath(TimestampedPath path, uint64_t hash)
 	: path(std::move(path))
+	, hash(hash)
 {}
 
-AssetPath::AssetPath(TimestampedPath path, Path dataPath)
+AssetPath::AssetPath(TimestampedPath path, Path dataPath, uint64_t hash)
 	: path(std::move(path))
 	, dataPath(std::move(dataPath))
+	, hash(hash)
 {}
 
 const Path& AssetPath::getPath() const
@@ -35,16 +38,23 @@ int64_t AssetPath::getTimestamp() const
 	return path.second;
 }
 
+uint64_t AssetPath::getHash() const
+{
+	return hash;
+}
+
 void AssetPath::serialize(Serializer& s) const
 {
 	s << path;
 	s << dataPath;
+	s << hash;
 }
 
 void AssetPath::deserialize(Deserializer& s)
 {
 	s >> path;
 	s >> dataPath;
+	s >> hash;
 }
 
 void ImportAssetsDatabaseEntry::serialize(Serializer& s) const
@@ -87,6 +97,7 @@ void ImportAssetsDatabase::InputFileEntry::serialize(Serializer& s) const
 	for (int i = 0; i < nTimestamps; ++i) {
 		s << timestamp[i];
 	}
+	s << hash;
 	s << metadata;
 	s << basePath;
 }
@@ -103,6 +114,7 @@ void ImportAssetsDatabase::InputFileEntry::deserialize(Deserializer& s)
 	for (int i = nTimestamps; i < int(timestamp.size()); ++i) {
 		timestamp[i] = 0;
 	}
+	s >> hash;
 	s >> metadata;
 	s >> basePath;
 }
@@ -155,17 +167,26 @@ bool ImportAssetsDatabase::needToLoadInputMetadata(const Path& path, std::array<
 	return false;
 }
 
-void ImportAssetsDatabase::setInputFileMetadata(const Path& path, std::array<int64_t, 3> timestamps, const Metadata& data, Path basePath)
+void ImportAssetsDatabase::setInputFileMetadata(const Path& path, std::array<int64_t, 3> timestamps, uint64_t hash, const Metadata& data, Path basePath)
 {
 	std::lock_guard<std::mutex> lock(mutex);
 
 	auto& input = inputFiles[path.toString()];
 	input.timestamp = timestamps;
+	input.hash = hash;
 	input.metadata = data;
 	input.basePath = std::move(basePath);
 	input.missing = false;
 }
 
+uint64_t ImportAssetsDatabase::getInputFileHash(const Path& path) const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	const auto iter = inputFiles.find(path.toString());
+	return iter != inputFiles.end() ? iter->second.hash : 0;
+}
+
 void ImportAssetsDatabase::markInputPresent(const Path& path)
 {
 	std::lock_guard<std::mutex> lock(mutex);
@@ -292,21 +313,21 @@ bool ImportAssetsDatabase::needsImporting(const ImportAssetsDatabaseEntry& asset
 		if (result == oldAsset.inputFiles.end()) {
 			// File wasn't there before
 			return true;
-		} else if (result->getTimestamp() != i.getTimestamp()) {
-			// Timestamp changed
+		} else if (result->getHash() != i.getHash() || i.getHash() == 0) {
+			// Contents changed
 			return true;
 		}
 	}
 
 	// Any of the additional input files changed?
 	for (const auto& i: oldAsset.additionalInputFiles) {
-		if (!FileSystem::exists(i.first)) {
+		if (!FileSystem::exists(i.getPath())) {
 			// File removed
 			return true;
-		} else if  (FileSystem::getLastWriteTime(i.first) != i.second) {
-			// Timestamp changed
+		} else if (FileSystem::getLastWriteTime(i.getPath()) != i.getTimestamp() && Hash::hash(FileSystem::readFile(i.getPath())) != i.getHash()) {
+			// Contents changed (only hashed if the timestamp moved)
 			return true;
-		}		
+		}
 	}
 
 	// Have any of the output files gone missing?
@@ -338,6 +359,33 @@ void ImportAssetsDatabase::markAsImported(const ImportAssetsDatabaseEntry& asset
 	}
 }
 
+uint64_t ImportAssetsDatabase::getImportKey(const ImportAssetsDatabaseEntry& asset, uint64_t importerVersion) const
+{
+	// Identifies the output of an import by everything that goes into it, rather than by when it happened
+	Hash::Hasher hasher;
+	hasher.feed(currentAssetVersion);
+	hasher.feed(importerVersion);
+	hasher.feed(int(asset.assetType));
+	hasher.feed(asset.assetId);
+
+	std::lock_guard<std::mutex> lock(mutex);
+	for (const auto& i: asset.inputFiles) {
+		if (i.getHash() == 0) {
+			return 0;
+		}
+		hasher.feed(i.getPath().toString());
+		hasher.feed(i.getHash());
+
+		const auto iter = inputFiles.find(i.getPath().toString());
+		if (iter != inputFiles.end()) {
+			// Metadata includes flags set by the tool itself (e.g. skipGen), so the meta file hash alone isn't enough
+			const auto meta = Serializer::toBytes(iter->second.metadata);
+			hasher.feedBytes(gsl::as_bytes(gsl::span<const Byte>(meta)));
+		}
+	}
+	return hasher.digest();
+}
+
 void ImportAssetsDatabase::markDeleted(const ImportAssetsDatabaseEntry& asset)
 {
 	std::lock_guard<std::mutex> lock(mutex);
@@ -3,6 +3,8 @@
 #include "halley/tools/assets/check_assets_task.h"
 #include "halley/tools/project/project.h"
 #include "halley/tools/assets/import_assets_database.h"
+#include "halley/tools/assets/import_assets_cache.h"
+#include "halley/tools/assets/import_scheduler.h"
 #include "halley/resources/resource_data.h"
 #include "halley/tools/file/filesystem.h"
 #include "halley/tools/assets/asset_collector.h"
@@ -22,7 +24,6 @@ ImportAssetsTask::ImportAssetsTask(String taskName, ImportAssetsDatabase& db, st
 	, packAfter(packAfter)
 	, files(std::move(files))
 	, deletedAssets(std::move(deletedAssets))
-	, totalImportTime(0)
 {}
 
 void ImportAssetsTask::run()
@@ -31,42 +32,53 @@ void ImportAssetsTask::run()
 	using namespace std::chrono_literals;
 	auto lastSave = std::chrono::steady_clock::now();
 
-	assetsImported = 0;
-	assetsToImport = files.size();
-	std::vector<Future<void>> tasks;
-
-	constexpr bool parallelImport = !Debug::isDebug();
-
+	jobs.clear();
+	jobs.resize(files.size());
+	std::vector<ImportAssetType> types;
 	for (size_t i = 0; i < files.size(); ++i) {
-		auto importFunc = [&, i] () {
-			if (isCancelled()) {
-				return;
-			}
+		jobs[i].type = files[i].assetType;
+		types.push_back(files[i].assetType);
+	}
 
-			if (doImportAsset(files[i])) {
-				++assetsImported;
-				setProgress(float(assetsImported) * 0.98f / float(assetsToImport), files[i].assetId);
-			}
+	constexpr bool parallelImport = !Debug::isDebug();
 
-			auto now = std::chrono::steady_clock::now();
-			if (now - lastSave > 1s) {
-				db.save();
-				lastSave = now;
+	size_t nImported = 0;
+	ImportScheduler scheduler(std::move(types), [&] (ImportAssetType type) { return importer->getMaxParallelImports(type); });
+	scheduler.run(parallelImport ? &Executors::getCPUAux() : nullptr, [&] (size_t i)
+	{
+		auto& job = jobs[i];
+		job.launched = true;
+		job.startTime = timer.elapsedNanoseconds();
+		job.outcome = isCancelled() ? ImportOutcome::Cancelled : doImportAsset(files[i]);
+		job.endTime = timer.elapsedNanoseconds();
+	}, [&] (const std::vector<ImportScheduler::FinishedJob>& finished)
+	{
+		std::vector<size_t> indices;
+		for (const auto& f: finished) {
+			const auto i = f.index;
+			if (f.error) {
+				logError("\"" + files[i].assetId + "\" - " + f.error.value());
+				jobs[i].outcome = ImportOutcome::Failed;
+				jobs[i].endTime = timer.elapsedNanoseconds();
+			} else if (jobs[i].outcome == ImportOutcome::Imported) {
+				++nImported;
+				setProgress(float(nImported) * 0.98f / float(jobs.size()), files[i].assetId);
 			}
-		};
-
-		if (parallelImport) {
-			tasks.push_back(Concurrent::execute(Executors::getCPUAux(), importFunc));
-		} else {
-			importFunc();
+			indices.push_back(i);
 		}
-	}
+		commitFinished(indices);
 
-	Concurrent::whenAll(tasks.begin(), tasks.end()).get();
+		const auto now = std::chrono::steady_clock::now();
+		if (now - lastSave > 1s) {
+			db.save();
+			lastSave = now;
+		}
+	}, [&] () { return isCancelled(); });
 	db.save();
 
 	if (!isCancelled()) {
 		setProgress(1.0f, "");
+		project.getImportAssetsCache().prune();
 
 		if (!hasError()) {
 			if (!outputAssets.empty()) {
@@ -88,29 +100,98 @@ void ImportAssetsTask::run()
 	}
 
 	timer.pause();
-	Time realTime = timer.elapsedNanoseconds() / 1000000000.0;
-	Time importTime = totalImportTime / 1000000000.0;
-	logInfo("Import took " + toString(realTime) + " seconds, on which " + toString(importTime) + " seconds of work were performed (" + toString(importTime / realTime) + "x realtime)");
+	logTimings(timer.elapsedNanoseconds());
 }
 
-bool ImportAssetsTask::doImportAsset(ImportAssetsDatabaseEntry& asset)
+void ImportAssetsTask::commitFinished(const std::vector<size_t>& finished)
 {
-	logInfo("Importing " + asset.assetId);
-	Stopwatch timer;
+	// Only the scheduling thread touches these, so workers never wait on each other to record their results
+	for (const auto i: finished) {
+		const auto& asset = files[i];
+		if (jobs[i].outcome == ImportOutcome::Imported) {
+			db.markAsImported(asset);
+			for (const auto& o: asset.outputFiles) {
+				outputAssets.insert(toString(o.type) + ":" + o.name);
+			}
+		} else if (jobs[i].outcome == ImportOutcome::Failed) {
+			db.markFailed(asset);
+		}
+	}
+}
+
+void ImportAssetsTask::logTimings(int64_t realTimeNs)
+{
+	struct TypeTiming {
+		size_t count = 0;
+		int64_t total = 0;
+		int64_t longest = 0;
+	};
+	std::map<ImportAssetType, TypeTiming> byType;
+	int64_t totalImportTime = 0;
+
+	// With no dependencies between imports, the slowest one bounds how fast this can go regardless of thread count
+	std::optional<size_t> slowest;
+	for (size_t i = 0; i < jobs.size(); ++i) {
+		const auto& job = jobs[i];
+		if (!job.launched) {
+			continue;
+		}
+		const int64_t duration = job.endTime - job.startTime;
+
+		auto& timing = byType[job.type];
+		++timing.count;
+		timing.total += duration;
+		timing.longest = std::max(timing.longest, duration);
+		totalImportTime += duration;
 
-	auto result = importAsset(asset, [&] (const Path& path) { return db.getMetadata(path); }, *importer, assetsPath, [=] (float, const String&) -> bool { return !isCancelled(); });
+		if (!slowest || duration > jobs[*slowest].endTime - jobs[*slowest].startTime) {
+			slowest = i;
+		}
+	}
+
+	const Time realTime = realTimeNs / 1000000000.0;
+	const Time importTime = totalImportTime / 1000000000.0;
+	logInfo("Import took " + toString(realTime) + " seconds, on which " + toString(importTime) + " seconds of work were performed (" + toString(importTime / realTime) + "x realtime)");
+
+	if (slowest) {
+		const auto& job = jobs[*slowest];
+		logInfo("Slowest asset: " + files[*slowest].assetId + " (" + toString((job.endTime - job.startTime) / 1000000000.0) + " seconds)");
+	}
+
+	for (const auto& [type, timing]: byType) {
+		logInfo("- " + toString(type) + ": " + toString(timing.count) + " asset(s), " + toString(timing.total / 1000000000.0) + " s total, " + toString(timing.longest / 1000000000.0) + " s longest");
+	}
+}
+
+ImportAssetsTask::ImportOutcome ImportAssetsTask::doImportAsset(ImportAssetsDatabaseEntry& asset)
+{
+	// Identical inputs were imported before, just restore the output
+	const auto& cache = project.getImportAssetsCache();
+	const auto cacheKey = db.getImportKey(asset, importer->getVersionHash());
+	ImportResult result;
+	if (auto cached = cache.get(cacheKey)) {
+		logInfo("Restoring " + asset.assetId + " from import cache");
+		result.out = std::move(cached->out);
+		result.outFiles = std::move(cached->outFiles);
+		result.additionalInputs = std::move(cached->additionalInputs);
+		result.success = true;
+	} else {
+		logInfo("Importing " + asset.assetId);
+		result = importAsset(asset, [&] (const Path& path) { return db.getMetadata(path); }, *importer, assetsPath, [=] (float, const String&) -> bool { return !isCancelled(); });
+		if (result.success) {
+			cache.put(cacheKey, result.out, result.outFiles, result.additionalInputs);
+		}
+	}
 	
 	if (!result.success) {
 		logError("\"" + asset.assetId + "\" - " + result.errorMsg);
 		asset.additionalInputFiles = std::move(result.additionalInputs);
-		db.markFailed(asset);
-
-		return false;
+		return ImportOutcome::Failed;
 	}
 	
 	// Check if it didn't get cancelled
 	if (isCancelled()) {
-		return false;
+		return ImportOutcome::Cancelled;
 	}
 
 	// Retrieve previous output from this asset, and remove any files which went missing
@@ -131,21 +212,11 @@ bool ImportAssetsTask::doImportAsset(ImportAssetsDatabaseEntry& asset)
 		FileSystem::writeFile(path, outFile.second);
 	}
 
-	// Add to list of output assets
-	for (auto& o: result.out) {
-		std::unique_lock<std::mutex> lock(mutex);
-		outputAssets.insert(toString(o.type) + ":" + o.name);
-	}
-
-	// Store output in db
+	// Output is registered and stored in db by commitFinished
 	asset.additionalInputFiles = std::move(result.additionalInputs);
 	asset.outputFiles = std::move(result.out);
-	db.markAsImported(asset);
-
-	timer.pause();
-	totalImportTime += timer.elapsedNanoseconds();
 
-	return true;
+	return ImportOutcome::Imported;
 }
 
 ImportAssetsTask::ImportResult ImportAssetsTask::importAsset(const ImportAssetsDatabaseEntry& asset, const MetadataFetchCallback& metadataFetcher, const AssetImporter& importer, Path assetsPath, AssetCollector::ProgressReporter progressReporter)
@@ -0,0 +1,91 @@
+#include "halley/tools/assets/import_scheduler.h"
+#include "halley/concurrency/concurrent.h"
+#include "halley/support/exception.h"
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+
+using namespace Halley;
+
+ImportScheduler::ImportScheduler(std::vector<ImportAssetType> types, LimitCallback getLimit)
+	: types(std::move(types))
+	, getLimit(std::move(getLimit))
+{}
+
+void ImportScheduler::run(ExecutionQueue* queue, const JobCallback& runJob, const FinishedCallback& onFinished, const CancelledCallback& isCancelled)
+{
+	using namespace std::chrono_literals;
+
+	std::map<ImportAssetType, std::deque<size_t>> waiting;
+	for (size_t i = 0; i < types.size(); ++i) {
+		waiting[types[i]].push_back(i);
+	}
+
+	std::mutex mutex;
+	std::condition_variable jobFinished;
+	std::vector<FinishedJob> finishedJobs;
+
+	std::map<ImportAssetType, int> running;
+	size_t nLaunched = 0;
+	size_t nDone = 0;
+
+	auto launch = [&] (size_t i)
+	{
+		++running[types[i]];
+		++nLaunched;
+
+		auto jobFunc = [&, i] () {
+			// Always report back, or run() would wait forever for this job
+			FinishedJob result{ i, std::nullopt };
+			try {
+				runJob(i);
+			} catch (const Exception& e) {
+				result.error = e.getMessage();
+			} catch (const std::exception& e) {
+				result.error = String(e.what());
+			} catch (...) {
+				result.error = String("Unknown error");
+			}
+
+			std::unique_lock<std::mutex> lock(mutex);
+			finishedJobs.push_back(std::move(result));
+			jobFinished.notify_one();
+		};
+
+		if (queue) {
+			Concurrent::execute(*queue, jobFunc);
+		} else {
+			jobFunc();
+		}
+	};
+
+	while (nDone < nLaunched || (nLaunched < types.size() && !isCancelled())) {
+		if (!isCancelled()) {
+			for (auto& [type, jobs]: waiting) {
+				const int limit = getLimit(type);
+				while (!jobs.empty() && (limit == 0 || running[type] < limit)) {
+					const auto i = jobs.front();
+					jobs.pop_front();
+					launch(i);
+				}
+			}
+		}
+
+		std::vector<FinishedJob> finished;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			jobFinished.wait_for(lock, 100ms, [&] () { return !finishedJobs.empty(); });
+			finished = std::move(finishedJobs);
+			finishedJobs.clear();
+		}
+
+		for (const auto& job: finished) {
+			--running[types[job.index]];
+		}
+		nDone += finished.size();
+		if (!finished.empty()) {
+			onFinished(finished);
+		}
+	}
+}
@@ -6,6 +6,28 @@
 
 using namespace Halley;
 
+namespace {
+	void collectDependencies(const EntityData& data, std::set<String>& deps)
+	{
+		if (!data.getPrefab().isEmpty()) {
+			deps.insert(toString(AssetType::Prefab) + ":" + data.getPrefab());
+		}
+		for (const auto& child: data.getChildren()) {
+			collectDependencies(child, deps);
+		}
+	}
+
+	// Lets Resources::prefetch pull in nested prefabs alongside the asset
+	void setDependencies(Metadata& meta, const Prefab& prefab)
+	{
+		std::set<String> deps;
+		collectDependencies(prefab.getEntityData(), deps);
+		if (!deps.empty()) {
+			meta.set("dependencies", String::concatList(Vector<String>(deps.begin(), deps.end()), ","));
+		}
+	}
+}
+
 void ConfigImporter::import(const ImportingAsset& asset, IAssetCollector& collector)
 {
 	ConfigFile config = YAMLConvert::parseConfig(gsl::as_bytes(gsl::span<const Byte>(asset.inputFiles.at(0).data)));
@@ -23,6 +45,7 @@ void PrefabImporter::import(const ImportingAsset& asset, IAssetCollector& collec
 
 	Metadata meta = asset.inputFiles.at(0).metadata;
 	meta.set("asset_compression", "deflate");
+	setDependencies(meta, prefab);
 
 	collector.output(Path(asset.assetId).replaceExtension("").string(), AssetType::Prefab, Serializer::toBytes(prefab), meta);
 }
@@ -34,6 +57,7 @@ void SceneImporter::import(const ImportingAsset& asset, IAssetCollector& collect
 
 	Metadata meta = asset.inputFiles.at(0).metadata;
 	meta.set("asset_compression", "deflate");
+	setDependencies(meta, scene);
 
 	collector.output(Path(asset.assetId).replaceExtension("").string(), AssetType::Scene, Serializer::toBytes(scene), meta);
 }
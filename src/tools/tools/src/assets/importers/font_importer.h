@@ -7,6 +7,7 @@ namespace Halley
 	{
 	public:
 		ImportAssetType getType() const override { return ImportAssetType::Font; }
+		int getMaxParallelImports() const override { return 1; } // Distance field generation already uses every core
 
 		void import(const ImportingAsset& asset, IAssetCollector& collector) override;
 	};
@@ -2,20 +2,39 @@
 #include "halley/tools/assets/import_assets_database.h"
 #include "halley/tools/file/filesystem.h"
 #include "halley/file_formats/image.h"
+#include "halley/file_formats/texture_container.h"
 
 using namespace Halley;
 
 void TextureImporter::import(const ImportingAsset& asset, IAssetCollector& collector)
 {
-	// Update metadata
 	auto meta = asset.inputFiles.at(0).metadata;
-	meta.set("compression", "png");
 
 	// Get image
 	Image image;
 	Deserializer s(asset.inputFiles.at(0).data);
 	s >> image;
 
-	// Encode to PNG and save
-	collector.output(asset.assetId, AssetType::Texture, image.savePNGToBytes(), meta);
+	// PNG can still be requested explicitly, e.g. where download size matters more than load times.
+	// This is separate from "compression", which describes the source image.
+	const auto textureFormat = meta.getString("textureFormat", "htex");
+	if (textureFormat == "png") {
+		meta.set("compression", "png");
+		collector.output(asset.assetId, AssetType::Texture, image.savePNGToBytes(), meta);
+		return;
+	} else if (textureFormat != "htex") {
+		throw Exception("Unknown texture format \"" + textureFormat + "\" on " + asset.assetId, HalleyExceptions::Tools);
+	}
+
+	if (image.getFormat() == Image::Format::RGBA && meta.getBool("premultiply", false)) {
+		image.preMultiply();
+		meta.set("format", toString(image.getFormat()));
+	}
+
+	// Raw pixels in upload layout, with mip maps baked in
+	const bool mipMaps = meta.getBool("mipmap", false);
+	auto bytes = TextureContainer::encode(image, mipMaps);
+	meta.set("textureFormat", "htex");
+	meta.set("mipLevels", mipMaps ? TextureContainer::getNumMipLevels(image.getSize()) : 1);
+	collector.output(asset.assetId, AssetType::Texture, bytes, meta);
 }
@@ -243,7 +243,12 @@ Vector<String> CodegenCPP::generateComponentHeader(ComponentSchema component)
 	gen
 		.setAccessLevel(MemberAccess::Public)
 		.addMember(MemberSchema(TypeSchema("int", false, true, true), "componentIndex", toString(component.id)))
-		.addMember(MemberSchema(TypeSchema("char*", true, true, true), "componentName", component.name))
+		.addMember(MemberSchema(TypeSchema("char*", true, true, true), "componentName", component.name));
+	if (component.prefabTemplateCopy) {
+		gen.addMember(MemberSchema(TypeSchema("bool", false, true, true), "prefabTemplateCopy", "true"));
+	}
+
+	gen
 		.addBlankLine()
 		.addMembers(component.members)
 		.addBlankLine()
@@ -393,7 +398,8 @@ Vector<String> CodegenCPP::generateSystemHeader(SystemSchema& system, const Hash
 				.addBlankLine()
 				.addTypeDefinition("Type", "Halley::FamilyType<" + String::concatList(convert<ComponentReferenceSchema, String>(fam.components, [](auto& comp)
 				{
-					return comp.optional ? "Halley::MaybeRef<" + comp.name + "Component>" : comp.name + "Component";
+					const String type = String(comp.write ? "" : "const ") + comp.name + "Component";
+					return comp.optional ? "Halley::MaybeRef<" + type + ">" : type;
 				}), ", ") + ">")
 				.addBlankLine()
 				.setAccessLevel(MemberAccess::Protected)
@@ -609,11 +615,17 @@ Vector<String> CodegenCPP::generateSystemHeader(SystemSchema& system, const Hash
 			}, "canHandleSystemMessage", true, false, true, true), canReceiveBody);
 	}
 
+	// Access declaration, used to schedule systems concurrently
+	const bool sendsMessages = std::any_of(system.messages.begin(), system.messages.end(), [] (const MessageReferenceSchema& msg) { return msg.send; });
+	const bool sendsSystemMessages = std::any_of(system.systemMessages.begin(), system.systemMessages.end(), [] (const MessageReferenceSchema& msg) { return msg.send; });
+	const String servicesDeclared = String::concatList(convert<ServiceSchema, String>(system.services, [](auto& service) { return "typeid(" + service.name + ").name()"; }), ", ");
+	const String accessDeclaration = "declareAccess({ " + toString(int(system.access)) + ", { " + servicesDeclared + " }, " + (sendsMessages ? "true" : "false") + ", " + (sendsSystemMessages ? "true" : "false") + " });";
+
 	sysClassGen
 		.setAccessLevel(MemberAccess::Public)
 		.addCustomConstructor({}, {
 			VariableSchema(TypeSchema(""), "System", "{" + String::concatList(convert<FamilySchema, String>(system.families, [](auto& fam) { return "&" + fam.name + "Family"; }), ", ") + "}, {" + String::concatList(entityMsgsReceived, ", ") + "}")
-		}, { "static_assert(std::is_final_v<T>, \"System must be final.\");" })
+		}, { "static_assert(std::is_final_v<T>, \"System must be final.\");", accessDeclaration })
 		.finish()
 		.writeTo(contents);
 
@@ -1,39 +1,109 @@
 #include "halley/tools/distance_field/distance_field_generator.h"
 #include <cassert>
 #include <halley/file_formats/image.h>
+#include <halley/concurrency/concurrent.h>
 #include <gsl/gsl_assert>
 
 using namespace Halley;
 
-static float getDistanceAt(const int* src, int srcW, int srcH, int xCentre, int yCentre, float radius)
-{
-	auto getAlpha = [&](int x, int y) { return (src[x + y * srcW] & 0xFF000000) >> 24; };
-	bool isInside = getAlpha(xCentre, yCentre) > 127;
-	if (radius < 0.001f) {
-		return isInside ? 1.0f : 0.0f;
-	}
+namespace {
+	constexpr double farAway = 1e20;
+	constexpr size_t linesPerTask = 16;
+
+	// Squared distance transform of one line (Felzenszwalb & Huttenlocher), in place.
+	// The lower envelope of the parabolas rooted at each sample gives the exact distance in linear time.
+	class LineTransform {
+	public:
+		explicit LineTransform(size_t maxLength)
+			: f(maxLength)
+			, z(maxLength + 1)
+			, v(maxLength)
+		{}
+
+		void run(double* data, size_t stride, size_t n)
+		{
+			for (size_t i = 0; i < n; ++i) {
+				f[i] = data[i * stride];
+			}
+
+			size_t k = 0;
+			v[0] = 0;
+			z[0] = -farAway;
+			z[1] = farAway;
+			for (size_t q = 1; q < n; ++q) {
+				double s = intersect(q, v[k]);
+				while (s <= z[k]) {
+					--k;
+					s = intersect(q, v[k]);
+				}
+				++k;
+				v[k] = int(q);
+				z[k] = s;
+				z[k + 1] = farAway;
+			}
 
-	int iRadius = int(ceil(radius));
-	int x0 = std::max(0, xCentre - iRadius);
-	int x1 = std::min(xCentre + iRadius, srcW - 1);
-	int y0 = std::max(0, yCentre - iRadius);
-	int y1 = std::min(yCentre + iRadius, srcH - 1);
-
-	int bestDistSqr = 2147483647;
-	for (int y = y0; y <= y1; y++) {
-		for (int x = x0; x <= x1; x++) {
-			bool thisInside = getAlpha(x, y) > 127;
-			if (isInside != thisInside) {
-				// Candidate for best neighbour
-				int distSqr = (x - xCentre) * (x - xCentre) + (y - yCentre) * (y - yCentre);
-				bestDistSqr = std::min(distSqr, bestDistSqr);
+			k = 0;
+			for (size_t q = 0; q < n; ++q) {
+				while (z[k + 1] < double(q)) {
+					++k;
+				}
+				const double d = double(q) - double(v[k]);
+				data[q * stride] = d * d + f[v[k]];
 			}
 		}
+
+	private:
+		std::vector<double> f;
+		std::vector<double> z;
+		std::vector<int> v;
+
+		double intersect(size_t q, int p) const
+		{
+			const double qd = double(q);
+			const double pd = double(p);
+			return ((f[q] + qd * qd) - (f[p] + pd * pd)) / (2.0 * qd - 2.0 * pd);
+		}
+	};
+
+	// Runs the 1D transform over every column and then every row, which is separable for the Euclidean distance.
+	void transform2D(std::vector<double>& grid, size_t w, size_t h)
+	{
+		Concurrent::parallelFor(0, (w + linesPerTask - 1) / linesPerTask, [&] (size_t block)
+		{
+			LineTransform transform(h);
+			for (size_t x = block * linesPerTask; x < std::min(w, (block + 1) * linesPerTask); ++x) {
+				transform.run(grid.data() + x, w, h);
+			}
+		});
+
+		Concurrent::parallelFor(0, (h + linesPerTask - 1) / linesPerTask, [&] (size_t block)
+		{
+			LineTransform transform(w);
+			for (size_t y = block * linesPerTask; y < std::min(h, (block + 1) * linesPerTask); ++y) {
+				transform.run(grid.data() + y * w, 1, w);
+			}
+		});
 	}
+}
+
+static bool isInside(int pixel)
+{
+	return ((pixel & 0xFF000000) >> 24) > 127;
+}
+
+static float getDistanceAt(const int* src, const double* distSqr, int srcW, int x, int y, float radius)
+{
+	const bool inside = isInside(src[x + y * srcW]);
+	if (radius < 0.001f) {
+		return inside ? 1.0f : 0.0f;
+	}
+
+	// Nothing on the other side anywhere in the image
+	const double bestDistSqr = std::min(distSqr[x + y * srcW], 2147483647.0);
 
 	const float dist = float(sqrt(bestDistSqr));
 	const float normalDistance = (2 * dist - 1) / (2 * radius);
-	const float finalValue = 0.5f * (isInside ? 1.0f + normalDistance : 1.0f - normalDistance);
+	const float finalValue = 0.5f * (inside ? 1.0f + normalDistance : 1.0f - normalDistance);
 
 	return finalValue;
 }
@@ -46,6 +116,25 @@ std::unique_ptr<Image> DistanceFieldGenerator::generate(Image& srcImg, Vector2i
 	const int srcH = srcImg.getHeight();
 	const auto src = srcImg.getPixels4BPP();
 
+	// Squared distance from each texel to the closest texel on the other side of the edge.
+	// Each side is measured against its own set of features, and then merged.
+	const size_t nTexels = size_t(srcW) * size_t(srcH);
+	std::vector<double> toInside(nTexels);
+	std::vector<double> toOutside(nTexels);
+	for (size_t i = 0; i < nTexels; ++i) {
+		const bool inside = isInside(src[i]);
+		toInside[i] = inside ? 0.0 : farAway;
+		toOutside[i] = inside ? farAway : 0.0;
+	}
+	transform2D(toInside, srcW, srcH);
+	transform2D(toOutside, srcW, srcH);
+	for (size_t i = 0; i < nTexels; ++i) {
+		if (isInside(src[i])) {
+			toInside[i] = toOutside[i];
+		}
+	}
+	const auto& distSqr = toInside;
+
 	auto dstImg = std::make_unique<Image>(Image::Format::SingleChannel, size);
 
 	const int w = size.x;
@@ -55,21 +144,23 @@ std::unique_ptr<Image> DistanceFieldGenerator::generate(Image& srcImg, Vector2i
 	int texelW = srcW / w;
 	int texelH = srcH / h;
 
-	for (int y = 0; y < h; y++) {
+	Concurrent::parallelFor(0, size_t(h), [&] (size_t row)
+	{
+		const int y = int(row);
 		for (int x = 0; x < w; x++) {
 			unsigned char* dst = &dstStart[x + y * w];
 			float distAcc = 0;
-			// For each sub-pixel, compute the distance to closest pixel of the opposite value
+			// For each sub-pixel, take the distance to closest pixel of the opposite value
 			// Then average it all
 			for (int j = 0; j < texelH; j++) {
 				for (int i = 0; i < texelW; i++) {
-					distAcc += getDistanceAt(src.data(), srcW, srcH, x * srcW / w + i, y * srcH / h + j, radius * srcW / w);
+					distAcc += getDistanceAt(src.data(), distSqr.data(), srcW, x * srcW / w + i, y * srcH / h + j, radius * srcW / w);
 				}
 			}
 			int distance = clamp(int(distAcc * 255 / (texelW * texelH)), 0, 255);
 			*dst = static_cast<unsigned char>(distance);
 		}
-	}
+	});
 
 	return dstImg;
 }
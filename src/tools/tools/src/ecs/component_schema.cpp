@@ -60,6 +60,9 @@ ComponentSchema::ComponentSchema(YAML::Node node, bool generate)
 		customImplementation = node["customImplementation"].as<std::string>();
 	}
 
+	// Only safe for components that don't own anything shared, e.g. shared_ptrs or handles
+	prefabTemplateCopy = node["prefabTemplateCopy"].as<bool>(false);
+
 	const auto deps = node["componentDependencies"];
 	if (deps.IsSequence()) {
 		for (auto n = deps.begin(); n != deps.end(); ++n) {
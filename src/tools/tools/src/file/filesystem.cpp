@@ -50,6 +50,12 @@ int64_t FileSystem::getLastWriteTime(const Path& p)
 	return result;
 }
 
+void FileSystem::setLastWriteTime(const Path& p, int64_t time)
+{
+	boost::system::error_code ec;
+	last_write_time(getNative(p), std::time_t(time), ec);
+}
+
 bool FileSystem::isFile(const Path& p)
 {
 	return is_regular_file(getNative(p));
@@ -110,8 +110,10 @@ void AssetPackInspector::printData() const
 			std::cout << "  Assets of type " << infoCol << lastType << stdCol << ":\n";
 		}
 
+		// v2 entries also have the unpacked size and flags
 		auto splitPath = entry.entry.path.split(':');
-		std::cout << "    [" << i << "] " << strCol << entry.key << stdCol << " [" << infoCol << toString(entry.hash, 16) << stdCol << "]: at " << infoCol << splitPath.at(0) << stdCol << ", " << infoCol << splitPath.at(1) << stdCol << " bytes, " << strCol << toString(entry.entry.meta) <<  stdCol << "\n";
+		const String unpacked = splitPath.size() >= 4 ? " (" + splitPath[2] + " unpacked, flags " + splitPath[3] + ")" : "";
+		std::cout << "    [" << i << "] " << strCol << entry.key << stdCol << " [" << infoCol << toString(entry.hash, 16) << stdCol << "]: at " << infoCol << splitPath.at(0) << stdCol << ", " << infoCol << splitPath.at(1) << stdCol << " bytes" << unpacked << ", " << strCol << toString(entry.entry.meta) <<  stdCol << "\n";
 
 		++i;
 	}
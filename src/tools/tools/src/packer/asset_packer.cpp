@@ -8,6 +8,8 @@
 #include "halley/core/resources/asset_pack.h"
 #include "halley/tools/project/project.h"
 #include "halley/tools/assets/import_assets_database.h"
+#include "halley/concurrency/concurrent.h"
+#include "halley/maths/random.h"
 using namespace Halley;
 
 
@@ -147,6 +149,14 @@ std::map<String, AssetPackListing> AssetPacker::sortIntoPacks(const AssetPackMan
 
 void AssetPacker::generatePacks(std::map<String, AssetPackListing> packs, const Path& src, const Path& dst)
 {
+	struct PackToGenerate {
+		const String* packId;
+		const AssetPackListing* listing;
+		Path dst;
+		Bytes seed;
+	};
+	std::vector<PackToGenerate> toGenerate;
+
 	for (auto& packListing: packs) {
 		if (packListing.first.isEmpty()) {
 			Logger::logWarning("The following assets will not be packed:");
@@ -158,43 +168,58 @@ void AssetPacker::generatePacks(std::map<String, AssetPackListing> packs, const
 			// Only pack if this pack listing is active or if it doesn't exist
 			auto dstPack = dst / packListing.first + ".dat";
 			if (packListing.second.isActive() || !FileSystem::exists(dstPack)) {
-				generatePack(packListing.first, packListing.second, src, dstPack);
+				// Each pack gets its own generator for IVs, as the global one isn't thread-safe
+				Bytes seed(16);
+				Random::getGlobal().getBytes(gsl::span<Byte>(seed));
+				toGenerate.push_back(PackToGenerate{ &packListing.first, &packListing.second, dstPack, std::move(seed) });
 			}
 		}
 	}
+
+	Concurrent::parallelFor(Executors::getCPUAux(), 0, toGenerate.size(), [&] (size_t i)
+	{
+		const auto& p = toGenerate[i];
+		generatePack(*p.packId, *p.listing, src, p.dst, p.seed);
+	});
 }
 
-void AssetPacker::generatePack(const String& packId, const AssetPackListing& packListing, const Path& src, const Path& dst)
+void AssetPacker::generatePack(const String& packId, const AssetPackListing& packListing, const Path& src, const Path& dst, const Bytes& seed)
 {
-	AssetPack pack;
-	AssetDatabase& db = pack.getAssetDatabase();
-	Bytes& data = pack.getData();
-
-	for (auto& entry: packListing.getEntries()) {
-		//Logger::logDev("  [" + toString(entry.type) + "] " + entry.name);
+	const auto& entries = packListing.getEntries();
+	const auto& encryptionKey = packListing.getEncryptionKey();
+
+	std::vector<std::array<char, 16>> ivs(entries.size());
+	if (!encryptionKey.isEmpty()) {
+		Random rng(gsl::as_bytes(gsl::span<const Byte>(seed)));
+		for (auto& iv: ivs) {
+			rng.getBytes(gsl::as_writable_bytes(gsl::span<char>(iv)));
+		}
+	}
 
-		// Read original file
+	// Every asset is compressed and encrypted on its own, so they can all be done in parallel
+	std::vector<AssetPackEntryData> encoded(entries.size());
+	Concurrent::parallelFor(Executors::getCPUAux(), 0, entries.size(), [&] (size_t i)
+	{
+		const auto& entry = entries[i];
 		auto fileData = FileSystem::readFile(src / entry.path);
-		const size_t pos = data.size();
-		const size_t size = fileData.size();
-		if (size == 0) {
+		if (fileData.empty()) {
 			throw Exception("Unable to pack: \"" + (src / entry.path) + "\". File not found or empty.", HalleyExceptions::Tools);
 		}
-		
-		// Read data into pack data
-		data.reserve(nextPowerOf2(pos + size));
-		data.resize(pos + size);
-		memcpy(data.data() + pos, fileData.data(), size);
 
-		db.addAsset(entry.name, entry.type, AssetDatabase::Entry(toString(pos) + ":" + toString(size), entry.metadata));
-	}
+		// Audio clips are streamed, so they're kept seekable
+		const bool compress = entry.type != AssetType::AudioClip;
+		encoded[i] = AssetPack::encodeAsset(gsl::as_bytes(gsl::span<const Byte>(fileData)), compress, encryptionKey, ivs[i]);
+	});
 
-	if (!packListing.getEncryptionKey().isEmpty()) {
-		Logger::logInfo("- Encrypting \"" + packId + "\"...");
-		pack.encrypt(packListing.getEncryptionKey());
+	AssetPack pack;
+	size_t originalSize = 0;
+	for (size_t i = 0; i < entries.size(); ++i) {
+		originalSize += encoded[i].size;
+		pack.addAsset(entries[i].name, entries[i].type, encoded[i], entries[i].metadata);
+		encoded[i] = AssetPackEntryData();
 	}
 
 	// Write pack
 	FileSystem::writeFile(dst, pack.writeOut());
-	Logger::logInfo("- Packed " + toString(packListing.getEntries().size()) + " entries on \"" + packId + "\" (" + String::prettySize(data.size()) + ").");
+	Logger::logInfo("- Packed " + toString(entries.size()) + " entries on \"" + packId + "\" (" + String::prettySize(pack.getData().size()) + ", from " + String::prettySize(originalSize) + ")" + (encryptionKey.isEmpty() ? "." : ", encrypted."));
 }
@@ -1,5 +1,6 @@
 #include <utility>
 #include "halley/tools/assets/import_assets_database.h"
+#include "halley/tools/assets/import_assets_cache.h"
 #include "halley/tools/project/project.h"
 
 #include "halley/core/api/halley_api.h"
@@ -32,6 +33,7 @@ Project::Project(Path projectRootPath, Path halleyRootPath)
 	importAssetsDatabase = std::make_unique<ImportAssetsDatabase>(getUnpackedAssetsPath(), getUnpackedAssetsPath() / "import.db", getUnpackedAssetsPath() / "assets.db", platforms);
 	codegenDatabase = std::make_unique<ImportAssetsDatabase>(getGenPath(), getGenPath() / "import.db", getGenPath() / "assets.db", std::vector<String>{ "" });
 	sharedCodegenDatabase = std::make_unique<ImportAssetsDatabase>(getSharedGenPath(), getSharedGenPath() / "import.db", getSharedGenPath() / "assets.db", std::vector<String>{ "" });
+	importAssetsCache = std::make_unique<ImportAssetsCache>(getUnpackedAssetsPath() / "import_cache");
 
 	const auto dllPath = getDLLPath();
 	if (!dllPath.isEmpty()) {
@@ -140,6 +142,11 @@ ImportAssetsDatabase& Project::getImportAssetsDatabase() const
 	return *importAssetsDatabase;
 }
 
+ImportAssetsCache& Project::getImportAssetsCache() const
+{
+	return *importAssetsCache;
+}
+
 ImportAssetsDatabase& Project::getCodegenDatabase() const
 {
 	return *codegenDatabase;
@@ -182,11 +189,17 @@ void Project::setAssetPackManifest(const Path& path)
 
 void Project::setDevConServer(DevConServer* server)
 {
+	devConServer = server;
 	addAssetPackReloadCallback([=] (const std::vector<String>& assetIds) {
 		server->reloadAssets(assetIds);
 	});
 }
 
+DevConServer* Project::getDevConServer() const
+{
+	return devConServer;
+}
+
 void Project::addAssetReloadCallback(AssetReloadCallback callback)
 {
 	assetReloadCallbacks.push_back(std::move(callback));